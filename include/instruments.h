@@ -82,6 +82,29 @@ make_strategy(eval_fn_t time_fn, /* return seconds */
               void *strategy_arg,
               void *default_chooser_arg);
 
+/** Function pointer type for vectorized strategy-evaluation callbacks.
+ *  Evaluates a row of 'count' sample tuples in one call, instead of
+ *  one tuple per call: get_estimator_values_vec returns each
+ *  estimator's values, one per tuple, and the callback stores the
+ *  'count' results in 'values', in the same order.
+ *  The other arguments and the requirements are as for eval_fn_t.
+ */
+typedef void (*eval_vec_fn_t)(instruments_context_t, void *, void *,
+                              size_t count, double *values);
+
+/** Same as make_strategy, but with vectorized callbacks.
+ *  Where the evaluation method allows it, the callbacks are called
+ *  once per row of sample tuples, so a simple loop over the rows
+ *  can be vectorized by the compiler.  Otherwise, they're called
+ *  with a count of 1.
+ */
+CDECL instruments_strategy_t
+make_vector_strategy(eval_vec_fn_t time_fn, /* return seconds */
+                     eval_vec_fn_t energy_cost_fn, /* return milliJoules */
+                     eval_vec_fn_t data_cost_fn, /* return bytes */
+                     void *strategy_arg,
+                     void *default_chooser_arg);
+
 /** Create a *redundant* strategy by combining two or more
  *  single-option strategies.
  */
@@ -130,22 +153,210 @@ CDECL instruments_strategy_evaluator_t
 register_strategy_set_with_fns(const char *name, const instruments_strategy_t *strategies, size_t num_strategies,
                                struct instruments_chooser_arg_fns chooser_arg_fns);
 
+struct instruments_chooser_arg_fns_v2 {
+    /* same as in instruments_chooser_arg_fns. */
+    int (*chooser_arg_less)(void *, void *);
+    void * (*copy_chooser_arg)(void *);
+    void (*delete_chooser_arg)(void *);
+
+    /* optional (may be NULL).  If given, the decision cache is a hash table
+     * instead of a tree.  Equivalent chooser_args (neither is less than
+     * the other) must hash to the same value.
+     */
+    size_t (*chooser_arg_hash)(void *);
+};
+
+CDECL instruments_strategy_evaluator_t
+register_strategy_set_with_fns_v2(const char *name, const instruments_strategy_t *strategies, size_t num_strategies,
+                                  struct instruments_chooser_arg_fns_v2 chooser_arg_fns);
+
+/** Set the maximum number of decisions the evaluator caches
+ *  (separately for choose_strategy and choose_nonredundant_strategy).
+ *  When the cache is full, caching a new decision evicts one that hasn't
+ *  been used recently.  0 means unbounded.  The default is 1024.
+ */
+CDECL void set_strategy_evaluator_cache_size(instruments_strategy_evaluator_t evaluator,
+                                             size_t max_entries);
+
+struct instruments_evaluator_stats {
+    unsigned long long cache_hits;
+    unsigned long long cache_misses;
+    unsigned long long cache_evictions;
+    size_t cache_entries;
+
+    /* redundant strategies whose expected time and cost were computed,
+     * and those skipped because their children's costs alone
+     * already exceeded the best singular strategy's time plus cost. */
+    unsigned long long redundant_strategies_evaluated;
+    unsigned long long redundant_strategies_pruned;
+};
+
+/** Get the evaluator's decision cache and pruning counters, accumulated
+ *  since the evaluator was created.
+ */
+CDECL void get_strategy_evaluator_stats(instruments_strategy_evaluator_t evaluator,
+                                        struct instruments_evaluator_stats *stats);
+
 
 CDECL void set_strategy_evaluator_name(instruments_strategy_evaluator_t evaluator, const char * name);
 CDECL const char *get_strategy_evaluator_name(instruments_strategy_evaluator_t evaluator);
 
+/** Set the number of threads used to evaluate strategies in choose_strategy.
+ *
+ *  With more than one thread, the singular strategies are evaluated
+ *  in parallel, then the redundant strategies.  The chosen strategy is
+ *  the same as with serial evaluation.  Evaluation methods that keep
+ *  per-evaluation state ignore this and always evaluate serially.
+ *  The default is 1 (serial evaluation).
+ */
+CDECL void set_strategy_evaluator_threads(instruments_strategy_evaluator_t evaluator, size_t num_threads);
+
+/** Set the number of threads used within one expected-value calculation.
+ *
+ *  With more than one thread, the exhaustive methods split the
+ *  joint error distribution by the first estimator's error samples
+ *  and evaluate the slices in parallel.  The slices' sums are added
+ *  up in a fixed order, so the result doesn't depend on the number of
+ *  threads.  If deterministic is nonzero, the serial calculation
+ *  adds them up the same way, so it matches the parallel calculation
+ *  bit-for-bit; otherwise it keeps a single running sum, which
+ *  can differ in the last few bits.  Clears the evaluator's decision cache.
+ *  This is independent of set_strategy_evaluator_threads; the two
+ *  multiply.  The default is 1 thread, non-deterministic.
+ *  Methods that don't enumerate the error samples ignore this.
+ *  Strategies that depend on more than one estimator are sliced this way
+ *  rather than updated incrementally (see
+ *  set_strategy_evaluator_incremental_updates).
+ */
+CDECL void set_strategy_evaluator_loop_threads(instruments_strategy_evaluator_t evaluator,
+                                               size_t num_threads, int deterministic);
+
+/** Let the exhaustive methods update an expected value in place
+ *  when an estimator only gains an error sample, instead of
+ *  recomputing it over every tuple of samples.
+ *
+ *  This only helps if observations usually leave the estimates fixed,
+ *  e.g. external estimators whose estimates are set apart from their
+ *  observations.  An update is only exact then: the old tuples keep
+ *  their values, so only the tuples with the new sample are evaluated.
+ *  That's a factor of the estimator's sample count fewer evaluations.
+ *  An observation that moves the estimate changes every error-adjusted
+ *  value, so the next expected value is recomputed fully, and the
+ *  running sums kept for the updates (one per strategy, eval fn and
+ *  chooser_arg, compared with chooser_arg_less) are of no use.
+ *  Only the unweighted all-samples methods qualify, and only for
+ *  estimators without conditions; anything else recomputes fully.
+ *  With loop threads or deterministic loops set (see
+ *  set_strategy_evaluator_loop_threads), only strategies that depend
+ *  on a single estimator are updated incrementally.
+ *  After max_updates incremental updates in a row, a value is recomputed
+ *  fully, to keep rounding error from accumulating.
+ *  0 (the default) turns incremental updates off.
+ */
+CDECL void set_strategy_evaluator_incremental_updates(instruments_strategy_evaluator_t evaluator,
+                                                      size_t max_updates);
+
+/** Set a target cost for each expected value the exhaustive methods
+ *  compute: at most max_tuples tuples of error samples, and/or
+ *  at most max_microseconds (0 means no limit for either).
+ *
+ *  To meet it, each estimator's error samples are merged into fewer
+ *  samples of about equal probability, each at its group's mean,
+ *  so that the product of the strategy's estimators' sample counts
+ *  fits.  Estimators whose error-adjusted values are more spread out,
+ *  relative to their mean, keep more samples, since they affect
+ *  the expected values most.  The time limit is converted to tuples
+ *  with the time per tuple measured on strategies that are evaluated
+ *  one tuple at a time, serially, and is applied as of
+ *  the next observation.
+ *
+ *  Stored samples aren't changed; only the ones used to evaluate.
+ *  Since one estimator's observation can change the sample counts
+ *  of the others, each observation clears every cached decision
+ *  while a budget is set.
+ *  The Monte Carlo methods ignore this (see set_strategy_evaluator_sampling),
+ *  as do the IntNW- and remote-exec-specific ones.
+ */
+CDECL void set_strategy_evaluator_evaluation_budget(instruments_strategy_evaluator_t evaluator,
+                                                    size_t max_tuples, double max_microseconds);
+
+/** Set the most centroids that each estimator's error sketch keeps,
+ *  for the quantile-sketch methods (e.g. EMPIRICAL_ERROR_QUANTILE_SKETCH).
+ *  That bounds each estimator's share of the exhaustive loop, however
+ *  many observations there are; more centroids are more accurate.
+ *  Existing sketches are merged down if they're over the new size.
+ *  The default is 50.
+ */
+CDECL void set_strategy_evaluator_sketch_size(instruments_strategy_evaluator_t evaluator,
+                                              size_t max_centroids);
+
+/** Set the number of random draws per expected value, and the seed,
+ *  for evaluation methods that sample the joint error distribution
+ *  (the *-monte-carlo and *-stratified methods).  Evaluation time grows linearly with
+ *  num_samples; the standard error shrinks with its square root.
+ *  The default is 1000 draws.  Clears the evaluator's decision cache.
+ *  Other methods ignore this.
+ */
+CDECL void set_strategy_evaluator_sampling(instruments_strategy_evaluator_t evaluator,
+                                           size_t num_samples, unsigned long seed);
+
 /** Choose and return the best strategy.
+ *
+ *  Safe to call from several threads at once.  Unless the evaluation
+ *  method keeps per-evaluation state (as above), concurrent calls
+ *  proceed in parallel, waiting only for observations and other
+ *  updates to the evaluator, which apply between decisions.
  */
 CDECL instruments_strategy_t
 choose_strategy(instruments_strategy_evaluator_t evaluator, void *chooser_arg);
-/* TODO: add 'excludes' for when a strategy is not possible? 
- *       or else the opposite? 
- *       or maybe a 'disable_strategy' function that prevents
- *       choose_strategy from considering a strategy until
- *       'enable_strategy' is called? 
- * NOTE: this only matters if there are more than two 
- *        'singular' strategies. 
+
+/** Stop the evaluator from considering a strategy (e.g. because its
+ *  network is down) until enable_strategy is called.  Disabling a
+ *  singular strategy also disables every redundant strategy that
+ *  includes it.  If every singular strategy is disabled,
+ *  choose_strategy returns NULL.
+ *
+ *  This is cheap; the evaluator keeps its error distributions and
+ *  saved values, and only forgets the cached decisions that the change
+ *  might affect.  The strategy must be one of those registered with
+ *  the evaluator.
+ */
+CDECL void disable_strategy(instruments_strategy_evaluator_t evaluator,
+                            instruments_strategy_t strategy);
+
+/** Undo disable_strategy. */
+CDECL void enable_strategy(instruments_strategy_evaluator_t evaluator,
+                           instruments_strategy_t strategy);
+
+/** Choose the best strategy for each of a batch of chooser_args.
+ *
+ *  Equivalent to calling choose_strategy(evaluator, chooser_args[i])
+ *  for each i and storing the result in chosen_strategies[i], but
+ *  the evaluation work that doesn't depend on chooser_arg
+ *  (e.g. preparing the error samples and iterating over them)
+ *  is shared across the whole batch.
+ */
+CDECL void
+choose_strategies_batch(instruments_strategy_evaluator_t evaluator, 
+                        void **chooser_args, size_t num_args,
+                        instruments_strategy_t *chosen_strategies);
+
+/** Choose the best strategy, giving up on exhaustive evaluation
+ *  after about max_micros microseconds.
+ *
+ *  With the empirical-error methods, each expected value is computed
+ *  over the joint error distribution's most probable combinations first,
+ *  so if time runs out, the strategy returned is the best one according
+ *  to the most likely part of the distribution.  If confidence is non-NULL,
+ *  it is set to the smallest fraction of probability mass covered by any
+ *  of the expected values compared; 1.0 means the evaluation completed
+ *  and the result is the same as choose_strategy's.
+ *  Incomplete decisions are not cached.
+ *  Other evaluation methods always evaluate completely.
  */
+CDECL instruments_strategy_t
+choose_strategy_with_deadline(instruments_strategy_evaluator_t evaluator, void *chooser_arg,
+                              double max_micros, double *confidence);
 
 /** Choose and return the best nonredundant strategy.
  */
@@ -162,11 +373,21 @@ choose_nonredundant_strategy_ignore_cost(instruments_strategy_evaluator_t evalua
  *  This does not begin a new computation; it merely returns
  *  the last computed completion time for the given strategy.
  *  It should therefore only be called after a call to choose_strategy.
+ *  A redundant strategy that choose_strategy could rule out without
+ *  evaluating it keeps its previous time.
  */
 CDECL double
 get_last_strategy_time(instruments_strategy_evaluator_t evaluator, 
                        instruments_strategy_t strategy);
 
+/** Return the standard error of the last computed completion time
+ *  for the given strategy.  It's 0 unless the evaluation method
+ *  estimates the time by sampling.
+ */
+CDECL double
+get_last_strategy_time_error(instruments_strategy_evaluator_t evaluator, 
+                             instruments_strategy_t strategy);
+
 /* Functions for use in composing one strategy from another. */
 
 /** Given an eval context and a strategy, returns the strategy's completion time. */
@@ -294,6 +515,14 @@ typedef void * instruments_estimator_t;
 CDECL double get_estimator_value(instruments_context_t ctx,
                                  instruments_estimator_t estimator);
 
+/** Vectorized form of get_estimator_value, for eval_vec_fn_t callbacks:
+ *  returns the estimator's values for each of the tuples being evaluated.
+ *  The array belongs to the context; it's only valid until the
+ *  callback returns, and must not be modified.
+ */
+CDECL const double *get_estimator_values_vec(instruments_context_t ctx,
+                                             instruments_estimator_t estimator);
+
 
 /* interface for external estimators */
 
@@ -321,6 +550,17 @@ CDECL void free_external_estimator(instruments_external_estimator_t estimator);
 CDECL void add_observation(instruments_external_estimator_t estimator, 
                            double observation, double new_estimate);
 
+/** Add several observations, to one or more external estimators.
+ *
+ *  Equivalent to calling add_observation(estimators[i], observations[i], 
+ *  new_estimates[i]) for each i in order, except that each strategy
+ *  evaluator using these estimators processes all the observations
+ *  at once and only then invalidates its cached decisions (once).
+ */
+CDECL void add_observations_batch(instruments_external_estimator_t *estimators,
+                                  const double *observations, const double *new_estimates,
+                                  size_t num_observations);
+
 
 /** Set hints for binning estimator values in a histogram.
  *
@@ -338,6 +578,35 @@ CDECL void set_estimator_range_hints(instruments_estimator_t estimator,
  */
 CDECL int estimator_has_range_hints(instruments_estimator_t estimator);
 
+typedef enum {
+    INSTRUMENTS_RETAIN_ALL_SAMPLES,   /* the default: keep every error sample. */
+    INSTRUMENTS_RETAIN_SLIDING_WINDOW,/* keep the newest max_samples. */
+    INSTRUMENTS_RETAIN_RESERVOIR,     /* keep a uniform random max_samples of all seen. */
+    INSTRUMENTS_RETAIN_MAX_AGE,       /* keep samples newer than max_age_seconds. */
+} instruments_sample_retention_t;
+
+/** Bound the error samples kept for this estimator.
+ *
+ *  By default, an unweighted empirical-error evaluator keeps every
+ *  error sample forever, so a long-running process uses more memory
+ *  and takes longer to decide as time goes on.
+ *  With a retention policy, the estimator's error distribution
+ *  keeps at most max_samples of them (if max_samples > 0),
+ *  dropping the oldest (SLIDING_WINDOW), a random one (RESERVOIR),
+ *  or those older than max_age_seconds (MAX_AGE) as new samples arrive.
+ *  0 means no limit for either.
+ *  The policy is saved and restored with the error distribution;
+ *  a restored distribution keeps its saved policy unless this is
+ *  called for its estimator.
+ *
+ *  Applies to the unweighted ALL_SAMPLES distributions; the weighted
+ *  ones already keep a bounded number of samples, and the binned
+ *  and sketched ones take constant space.
+ */
+CDECL void set_estimator_sample_retention(instruments_estimator_t estimator,
+                                          instruments_sample_retention_t policy,
+                                          size_t max_samples, double max_age_seconds);
+
 
 typedef enum {
     INSTRUMENTS_ESTIMATOR_VALUE_AT_LEAST,
@@ -18,6 +18,7 @@ LOCAL_MODULE := instruments
 LOCAL_EXPORT_C_INCLUDES := $(LOCAL_PATH)/../include $(LOCAL_PATH)/../src
 LOCAL_SRC_FILES := $(addprefix ../src/, \
 	abstract_joint_distribution.cc \
+	choice_cache.cc \
 	continuous_distribution.cc \
 	debug.cc \
 	error_calculation.cc \
@@ -32,9 +33,13 @@ LOCAL_SRC_FILES := $(addprefix ../src/, \
 	evaluators/students_t.cc \
 	external_estimator.cc \
 	goal_adaptive_resource_weight.cc \
+	histogram_breaks.cc \
 	instruments.cc \
 	generic_joint_distribution.cc \
+	joint_distributions/combined_loop.cc \
+	joint_distributions/combiner_kernels.cc \
 	joint_distributions/intnw_joint_distribution.cc \
+	joint_distributions/monte_carlo_joint_distribution.cc \
 	joint_distributions/remote_exec_joint_distribution.cc \
 	joint_distributions/optimized_generic_joint_distribution.cc \
 	resource_weights.cc \
@@ -42,6 +47,7 @@ LOCAL_SRC_FILES := $(addprefix ../src/, \
 	stats_distribution.cc \
 	stats_distribution_all_samples.cc \
 	stats_distribution_binned.cc \
+	stats_distribution_t_digest.cc \
 	stopwatch.cc \
 	strategy.cc \
 	strategy_evaluator.cc \
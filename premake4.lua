@@ -3,6 +3,12 @@ solution "Instruments"
   
   includedirs { "./include", "../nested_array" }
 
+  -- the library doesn't need R; only the tests that compare against it do.
+  newoption {
+    trigger = "with-r",
+    description = "Build the unit tests that use R (needs R, Rcpp and RInside)"
+  }
+
   include "src"
   include "tests/unit"
   include "tests/acceptance"
@@ -1,28 +1,114 @@
 #include "abstract_joint_distribution.h"
 
 #include "stats_distribution_all_samples.h"
-#ifndef ANDROID
 #include "stats_distribution_binned.h"
-#endif
+#include "stats_distribution_t_digest.h"
+#include "estimator.h"
+#include "strategy_evaluator.h"
 
 #include <stdlib.h>
 #include <stdexcept>
 
+AbstractJointDistribution::AbstractJointDistribution(StatsDistributionType dist_type_)
+    : dist_type(dist_type_), sketch_size(StatsDistributionTDigest::DEFAULT_MAX_CENTROIDS),
+      chooser_arg_fns(default_chooser_arg_fns)
+{
+}
+
+void
+AbstractJointDistribution::setChooserArgFns(const struct instruments_chooser_arg_fns_v2& fns)
+{
+    chooser_arg_fns = fns;
+}
+
+bool
+AbstractJointDistribution::hasChooserArgComparator()
+{
+    return chooser_arg_fns.chooser_arg_less != default_chooser_arg_fns.chooser_arg_less;
+}
+
+std::shared_ptr<void>
+AbstractJointDistribution::copyChooserArg(void *chooser_arg)
+{
+    return std::shared_ptr<void>(chooser_arg_fns.copy_chooser_arg(chooser_arg),
+                                 chooser_arg_fns.delete_chooser_arg);
+}
+
+bool
+AbstractJointDistribution::chooserArgLess(void *left, void *right)
+{
+    return chooser_arg_fns.chooser_arg_less(left, right);
+}
+
+bool
+AbstractJointDistribution::chooserArgsEqual(void *left, void *right)
+{
+    return !chooserArgLess(left, right) && !chooserArgLess(right, left);
+}
+
 StatsDistribution *
 AbstractJointDistribution::createSamplesDistribution(Estimator *estimator)
 {
     switch (dist_type) {
     case ALL_SAMPLES_WEIGHTED:
         return new StatsDistributionAllSamples(true); // use weighted error method.
-    case ALL_SAMPLES:
-        return new StatsDistributionAllSamples(false);
+    case ALL_SAMPLES: {
+        StatsDistribution *distribution = new StatsDistributionAllSamples(false);
+        applyRetention(estimator, distribution);
+        return distribution;
+    }
     case BINNED:
-#ifdef ANDROID
-        throw std::runtime_error("Binned distribution not yet supported.");
-#else
         return StatsDistributionBinned::create(estimator);
-#endif
+    case QUANTILE_SKETCH:
+        return new StatsDistributionTDigest(sketch_size);
     default:
         abort();
     }
 }
+
+void
+AbstractJointDistribution::setSketchSize(size_t max_centroids)
+{
+    sketch_size = max_centroids;
+}
+
+void
+AbstractJointDistribution::resizeSketch(StatsDistribution *distribution)
+{
+    StatsDistributionTDigest *sketch = dynamic_cast<StatsDistributionTDigest *>(distribution);
+    if (sketch) {
+        sketch->setMaxCentroids(sketch_size);
+    }
+}
+
+void
+AbstractJointDistribution::applyRetention(Estimator *estimator, StatsDistribution *distribution)
+{
+    if (dist_type != ALL_SAMPLES || !estimator || !estimator->hasSampleRetention()) {
+        return;
+    }
+    StatsDistributionAllSamples *samples = dynamic_cast<StatsDistributionAllSamples *>(distribution);
+    if (samples) {
+        samples->setRetention(estimator->getSampleRetention());
+    }
+}
+
+double
+AbstractJointDistribution::expectedValueWithDeadline(Strategy *strategy, typesafe_eval_fn_t fn,
+                                                     void *strategy_arg, void *chooser_arg,
+                                                     std::chrono::steady_clock::time_point deadline,
+                                                     double *coverage)
+{
+    *coverage = 1.0;
+    return expectedValue(strategy, fn, strategy_arg, chooser_arg);
+}
+
+void
+AbstractJointDistribution::expectedValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                          void *strategy_arg, void **chooser_args, size_t num_args,
+                                          double *values)
+{
+    for (size_t i = 0; i < num_args; ++i) {
+        values[i] = expectedValue(strategy, fn, strategy_arg, chooser_args[i]);
+    }
+}
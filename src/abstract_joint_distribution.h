@@ -6,17 +6,91 @@
 #include "strategy_evaluation_context.h"
 
 #include <fstream>
+#include <chrono>
+#include <memory>
 
 class Estimator;
 class StatsDistribution;
 
 class AbstractJointDistribution : public StrategyEvaluationContext {
   public:
-    AbstractJointDistribution(StatsDistributionType dist_type_) : dist_type(dist_type_) {}
+    AbstractJointDistribution(StatsDistributionType dist_type_);
     virtual ~AbstractJointDistribution() {}
 
-    virtual void setEvalArgs(void *strategy_arg_, void *chooser_arg_) = 0;
-    virtual double expectedValue(Strategy *strategy, typesafe_eval_fn_t fn) = 0;
+    virtual double expectedValue(Strategy *strategy, typesafe_eval_fn_t fn,
+                                 void *strategy_arg, void *chooser_arg) = 0;
+
+    // values[i] = expectedValue(strategy, fn, strategy_arg, chooser_args[i]).
+    // override to share work (e.g. sample extraction) across the batch.
+    virtual void expectedValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                void *strategy_arg, void **chooser_args, size_t num_args,
+                                double *values);
+
+    // values[i] = the least value fn takes on any tuple that
+    //  expectedValue(strategy, fn, strategy_arg, chooser_args[i]) weighs.
+    // Override and return true if the tuples can be visited;
+    //  by default there's no such bound.
+    virtual bool minimumValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                               void *strategy_arg, void **chooser_args, size_t num_args,
+                               double *values) { return false; }
+
+    // Override and return true if expectedValue keeps no per-call state
+    //  in the object, so that several strategies can be evaluated at once.
+    // The evaluator calls prepareEvaluation before starting concurrent calls,
+    //  so that any lazily-built state is built exactly once, up front.
+    virtual bool evaluationIsReentrant() { return false; }
+    virtual void prepareEvaluation(void *chooser_arg) {}
+
+    // Override and return true if a strategy's expected value can be reused
+    //  in later decisions without evaluating it again -- i.e. evaluating one
+    //  strategy leaves behind no state that evaluating another depends on.
+    virtual bool strategyValuesAreReusable() { return false; }
+
+    // Override and return false if an observation can change the
+    //  expected values of strategies that don't use its estimator.
+    virtual bool valuesDependOnlyOnStrategyEstimators() { return true; }
+
+    // Like expectedValue, but stops at the deadline and returns the expected
+    //  value over the joint-distribution tuples visited so far, setting
+    //  *coverage to their share of the probability mass (1.0 if complete).
+    // Override if the iteration can be cut short; by default, this always
+    //  evaluates completely.
+    virtual double expectedValueWithDeadline(Strategy *strategy, typesafe_eval_fn_t fn,
+                                             void *strategy_arg, void *chooser_arg,
+                                             std::chrono::steady_clock::time_point deadline,
+                                             double *coverage);
+
+    // for distributions that estimate expected values from random draws:
+    //  how many draws to make, and the seed to start from.
+    virtual void setSampling(size_t num_samples, unsigned long seed) {}
+
+    // for distributions that enumerate the error samples: how many
+    //  threads (including the caller's) one expected value is split
+    //  across, and whether the serial sum should match the parallel one.
+    virtual void setLoopThreads(size_t num_threads, bool deterministic) {}
+
+    // for distributions that enumerate the error samples: how many times
+    //  in a row an expected value may be updated for new samples
+    //  instead of recomputed.  0 means never.
+    virtual void setIncrementalUpdates(size_t max_updates) {}
+
+    // caps the tuples of error samples per expected value, or the
+    //  microseconds per expected value, or both (0 means no cap),
+    //  by giving each estimator fewer, merged samples.
+    virtual void setEvaluationBudget(size_t max_tuples, double max_microseconds) {}
+
+    // for QUANTILE_SKETCH: the most centroids each estimator's sketch
+    //  keeps, i.e. the most error samples it contributes to the loops.
+    //  Override to shrink the existing sketches too (see resizeSketches).
+    virtual void setSketchSize(size_t max_centroids);
+
+    // how the evaluator's chooser_args are copied and compared,
+    //  for distributions that keep state per chooser_arg.
+    void setChooserArgFns(const struct instruments_chooser_arg_fns_v2& fns);
+
+    // standard error of the last expected value computed with fn
+    //  for this strategy.  Exact distributions have none.
+    virtual double getLastStandardError(Strategy *strategy, typesafe_eval_fn_t fn) { return 0.0; }
 
     virtual double getAdjustedEstimatorValue(Estimator *estimator) = 0;
     virtual void processObservation(Estimator *estimator, double observation, 
@@ -27,9 +101,39 @@ class AbstractJointDistribution : public StrategyEvaluationContext {
     virtual void saveToFile(std::ofstream& out) = 0;
     virtual void restoreFromFile(std::ifstream& in) = 0;
   protected:
+    // false if chooser_args are only compared by address, in which case
+    //  the same address may hold a different argument next time.
+    bool hasChooserArgComparator();
+    std::shared_ptr<void> copyChooserArg(void *chooser_arg);
+    bool chooserArgLess(void *left, void *right);
+    bool chooserArgsEqual(void *left, void *right);
+
     StatsDistribution *createSamplesDistribution(Estimator *estimator=NULL);
+
+    // applies sketch_size, if distribution is a sketch.
+    void resizeSketch(StatsDistribution *distribution);
+
+    // for setSketchSize overrides: sets sketch_size and applies it to
+    //  every distribution in the maps, keyed by estimator or by name.
+    template <typename SamplesMap, typename PlaceholderMap>
+    void resizeSketches(size_t max_centroids, SamplesMap& samples, PlaceholderMap& placeholders) {
+        AbstractJointDistribution::setSketchSize(max_centroids);
+        for (auto& p : samples) {
+            resizeSketch(p.second);
+        }
+        for (auto& p : placeholders) {
+            resizeSketch(p.second);
+        }
+    }
+
+    // applies the estimator's sample retention policy, if it has one
+    //  and distribution keeps all samples.  Called before each new sample, so a policy
+    //  set after the distribution was created still takes effect.
+    void applyRetention(Estimator *estimator, StatsDistribution *distribution);
   private:
     StatsDistributionType dist_type;
+    size_t sketch_size;
+    struct instruments_chooser_arg_fns_v2 chooser_arg_fns;
 };
 
 
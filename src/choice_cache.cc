@@ -0,0 +1,388 @@
+#include "choice_cache.h"
+
+#include <math.h>
+
+#include <thread>
+#include <utility>
+#include <algorithm>
+
+using std::mutex; using std::lock_guard;
+using std::shared_ptr; using std::make_shared;
+using std::any_of; using std::none_of;
+
+static size_t this_thread_slot(size_t num_slots)
+{
+    static std::atomic<size_t> next_slot(0);
+    static thread_local size_t slot = next_slot.fetch_add(1);
+    return slot % num_slots;
+}
+
+ChoiceCache::Snapshot::Snapshot(const struct instruments_chooser_arg_fns_v2& fns)
+    : hashed(fns.chooser_arg_hash != NULL),
+      ordered_index(Comparator(fns.chooser_arg_less)),
+      hashed_index(0, Hasher(fns.chooser_arg_hash), KeyEqual(fns.chooser_arg_less)),
+      hand(0)
+{
+}
+
+bool
+ChoiceCache::Snapshot::findSlot(void *chooser_arg, size_t *slot) const
+{
+    if (hashed) {
+        auto it = hashed_index.find(chooser_arg);
+        if (it != hashed_index.end()) {
+            *slot = it->second;
+            return true;
+        }
+    } else {
+        auto it = ordered_index.find(chooser_arg);
+        if (it != ordered_index.end()) {
+            *slot = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
+ChoiceCache::Entry *
+ChoiceCache::Snapshot::find(void *chooser_arg) const
+{
+    size_t slot;
+    if (findSlot(chooser_arg, &slot)) {
+        return clock[slot].get();
+    }
+    return NULL;
+}
+
+void
+ChoiceCache::Snapshot::setIndex(void *chooser_arg, size_t slot)
+{
+    if (hashed) {
+        hashed_index[chooser_arg] = slot;
+    } else {
+        ordered_index[chooser_arg] = slot;
+    }
+}
+
+void
+ChoiceCache::Snapshot::eraseIndex(void *chooser_arg)
+{
+    if (hashed) {
+        hashed_index.erase(chooser_arg);
+    } else {
+        ordered_index.erase(chooser_arg);
+    }
+}
+
+ChoiceCache::ChoiceCache(struct instruments_chooser_arg_fns_v2 chooser_arg_fns_,
+                         size_t max_entries_)
+    : chooser_arg_fns(chooser_arg_fns_), max_entries(max_entries_),
+      cur_generation(0), evictions(0), reader_phase(0)
+{
+    for (auto& phase_counts : reader_counts) {
+        for (auto& reader_count : phase_counts) {
+            reader_count.count = 0;
+        }
+    }
+    for (auto& counts : lookup_counts) {
+        counts.hits = 0;
+        counts.misses = 0;
+    }
+    current = new Snapshot(chooser_arg_fns);
+}
+
+ChoiceCache::~ChoiceCache()
+{
+    delete current.load();
+}
+
+void
+ChoiceCache::setChooserArgFns(struct instruments_chooser_arg_fns_v2 chooser_arg_fns_)
+{
+    lock_guard<mutex> lock(writer_lock);
+    chooser_arg_fns = chooser_arg_fns_;
+    publish(new Snapshot(chooser_arg_fns));
+}
+
+void
+ChoiceCache::setMaxEntries(size_t max_entries_)
+{
+    lock_guard<mutex> lock(writer_lock);
+    max_entries = max_entries_;
+
+    Snapshot *snapshot = current.load();
+    if (max_entries == 0 || snapshot->clock.size() <= max_entries) {
+        return;
+    }
+
+    // keep the entries the clock hand would reach last.
+    Snapshot *new_snapshot = new Snapshot(chooser_arg_fns);
+    size_t num_entries = snapshot->clock.size();
+    for (size_t i = num_entries - max_entries; i < num_entries; ++i) {
+        EntryPtr entry = snapshot->clock[(snapshot->hand + i) % num_entries];
+        new_snapshot->setIndex(entry->chooser_arg.get(), new_snapshot->clock.size());
+        new_snapshot->clock.push_back(entry);
+    }
+    evictions += num_entries - max_entries;
+    publish(new_snapshot);
+}
+
+std::atomic<long>&
+ChoiceCache::beginRead(size_t slot)
+{
+    // the increment must be visible before we load the snapshot pointer,
+    //  so that a writer who misses it knows we'll see its new snapshot.
+    //  Hence the (default) sequentially consistent operations.
+    std::atomic<long>& reader_count = reader_counts[reader_phase.load() & 1][slot].count;
+    reader_count.fetch_add(1);
+    return reader_count;
+}
+
+instruments_strategy_t
+ChoiceCache::lookup(void *chooser_arg)
+{
+    size_t slot = this_thread_slot(NUM_READER_SLOTS);
+    std::atomic<long>& reader_count = beginRead(slot);
+
+    instruments_strategy_t winner = NULL;
+    Entry *entry = current.load()->find(chooser_arg);
+    if (entry && entry->winner) {
+        winner = entry->winner;
+        if (!entry->referenced.load(std::memory_order_relaxed)) {
+            entry->referenced.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    reader_count.fetch_sub(1);
+
+    if (winner) {
+        lookup_counts[slot].hits.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        lookup_counts[slot].misses.fetch_add(1, std::memory_order_relaxed);
+    }
+    return winner;
+}
+
+bool
+ChoiceCache::lookupValues(void *chooser_arg, std::vector<double>& values)
+{
+    std::atomic<long>& reader_count = beginRead(this_thread_slot(NUM_READER_SLOTS));
+
+    bool found = false;
+    Entry *entry = current.load()->find(chooser_arg);
+    if (entry && !entry->values.empty()) {
+        values = entry->values;
+        found = true;
+    }
+
+    reader_count.fetch_sub(1);
+    return found;
+}
+
+unsigned long
+ChoiceCache::generation()
+{
+    return cur_generation.load();
+}
+
+void
+ChoiceCache::insert(void *chooser_arg, instruments_strategy_t winner,
+                    unsigned long generation_,
+                    const std::vector<Estimator *>& dependencies,
+                    const std::vector<double>& values)
+{
+    lock_guard<mutex> lock(writer_lock);
+    if (cur_generation.load() != generation_) {
+        return;
+    }
+
+    Snapshot *new_snapshot = new Snapshot(*current.load());
+    shared_ptr<void> my_copy(chooser_arg_fns.copy_chooser_arg(chooser_arg), 
+                             chooser_arg_fns.delete_chooser_arg);
+    auto entry = make_shared<Entry>(my_copy, winner, dependencies, values);
+
+    size_t slot;
+    if (new_snapshot->findSlot(chooser_arg, &slot)) {
+        replaceEntry(new_snapshot, slot, entry);
+    } else {
+        addEntry(new_snapshot, entry);
+    }
+    publish(new_snapshot);
+}
+
+void
+ChoiceCache::invalidate(Estimator *estimator, const std::vector<size_t>& stale_values)
+{
+    invalidate(std::vector<Estimator *>(1, estimator), stale_values);
+}
+
+void
+ChoiceCache::invalidate(const std::vector<Estimator *>& estimators, 
+                        const std::vector<size_t>& stale_values)
+{
+    invalidateEntries([&estimators](const Entry& entry) {
+            // both sorted.
+            auto dep = entry.dependencies.begin(), dep_end = entry.dependencies.end();
+            auto est = estimators.begin(), est_end = estimators.end();
+            while (dep != dep_end && est != est_end) {
+                if (*dep < *est) {
+                    ++dep;
+                } else if (*est < *dep) {
+                    ++est;
+                } else {
+                    return true;
+                }
+            }
+            return false;
+        }, stale_values);
+}
+
+void
+ChoiceCache::invalidateWinners(std::function<bool(instruments_strategy_t)> affected)
+{
+    invalidateEntries([&affected](const Entry& entry) {
+            return entry.winner && affected(entry.winner);
+        }, std::vector<size_t>());
+}
+
+void
+ChoiceCache::invalidateEntries(std::function<bool(const Entry&)> affected,
+                               const std::vector<size_t>& stale_values)
+{
+    lock_guard<mutex> lock(writer_lock);
+    cur_generation.fetch_add(1);
+
+    auto is_affected = [&affected](const EntryPtr& entry) {
+        return affected(*entry);
+    };
+
+    Snapshot *snapshot = current.load();
+    if (none_of(snapshot->clock.begin(), snapshot->clock.end(), is_affected)) {
+        return;
+    }
+
+    Snapshot *new_snapshot = new Snapshot(*snapshot);
+    size_t slot = 0;
+    while (slot < new_snapshot->clock.size()) {
+        EntryPtr entry = new_snapshot->clock[slot];
+        if (!is_affected(entry)) {
+            ++slot;
+            continue;
+        }
+
+        std::vector<double> values = entry->values;
+        for (size_t i : stale_values) {
+            if (i < values.size()) {
+                values[i] = NAN;
+            }
+        }
+
+        if (any_of(values.begin(), values.end(), [](double v) { return !isnan(v); })) {
+            replaceEntry(new_snapshot, slot, 
+                         make_shared<Entry>(entry->chooser_arg, (instruments_strategy_t) NULL,
+                                            entry->dependencies, values));
+            ++slot;
+        } else {
+            // moves the last entry into this slot, so don't advance.
+            removeEntry(new_snapshot, slot);
+        }
+    }
+    publish(new_snapshot);
+}
+
+void
+ChoiceCache::replaceEntry(Snapshot *snapshot, size_t slot, EntryPtr entry)
+{
+    // replace rather than update the entry; older snapshots still refer to it.
+    snapshot->eraseIndex(snapshot->clock[slot]->chooser_arg.get());
+    snapshot->clock[slot] = entry;
+    snapshot->setIndex(entry->chooser_arg.get(), slot);
+}
+
+void
+ChoiceCache::removeEntry(Snapshot *snapshot, size_t slot)
+{
+    auto& clock = snapshot->clock;
+    snapshot->eraseIndex(clock[slot]->chooser_arg.get());
+    if (slot != clock.size() - 1) {
+        clock[slot] = clock.back();
+        snapshot->setIndex(clock[slot]->chooser_arg.get(), slot);
+    }
+    clock.pop_back();
+    if (snapshot->hand >= clock.size()) {
+        snapshot->hand = 0;
+    }
+}
+
+void
+ChoiceCache::addEntry(Snapshot *snapshot, EntryPtr entry)
+{
+    auto& clock = snapshot->clock;
+    if (max_entries == 0 || clock.size() < max_entries) {
+        snapshot->setIndex(entry->chooser_arg.get(), clock.size());
+        clock.push_back(entry);
+        return;
+    }
+
+    // one sweep unmarks everything, but concurrent hits can re-mark
+    //  entries behind the hand, so give up after two.
+    for (size_t i = 0; i < 2 * clock.size(); ++i) {
+        if (!clock[snapshot->hand]->referenced.exchange(false)) {
+            break;
+        }
+        snapshot->hand = (snapshot->hand + 1) % clock.size();
+    }
+    size_t slot = snapshot->hand;
+    replaceEntry(snapshot, slot, entry);
+    snapshot->hand = (slot + 1) % clock.size();
+    ++evictions;
+}
+
+void
+ChoiceCache::clear()
+{
+    lock_guard<mutex> lock(writer_lock);
+    cur_generation.fetch_add(1);
+    publish(new Snapshot(chooser_arg_fns));
+}
+
+ChoiceCache::Stats
+ChoiceCache::getStats()
+{
+    Stats stats;
+    stats.hits = 0;
+    stats.misses = 0;
+    for (auto& counts : lookup_counts) {
+        stats.hits += counts.hits.load(std::memory_order_relaxed);
+        stats.misses += counts.misses.load(std::memory_order_relaxed);
+    }
+    stats.evictions = evictions.load();
+
+    lock_guard<mutex> lock(writer_lock);
+    stats.entries = current.load()->clock.size();
+    return stats;
+}
+
+void
+ChoiceCache::publish(Snapshot *new_snapshot)
+{
+    Snapshot *old_snapshot = current.exchange(new_snapshot);
+    waitForReaders();
+    delete old_snapshot;
+}
+
+void
+ChoiceCache::waitForReaders()
+{
+    // any reader not yet counted will load the new snapshot, but a reader
+    //  that read the phase before an earlier flip may be counted in either
+    //  phase, so drain both, steering new readers away from each in turn.
+    for (int i = 0; i < 2; ++i) {
+        size_t old_phase = reader_phase.fetch_add(1) & 1;
+        for (auto& reader_count : reader_counts[old_phase]) {
+            while (reader_count.count.load() != 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
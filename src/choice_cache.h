@@ -0,0 +1,193 @@
+#ifndef CHOICE_CACHE_H_INCL
+#define CHOICE_CACHE_H_INCL
+
+#include "instruments.h"
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <functional>
+
+class Estimator;
+
+/* Bounded cache of strategy decisions, keyed by chooser_arg.
+ *
+ * Lookups take no locks.  The cache contents are an immutable snapshot
+ * that writers replace wholesale (copy-on-write, under a writer mutex).
+ * A replaced snapshot is freed once every reader that might still be
+ * looking at it has finished (an RCU-style grace period), so readers
+ * never block; only writers wait, and only for lookups already in flight.
+ *
+ * That makes inserts O(n), but an insert follows a full strategy
+ * evaluation, which costs far more than copying the map.
+ *
+ * When the cache is full, an insert evicts an entry chosen by CLOCK:
+ * a hit marks its entry referenced, and the clock hand skips (and unmarks)
+ * referenced entries.  If the chooser_arg fns include a hash function,
+ * entries are indexed by hash instead of by chooser_arg_less.
+ *
+ * Each entry also records the estimators its decision depended on,
+ * and optionally a table of values (opaque to the cache; NaN means unknown)
+ * that the evaluator can reuse when it next decides for the same chooser_arg.
+ * invalidate() drops the decisions that depended on a changed estimator
+ * but keeps their entries' still-valid values; invalidateWinners() drops
+ * decisions by their chosen strategy, keeping all the values.
+ */
+class ChoiceCache {
+  public:
+    static const size_t DEFAULT_MAX_ENTRIES = 1024;
+
+    ChoiceCache(struct instruments_chooser_arg_fns_v2 chooser_arg_fns_,
+                size_t max_entries_=DEFAULT_MAX_ENTRIES);
+    ~ChoiceCache();
+
+    // must not be called while the cache is in use.  Clears the cache.
+    void setChooserArgFns(struct instruments_chooser_arg_fns_v2 chooser_arg_fns_);
+
+    // 0 means unbounded.  Shrinking the cache evicts entries as needed.
+    void setMaxEntries(size_t max_entries_);
+
+    // returns NULL if there's no cached decision for this chooser_arg.
+    instruments_strategy_t lookup(void *chooser_arg);
+
+    // returns false if there are no saved values for this chooser_arg.
+    bool lookupValues(void *chooser_arg, std::vector<double>& values);
+
+    // bumped by every clear() and invalidate().  Read it before evaluating
+    //  a strategy and pass it back to insert, so that a decision based on
+    //  since-invalidated estimates doesn't get cached.
+    unsigned long generation();
+
+    // stores a copy of chooser_arg (made with copy_chooser_arg).
+    // does nothing if the cache has been cleared since generation_.
+    // dependencies must be sorted.
+    void insert(void *chooser_arg, instruments_strategy_t winner,
+                unsigned long generation_,
+                const std::vector<Estimator *>& dependencies=std::vector<Estimator *>(),
+                const std::vector<double>& values=std::vector<double>());
+
+    // forgets the decisions that depended on estimator, and sets
+    //  the given values of those entries to NaN.
+    void invalidate(Estimator *estimator, const std::vector<size_t>& stale_values);
+    // same, for the decisions that depended on any of these (sorted) estimators.
+    void invalidate(const std::vector<Estimator *>& estimators, 
+                    const std::vector<size_t>& stale_values);
+
+    // forgets the decisions whose winner satisfies affected.
+    void invalidateWinners(std::function<bool(instruments_strategy_t)> affected);
+    void clear();
+
+    struct Stats {
+        unsigned long long hits;
+        unsigned long long misses;
+        unsigned long long evictions;
+        size_t entries;
+    };
+    Stats getStats();
+
+  private:
+    struct Entry {
+        // our own copy; shared with the entry this one replaces, if any.
+        std::shared_ptr<void> chooser_arg;
+        instruments_strategy_t winner; // NULL if invalidated
+        std::vector<Estimator *> dependencies;
+        std::vector<double> values;
+        std::atomic<bool> referenced;
+
+        Entry(std::shared_ptr<void> chooser_arg_, instruments_strategy_t winner_,
+              const std::vector<Estimator *>& dependencies_,
+              const std::vector<double>& values_)
+            : chooser_arg(chooser_arg_), winner(winner_), 
+              dependencies(dependencies_), values(values_), referenced(false) {}
+    };
+    typedef std::shared_ptr<Entry> EntryPtr;
+
+    class Comparator {
+      public:
+        Comparator(int (*less_)(void *, void *)) : less(less_) {}
+        bool operator()(void *left, void *right) const { return less(left, right); }
+      private:
+        int (*less)(void *, void *);
+    };
+    class Hasher {
+      public:
+        Hasher(size_t (*hash_)(void *)) : hash(hash_) {}
+        size_t operator()(void *arg) const { return hash(arg); }
+      private:
+        size_t (*hash)(void *);
+    };
+    class KeyEqual {
+      public:
+        KeyEqual(int (*less_)(void *, void *)) : less(less_) {}
+        bool operator()(void *left, void *right) const {
+            return !less(left, right) && !less(right, left);
+        }
+      private:
+        int (*less)(void *, void *);
+    };
+
+    // The index maps each chooser_arg to its slot on the clock.
+    //  Entries are shared between successive snapshots.
+    struct Snapshot {
+        Snapshot(const struct instruments_chooser_arg_fns_v2& fns);
+
+        bool hashed;
+        std::map<void *, size_t, Comparator> ordered_index;
+        std::unordered_map<void *, size_t, Hasher, KeyEqual> hashed_index;
+        std::vector<EntryPtr> clock;
+        size_t hand;
+
+        Entry *find(void *chooser_arg) const;
+        bool findSlot(void *chooser_arg, size_t *slot) const;
+        void setIndex(void *chooser_arg, size_t slot);
+        void eraseIndex(void *chooser_arg);
+    };
+
+    struct instruments_chooser_arg_fns_v2 chooser_arg_fns;
+    size_t max_entries;
+
+    std::atomic<Snapshot *> current;
+    std::atomic<unsigned long> cur_generation;
+    std::atomic<unsigned long long> evictions;
+    std::mutex writer_lock;
+
+    // readers announce themselves in one of two phases; a writer publishes
+    //  a new snapshot, flips the phase, and waits for the old phase to drain.
+    //  New readers land in the new phase, so the writer can't be starved.
+    //  Counts are padded out to separate cache lines to keep readers
+    //  from contending on one; so are the hit/miss counts.
+    //  (Padded rather than aligned, since the evaluators that contain
+    //  these are allocated with plain new.)
+    static const size_t NUM_READER_SLOTS = 16;
+    static const size_t CACHE_LINE_SIZE = 64;
+    struct ReaderCount {
+        std::atomic<long> count;
+        char padding[CACHE_LINE_SIZE - sizeof(std::atomic<long>)];
+    };
+    ReaderCount reader_counts[2][NUM_READER_SLOTS];
+    std::atomic<size_t> reader_phase;
+
+    struct LookupCounts {
+        std::atomic<unsigned long long> hits;
+        std::atomic<unsigned long long> misses;
+        char padding[CACHE_LINE_SIZE - 2 * sizeof(std::atomic<unsigned long long>)];
+    };
+    LookupCounts lookup_counts[NUM_READER_SLOTS];
+
+    // returns the count to decrement when done reading.
+    std::atomic<long>& beginRead(size_t slot);
+
+    // must be holding writer_lock.
+    void addEntry(Snapshot *snapshot, EntryPtr entry);
+    void replaceEntry(Snapshot *snapshot, size_t slot, EntryPtr entry);
+    void removeEntry(Snapshot *snapshot, size_t slot);
+    void invalidateEntries(std::function<bool(const Entry&)> affected,
+                           const std::vector<size_t>& stale_values);
+    void publish(Snapshot *new_snapshot);
+    void waitForReaders();
+};
+
+#endif
@@ -5,7 +5,8 @@
 #include <assert.h>
 
 #include <deque>
-using std::deque;
+#include <vector>
+using std::deque; using std::vector;
 
 static const double MIN_SIZE_THRESHOLD = 0.01;
 
@@ -39,6 +40,7 @@ double instruments::calculate_weighted_probability(size_t num_samples, double we
 }
 
 static deque<double> normalizers;
+static vector<vector<double> > weighted_probabilities;
 
 static struct StaticIniter {
     StaticIniter() {
@@ -51,6 +53,14 @@ static struct StaticIniter {
                 normalizers[i] += instruments::calculate_weighted_probability(i, weight);
             }
         }
+
+        weighted_probabilities.resize(instruments::MAX_SAMPLES + 1);
+        for (size_t i = 1; i < weighted_probabilities.size(); ++i) {
+            for (size_t j = 0; j < i; ++j) {
+                double weight = instruments::calculate_normalized_sample_weight(j, i);
+                weighted_probabilities[i].push_back(instruments::calculate_weighted_probability(i, weight));
+            }
+        }
     }
 } initer;
 
@@ -61,3 +71,10 @@ double instruments::calculate_normalized_sample_weight(size_t sample_index, size
     assert(num_samples < normalizers.size());
     return calculate_sample_weight(sample_index, num_samples) / normalizers[num_samples];
 }
+
+const double *instruments::get_weighted_sample_probabilities(size_t num_samples)
+{
+    assert(num_samples > 0);
+    assert(num_samples < weighted_probabilities.size());
+    return &weighted_probabilities[num_samples][0];
+}
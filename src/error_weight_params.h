@@ -11,6 +11,10 @@ namespace instruments {
     double calculate_sample_weight(size_t sample_index, size_t num_samples);
     double calculate_weighted_probability(size_t num_samples, double weight);
     double calculate_normalized_sample_weight(size_t sample_index, size_t num_samples);
+
+    // the weighted probability of each of num_samples samples, oldest first;
+    //  precomputed for every num_samples up to MAX_SAMPLES.
+    const double *get_weighted_sample_probabilities(size_t num_samples);
 }
 
 #endif
@@ -13,8 +13,11 @@ namespace inst = instruments;
 #include <stdexcept>
 #include <string>
 #include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
 using std::runtime_error; using std::string;
-using std::ostringstream;
+using std::ostringstream; using std::vector; using std::map;
 
 Estimator *
 Estimator::create(string name)
@@ -41,7 +44,7 @@ Estimator::create(EstimatorType type, string name)
 }
 
 Estimator::Estimator(const string& name_)
-    : name(name_), has_estimate(false), has_range_hints(false)
+    : name(name_), has_estimate(false), has_range_hints(false), has_sample_retention(false)
 {
     if (name.empty()) {
         throw runtime_error("Estimator name must not be empty");
@@ -85,26 +88,66 @@ Estimator::getEstimate()
 }
 
 
+EstimatorObservation
+Estimator::recordObservation(double observation)
+{
+    EstimatorObservation record = { this, observation, invalid_estimate(), invalid_estimate() };
+
+    PthreadScopedLock guard(&estimator_mutex);
+    if (has_estimate) {
+        record.old_estimate = getEstimateLocked();
+    }
+    storeNewObservation(observation);
+    has_estimate = true;
+    record.new_estimate = getEstimateLocked();
+    return record;
+}
+
 void
 Estimator::addObservation(double observation)
 {
-    double old_estimate = invalid_estimate(), new_estimate = invalid_estimate();
-    {
-        PthreadScopedLock guard(&estimator_mutex);
-        if (has_estimate) {
-            old_estimate = getEstimateLocked();
-        }
-        storeNewObservation(observation);
-        has_estimate = true;
-        new_estimate = getEstimateLocked();
-    }
+    EstimatorObservation record = recordObservation(observation);
     
     {
         PthreadScopedLock guard(&subscribers_mutex);
         for (StrategyEvaluator *subscriber : subscribers) {
-            subscriber->observationAdded(this, observation, old_estimate, new_estimate);
+            subscriber->observationAdded(this, observation, 
+                                         record.old_estimate, record.new_estimate);
+        }
+    }
+}
+
+void
+Estimator::notifyObservations(const vector<EstimatorObservation>& observations)
+{
+    vector<Estimator *> estimators;
+    for (const EstimatorObservation& record : observations) {
+        estimators.push_back(record.estimator);
+    }
+    std::sort(estimators.begin(), estimators.end());
+    estimators.erase(std::unique(estimators.begin(), estimators.end()), estimators.end());
+
+    // hold all the subscriber sets still (so no subscriber goes away)
+    //  until everyone's been notified.  Lock in address order, so that
+    //  concurrent batches can't deadlock.
+    for (Estimator *estimator : estimators) {
+        pthread_mutex_lock(&estimator->subscribers_mutex);
+    }
+
+    // each subscriber sees its estimators' observations in their original order.
+    map<StrategyEvaluator *, vector<EstimatorObservation> > subscriber_observations;
+    for (const EstimatorObservation& record : observations) {
+        for (StrategyEvaluator *subscriber : record.estimator->subscribers) {
+            subscriber_observations[subscriber].push_back(record);
         }
     }
+    for (auto& p : subscriber_observations) {
+        p.first->observationsAdded(p.second);
+    }
+
+    for (Estimator *estimator : estimators) {
+        pthread_mutex_unlock(&estimator->subscribers_mutex);
+    }
 }
 
 bool
@@ -164,6 +207,28 @@ Estimator::setRangeHints(double min, double max, size_t num_bins)
     has_range_hints = true;
 }
 
+bool
+Estimator::hasSampleRetention()
+{
+    PthreadScopedLock guard(&estimator_mutex);
+    return has_sample_retention;
+}
+
+SampleRetention
+Estimator::getSampleRetention()
+{
+    PthreadScopedLock guard(&estimator_mutex);
+    return sample_retention;
+}
+
+void
+Estimator::setSampleRetention(const SampleRetention& retention)
+{
+    PthreadScopedLock guard(&estimator_mutex);
+    sample_retention = retention;
+    has_sample_retention = true;
+}
+
 void
 Estimator::setCondition(enum ConditionType type, double value)
 {
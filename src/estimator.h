@@ -3,13 +3,24 @@
 
 #include "instruments.h"
 #include "estimator_range_hints.h"
+#include "sample_retention.h"
 #include "estimator_type.h"
 #include "small_set.h"
 
 #include <string>
 #include <map>
+#include <vector>
 
 class StrategyEvaluator;
+class Estimator;
+
+// an observation that has been added to its estimator.
+struct EstimatorObservation {
+    Estimator *estimator;
+    double observation;
+    double old_estimate;
+    double new_estimate;
+};
 
 enum ConditionType {
     AT_LEAST = INSTRUMENTS_ESTIMATOR_VALUE_AT_LEAST,
@@ -30,6 +41,10 @@ class Estimator {
     static Estimator *create(EstimatorType type, std::string name);
     
     void addObservation(double value);
+
+    // lets each subscriber of these estimators know about all of
+    //  their (already recorded) observations at once.
+    static void notifyObservations(const std::vector<EstimatorObservation>& observations);
     
     void subscribe(StrategyEvaluator *subscriber);
     void unsubscribe(StrategyEvaluator *unsubscriber);
@@ -44,6 +59,12 @@ class Estimator {
     EstimatorRangeHints getRangeHints();
     void setRangeHints(double min, double max, size_t num_bins);
 
+    // which of this estimator's error samples the distributions keep.
+    //  Without one, a restored distribution keeps its saved policy.
+    bool hasSampleRetention();
+    SampleRetention getSampleRetention();
+    void setSampleRetention(const SampleRetention& retention);
+
     // used to set conditional probability bounds on the value of an estimator
     //   that can be used during strategy evaluation.
     // for instance, if I know the current wifi session is at least
@@ -73,6 +94,9 @@ class Estimator {
   protected:
     Estimator(const std::string& name_);
 
+    // updates the estimate without notifying the subscribers.
+    EstimatorObservation recordObservation(double value);
+
     /* override to get estimates from addObservation. */
     virtual void storeNewObservation(double value) = 0;
     virtual double getEstimateLocked() = 0;
@@ -91,6 +115,9 @@ class Estimator {
     bool has_range_hints;
     EstimatorRangeHints range_hints;
 
+    bool has_sample_retention;
+    SampleRetention sample_retention;
+
     std::map<enum ConditionType, double> conditions;
 
     bool hasConditionsLocked();
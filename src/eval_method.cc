@@ -30,10 +30,16 @@ static NameMap::value_type names_initializer[] = {
     NameMap::value_type(EMPIRICAL_ERROR_ALL_SAMPLES, "ee-all-samples"),
     NameMap::value_type(EMPIRICAL_ERROR_ALL_SAMPLES_WEIGHTED, "ee-as-weighted"),
     NameMap::value_type(EMPIRICAL_ERROR_BINNED, "ee-binned"),
+    NameMap::value_type(EMPIRICAL_ERROR_QUANTILE_SKETCH, "ee-quantile-sketch"),
     NameMap::value_type(EMPIRICAL_ERROR_ALL_SAMPLES_INTNW, "ee-as-intnw"),
     NameMap::value_type(EMPIRICAL_ERROR_ALL_SAMPLES_WEIGHTED_INTNW, "ee-as-weighted-intnw"),
     NameMap::value_type(EMPIRICAL_ERROR_BINNED_INTNW, "ee-binned-intnw"),
     NameMap::value_type(EMPIRICAL_ERROR_ALL_SAMPLES_WEIGHTED_INTNW, "ee-as-weighted-remote-exec"),
+    NameMap::value_type(EMPIRICAL_ERROR_ALL_SAMPLES_MONTE_CARLO, "ee-as-monte-carlo"),
+    NameMap::value_type(EMPIRICAL_ERROR_BINNED_MONTE_CARLO, "ee-binned-monte-carlo"),
+    NameMap::value_type(EMPIRICAL_ERROR_ALL_SAMPLES_QUASI_MONTE_CARLO, "ee-as-quasi-monte-carlo"),
+    NameMap::value_type(EMPIRICAL_ERROR_ALL_SAMPLES_STRATIFIED, "ee-as-stratified"),
+    NameMap::value_type(EMPIRICAL_ERROR_QUANTILE_SKETCH_INTNW, "ee-qs-intnw"),
 };
 
 static NameMap names(names_initializer, 
@@ -11,12 +11,16 @@ CDECL enum StatsDistributionType {
     ALL_SAMPLES = 0x0, // default
     ALL_SAMPLES_WEIGHTED = 0x1,
     BINNED      = 0x2,
+    QUANTILE_SKETCH = 0x3, // bounded number of centroids (t-digest)
 };
 
 CDECL enum JointDistributionType {
     GENERIC_JOINT_DISTRIBUTION = 0x00, // default
     INTNW_JOINT_DISTRIBUTION = 0x10,
-    REMOTE_EXEC_JOINT_DISTRIBUTION = 0x20
+    REMOTE_EXEC_JOINT_DISTRIBUTION = 0x20,
+    MONTE_CARLO_JOINT_DISTRIBUTION = 0x30,  // random draws instead of all tuples
+    QUASI_MONTE_CARLO_JOINT_DISTRIBUTION = 0x40, // low-discrepancy draws
+    STRATIFIED_JOINT_DISTRIBUTION = 0x50 // Latin hypercube draws
 };
 
 #ifdef __cplusplus
@@ -39,6 +43,7 @@ CDECL enum EvalMethod {
     EMPIRICAL_ERROR_ALL_SAMPLES=(EMPIRICAL_ERROR | ALL_SAMPLES),
     EMPIRICAL_ERROR_ALL_SAMPLES_WEIGHTED=(EMPIRICAL_ERROR | ALL_SAMPLES_WEIGHTED),
     EMPIRICAL_ERROR_BINNED=(EMPIRICAL_ERROR | BINNED),
+    EMPIRICAL_ERROR_QUANTILE_SKETCH=(EMPIRICAL_ERROR | QUANTILE_SKETCH),
     EMPIRICAL_ERROR_ALL_SAMPLES_INTNW=(EMPIRICAL_ERROR_ALL_SAMPLES | 
                                        INTNW_JOINT_DISTRIBUTION),
     EMPIRICAL_ERROR_ALL_SAMPLES_WEIGHTED_INTNW=(EMPIRICAL_ERROR_ALL_SAMPLES_WEIGHTED |
@@ -47,6 +52,16 @@ CDECL enum EvalMethod {
                                   INTNW_JOINT_DISTRIBUTION),
     EMPIRICAL_ERROR_ALL_SAMPLES_WEIGHTED_REMOTE_EXEC=(EMPIRICAL_ERROR_ALL_SAMPLES_WEIGHTED |
                                                       REMOTE_EXEC_JOINT_DISTRIBUTION),
+    EMPIRICAL_ERROR_ALL_SAMPLES_MONTE_CARLO=(EMPIRICAL_ERROR_ALL_SAMPLES |
+                                             MONTE_CARLO_JOINT_DISTRIBUTION),
+    EMPIRICAL_ERROR_BINNED_MONTE_CARLO=(EMPIRICAL_ERROR_BINNED |
+                                        MONTE_CARLO_JOINT_DISTRIBUTION),
+    EMPIRICAL_ERROR_ALL_SAMPLES_QUASI_MONTE_CARLO=(EMPIRICAL_ERROR_ALL_SAMPLES |
+                                                   QUASI_MONTE_CARLO_JOINT_DISTRIBUTION),
+    EMPIRICAL_ERROR_ALL_SAMPLES_STRATIFIED=(EMPIRICAL_ERROR_ALL_SAMPLES |
+                                            STRATIFIED_JOINT_DISTRIBUTION),
+    EMPIRICAL_ERROR_QUANTILE_SKETCH_INTNW=(EMPIRICAL_ERROR_QUANTILE_SKETCH |
+                                           INTNW_JOINT_DISTRIBUTION),
 };
 
 CDECL const char *
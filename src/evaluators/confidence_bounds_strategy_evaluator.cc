@@ -541,7 +541,7 @@ static int CENTER_OF_BOUNDS = -1;
 
 ConfidenceBoundsStrategyEvaluator::ConfidenceBoundsStrategyEvaluator(bool weighted_)
     : eval_mode(DEFAULT_EVAL_MODE), // TODO: set as option?
-      step(CENTER_OF_BOUNDS), last_chooser_arg(NULL), weighted(weighted_)
+      last_chooser_arg(NULL), weighted(weighted_)
 {
 }
 
@@ -631,6 +631,19 @@ ConfidenceBoundsStrategyEvaluator::expectedValue(Strategy *strategy, typesafe_ev
 
 typedef const double& (*bound_fn_t)(const double&, const double&);
 
+class ConfidenceBoundsStrategyEvaluator::BoundsStep : public StrategyEvaluationContext {
+  public:
+    BoundsStep(ConfidenceBoundsStrategyEvaluator *evaluator_, int step_)
+        : evaluator(evaluator_), step(step_) {}
+
+    virtual double getAdjustedEstimatorValue(Estimator *estimator) {
+        return evaluator->getAdjustedEstimatorValue(estimator, step);
+    }
+
+    ConfidenceBoundsStrategyEvaluator *evaluator;
+    int step;
+};
+
 double
 ConfidenceBoundsStrategyEvaluator::evaluateBounded(BoundType bound_type, typesafe_eval_fn_t fn,
                                                    void *strategy_arg, void *chooser_arg)
@@ -639,8 +652,8 @@ ConfidenceBoundsStrategyEvaluator::evaluateBounded(BoundType bound_type, typesaf
     setConditionalBounds();
 
     if (bound_type == CENTER) {
-        step = CENTER_OF_BOUNDS;
-        val = fn(this, strategy_arg, chooser_arg);
+        BoundsStep center(this, CENTER_OF_BOUNDS);
+        val = fn(&center, strategy_arg, chooser_arg);
         inst::dbgprintf(inst::DEBUG, "Used center of bounds; value is %f\n", val);
     } else {
         bound_fn_t bound_fns[UPPER + 1] = { &std::min<double>, &std::max<double> };
@@ -655,8 +668,9 @@ ConfidenceBoundsStrategyEvaluator::evaluateBounded(BoundType bound_type, typesaf
         val = bound_init_fn(0.0, std::numeric_limits<double>::max());
         ostringstream s;
         bool debugging = inst::is_debugging_on(inst::DEBUG);
-        for (step = 0; step < finish; ++step) {
-            double cur_val = fn(this, strategy_arg, chooser_arg);
+        BoundsStep corner(this, 0);
+        for (corner.step = 0; corner.step < finish; ++corner.step) {
+            double cur_val = fn(&corner, strategy_arg, chooser_arg);
             val = bound_fn(val, cur_val);
             if (debugging) {
                 s << cur_val << " ";
@@ -689,6 +703,12 @@ ConfidenceBoundsStrategyEvaluator::clearConditionalBounds()
 
 double
 ConfidenceBoundsStrategyEvaluator::getAdjustedEstimatorValue(Estimator *estimator)
+{
+    return getAdjustedEstimatorValue(estimator, CENTER_OF_BOUNDS);
+}
+
+double
+ConfidenceBoundsStrategyEvaluator::getAdjustedEstimatorValue(Estimator *estimator, int step)
 {
     // use the low bits of step as selectors for the array of bounds
     //  (i.e. 0 bit = LOWER, 1 bit = UPPER)
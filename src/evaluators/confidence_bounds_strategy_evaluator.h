@@ -39,7 +39,11 @@ class ConfidenceBoundsStrategyEvaluator : public StrategyEvaluator {
     EvalMode eval_mode;
     static EvalMode DEFAULT_EVAL_MODE;
 
-    int step;
+    // each evaluation of the eval fn picks a bound for each estimator;
+    //  the step says which (see getAdjustedEstimatorValue).
+    class BoundsStep;
+    double getAdjustedEstimatorValue(Estimator *estimator, int step);
+
     class ErrorConfidenceBounds;
     std::vector<ErrorConfidenceBounds *> error_bounds;
     std::map<Estimator *, ErrorConfidenceBounds *> bounds_by_estimator;
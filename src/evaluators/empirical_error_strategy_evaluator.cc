@@ -20,10 +20,20 @@ using std::ostringstream;
 #include "joint_distributions/intnw_joint_distribution.h"
 #include "joint_distributions/remote_exec_joint_distribution.h"
 #include "joint_distributions/optimized_generic_joint_distribution.h"
+#include "joint_distributions/monte_carlo_joint_distribution.h"
+#include "stats_distribution_t_digest.h"
 
 EmpiricalErrorStrategyEvaluator::EmpiricalErrorStrategyEvaluator(EvalMethod method)
 {
     jointDistribution = NULL;
+    num_samples = MonteCarloJointDistribution::DEFAULT_NUM_SAMPLES;
+    seed = MonteCarloJointDistribution::DEFAULT_SEED;
+    loop_threads = 1;
+    deterministic_loops = false;
+    max_incremental_updates = 0;
+    sketch_size = StatsDistributionTDigest::DEFAULT_MAX_CENTROIDS;
+    max_tuples = 0;
+    max_microseconds = 0.0;
     dist_type = StatsDistributionType(method & STATS_DISTRIBUTION_TYPE_MASK);
     joint_distribution_type = JointDistributionType(method & JOINT_DISTRIBUTION_TYPE_MASK);
 }
@@ -43,6 +53,12 @@ EmpiricalErrorStrategyEvaluator::setStrategies(const instruments_strategy_t *str
     delete jointDistribution;
 
     jointDistribution = createJointDistribution(joint_distribution_type);
+    jointDistribution->setChooserArgFns(getChooserArgFns());
+    jointDistribution->setSampling(num_samples, seed);
+    jointDistribution->setLoopThreads(loop_threads, deterministic_loops);
+    jointDistribution->setIncrementalUpdates(max_incremental_updates);
+    jointDistribution->setSketchSize(sketch_size);
+    jointDistribution->setEvaluationBudget(max_tuples, max_microseconds);
 }
 
 AbstractJointDistribution *
@@ -57,6 +73,14 @@ EmpiricalErrorStrategyEvaluator::createJointDistribution(JointDistributionType j
     } else if (joint_distribution_type == GENERIC_JOINT_DISTRIBUTION) {
         //return new GenericJointDistribution(dist_type, strategies);
         return new OptimizedGenericJointDistribution(dist_type, strategies);
+    } else if (joint_distribution_type == MONTE_CARLO_JOINT_DISTRIBUTION) {
+        return new MonteCarloJointDistribution(dist_type, strategies);
+    } else if (joint_distribution_type == QUASI_MONTE_CARLO_JOINT_DISTRIBUTION) {
+        return new MonteCarloJointDistribution(dist_type, strategies,
+                                               MonteCarloJointDistribution::QUASI_RANDOM_SAMPLING);
+    } else if (joint_distribution_type == STRATIFIED_JOINT_DISTRIBUTION) {
+        return new MonteCarloJointDistribution(dist_type, strategies,
+                                               MonteCarloJointDistribution::STRATIFIED_SAMPLING);
     } else abort();
     // TODO: other specialized eval methods
 }
@@ -92,8 +116,108 @@ EmpiricalErrorStrategyEvaluator::expectedValue(Strategy *strategy, typesafe_eval
                                                void *strategy_arg, void *chooser_arg,
                                                ComparisonType comparison_type)
 {
-    jointDistribution->setEvalArgs(strategy_arg, chooser_arg);
-    return jointDistribution->expectedValue(strategy, fn);
+    if (hasEvaluationDeadline()) {
+        double coverage = 1.0;
+        double value = jointDistribution->expectedValueWithDeadline(strategy, fn, strategy_arg, 
+                                                                    chooser_arg, nextValueDeadline(),
+                                                                    &coverage);
+        reportCoverage(coverage);
+        return value;
+    }
+    return jointDistribution->expectedValue(strategy, fn, strategy_arg, chooser_arg);
+}
+
+void
+EmpiricalErrorStrategyEvaluator::expectedValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                                void *strategy_arg, void **chooser_args, size_t num_args,
+                                                double *values, ComparisonType comparison_type)
+{
+    if (hasEvaluationDeadline()) {
+        StrategyEvaluator::expectedValues(strategy, fn, strategy_arg, chooser_args, num_args,
+                                          values, comparison_type);
+        return;
+    }
+    jointDistribution->expectedValues(strategy, fn, strategy_arg, chooser_args, num_args, values);
+}
+
+bool
+EmpiricalErrorStrategyEvaluator::minimumValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                               void *strategy_arg, void **chooser_args, size_t num_args,
+                                               double *values)
+{
+    return jointDistribution->minimumValues(strategy, fn, strategy_arg, chooser_args, num_args, values);
+}
+
+void
+EmpiricalErrorStrategyEvaluator::setSamplingImpl(size_t num_samples_, unsigned long seed_)
+{
+    num_samples = num_samples_;
+    seed = seed_;
+    jointDistribution->setSampling(num_samples, seed);
+}
+
+void
+EmpiricalErrorStrategyEvaluator::setLoopThreadsImpl(size_t num_threads, bool deterministic)
+{
+    loop_threads = num_threads;
+    deterministic_loops = deterministic;
+    jointDistribution->setLoopThreads(loop_threads, deterministic_loops);
+}
+
+void
+EmpiricalErrorStrategyEvaluator::setIncrementalUpdatesImpl(size_t max_updates)
+{
+    max_incremental_updates = max_updates;
+    jointDistribution->setIncrementalUpdates(max_incremental_updates);
+}
+
+void
+EmpiricalErrorStrategyEvaluator::setSketchSizeImpl(size_t max_centroids)
+{
+    sketch_size = max_centroids;
+    jointDistribution->setSketchSize(sketch_size);
+}
+
+void
+EmpiricalErrorStrategyEvaluator::setEvaluationBudgetImpl(size_t max_tuples_, double max_microseconds_)
+{
+    max_tuples = max_tuples_;
+    max_microseconds = max_microseconds_;
+    jointDistribution->setEvaluationBudget(max_tuples, max_microseconds);
+}
+
+double
+EmpiricalErrorStrategyEvaluator::getLastStandardError(Strategy *strategy, eval_fn_type_t type)
+{
+    typesafe_eval_fn_t fn = strategy->getEvalFn(type);
+    if (!fn) {
+        return 0.0;
+    }
+    return jointDistribution->getLastStandardError(strategy, fn);
+}
+
+bool
+EmpiricalErrorStrategyEvaluator::evaluationIsReentrant()
+{
+    return jointDistribution->evaluationIsReentrant();
+}
+
+void
+EmpiricalErrorStrategyEvaluator::prepareEvaluation(void *chooser_arg)
+{
+    jointDistribution->prepareEvaluation(chooser_arg);
+}
+
+bool
+EmpiricalErrorStrategyEvaluator::valuesDependOnlyOnStrategyEstimators()
+{
+    return jointDistribution->valuesDependOnlyOnStrategyEstimators();
+}
+
+bool
+EmpiricalErrorStrategyEvaluator::strategyValuesAreReusable()
+{
+    return jointDistribution->strategyValuesAreReusable();
 }
 
 void
@@ -18,9 +18,25 @@ class EmpiricalErrorStrategyEvaluator : public StrategyEvaluator {
     virtual double expectedValue(Strategy *strategy, typesafe_eval_fn_t fn, 
                                  void *strategy_arg, void *chooser_arg,
                                  ComparisonType comparison_type);
+    virtual void expectedValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                void *strategy_arg, void **chooser_args, size_t num_args,
+                                double *values, ComparisonType comparison_type);
+    virtual bool minimumValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                               void *strategy_arg, void **chooser_args, size_t num_args,
+                               double *values);
 
     virtual void saveToFile(const char *filename);
     virtual void restoreFromFileImpl(const char *filename);
+
+    virtual bool evaluationIsReentrant();
+    virtual void prepareEvaluation(void *chooser_arg);
+
+    // each estimator's error distribution only changes with its own
+    //  observations, but the joint distribution may combine them.
+    virtual bool valuesDependOnlyOnStrategyEstimators();
+    virtual bool strategyValuesAreReusable();
+
+    virtual double getLastStandardError(Strategy *strategy, eval_fn_type_t type);
   protected:
     virtual void processObservation(Estimator *estimator, double observation, 
                                     double old_estimate, double new_estimate);
@@ -31,11 +47,26 @@ class EmpiricalErrorStrategyEvaluator : public StrategyEvaluator {
                                size_t num_strategies_);
 
     virtual AbstractJointDistribution *createJointDistribution(JointDistributionType type);
+    virtual void setSamplingImpl(size_t num_samples_, unsigned long seed_);
+    virtual void setLoopThreadsImpl(size_t num_threads, bool deterministic);
+    virtual void setIncrementalUpdatesImpl(size_t max_updates);
+    virtual void setSketchSizeImpl(size_t max_centroids);
+    virtual void setEvaluationBudgetImpl(size_t max_tuples_, double max_microseconds_);
     
     JointDistributionType joint_distribution_type;
   private:
     StatsDistributionType dist_type;
     AbstractJointDistribution *jointDistribution;
+
+    // kept here, since setStrategies replaces the joint distribution.
+    size_t num_samples;
+    unsigned long seed;
+    size_t loop_threads;
+    bool deterministic_loops;
+    size_t max_incremental_updates;
+    size_t sketch_size;
+    size_t max_tuples;
+    double max_microseconds;
 };
 
 #endif
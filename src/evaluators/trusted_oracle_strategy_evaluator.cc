@@ -10,6 +10,17 @@ TrustedOracleStrategyEvaluator::expectedValue(Strategy *strategy, typesafe_eval_
     return fn(this, strategy_arg, chooser_arg);
 }
 
+bool
+TrustedOracleStrategyEvaluator::minimumValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                              void *strategy_arg, void **chooser_args, size_t num_args,
+                                              double *values)
+{
+    for (size_t i = 0; i < num_args; ++i) {
+        values[i] = fn(this, strategy_arg, chooser_args[i]);
+    }
+    return true;
+}
+
 double
 TrustedOracleStrategyEvaluator::getAdjustedEstimatorValue(Estimator *estimator)
 {
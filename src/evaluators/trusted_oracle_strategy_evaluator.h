@@ -8,8 +8,19 @@ class TrustedOracleStrategyEvaluator : public StrategyEvaluator {
     virtual double expectedValue(Strategy *strategy, typesafe_eval_fn_t fn, 
                                  void *strategy_arg, void *chooser_arg,
                                  ComparisonType comparison_type);
+    // the estimates are the only tuple, so the minimum is the value.
+    virtual bool minimumValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                               void *strategy_arg, void **chooser_args, size_t num_args,
+                               double *values);
     virtual double getAdjustedEstimatorValue(Estimator *estimator);
 
+    // no state at all, so strategies can be evaluated in parallel.
+    virtual bool evaluationIsReentrant() { return true; }
+
+    // values are just functions of the strategy's current estimates.
+    virtual bool valuesDependOnlyOnStrategyEstimators() { return true; }
+    virtual bool strategyValuesAreReusable() { return true; }
+
     // nothing to save/restore.
     virtual void saveToFile(const char *filename) {}
     virtual void restoreFromFileImpl(const char *filename) {}
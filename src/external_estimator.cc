@@ -13,6 +13,18 @@ void ExternalEstimator::addObservation(double observation, double new_value)
     Estimator::addObservation(observation);
 }
 
+void ExternalEstimator::addObservations(ExternalEstimator **estimators, const double *observations,
+                                        const double *new_values, size_t num_observations)
+{
+    std::vector<EstimatorObservation> records;
+    records.reserve(num_observations);
+    for (size_t i = 0; i < num_observations; ++i) {
+        estimators[i]->stagedValue = new_values[i];
+        records.push_back(estimators[i]->recordObservation(observations[i]));
+    }
+    Estimator::notifyObservations(records);
+}
+
 double ExternalEstimator::getEstimateLocked()
 {
     return lastValue;
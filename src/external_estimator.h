@@ -8,6 +8,10 @@ class ExternalEstimator : public Estimator {
     ExternalEstimator(const std::string& name);
     void addObservation(double observation, double new_value);
 
+    // adds all the observations, then notifies each subscriber once.
+    static void addObservations(ExternalEstimator **estimators, const double *observations,
+                                const double *new_values, size_t num_observations);
+
   protected:
     virtual double getEstimateLocked();
     virtual void storeNewObservation(double observation);
@@ -35,6 +35,7 @@ GenericJointDistribution::GenericJointDistribution(StatsDistributionType dist_ty
     time_memos.resize(singular_strategies.size(), NULL);
     energy_memos.resize(singular_strategies.size(), NULL);
     data_memos.resize(singular_strategies.size(), NULL);
+    memos_valid.resize(singular_strategies.size(), false);
     iterator = NULL;
 }
 
@@ -44,6 +45,11 @@ GenericJointDistribution::~GenericJointDistribution()
          it != estimatorError.end(); ++it) {
         delete it->second;
     }
+    for (size_t i = 0; i < time_memos.size(); ++i) {
+        delete time_memos[i];
+        delete energy_memos[i];
+        delete data_memos[i];
+    }
 }
 
 struct memoized_strategy_args {
@@ -170,8 +176,10 @@ GenericJointDistribution::setEvalArgs(void *strategy_arg_, void *chooser_arg_)
 }
 
 double 
-GenericJointDistribution::expectedValue(Strategy *strategy, typesafe_eval_fn_t fn)
+GenericJointDistribution::expectedValue(Strategy *strategy, typesafe_eval_fn_t fn,
+                                        void *strategy_arg_, void *chooser_arg_)
 {
+    setEvalArgs(strategy_arg_, chooser_arg_);
     ASSERT(iterator == NULL);
     
     struct memoized_strategy_args args;
@@ -217,6 +225,7 @@ GenericJointDistribution::processObservation(Estimator *estimator, double observ
     
     if (estimate_is_valid(old_estimate)) {
         double error = calculate_error(old_estimate, observation);
+        applyRetention(estimator, estimatorError[estimator]);
         estimatorError[estimator]->addValue(error);
     } else if (estimatorError.count(estimator) == 0) {
         estimatorError[estimator] = createSamplesDistribution(estimator);
@@ -253,16 +262,20 @@ GenericJointDistribution::setEmptyMemos(Strategy *strategy, const vector<size_t>
     ASSERT(!strategy->isRedundant());
 
     size_t index = getStrategyIndex(strategy);
-    if (time_memos[index] != NULL) {
-        ASSERT(energy_memos[index] != NULL &&
-               data_memos[index] != NULL);
-
+    if (memos_valid[index]) {
         // ignore; assume that expectedValue has been called twice with the same arguments
         return;
     }
-    time_memos[index] = new MultiDimensionArray<double>(dimensions, DBL_MAX);
-    energy_memos[index] = new MultiDimensionArray<double>(dimensions, DBL_MAX);
-    data_memos[index] = new MultiDimensionArray<double>(dimensions, DBL_MAX);
+    memos_valid[index] = true;
+    if (time_memos[index] == NULL) {
+        time_memos[index] = new MultiDimensionArray<double>(dimensions, DBL_MAX);
+        energy_memos[index] = new MultiDimensionArray<double>(dimensions, DBL_MAX);
+        data_memos[index] = new MultiDimensionArray<double>(dimensions, DBL_MAX);
+    } else {
+        time_memos[index]->reset(dimensions, DBL_MAX);
+        energy_memos[index]->reset(dimensions, DBL_MAX);
+        data_memos[index]->reset(dimensions, DBL_MAX);
+    }
 }
 
 void
@@ -270,14 +283,8 @@ GenericJointDistribution::clearMemos()
 {
     ASSERT(time_memos.size() == energy_memos.size() &&
            energy_memos.size() == data_memos.size());
-    for (size_t i = 0; i < time_memos.size(); ++i) {
-        delete time_memos[i];
-        delete energy_memos[i];
-        delete data_memos[i];
-        time_memos[i] = NULL;
-        energy_memos[i] = NULL;
-        data_memos[i] = NULL;
-    }
+    // keep the arrays; setEmptyMemos resets them in place.
+    memos_valid.assign(memos_valid.size(), false);
 }
 
 inline int
@@ -23,8 +23,8 @@ class GenericJointDistribution : public AbstractJointDistribution {
                       const std::vector<Strategy *>& strategies);
     ~GenericJointDistribution();
 
-    void setEvalArgs(void *strategy_arg_, void *chooser_arg_);
-    double expectedValue(Strategy *strategy, typesafe_eval_fn_t fn);
+    double expectedValue(Strategy *strategy, typesafe_eval_fn_t fn,
+                         void *strategy_arg_, void *chooser_arg_);
 
     double getAdjustedEstimatorValue(Estimator *estimator);
     void processObservation(Estimator *estimator, double observation,
@@ -35,6 +35,8 @@ class GenericJointDistribution : public AbstractJointDistribution {
     virtual void restoreFromFile(std::ifstream& in);
 
   private:
+    void setEvalArgs(void *strategy_arg_, void *chooser_arg_);
+
     EstimatorErrorMap estimatorError;
     void *strategy_arg;
     void *chooser_arg;
@@ -44,6 +46,8 @@ class GenericJointDistribution : public AbstractJointDistribution {
     std::vector<MultiDimensionArray<double> *> time_memos;
     std::vector<MultiDimensionArray<double> *> energy_memos;
     std::vector<MultiDimensionArray<double> *> data_memos;
+    // false if the strategy's memos are stale (or not yet created).
+    std::vector<bool> memos_valid;
 
     void setEmptyMemos(Strategy *strategy, const std::vector<size_t>& dimensions);
     void clearMemos();
@@ -0,0 +1,171 @@
+#include "histogram_breaks.h"
+#include "debug.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+using std::vector;
+
+// the most regular bins considered, and the finest grid
+//  that irregular bins are made from.
+static const size_t MAX_REGULAR_BINS = 64;
+static const size_t MAX_GRID_CELLS = 32;
+
+// R's default of n / log(n) bins, at most.
+static size_t max_bins(size_t num_samples)
+{
+    double bins = (num_samples > 2) ? floor(num_samples / log(num_samples)) : 1.0;
+    return std::max<size_t>(1, std::min<size_t>(MAX_REGULAR_BINS, bins));
+}
+
+// counts[k] is the number of samples at or below the k-th of num_cells
+//  equal divisions of [low, high]; counts[0] is 0, so the first cell
+//  includes the low end.
+static vector<size_t> cumulative_counts(const vector<double>& sorted_samples,
+                                        double low, double high, size_t num_cells)
+{
+    vector<size_t> counts(num_cells + 1, 0);
+    double width = (high - low) / num_cells;
+    for (size_t k = 1; k < num_cells; ++k) {
+        double x = low + k * width;
+        counts[k] = std::upper_bound(sorted_samples.begin(), sorted_samples.end(), x) - sorted_samples.begin();
+    }
+    counts[num_cells] = sorted_samples.size();
+    return counts;
+}
+
+// log-likelihood of the count samples in a bin of the given width,
+//  out of n.
+static double bin_log_likelihood(size_t count, double width, size_t n)
+{
+    if (count == 0) {
+        return 0.0;
+    }
+    return count * log(count / (n * width));
+}
+
+static double regular_penalty(size_t num_bins)
+{
+    return (num_bins - 1.0) + pow(log(num_bins), 2.5);
+}
+
+static double irregular_penalty(size_t num_cells, size_t num_bins)
+{
+    // log of (num_cells - 1 choose num_bins - 1): the ways to pick the breaks.
+    double log_choices = (lgamma(num_cells) - lgamma(num_bins) - 
+                          lgamma(num_cells - num_bins + 1.0));
+    return log_choices + regular_penalty(num_bins);
+}
+
+static vector<double> regular_breaks(double low, double high, size_t num_bins)
+{
+    vector<double> breaks;
+    double width = (high - low) / num_bins;
+    for (size_t i = 0; i < num_bins; ++i) {
+        breaks.push_back(low + i * width);
+    }
+    breaks.push_back(high);
+    return breaks;
+}
+
+static vector<double> best_regular_breaks(const vector<double>& sorted_samples, double *score)
+{
+    double low = sorted_samples.front(), high = sorted_samples.back();
+    size_t n = sorted_samples.size();
+
+    size_t best_bins = 1;
+    *score = -INFINITY;
+    for (size_t num_bins = 1; num_bins <= max_bins(n); ++num_bins) {
+        vector<size_t> counts = cumulative_counts(sorted_samples, low, high, num_bins);
+        double width = (high - low) / num_bins;
+        double likelihood = 0.0;
+        for (size_t i = 0; i < num_bins; ++i) {
+            likelihood += bin_log_likelihood(counts[i + 1] - counts[i], width, n);
+        }
+        double penalized = likelihood - regular_penalty(num_bins);
+        if (penalized > *score) {
+            *score = penalized;
+            best_bins = num_bins;
+        }
+    }
+    return regular_breaks(low, high, best_bins);
+}
+
+static vector<double> best_irregular_breaks(const vector<double>& sorted_samples, double *score)
+{
+    double low = sorted_samples.front(), high = sorted_samples.back();
+    size_t n = sorted_samples.size();
+    size_t num_cells = std::min(MAX_GRID_CELLS, max_bins(n));
+    vector<size_t> counts = cumulative_counts(sorted_samples, low, high, num_cells);
+    double cell_width = (high - low) / num_cells;
+
+    // the log-likelihood of a bin from cell i up to cell j, for every
+    //  i < j, so the search below is only additions.
+    vector<vector<double> > bin_likelihood(num_cells + 1, vector<double>(num_cells + 1, 0.0));
+    for (size_t i = 0; i < num_cells; ++i) {
+        for (size_t j = i + 1; j <= num_cells; ++j) {
+            bin_likelihood[i][j] = bin_log_likelihood(counts[j] - counts[i], (j - i) * cell_width, n);
+        }
+    }
+
+    // likelihood[d][j]: the best log-likelihood of the first j cells
+    //  split into d bins; last_break[d][j] is where that split's
+    //  last bin starts.
+    vector<vector<double> > likelihood(num_cells + 1, vector<double>(num_cells + 1, -INFINITY));
+    vector<vector<size_t> > last_break(num_cells + 1, vector<size_t>(num_cells + 1, 0));
+    likelihood[0][0] = 0.0;
+    for (size_t d = 1; d <= num_cells; ++d) {
+        for (size_t j = d; j <= num_cells; ++j) {
+            for (size_t i = d - 1; i < j; ++i) {
+                if (likelihood[d - 1][i] == -INFINITY) {
+                    continue;
+                }
+                double value = likelihood[d - 1][i] + bin_likelihood[i][j];
+                if (value > likelihood[d][j]) {
+                    likelihood[d][j] = value;
+                    last_break[d][j] = i;
+                }
+            }
+        }
+    }
+
+    size_t best_bins = 1;
+    *score = -INFINITY;
+    for (size_t d = 1; d <= num_cells; ++d) {
+        double penalized = likelihood[d][num_cells] - irregular_penalty(num_cells, d);
+        if (penalized > *score) {
+            *score = penalized;
+            best_bins = d;
+        }
+    }
+
+    vector<size_t> cells;
+    for (size_t d = best_bins, j = num_cells; d > 0; j = last_break[d][j], --d) {
+        cells.push_back(j);
+    }
+    cells.push_back(0);
+    std::reverse(cells.begin(), cells.end());
+
+    vector<double> breaks;
+    for (size_t k : cells) {
+        breaks.push_back(k == num_cells ? high : low + k * cell_width);
+    }
+    return breaks;
+}
+
+vector<double> choose_histogram_breaks(const vector<double>& sorted_samples, HistogramType type)
+{
+    ASSERT(sorted_samples.size() > 1);
+    ASSERT(sorted_samples.front() < sorted_samples.back());
+
+    double regular_score = -INFINITY, irregular_score = -INFINITY;
+    vector<double> regular, irregular;
+    if (type != IRREGULAR_HISTOGRAM) {
+        regular = best_regular_breaks(sorted_samples, &regular_score);
+    }
+    if (type != REGULAR_HISTOGRAM) {
+        irregular = best_irregular_breaks(sorted_samples, &irregular_score);
+    }
+    return (regular_score >= irregular_score) ? regular : irregular;
+}
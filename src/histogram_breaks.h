@@ -0,0 +1,34 @@
+#ifndef HISTOGRAM_BREAKS_H_INCL_K3W8RZ0QDN5MYV7C
+#define HISTOGRAM_BREAKS_H_INCL_K3W8RZ0QDN5MYV7C
+
+#include <vector>
+
+/* Picks histogram bins for a set of samples by penalized maximum
+ * likelihood, as R's histogram package does (Rozenholc, Mildenberger
+ * and Gather, "Combining regular and irregular histograms by penalized
+ * likelihood", 2010):
+ *  - regular: the number of equal-width bins that maximizes the
+ *    log-likelihood minus the Birge-Rozenholc penalty;
+ *  - irregular: the best partition of a fine regular grid into
+ *    intervals, found by dynamic programming, with a penalty that also
+ *    counts the number of ways to pick the breaks;
+ *  - combined: whichever of the two scores better.
+ * The grid and the number of bins are capped, so this takes
+ * microseconds even for thousands of samples.
+ *
+ * Bins include their upper break, and the first bin also includes its
+ * lower break, so the breaks span exactly the samples' range.
+ */
+
+enum HistogramType {
+    REGULAR_HISTOGRAM,
+    IRREGULAR_HISTOGRAM,
+    COMBINED_HISTOGRAM
+};
+
+// sorted_samples must be sorted and span more than one value.
+//  Returns the breaks, one more than the number of bins.
+std::vector<double> choose_histogram_breaks(const std::vector<double>& sorted_samples,
+                                            HistogramType type=COMBINED_HISTOGRAM);
+
+#endif
@@ -4,6 +4,7 @@
 #include <thread>
 #include <functional>
 #include <map>
+#include <vector>
 using std::thread;
 using std::max;
 using std::function;
@@ -11,6 +12,7 @@ using std::tie;
 using std::tuple;
 using std::make_tuple;
 using std::map;
+using std::vector;
 
 #ifdef ANDROID
 // WHAT.  why is the necessary?  bleh.
@@ -41,6 +43,16 @@ make_strategy(eval_fn_t time_fn, /* return seconds */
                         strategy_arg, default_chooser_arg);
 }
 
+instruments_strategy_t
+make_vector_strategy(eval_vec_fn_t time_fn, /* return seconds */
+                     eval_vec_fn_t energy_cost_fn, /* return mJ */
+                     eval_vec_fn_t data_cost_fn, /* return bytes */
+                     void *strategy_arg, void *default_chooser_arg)
+{
+    return new Strategy(time_fn, energy_cost_fn, data_cost_fn, 
+                        strategy_arg, default_chooser_arg);
+}
+
 instruments_strategy_t
 make_redundant_strategy(const instruments_strategy_t *strategies, 
                         size_t num_strategies, void *default_chooser_arg)
@@ -86,6 +98,18 @@ double get_estimator_value(instruments_context_t ctx,
     return get_adjusted_estimator_value(ctx, estimator);
 }
 
+const double *get_estimator_values_vec(instruments_context_t ctx,
+                                       instruments_estimator_t est_handle)
+{
+    // there's no row of values outside a vectorized eval fn.
+    StrategyEvaluationContext *context = static_cast<StrategyEvaluationContext *>(ctx);
+    ASSERT(context);
+    Estimator *estimator = static_cast<Estimator*>(est_handle);
+    const double *values = context->getAdjustedEstimatorRow(estimator);
+    ASSERT(values);
+    return values;
+}
+
 
 instruments_estimator_t
 get_network_bandwidth_down_estimator(const char *iface)
@@ -114,6 +138,21 @@ register_strategy_set(const char *name, const instruments_strategy_t *strategies
 instruments_strategy_evaluator_t
 register_strategy_set_with_cmp(const char *name, const instruments_strategy_t *strategies, size_t num_strategies,
                                struct instruments_chooser_arg_fns chooser_arg_fns)
+{
+    return StrategyEvaluator::create(name, strategies, num_strategies, 
+                                     upgrade_chooser_arg_fns(chooser_arg_fns));
+}
+
+instruments_strategy_evaluator_t
+register_strategy_set_with_fns(const char *name, const instruments_strategy_t *strategies, size_t num_strategies,
+                               struct instruments_chooser_arg_fns chooser_arg_fns)
+{
+    return register_strategy_set_with_cmp(name, strategies, num_strategies, chooser_arg_fns);
+}
+
+instruments_strategy_evaluator_t
+register_strategy_set_with_fns_v2(const char *name, const instruments_strategy_t *strategies, size_t num_strategies,
+                                  struct instruments_chooser_arg_fns_v2 chooser_arg_fns)
 {
     return StrategyEvaluator::create(name, strategies, num_strategies, chooser_arg_fns);
 }
@@ -128,6 +167,15 @@ register_strategy_set_with_method(const char *name, const instruments_strategy_t
 instruments_strategy_evaluator_t
 register_strategy_set_with_method_and_fns(const char *name, const instruments_strategy_t *strategies, size_t num_strategies,
                                           enum EvalMethod method, struct instruments_chooser_arg_fns chooser_arg_fns)
+{
+    return StrategyEvaluator::create(name, strategies, num_strategies, method, 
+                                     upgrade_chooser_arg_fns(chooser_arg_fns));
+}
+
+instruments_strategy_evaluator_t
+register_strategy_set_with_method_and_fns_v2(const char *name, const instruments_strategy_t *strategies,
+                                             size_t num_strategies, enum EvalMethod method,
+                                             struct instruments_chooser_arg_fns_v2 chooser_arg_fns)
 {
     return StrategyEvaluator::create(name, strategies, num_strategies, method, chooser_arg_fns);
 }
@@ -152,6 +200,60 @@ get_strategy_evaluator_name(instruments_strategy_evaluator_t e)
     return evaluator->getName();
 }
 
+void set_strategy_evaluator_threads(instruments_strategy_evaluator_t e, size_t num_threads)
+{
+    StrategyEvaluator *evaluator = static_cast<StrategyEvaluator*>(e);
+    evaluator->setEvaluationThreads(num_threads);
+}
+
+void set_strategy_evaluator_loop_threads(instruments_strategy_evaluator_t e,
+                                         size_t num_threads, int deterministic)
+{
+    StrategyEvaluator *evaluator = static_cast<StrategyEvaluator*>(e);
+    evaluator->setLoopThreads(num_threads, deterministic != 0);
+}
+
+void set_strategy_evaluator_incremental_updates(instruments_strategy_evaluator_t e,
+                                                size_t max_updates)
+{
+    StrategyEvaluator *evaluator = static_cast<StrategyEvaluator*>(e);
+    evaluator->setIncrementalUpdates(max_updates);
+}
+
+void set_strategy_evaluator_evaluation_budget(instruments_strategy_evaluator_t e,
+                                              size_t max_tuples, double max_microseconds)
+{
+    StrategyEvaluator *evaluator = static_cast<StrategyEvaluator*>(e);
+    evaluator->setEvaluationBudget(max_tuples, max_microseconds);
+}
+
+void set_strategy_evaluator_sketch_size(instruments_strategy_evaluator_t e,
+                                        size_t max_centroids)
+{
+    StrategyEvaluator *evaluator = static_cast<StrategyEvaluator*>(e);
+    evaluator->setSketchSize(max_centroids);
+}
+
+void set_strategy_evaluator_sampling(instruments_strategy_evaluator_t e,
+                                     size_t num_samples, unsigned long seed)
+{
+    StrategyEvaluator *evaluator = static_cast<StrategyEvaluator*>(e);
+    evaluator->setSampling(num_samples, seed);
+}
+
+void set_strategy_evaluator_cache_size(instruments_strategy_evaluator_t e, size_t max_entries)
+{
+    StrategyEvaluator *evaluator = static_cast<StrategyEvaluator*>(e);
+    evaluator->setCacheSize(max_entries);
+}
+
+void get_strategy_evaluator_stats(instruments_strategy_evaluator_t e,
+                                  struct instruments_evaluator_stats *stats)
+{
+    StrategyEvaluator *evaluator = static_cast<StrategyEvaluator*>(e);
+    evaluator->getStats(stats);
+}
+
 instruments_strategy_t
 choose_strategy(instruments_strategy_evaluator_t evaluator_handle,
                 void *chooser_arg)
@@ -160,6 +262,55 @@ choose_strategy(instruments_strategy_evaluator_t evaluator_handle,
     return evaluator->chooseStrategy(chooser_arg);
 }
 
+void
+disable_strategy(instruments_strategy_evaluator_t evaluator_handle,
+                 instruments_strategy_t strategy_handle)
+{
+    StrategyEvaluator *evaluator = (StrategyEvaluator *) evaluator_handle;
+    Strategy *strategy = (Strategy *) strategy_handle;
+    if (!evaluator->disableStrategy(strategy)) {
+        instruments::dbgprintf(instruments::ERROR,
+                               "Error: tried to disable strategy \"%s\", which evaluator \"%s\" doesn't have\n",
+                               strategy->getName(), evaluator->getName());
+    }
+}
+
+void
+enable_strategy(instruments_strategy_evaluator_t evaluator_handle,
+                instruments_strategy_t strategy_handle)
+{
+    StrategyEvaluator *evaluator = (StrategyEvaluator *) evaluator_handle;
+    Strategy *strategy = (Strategy *) strategy_handle;
+    if (!evaluator->enableStrategy(strategy)) {
+        instruments::dbgprintf(instruments::ERROR,
+                               "Error: tried to enable strategy \"%s\", which evaluator \"%s\" doesn't have\n",
+                               strategy->getName(), evaluator->getName());
+    }
+}
+
+void
+choose_strategies_batch(instruments_strategy_evaluator_t evaluator_handle,
+                        void **chooser_args, size_t num_args,
+                        instruments_strategy_t *chosen_strategies)
+{
+    StrategyEvaluator *evaluator = (StrategyEvaluator *) evaluator_handle;
+    evaluator->chooseStrategies(chooser_args, num_args, chosen_strategies);
+}
+
+instruments_strategy_t
+choose_strategy_with_deadline(instruments_strategy_evaluator_t evaluator_handle,
+                              void *chooser_arg, double max_micros, double *confidence)
+{
+    StrategyEvaluator *evaluator = (StrategyEvaluator *) evaluator_handle;
+    double coverage = 1.0;
+    instruments_strategy_t winner = 
+        evaluator->chooseStrategyWithDeadline(chooser_arg, max_micros, &coverage);
+    if (confidence) {
+        *confidence = coverage;
+    }
+    return winner;
+}
+
 instruments_strategy_t
 choose_nonredundant_strategy(instruments_strategy_evaluator_t evaluator_handle,
                              void *chooser_arg)
@@ -184,6 +335,14 @@ get_last_strategy_time(instruments_strategy_evaluator_t evaluator_handle,
     return evaluator->getLastStrategyTime(strategy);
 }
 
+double
+get_last_strategy_time_error(instruments_strategy_evaluator_t evaluator_handle,
+                             instruments_strategy_t strategy)
+{
+    StrategyEvaluator *evaluator = (StrategyEvaluator *) evaluator_handle;
+    return evaluator->getLastStandardError((Strategy *) strategy, TIME_FN);
+}
+
 /* Functions for use in composing one strategy from another. */
 
 /** Given an eval context and a strategy, returns the strategy's completion time. */
@@ -347,6 +506,17 @@ void add_observation(instruments_external_estimator_t est_handle,
     estimator->addObservation(observation, new_estimate);
 }
 
+void add_observations_batch(instruments_external_estimator_t *est_handles,
+                            const double *observations, const double *new_estimates,
+                            size_t num_observations)
+{
+    vector<ExternalEstimator *> estimators(num_observations);
+    for (size_t i = 0; i < num_observations; ++i) {
+        estimators[i] = static_cast<ExternalEstimator *>(est_handles[i]);
+    }
+    ExternalEstimator::addObservations(estimators.data(), observations, new_estimates, 
+                                       num_observations);
+}
 
 void set_estimator_range_hints(instruments_estimator_t est_handle,
                                double min, double max, size_t num_bins)
@@ -361,6 +531,18 @@ int estimator_has_range_hints(instruments_estimator_t est_handle)
     return estimator->hasRangeHints() ? 1 : 0;
 }
 
+void set_estimator_sample_retention(instruments_estimator_t est_handle,
+                                    instruments_sample_retention_t policy,
+                                    size_t max_samples, double max_age_seconds)
+{
+    Estimator *estimator = static_cast<Estimator *>(est_handle);
+    SampleRetention retention;
+    retention.policy = policy;
+    retention.max_samples = max_samples;
+    retention.max_age_seconds = max_age_seconds;
+    estimator->setSampleRetention(retention);
+}
+
 void set_estimator_condition(instruments_estimator_t est_handle,
                              instruments_estimator_condition_type_t condition_type,
                              double value)
@@ -427,6 +609,17 @@ find_upper_bound(instruments_strategy_evaluator_t evaluator,
 
     map<Strategy *, double> last_strategy_badnesses;
 
+    // strategy_gap_is_widening needs every strategy's latest time and cost.
+    struct PruningSuspension {
+        StrategyEvaluator *evaluator;
+        PruningSuspension(StrategyEvaluator *evaluator_) : evaluator(evaluator_) {
+            evaluator->suspendPruning();
+        }
+        ~PruningSuspension() {
+            evaluator->resumePruning();
+        }
+    } suspension(static_cast<StrategyEvaluator *>(evaluator));
+
     bool valid = true;
     set_estimator_condition(estimator, bound_type, upper);
     winner = chooser(evaluator, chooser_arg);
@@ -0,0 +1,182 @@
+#include "combined_loop.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <vector>
+using std::vector;
+
+// one of an operand's values, with the joint probability of the
+//  samples it was computed from.
+struct WeightedValue {
+    double value;
+    double probability;
+    size_t operand;
+    // the total probability of the operand's values after this one
+    //  in sorted order.
+    double rest;
+
+    bool operator<(const WeightedValue& other) const {
+        return value < other.value;
+    }
+};
+
+static bool
+uses_dimension(const CombinedLoopOperand& operand, size_t d)
+{
+    return operand.strides[d] != 0;
+}
+
+static double
+dimension_mass(const CombinedLoopArgs& args, size_t d)
+{
+    double mass = 0.0;
+    for (size_t i = 0; i < args.counts[d]; ++i) {
+        mass += args.probabilities[d][i];
+    }
+    return mass;
+}
+
+// the operand's values over only the dimensions it uses; each one
+//  stands for all the tuples that agree on those dimensions.
+//  Zero-probability values are left out, as the product walk skips them.
+static void
+collect_values(const CombinedLoopArgs& args, size_t arity, size_t c,
+               vector<WeightedValue>& values)
+{
+    const CombinedLoopOperand& operand = args.operands[c];
+    size_t dims[COMBINED_LOOP_MAX_ARITY];
+    size_t num_dims = 0;
+    for (size_t d = 0; d < arity; ++d) {
+        if (uses_dimension(operand, d)) {
+            if (args.counts[d] == 0) {
+                return;
+            }
+            dims[num_dims++] = d;
+        }
+    }
+
+    size_t indices[COMBINED_LOOP_MAX_ARITY] = { 0 };
+    while (true) {
+        double probability = 1.0;
+        size_t offset = 0;
+        for (size_t k = 0; k < num_dims; ++k) {
+            probability *= args.probabilities[dims[k]][indices[k]];
+            offset += indices[k] * operand.strides[dims[k]];
+        }
+        if (probability != 0.0) {
+            WeightedValue value = { operand.values[offset], probability, c, 0.0 };
+            values.push_back(value);
+        }
+
+        size_t k = num_dims;
+        for (; k > 0; --k) {
+            if (++indices[k - 1] < args.counts[dims[k - 1]]) {
+                break;
+            }
+            indices[k - 1] = 0;
+        }
+        if (k == 0) {
+            break;
+        }
+    }
+}
+
+// the total probability of the dimensions no operand uses; they
+//  scale the result without changing any values.
+static double
+unused_dimensions_mass(const CombinedLoopArgs& args, size_t arity)
+{
+    double mass = 1.0;
+    for (size_t d = 0; d < arity; ++d) {
+        bool used = false;
+        for (size_t c = 0; c < args.num_operands; ++c) {
+            used = used || uses_dimension(args.operands[c], d);
+        }
+        if (!used) {
+            mass *= dimension_mass(args, d);
+        }
+    }
+    return mass;
+}
+
+bool
+sorted_min_expectation(const CombinedLoopArgs& args, size_t arity, double *result)
+{
+    assert(arity <= COMBINED_LOOP_MAX_ARITY);
+    assert(args.num_operands <= COMBINED_LOOP_MAX_OPERANDS);
+    if (args.num_operands == 0) {
+        return false;
+    }
+    for (size_t d = 0; d < arity; ++d) {
+        size_t users = 0;
+        for (size_t c = 0; c < args.num_operands; ++c) {
+            if (uses_dimension(args.operands[c], d)) {
+                ++users;
+            }
+        }
+        if (users > 1) {
+            return false;
+        }
+    }
+
+    vector<WeightedValue> values;
+    for (size_t c = 0; c < args.num_operands; ++c) {
+        collect_values(args, arity, c, values);
+    }
+    std::sort(values.begin(), values.end());
+
+    // a sorted value is the tuple's minimum iff each other operand's
+    //  value comes later in the order, so its weight is the product of
+    //  the others' remaining probabilities.  Ties go to whichever comes
+    //  first; the minimum is the same either way.
+    double remaining[COMBINED_LOOP_MAX_OPERANDS] = { 0.0 };
+    for (size_t i = values.size(); i > 0; --i) {
+        WeightedValue& value = values[i - 1];
+        value.rest = remaining[value.operand];
+        remaining[value.operand] += value.probability;
+    }
+
+    double weightedSum = 0.0;
+    for (const WeightedValue& value : values) {
+        remaining[value.operand] = value.rest;
+        double others = 1.0;
+        for (size_t c = 0; c < args.num_operands; ++c) {
+            if (c != value.operand) {
+                others *= remaining[c];
+            }
+        }
+        weightedSum += value.value * (value.probability * others);
+    }
+    *result = weightedSum * unused_dimensions_mass(args, arity);
+    return true;
+}
+
+double
+linear_sum_expectation(const CombinedLoopArgs& args, size_t arity)
+{
+    assert(arity <= COMBINED_LOOP_MAX_ARITY);
+
+    double masses[COMBINED_LOOP_MAX_ARITY];
+    for (size_t d = 0; d < arity; ++d) {
+        masses[d] = dimension_mass(args, d);
+    }
+
+    double total = 0.0;
+    vector<WeightedValue> values;
+    for (size_t c = 0; c < args.num_operands; ++c) {
+        values.clear();
+        collect_values(args, arity, c, values);
+        double operand_sum = 0.0;
+        for (const WeightedValue& value : values) {
+            operand_sum += value.value * value.probability;
+        }
+        for (size_t d = 0; d < arity; ++d) {
+            if (!uses_dimension(args.operands[c], d)) {
+                operand_sum *= masses[d];
+            }
+        }
+        total += operand_sum;
+    }
+    return total;
+}
@@ -0,0 +1,195 @@
+#ifndef COMBINED_LOOP_H_INCL_UQ3NB8ZK1XW0FJ5T
+#define COMBINED_LOOP_H_INCL_UQ3NB8ZK1XW0FJ5T
+
+/* The tight loop that evaluates a redundant strategy from its children's
+ * memoized values: for every tuple of the estimators' error samples, combine
+ * the children's values (min for time, sum for costs) and weight the result
+ * by the tuple's joint probability.
+ *
+ * The number of nesting levels (one per estimator) and the combiner are
+ * template parameters, so each instantiation compiles down to the same
+ * fixed-depth loop that used to be written out by hand for each application.
+ * get_combined_loop picks the instantiation at runtime from the estimator
+ * count, so callers should look it up once, when the strategies are
+ * registered, rather than on every evaluation.
+ *
+ * Each child's values are stored flat; a child's stride along a loop
+ * dimension is 0 if it doesn't use that dimension's estimator.  That
+ * also covers estimators that are shared between children.
+ *
+ * Most of the time the product isn't walked at all.  The expected sum
+ * is always the sum of each child's expected value, and if no two children
+ * share an estimator, the expected minimum comes from one sorted pass
+ * over all the children's values.  Only a minimum over children that
+ * share an estimator takes the full walk (combined_product_loop).
+ * With two children that are contiguous (or constant) along the last
+ * dimension, its innermost rows go to the SIMD kernels, so callers
+ * should put such a dimension last where they can.
+ */
+
+#include "combiner_kernels.h"
+
+#include <float.h>
+#include <stddef.h>
+
+static const size_t COMBINED_LOOP_MAX_ARITY = 8;
+static const size_t COMBINED_LOOP_MAX_OPERANDS = 8;
+
+// one child strategy's memoized values.
+struct CombinedLoopOperand {
+    const double *values;
+    size_t strides[COMBINED_LOOP_MAX_ARITY];
+};
+
+struct CombinedLoopArgs {
+    // per loop dimension (estimator): its samples' probabilities.
+    const double *probabilities[COMBINED_LOOP_MAX_ARITY];
+    size_t counts[COMBINED_LOOP_MAX_ARITY];
+
+    const CombinedLoopOperand *operands;
+    size_t num_operands;
+};
+
+typedef double (*combined_loop_fn_t)(const CombinedLoopArgs& args);
+
+// the expected minimum over the first arity dimensions, without the
+//  product walk.  Returns false if two operands share a dimension.
+bool sorted_min_expectation(const CombinedLoopArgs& args, size_t arity, double *result);
+
+// the expected sum over the first arity dimensions, by linearity;
+//  the operands needn't be disjoint.
+double linear_sum_expectation(const CombinedLoopArgs& args, size_t arity);
+
+// shortcut() computes the whole expectation if it can, without the walk;
+//  weighted() does a whole innermost row for two operands (see combiner_kernels.h).
+//  Sums never need the walk, so SumCombiner is only a tag (see CombinedLoop).
+struct MinCombiner {
+    static bool shortcut(const CombinedLoopArgs& args, size_t arity, double *result) {
+        return sorted_min_expectation(args, arity, result);
+    }
+    static double identity() { return DBL_MAX; }
+    static double combine(double a, double b) { return (a < b) ? a : b; }
+    static double weighted(const double *probs, const double *a, size_t a_stride,
+                           const double *b, size_t b_stride, size_t count) {
+        return weighted_min(probs, a, a_stride, b, b_stride, count);
+    }
+};
+
+struct SumCombiner {};
+
+// Depth is the loop dimension this level walks; Remaining counts
+//  the levels from here to the innermost, inclusive.
+template <typename Combiner, size_t Depth, size_t Remaining>
+struct CombinedLoopLevel {
+    static void run(const CombinedLoopArgs& args, double probability,
+                    const size_t *offsets, double& weightedSum) {
+        const double *probs = args.probabilities[Depth];
+        size_t count = args.counts[Depth];
+        size_t next_offsets[COMBINED_LOOP_MAX_OPERANDS];
+        for (size_t i = 0; i < count; ++i) {
+            double next_probability = probability * probs[i];
+            if (next_probability == 0.0) {
+                // e.g. pruned by an estimator condition; nothing below counts.
+                continue;
+            }
+            for (size_t c = 0; c < args.num_operands; ++c) {
+                next_offsets[c] = offsets[c] + i * args.operands[c].strides[Depth];
+            }
+            CombinedLoopLevel<Combiner, Depth + 1, Remaining - 1>::run(args, next_probability,
+                                                                      next_offsets, weightedSum);
+        }
+    }
+};
+
+template <typename Combiner, size_t Depth>
+struct CombinedLoopLevel<Combiner, Depth, 1> {
+    static void run(const CombinedLoopArgs& args, double probability,
+                    const size_t *offsets, double& weightedSum) {
+        const double *probs = args.probabilities[Depth];
+        size_t count = args.counts[Depth];
+        if (args.num_operands == 2) {
+            const CombinedLoopOperand& a = args.operands[0];
+            const CombinedLoopOperand& b = args.operands[1];
+            if (a.strides[Depth] <= 1 && b.strides[Depth] <= 1) {
+                weightedSum += probability * Combiner::weighted(probs,
+                                                                a.values + offsets[0], a.strides[Depth],
+                                                                b.values + offsets[1], b.strides[Depth],
+                                                                count);
+                return;
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            double value = Combiner::identity();
+            for (size_t c = 0; c < args.num_operands; ++c) {
+                const CombinedLoopOperand& operand = args.operands[c];
+                value = Combiner::combine(value, operand.values[offsets[c] + i * operand.strides[Depth]]);
+            }
+            weightedSum += value * (probability * probs[i]);
+        }
+    }
+};
+
+// visits every tuple; combined_loop only falls back to this.
+template <typename Combiner, size_t Arity>
+double combined_product_loop(const CombinedLoopArgs& args)
+{
+    static_assert(Arity > 0 && Arity <= COMBINED_LOOP_MAX_ARITY, "unsupported loop depth");
+
+    size_t offsets[COMBINED_LOOP_MAX_OPERANDS] = { 0 };
+    double weightedSum = 0.0;
+    CombinedLoopLevel<Combiner, 0, Arity>::run(args, 1.0, offsets, weightedSum);
+    return weightedSum;
+}
+
+template <typename Combiner, size_t Arity>
+struct CombinedLoop {
+    static double run(const CombinedLoopArgs& args) {
+        double result;
+        if (Combiner::shortcut(args, Arity, &result)) {
+            return result;
+        }
+        return combined_product_loop<Combiner, Arity>(args);
+    }
+};
+
+template <size_t Arity>
+struct CombinedLoop<SumCombiner, Arity> {
+    static double run(const CombinedLoopArgs& args) {
+        return linear_sum_expectation(args, Arity);
+    }
+};
+
+template <typename Combiner, size_t Arity>
+double combined_loop(const CombinedLoopArgs& args)
+{
+    return CombinedLoop<Combiner, Arity>::run(args);
+}
+
+// returns NULL if there's no instantiation for this many estimators.
+template <typename Combiner>
+combined_loop_fn_t get_combined_loop(size_t arity)
+{
+    switch (arity) {
+    case 1: return &combined_loop<Combiner, 1>;
+    case 2: return &combined_loop<Combiner, 2>;
+    case 3: return &combined_loop<Combiner, 3>;
+    case 4: return &combined_loop<Combiner, 4>;
+    case 5: return &combined_loop<Combiner, 5>;
+    case 6: return &combined_loop<Combiner, 6>;
+    case 7: return &combined_loop<Combiner, 7>;
+    case 8: return &combined_loop<Combiner, 8>;
+    default: return NULL;
+    }
+}
+
+// fills in the strides of a row-major array with the given dimensions.
+inline void set_row_major_strides(const size_t *dims, size_t num_dims, size_t *strides)
+{
+    size_t stride = 1;
+    for (size_t i = num_dims; i > 0; --i) {
+        strides[i - 1] = stride;
+        stride *= dims[i - 1];
+    }
+}
+
+#endif
@@ -0,0 +1,176 @@
+#include "combiner_kernels.h"
+
+#include <assert.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_COMBINER_KERNELS
+#include <immintrin.h>
+#endif
+
+// handles the elements from start to count, one at a time.
+template <bool A_VARIES, bool B_VARIES>
+static inline double
+weighted_tail(const double *probs, const double *a, const double *b, size_t start, size_t count)
+{
+    double total = 0.0;
+    for (size_t i = start; i < count; ++i) {
+        double x = A_VARIES ? a[i] : a[0];
+        double y = B_VARIES ? b[i] : b[0];
+        total += probs[i] * ((x < y) ? x : y);
+    }
+    return total;
+}
+
+template <bool A_VARIES, bool B_VARIES>
+static double
+weighted_scalar(const double *probs, const double *a, size_t a_stride,
+                const double *b, size_t b_stride, size_t count)
+{
+    return weighted_tail<A_VARIES, B_VARIES>(probs, a, b, 0, count);
+}
+
+#ifdef HAVE_X86_COMBINER_KERNELS
+
+template <bool A_VARIES, bool B_VARIES>
+__attribute__((target("sse2")))
+static double
+weighted_sse2(const double *probs, const double *a, size_t a_stride,
+              const double *b, size_t b_stride, size_t count)
+{
+    if (count == 0) {
+        return 0.0;
+    }
+    const __m128d a_fixed = _mm_set1_pd(a[0]);
+    const __m128d b_fixed = _mm_set1_pd(b[0]);
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128d x0 = A_VARIES ? _mm_loadu_pd(a + i) : a_fixed;
+        __m128d x1 = A_VARIES ? _mm_loadu_pd(a + i + 2) : a_fixed;
+        __m128d y0 = B_VARIES ? _mm_loadu_pd(b + i) : b_fixed;
+        __m128d y1 = B_VARIES ? _mm_loadu_pd(b + i + 2) : b_fixed;
+        __m128d v0 = _mm_min_pd(x0, y0);
+        __m128d v1 = _mm_min_pd(x1, y1);
+        sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(probs + i), v0));
+        sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_loadu_pd(probs + i + 2), v1));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    return lanes[0] + lanes[1] + weighted_tail<A_VARIES, B_VARIES>(probs, a, b, i, count);
+}
+
+template <bool A_VARIES, bool B_VARIES>
+__attribute__((target("avx")))
+static double
+weighted_avx(const double *probs, const double *a, size_t a_stride,
+             const double *b, size_t b_stride, size_t count)
+{
+    if (count == 0) {
+        return 0.0;
+    }
+    const __m256d a_fixed = _mm256_set1_pd(a[0]);
+    const __m256d b_fixed = _mm256_set1_pd(b[0]);
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256d x0 = A_VARIES ? _mm256_loadu_pd(a + i) : a_fixed;
+        __m256d x1 = A_VARIES ? _mm256_loadu_pd(a + i + 4) : a_fixed;
+        __m256d y0 = B_VARIES ? _mm256_loadu_pd(b + i) : b_fixed;
+        __m256d y1 = B_VARIES ? _mm256_loadu_pd(b + i + 4) : b_fixed;
+        __m256d v0 = _mm256_min_pd(x0, y0);
+        __m256d v1 = _mm256_min_pd(x1, y1);
+        sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(_mm256_loadu_pd(probs + i), v0));
+        sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(_mm256_loadu_pd(probs + i + 4), v1));
+    }
+    for (; i + 4 <= count; i += 4) {
+        __m256d x = A_VARIES ? _mm256_loadu_pd(a + i) : a_fixed;
+        __m256d y = B_VARIES ? _mm256_loadu_pd(b + i) : b_fixed;
+        __m256d v = _mm256_min_pd(x, y);
+        sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(_mm256_loadu_pd(probs + i), v));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sum0, sum1));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) +
+        weighted_tail<A_VARIES, B_VARIES>(probs, a, b, i, count);
+}
+
+#endif
+
+// indexed by [a_stride][b_stride].
+typedef weighted_combiner_fn_t KernelTable[2][2];
+
+#define FILL_KERNEL_TABLE(table, KERNEL)         \
+    table[0][0] = &KERNEL<false, false>;        \
+    table[0][1] = &KERNEL<false, true>;         \
+    table[1][0] = &KERNEL<true, false>;         \
+    table[1][1] = &KERNEL<true, true>;
+
+static CombinerKernelLevel current_level;
+static KernelTable kernels;
+
+static void select_kernels(CombinerKernelLevel level)
+{
+    switch (level) {
+#ifdef HAVE_X86_COMBINER_KERNELS
+    case AVX_COMBINER_KERNELS:
+        FILL_KERNEL_TABLE(kernels, weighted_avx);
+        break;
+    case SSE2_COMBINER_KERNELS:
+        FILL_KERNEL_TABLE(kernels, weighted_sse2);
+        break;
+#endif
+    default:
+        level = SCALAR_COMBINER_KERNELS;
+        FILL_KERNEL_TABLE(kernels, weighted_scalar);
+        break;
+    }
+    current_level = level;
+}
+
+// picks the kernels once, on first use; thread-safe since C++11.
+static const KernelTable& get_kernels()
+{
+    static bool initialized = (select_kernels(get_best_combiner_kernel_level()), true);
+    (void) initialized;
+    return kernels;
+}
+
+double weighted_min(const double *probs, const double *a, size_t a_stride,
+                    const double *b, size_t b_stride, size_t count)
+{
+    assert(a_stride <= 1 && b_stride <= 1);
+    return get_kernels()[a_stride][b_stride](probs, a, a_stride, b, b_stride, count);
+}
+
+CombinerKernelLevel get_best_combiner_kernel_level()
+{
+#ifdef HAVE_X86_COMBINER_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx")) {
+        return AVX_COMBINER_KERNELS;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SSE2_COMBINER_KERNELS;
+    }
+#endif
+    return SCALAR_COMBINER_KERNELS;
+}
+
+CombinerKernelLevel get_combiner_kernel_level()
+{
+    (void) get_kernels();
+    return current_level;
+}
+
+void set_combiner_kernel_level(CombinerKernelLevel level)
+{
+    (void) get_kernels();
+    CombinerKernelLevel best = get_best_combiner_kernel_level();
+    select_kernels(level < best ? level : best);
+}
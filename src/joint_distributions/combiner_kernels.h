@@ -0,0 +1,41 @@
+#ifndef COMBINER_KERNELS_H_INCL_K2W7FQ0XRB
+#define COMBINER_KERNELS_H_INCL_K2W7FQ0XRB
+
+/* Innermost-row kernel for the combined loop's minimum walk
+ * (see combined_loop.h), for the common case of two children:
+ *
+ *   weighted_min:  sum over i of probs[i] * min(a[i * a_stride], b[i * b_stride])
+ *
+ * Each stride is 0 (the child doesn't vary along the row) or 1.
+ *
+ * On x86, there are SSE2 and AVX versions, and the best one the CPU
+ * supports is picked the first time they're used.  Elsewhere, only the
+ * scalar versions are built.  The SIMD versions keep several partial
+ * sums, so their results can differ from the scalar ones in the last bits.
+ */
+
+#include <stddef.h>
+
+enum CombinerKernelLevel {
+    SCALAR_COMBINER_KERNELS,
+    SSE2_COMBINER_KERNELS,
+    AVX_COMBINER_KERNELS
+};
+
+typedef double (*weighted_combiner_fn_t)(const double *probs,
+                                         const double *a, size_t a_stride,
+                                         const double *b, size_t b_stride,
+                                         size_t count);
+
+double weighted_min(const double *probs, const double *a, size_t a_stride,
+                    const double *b, size_t b_stride, size_t count);
+
+// the best level this CPU supports.
+CombinerKernelLevel get_best_combiner_kernel_level();
+CombinerKernelLevel get_combiner_kernel_level();
+
+// for benchmarks and tests: use the given level (capped at the best
+//  supported) from now on.  Not safe while evaluations are running.
+void set_combiner_kernel_level(CombinerKernelLevel level);
+
+#endif
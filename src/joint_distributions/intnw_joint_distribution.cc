@@ -46,20 +46,27 @@ static double *create_array(size_t length, double value)
     return array;
 }
 
+// the rows share one contiguous block, starting at array[0],
+//  so the combined loop can walk the whole array flat.
 static double **create_array(size_t dim1, size_t dim2, double value)
 {
-    double **array = new double*[dim1];
+    double **array = new double*[dim1 > 0 ? dim1 : 1];
+    double *block = create_array(dim1 * dim2, value);
+    array[0] = block;
     for (size_t i = 0; i < dim1; ++i) {
-        array[i] = create_array(dim2, value);
+        array[i] = block + i * dim2;
     }
     return array;
 }
 
+// likewise; the flat block starts at array[0][0].
 static double ***create_array(size_t dim1, size_t dim2, size_t dim3, double value)
 {
-    double ***array = new double**[dim1];
+    double ***array = new double**[dim1 > 0 ? dim1 : 1];
+    double **rows = create_array(dim1 * dim2, dim3, value);
+    array[0] = rows;
     for (size_t i = 0; i < dim1; ++i) {
-        array[i] = create_array(dim2, dim3, value);
+        array[i] = rows + i * dim2;
     }
     return array;
 }
@@ -69,22 +76,18 @@ static void destroy_array(double *array)
     delete [] array;
 }
 
-static void destroy_array(double **array, size_t dim1)
+static void destroy_array(double **array)
 {
     if (array) {
-        for (size_t i = 0; i < dim1; ++i) {
-            destroy_array(array[i]);
-        }
+        destroy_array(array[0]);
     }
     delete [] array;
 }
 
-static void destroy_array(double ***array, size_t dim1, size_t dim2)
+static void destroy_array(double ***array)
 {
     if (array) {
-        for (size_t i = 0; i < dim1; ++i) {
-            destroy_array(array[i], dim2);
-        }
+        destroy_array(array[0]);
     }
     delete [] array;
 }
@@ -180,6 +183,11 @@ IntNWJointDistribution::IntNWJointDistribution(StatsDistributionType dist_type,
         }
     }
     assert(singular_strategies.size() == REDUNDANT_STRATEGY_CHILDREN);
+
+    size_t num_estimators = NUM_ESTIMATORS_SINGULAR[0] + NUM_ESTIMATORS_SINGULAR[1];
+    min_loop = get_combined_loop<MinCombiner>(num_estimators);
+    sum_loop = get_combined_loop<SumCombiner>(num_estimators);
+    assert(min_loop && sum_loop);
     
     singular_probabilities = new double**[singular_strategy_estimators.size()];
     singular_samples_values = new double**[singular_strategy_estimators.size()];
@@ -255,6 +263,8 @@ IntNWJointDistribution::getEstimatorSamplesDistributions()
 {
     for (size_t i = 0; i < singular_strategy_estimators.size(); ++i) {
         if (singular_probabilities[i][0] != NULL) {
+            // still valid; this chooser_arg might still need its memo arrays.
+            createMemoArrays();
             return;
         }
 
@@ -283,7 +293,16 @@ IntNWJointDistribution::getEstimatorSamplesDistributions()
             estimatorIndices[estimator] = 0;
         }
     }
+    createMemoArrays();
+}
+
+void
+IntNWJointDistribution::createMemoArrays()
+{
     for (size_t i = 0; i < NUM_SAVED_VALUE_TYPES; ++i) {
+        if (cellular_strategy_saved_values[i] != NULL) {
+            continue;
+        }
         if (wifi_uses_sessions) {
             wifi_strategy_with_sessions_saved_values[i] = create_array(singular_samples_count[0][0],
                                                                        singular_samples_count[0][1],
@@ -300,15 +319,93 @@ IntNWJointDistribution::getEstimatorSamplesDistributions()
     }
 }
 
+IntNWJointDistribution::MemoTable::MemoTable()
+{
+    for (size_t i = 0; i < NUM_SAVED_VALUE_TYPES; ++i) {
+        wifi_with_sessions_saved_values[i] = NULL;
+        wifi_saved_values[i] = NULL;
+        cellular_saved_values[i] = NULL;
+    }
+}
+
+void
+IntNWJointDistribution::swapMemoTable(MemoTable& table)
+{
+    for (size_t i = 0; i < NUM_SAVED_VALUE_TYPES; ++i) {
+        std::swap(wifi_strategy_with_sessions_saved_values[i], table.wifi_with_sessions_saved_values[i]);
+        std::swap(wifi_strategy_saved_values[i], table.wifi_saved_values[i]);
+        std::swap(cellular_strategy_saved_values[i], table.cellular_saved_values[i]);
+    }
+    cache.swap(table.cache);
+}
+
+void
+IntNWJointDistribution::destroyMemoTable(MemoTable& table)
+{
+    for (size_t i = 0; i < NUM_SAVED_VALUE_TYPES; ++i) {
+        destroy_array(table.wifi_with_sessions_saved_values[i]);
+        destroy_array(table.wifi_saved_values[i]);
+        destroy_array(table.cellular_saved_values[i]);
+        table.wifi_with_sessions_saved_values[i] = NULL;
+        table.wifi_saved_values[i] = NULL;
+        table.cellular_saved_values[i] = NULL;
+    }
+    table.cache.clear();
+}
+
+void
+IntNWJointDistribution::switchMemoTable(void *new_chooser_arg)
+{
+    // park the current chooser_arg's table...
+    if (chooser_arg_copy) {
+        memo_tables.emplace_front(chooser_arg_copy, MemoTable());
+        swapMemoTable(memo_tables.front().second);
+    } else {
+        discardMemoTable();
+    }
+
+    // ...and bring back the new one's, if it's still around.
+    chooser_arg_copy.reset();
+    for (auto it = memo_tables.begin(); it != memo_tables.end(); ++it) {
+        if (chooserArgsEqual(it->first.get(), new_chooser_arg)) {
+            inst::dbgprintf(DEBUG, "IntNWJoint: reusing memoized values for chooser_arg %p\n",
+                            new_chooser_arg);
+            chooser_arg_copy = it->first;
+            swapMemoTable(it->second);
+            memo_tables.erase(it);
+            break;
+        }
+    }
+    if (!chooser_arg_copy) {
+        chooser_arg_copy = copyChooserArg(new_chooser_arg);
+    }
+    while (memo_tables.size() > MAX_MEMO_TABLES) {
+        destroyMemoTable(memo_tables.back().second);
+        memo_tables.pop_back();
+    }
+}
+
+void
+IntNWJointDistribution::discardMemoTable()
+{
+    MemoTable table;
+    swapMemoTable(table);
+    destroyMemoTable(table);
+}
+
 void 
 IntNWJointDistribution::clearEstimatorSamplesDistributions()
 {
+    // every chooser_arg's memoized values came from the old samples.
+    for (auto& entry : memo_tables) {
+        destroyMemoTable(entry.second);
+    }
+    memo_tables.clear();
+
     for (size_t i = 0; i < NUM_SAVED_VALUE_TYPES; ++i) {
-        destroy_array(wifi_strategy_with_sessions_saved_values[i], 
-                      singular_samples_count[0][0],
-                      singular_samples_count[0][1]);
-        destroy_array(wifi_strategy_saved_values[i], singular_samples_count[0][0]);
-        destroy_array(cellular_strategy_saved_values[i], singular_samples_count[1][0]);
+        destroy_array(wifi_strategy_with_sessions_saved_values[i]);
+        destroy_array(wifi_strategy_saved_values[i]);
+        destroy_array(cellular_strategy_saved_values[i]);
         wifi_strategy_with_sessions_saved_values[i] = NULL;
         wifi_strategy_saved_values[i] = NULL;
         cellular_strategy_saved_values[i] = NULL;
@@ -337,8 +434,13 @@ IntNWJointDistribution::clearEstimatorSamplesDistributions()
 void 
 IntNWJointDistribution::setEvalArgs(void *strategy_arg_, void *chooser_arg_)
 {
-    if (chooser_arg != chooser_arg_) {
-        clearEstimatorSamplesDistributions();
+    if (hasChooserArgComparator()) {
+        if (!chooser_arg_copy || !chooserArgsEqual(chooser_arg_copy.get(), chooser_arg_)) {
+            switchMemoTable(chooser_arg_);
+        }
+    } else if (chooser_arg != chooser_arg_) {
+        // nothing to key a parked table with.
+        discardMemoTable();
     }
 
     strategy_arg = strategy_arg_;
@@ -346,8 +448,11 @@ IntNWJointDistribution::setEvalArgs(void *strategy_arg_, void *chooser_arg_)
 }
 
 double 
-IntNWJointDistribution::expectedValue(Strategy *strategy, typesafe_eval_fn_t fn)
+IntNWJointDistribution::expectedValue(Strategy *strategy, typesafe_eval_fn_t fn,
+                                      void *strategy_arg_, void *chooser_arg_)
 {
+    setEvalArgs(strategy_arg_, chooser_arg_);
+
     pair<Strategy *, typesafe_eval_fn_t> key = make_pair(strategy, fn);
     if (cache.count(key) == 0) {
         if (strategy->isRedundant()) {
@@ -442,27 +547,6 @@ IntNWJointDistribution::singularStrategyExpectedValue(Strategy *strategy, typesa
     return weightedSum;
 }
 
-static inline double
-get_one_redundant_probability(double ***singular_probabilities,
-                              size_t strategy_index,
-                              size_t estimator_index,
-                              size_t distribution_index)
-{
-    return singular_probabilities[strategy_index][estimator_index][distribution_index];
-}
-
-#include <functional>
-
-static inline double min(double a, double b)
-{
-    return (a < b) ? a : b;
-}
-
-static inline double sum(double a, double b)
-{
-    return a + b;
-}
-
 static void ensure_valid(double& memoized_value)
 {
     if (memoized_value == DBL_MAX) {
@@ -528,22 +612,55 @@ IntNWJointDistribution::redundantStrategyExpectedValue(Strategy *strategy, types
 }
 
 
-#include "tight_loop.h"
-
 double
 IntNWJointDistribution::redundantStrategyExpectedValueMin(size_t saved_value_type)
 {
-    double weightedSum = 0.0;
-    FN_BODY_WITH_COMBINER(weightedSum, min, saved_value_type);
-    return weightedSum;
+    return combinedExpectedValue(min_loop, saved_value_type);
 }
 
 double
 IntNWJointDistribution::redundantStrategyExpectedValueSum(size_t saved_value_type)
 {
-    double weightedSum = 0.0;
-    FN_BODY_WITH_COMBINER(weightedSum, sum, saved_value_type);
-    return weightedSum;
+    return combinedExpectedValue(sum_loop, saved_value_type);
+}
+
+double
+IntNWJointDistribution::combinedExpectedValue(combined_loop_fn_t loop, size_t saved_value_type)
+{
+    assert(wifi_strategy_saved_values[saved_value_type] != NULL ||
+           wifi_strategy_with_sessions_saved_values[saved_value_type] != NULL);
+    assert(cellular_strategy_saved_values[saved_value_type] != NULL);
+
+    // loop dimensions: the wifi estimators, then the cellular estimators.
+    size_t num_wifi_estimators = NUM_ESTIMATORS_SINGULAR[WIFI_STRATEGY_INDEX];
+    size_t num_cellular_estimators = NUM_ESTIMATORS_SINGULAR[CELLULAR_STRATEGY_INDEX];
+
+    CombinedLoopArgs args;
+    for (size_t j = 0; j < num_wifi_estimators; ++j) {
+        args.probabilities[j] = singular_probabilities[WIFI_STRATEGY_INDEX][j];
+        args.counts[j] = singular_samples_count[WIFI_STRATEGY_INDEX][j];
+    }
+    for (size_t j = 0; j < num_cellular_estimators; ++j) {
+        args.probabilities[num_wifi_estimators + j] = singular_probabilities[CELLULAR_STRATEGY_INDEX][j];
+        args.counts[num_wifi_estimators + j] = singular_samples_count[CELLULAR_STRATEGY_INDEX][j];
+    }
+
+    CombinedLoopOperand operands[REDUNDANT_STRATEGY_CHILDREN] = {};
+    CombinedLoopOperand& wifi = operands[WIFI_STRATEGY_INDEX];
+    CombinedLoopOperand& cellular = operands[CELLULAR_STRATEGY_INDEX];
+    if (wifi_uses_sessions) {
+        wifi.values = wifi_strategy_with_sessions_saved_values[saved_value_type][0][0];
+    } else {
+        wifi.values = wifi_strategy_saved_values[saved_value_type][0];
+    }
+    set_row_major_strides(args.counts, num_wifi_estimators, wifi.strides);
+    cellular.values = cellular_strategy_saved_values[saved_value_type][0];
+    set_row_major_strides(args.counts + num_wifi_estimators, num_cellular_estimators,
+                          cellular.strides + num_wifi_estimators);
+
+    args.operands = operands;
+    args.num_operands = REDUNDANT_STRATEGY_CHILDREN;
+    return loop(args);
 }
 
 
@@ -569,6 +686,7 @@ IntNWJointDistribution::processObservation(Estimator *estimator, double observat
     if (estimate_is_valid(old_estimate) && estimatorSamples.count(estimator) > 0) {
         // if there's a prior estimate, we can calculate an error sample
         double error = calculate_error(old_estimate, observation);
+        applyRetention(estimator, estimatorSamples[estimator]);
         estimatorSamples[estimator]->addValue(error);
         
         inst::dbgprintf(INFO, "IntNWJoint: Added error observation to estimator %s: %f\n", 
@@ -579,6 +697,13 @@ IntNWJointDistribution::processObservation(Estimator *estimator, double observat
     clearEstimatorSamplesDistributions();
 }
 
+void
+IntNWJointDistribution::setSketchSize(size_t max_centroids)
+{
+    resizeSketches(max_centroids, estimatorSamples, estimatorSamplesPlaceholders);
+    clearEstimatorSamplesDistributions();
+}
+
 void
 IntNWJointDistribution::processEstimatorConditionsChange(Estimator *estimator)
 {
@@ -0,0 +1,265 @@
+#include "monte_carlo_joint_distribution.h"
+
+#include "estimator.h"
+#include "debug.h"
+namespace inst = instruments;
+using inst::DEBUG;
+
+#include <math.h>
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <random>
+using std::vector; using std::make_pair;
+using std::chrono::steady_clock;
+
+// the points in the unit hypercube that the draws come from.
+class UnitPoints {
+  public:
+    UnitPoints(MonteCarloJointDistribution::SamplingMode mode_, size_t num_dims,
+               size_t num_points_, unsigned long seed)
+        : mode(mode_), num_points(num_points_), index(0), rng(seed), unit(0.0, 1.0)
+    {
+        if (mode == MonteCarloJointDistribution::QUASI_RANDOM_SAMPLING) {
+            // a random shift per dimension (Cranley-Patterson) keeps
+            //  low-numbered dimensions from lining up on the same points.
+            bases = first_primes(num_dims);
+            for (size_t d = 0; d < num_dims; ++d) {
+                shifts.push_back(unit(rng));
+            }
+        } else if (mode == MonteCarloJointDistribution::STRATIFIED_SAMPLING) {
+            strata.resize(num_dims, vector<size_t>(num_points));
+            for (vector<size_t>& order : strata) {
+                std::iota(order.begin(), order.end(), 0);
+                std::shuffle(order.begin(), order.end(), rng);
+            }
+        }
+    }
+
+    void next(vector<double>& point) {
+        for (size_t d = 0; d < point.size(); ++d) {
+            if (mode == MonteCarloJointDistribution::QUASI_RANDOM_SAMPLING) {
+                double u = radical_inverse(index + 1, bases[d]) + shifts[d];
+                point[d] = u - floor(u);
+            } else if (mode == MonteCarloJointDistribution::STRATIFIED_SAMPLING) {
+                point[d] = (strata[d][index] + unit(rng)) / num_points;
+            } else {
+                point[d] = unit(rng);
+            }
+        }
+        ++index;
+    }
+
+  private:
+    MonteCarloJointDistribution::SamplingMode mode;
+    size_t num_points;
+    size_t index;
+    std::mt19937_64 rng;
+    std::uniform_real_distribution<double> unit;
+
+    vector<unsigned long> bases;
+    vector<double> shifts;
+    vector<vector<size_t> > strata;
+
+    static double radical_inverse(unsigned long n, unsigned long base) {
+        double value = 0.0;
+        double scale = 1.0 / base;
+        while (n > 0) {
+            value += (n % base) * scale;
+            n /= base;
+            scale /= base;
+        }
+        return value;
+    }
+
+    static vector<unsigned long> first_primes(size_t count) {
+        vector<unsigned long> primes;
+        for (unsigned long candidate = 2; primes.size() < count; ++candidate) {
+            bool is_prime = true;
+            for (unsigned long p : primes) {
+                if (p * p > candidate) {
+                    break;
+                }
+                if (candidate % p == 0) {
+                    is_prime = false;
+                    break;
+                }
+            }
+            if (is_prime) {
+                primes.push_back(candidate);
+            }
+        }
+        return primes;
+    }
+};
+
+// evaluation context for one draw from the joint error distribution.
+class MonteCarloDraw : public StrategyEvaluationContext {
+  public:
+    MonteCarloDraw(OptimizedGenericJointDistribution *distribution,
+                   const vector<Estimator *>& estimators_)
+        : estimators(estimators_), indices(estimators_.size(), 0)
+    {
+        for (Estimator *estimator : estimators) {
+            adjusted_values.push_back(&distribution->getAdjustedEstimatorValues(estimator));
+        }
+    }
+
+    double getAdjustedEstimatorValue(Estimator *estimator) {
+        for (size_t i = 0; i < estimators.size(); ++i) {
+            if (estimators[i] == estimator) {
+                return (*adjusted_values[i])[indices[i]];
+            }
+        }
+        // not discovered as one of this strategy's estimators,
+        //  so there's no error distribution to draw from.
+        return estimator->getEstimate();
+    }
+
+    const vector<Estimator *>& estimators;
+    vector<const vector<double> *> adjusted_values;
+    vector<size_t> indices;
+};
+
+MonteCarloJointDistribution::MonteCarloJointDistribution(StatsDistributionType dist_type,
+                                                         const vector<Strategy *>& strategies_,
+                                                         SamplingMode mode_)
+    : OptimizedGenericJointDistribution(dist_type, strategies_),
+      mode(mode_), num_samples(DEFAULT_NUM_SAMPLES), seed(DEFAULT_SEED)
+{
+}
+
+void
+MonteCarloJointDistribution::setSampling(size_t num_samples_, unsigned long seed_)
+{
+    num_samples = (num_samples_ > 0) ? num_samples_ : DEFAULT_NUM_SAMPLES;
+    seed = seed_;
+}
+
+double
+MonteCarloJointDistribution::expectedValue(Strategy *strategy, typesafe_eval_fn_t fn,
+                                           void *strategy_arg, void *chooser_arg_)
+{
+    double value = 0.0;
+    sample(strategy, fn, strategy_arg, &chooser_arg_, 1, &value, NULL);
+    return value;
+}
+
+void
+MonteCarloJointDistribution::expectedValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                            void *strategy_arg, void **chooser_args, size_t num_args,
+                                            double *values)
+{
+    sample(strategy, fn, strategy_arg, chooser_args, num_args, values, NULL);
+}
+
+double
+MonteCarloJointDistribution::expectedValueWithDeadline(Strategy *strategy, typesafe_eval_fn_t fn,
+                                                       void *strategy_arg, void *chooser_arg_,
+                                                       steady_clock::time_point deadline,
+                                                       double *coverage)
+{
+    double value = 0.0;
+    size_t draws = sample(strategy, fn, strategy_arg, &chooser_arg_, 1, &value, &deadline);
+    *coverage = double(draws) / num_samples;
+    return value;
+}
+
+double
+MonteCarloJointDistribution::getLastStandardError(Strategy *strategy, typesafe_eval_fn_t fn)
+{
+    std::lock_guard<std::mutex> lock(standard_errors_mutex);
+    auto it = standard_errors.find(make_pair(strategy, fn));
+    if (it != standard_errors.end()) {
+        return it->second;
+    }
+    return 0.0;
+}
+
+size_t
+MonteCarloJointDistribution::sample(Strategy *strategy, typesafe_eval_fn_t fn, void *strategy_arg,
+                                    void **chooser_args, size_t num_args, double *values,
+                                    const steady_clock::time_point *deadline)
+{
+    getEstimatorSamplesDistributions();
+
+    size_t strategy_index = getStrategyIndex(strategy);
+    const vector<vector<double> >& cur_strategy_probabilities = probabilities[strategy_index];
+    const vector<Estimator *>& cur_strategy_estimators = strategy_estimators[strategy_index];
+    size_t num_dims = cur_strategy_probabilities.size();
+
+    // each estimator's cumulative probabilities, for drawing by inversion.
+    //  The exact engines don't normalize the joint probabilities, so
+    //  the estimate is scaled by their total to match.
+    vector<vector<double> > cdfs(num_dims);
+    double total_mass = 1.0;
+    for (size_t d = 0; d < num_dims; ++d) {
+        const vector<double>& probs = cur_strategy_probabilities[d];
+        cdfs[d].resize(probs.size());
+        std::partial_sum(probs.begin(), probs.end(), cdfs[d].begin());
+        total_mass *= cdfs[d].empty() ? 0.0 : cdfs[d].back();
+    }
+
+    for (size_t i = 0; i < num_args; ++i) {
+        values[i] = 0.0;
+    }
+    if (total_mass <= 0.0) {
+        return num_samples;
+    }
+
+    MonteCarloDraw draw(this, cur_strategy_estimators);
+    vector<double> means(num_args, 0.0);
+    vector<double> sum_squared_deviations(num_args, 0.0);
+
+    UnitPoints points(mode, num_dims, num_samples, seed);
+    vector<double> point(num_dims);
+
+    const size_t DEADLINE_CHECK_INTERVAL = 16;
+    size_t num_draws = 0;
+    while (num_draws < num_samples) {
+        if (deadline && num_draws > 0 && num_draws % DEADLINE_CHECK_INTERVAL == 0 &&
+            steady_clock::now() >= *deadline) {
+            break;
+        }
+        points.next(point);
+        for (size_t d = 0; d < num_dims; ++d) {
+            const vector<double>& cdf = cdfs[d];
+            double u = point[d] * cdf.back();
+            size_t index = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+            draw.indices[d] = std::min(index, cdf.size() - 1);
+        }
+        ++num_draws;
+
+        // running mean and variance (Welford), so a long run doesn't lose precision.
+        for (size_t i = 0; i < num_args; ++i) {
+            double value = fn(&draw, strategy_arg, chooser_args[i]);
+            double delta = value - means[i];
+            means[i] += delta / num_draws;
+            sum_squared_deviations[i] += delta * (value - means[i]);
+        }
+    }
+
+    double max_standard_error = 0.0;
+    for (size_t i = 0; i < num_args; ++i) {
+        values[i] = means[i] * total_mass;
+        if (num_draws > 1) {
+            double variance = sum_squared_deviations[i] / (num_draws - 1);
+            double standard_error = sqrt(variance / num_draws) * total_mass;
+            max_standard_error = std::max(max_standard_error, standard_error);
+        }
+    }
+    if (num_draws < 2) {
+        // one draw says nothing about the spread.
+        max_standard_error = INFINITY;
+    }
+
+    inst::dbgprintf(DEBUG, "strategy \"%s\" (fn %s): %zu draws, standard error %f\n",
+                    strategy->getName(), get_value_name(strategy, fn).c_str(),
+                    num_draws, max_standard_error);
+    {
+        std::lock_guard<std::mutex> lock(standard_errors_mutex);
+        standard_errors[make_pair(strategy, fn)] = max_standard_error;
+    }
+    return num_draws;
+}
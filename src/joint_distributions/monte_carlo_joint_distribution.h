@@ -0,0 +1,82 @@
+#ifndef _MONTE_CARLO_JOINT_DISTRIBUTION_H_
+#define _MONTE_CARLO_JOINT_DISTRIBUTION_H_
+
+#include "optimized_generic_joint_distribution.h"
+
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/* Estimates each expected value from a fixed number of random draws
+ * from the joint error distribution, instead of visiting every tuple.
+ * The cost grows with the number of draws, not with the product of the
+ * estimators' sample counts, so it suits strategies with many estimators.
+ *
+ * Each draw maps a point in the unit hypercube through each estimator's
+ * inverse CDF.  The points can be:
+ *  - independent uniform random points (plain Monte Carlo);
+ *  - a randomly-shifted Halton sequence (quasi-Monte Carlo), which
+ *    fills the cube more evenly and so converges faster;
+ *  - a Latin hypercube: each estimator's range is cut into one
+ *    equal-probability stratum per draw, and each stratum gets one draw.
+ *    So every error sample gets draws in proportion to its probability.
+ * The standard error is computed as for independent draws; for the
+ * last two, that overstates it.
+ *
+ * Every evaluation starts from the same seed, so the results are
+ * reproducible, and strategies are compared on the same draws
+ * (common random numbers), which keeps sampling noise from
+ * flipping close decisions back and forth.
+ */
+class MonteCarloJointDistribution : public OptimizedGenericJointDistribution {
+  public:
+    static const size_t DEFAULT_NUM_SAMPLES = 1000;
+    static const unsigned long DEFAULT_SEED = 42;
+
+    enum SamplingMode {
+        RANDOM_SAMPLING,
+        QUASI_RANDOM_SAMPLING,
+        STRATIFIED_SAMPLING
+    };
+
+    MonteCarloJointDistribution(StatsDistributionType dist_type,
+                                const std::vector<Strategy *>& strategies,
+                                SamplingMode mode_=RANDOM_SAMPLING);
+
+    virtual void setSampling(size_t num_samples_, unsigned long seed_);
+
+    virtual double expectedValue(Strategy *strategy, typesafe_eval_fn_t fn,
+                                 void *strategy_arg, void *chooser_arg_);
+    virtual void expectedValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                void *strategy_arg, void **chooser_args, size_t num_args,
+                                double *values);
+
+    // stops drawing at the deadline; *coverage is the fraction
+    //  of the draws that were made.
+    virtual double expectedValueWithDeadline(Strategy *strategy, typesafe_eval_fn_t fn,
+                                             void *strategy_arg, void *chooser_arg_,
+                                             std::chrono::steady_clock::time_point deadline,
+                                             double *coverage);
+
+    virtual double getLastStandardError(Strategy *strategy, typesafe_eval_fn_t fn);
+
+    // the draws, not the tuples, set the cost here; see setSampling.
+    virtual void setEvaluationBudget(size_t max_tuples_, double max_microseconds_) {}
+
+  private:
+    SamplingMode mode;
+    size_t num_samples;
+    unsigned long seed;
+
+    std::mutex standard_errors_mutex;
+    std::map<std::pair<Strategy *, typesafe_eval_fn_t>, double> standard_errors;
+
+    // draws until num_samples or the deadline, whichever comes first.
+    //  Returns the number of draws made.
+    size_t sample(Strategy *strategy, typesafe_eval_fn_t fn, void *strategy_arg,
+                  void **chooser_args, size_t num_args, double *values,
+                  const std::chrono::steady_clock::time_point *deadline);
+};
+
+#endif /* _MONTE_CARLO_JOINT_DISTRIBUTION_H_ */
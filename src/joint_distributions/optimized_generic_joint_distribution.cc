@@ -4,6 +4,7 @@
 #include "stats_distribution_all_samples.h"
 #include "estimator.h"
 #include "error_calculation.h"
+#include "multi_dimension_array.h"
 #include "debug.h"
 namespace inst = instruments;
 using inst::ERROR; using inst::INFO; using inst::DEBUG;
@@ -11,6 +12,7 @@ using inst::ERROR; using inst::INFO; using inst::DEBUG;
 #include <stdlib.h>
 #include <stdio.h>
 #include <float.h>
+#include <math.h>
 #include <assert.h>
 
 #include <vector>
@@ -20,10 +22,14 @@ using inst::ERROR; using inst::INFO; using inst::DEBUG;
 #include <sstream>
 #include <string>
 #include <stdexcept>
+#include <queue>
+#include <numeric>
+#include <chrono>
 using std::map; using std::pair; using std::make_pair;
 using std::vector; using std::ifstream; using std::ofstream; using std::find_if;
 using std::ostringstream; using std::endl;
 using std::runtime_error; using std::string;
+using std::chrono::steady_clock;
 
 static vector<double> get_estimator_values(StatsDistribution *estimator_samples, 
                                            double (StatsDistribution::Iterator::*fn)(size_t), size_t& count)
@@ -97,12 +103,20 @@ static void adjust_probs_for_estimator_conditions(Estimator *estimator, vector<d
     }
 }
 
+// a guess at the cost of one tuple, until one is measured.
+static const double INITIAL_NS_PER_TUPLE = 100.0;
+
+// weight of each new measurement in the moving average.
+static const double NS_PER_TUPLE_GAIN = 0.25;
+
 OptimizedGenericJointDistribution::OptimizedGenericJointDistribution(StatsDistributionType dist_type,
                                                           const std::vector<Strategy *>& strategies_)
-    : AbstractJointDistribution(dist_type)
+    : AbstractJointDistribution(dist_type), deterministic_loops(false),
+      max_incremental_updates(0), running_sums(RunningSumKeyLess(this)),
+      max_tuples(0), max_microseconds(0.0),
+      ns_per_tuple(INITIAL_NS_PER_TUPLE), tuple_budget(0), time_next_value(false)
 {
-    strategy_arg = NULL;
-    chooser_arg = NULL;
+    samples_ready = false;
     strategies = strategies_;
 
     for (Strategy *strategy : strategies_) {
@@ -110,12 +124,20 @@ OptimizedGenericJointDistribution::OptimizedGenericJointDistribution(StatsDistri
         strategy_estimators.push_back(estimators);
         
         size_t num_estimators = estimators.size();
-        loops.emplace_back();
 
         // example of these nested vector structures:
         // probabilities[strategy_index][estimator_index] = [vector of probability samples]
         probabilities.emplace_back(num_estimators, vector<double>());
         samples_values.emplace_back(num_estimators, vector<double>());
+
+        combined_loop_fn_t min_loop = NULL, sum_loop = NULL;
+        if (strategy->isRedundant() &&
+            strategy->getChildStrategies().size() <= COMBINED_LOOP_MAX_OPERANDS) {
+            min_loop = get_combined_loop<MinCombiner>(num_estimators);
+            sum_loop = get_combined_loop<SumCombiner>(num_estimators);
+        }
+        min_loops.push_back(min_loop);
+        sum_loops.push_back(sum_loop);
     }
     
 }
@@ -124,6 +146,25 @@ OptimizedGenericJointDistribution::~OptimizedGenericJointDistribution()
 {
 }
 
+void
+OptimizedGenericJointDistribution::setLoopThreads(size_t num_threads, bool deterministic)
+{
+    loop_pool.reset();
+    if (num_threads > 1) {
+        // the calling thread does its share of the work.
+        loop_pool.reset(new ThreadPool(num_threads - 1));
+    }
+    deterministic_loops = deterministic;
+}
+
+void
+OptimizedGenericJointDistribution::setIncrementalUpdates(size_t max_updates)
+{
+    std::lock_guard<std::mutex> lock(running_sums_mutex);
+    max_incremental_updates = max_updates;
+    running_sums.clear();
+}
+
 void
 OptimizedGenericJointDistribution::ensureSamplesDistributionExists(Estimator *estimator)
 {
@@ -161,11 +202,19 @@ get_error_adjusted_estimates(Estimator *estimator, const vector<double>& error_s
 void
 OptimizedGenericJointDistribution::getEstimatorSamplesDistributions()
 {
-    for (size_t i = 0; i < strategy_estimators.size(); ++i) {
-        if (!probabilities[i][0].empty()) {
-            return;
-        }
+    if (samples_ready) {
+        return;
+    }
 
+    // concurrent decisions can race to be the first to need the samples.
+    //  Anything that clears them holds the evaluator exclusively,
+    //  so the fast path above needn't lock.
+    std::lock_guard<std::mutex> lock(samples_mutex);
+    if (samples_ready) {
+        return;
+    }
+
+    for (size_t i = 0; i < strategy_estimators.size(); ++i) {
         size_t num_estimators = strategies[i]->getEstimators().size();
         for (size_t j = 0; j < num_estimators; ++j) {
             Estimator *estimator = strategy_estimators[i][j];
@@ -186,6 +235,10 @@ OptimizedGenericJointDistribution::getEstimatorSamplesDistributions()
         }
     }
 
+    if (tuple_budget > 0) {
+        applyEvaluationBudget(tuple_budget);
+    }
+
     for (size_t i = 0; i < strategy_estimators.size(); ++i) {
         size_t num_estimators = strategies[i]->getEstimators().size();
         for (size_t j = 0; j < num_estimators; ++j) {
@@ -199,16 +252,199 @@ OptimizedGenericJointDistribution::getEstimatorSamplesDistributions()
             }
         }
     }
+    samples_ready = true;
+}
+
+void
+OptimizedGenericJointDistribution::setEvaluationBudget(size_t max_tuples_, double max_microseconds_)
+{
+    max_tuples = max_tuples_;
+    max_microseconds = max_microseconds_;
+    clearEstimatorSamplesDistributions();
+}
+
+bool
+OptimizedGenericJointDistribution::valuesDependOnlyOnStrategyEstimators()
+{
+    return (max_tuples == 0 && max_microseconds == 0.0);
+}
+
+size_t
+OptimizedGenericJointDistribution::tupleBudget()
+{
+    size_t budget = max_tuples;
+    if (max_microseconds > 0.0) {
+        double tuples = max_microseconds * 1000.0 / ns_per_tuple.load();
+        size_t time_budget = (size_t) std::max(1.0, std::min(tuples, 1e15));
+        if (budget == 0 || time_budget < budget) {
+            budget = time_budget;
+        }
+    }
+    return budget;
+}
+
+// merges sorted samples into at most count groups of about equal
+//  probability.  Each group is one sample, at its mean error,
+//  so the estimator's expected adjusted value doesn't change.
+static void
+merge_samples(vector<double>& values, vector<double>& probs, size_t count)
+{
+    vector<pair<double, double> > samples;
+    double total = 0.0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (probs[i] > 0.0) {
+            samples.push_back(make_pair(values[i], probs[i]));
+            total += probs[i];
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+
+    vector<double> group_sums(count, 0.0), group_probs(count, 0.0);
+    double cumulative = 0.0;
+    for (auto& sample : samples) {
+        // by the middle of the sample's own mass.
+        double position = (cumulative + sample.second / 2.0) / total;
+        size_t group = std::min(count - 1, (size_t) (position * count));
+        group_sums[group] += sample.first * sample.second;
+        group_probs[group] += sample.second;
+        cumulative += sample.second;
+    }
+
+    values.clear();
+    probs.clear();
+    for (size_t g = 0; g < count; ++g) {
+        if (group_probs[g] > 0.0) {
+            values.push_back(group_sums[g] / group_probs[g]);
+            probs.push_back(group_probs[g]);
+        }
+    }
+}
+
+// the spread of the estimator's adjusted values, relative to their mean,
+//  so that estimators in different units compare.
+static double
+relative_spread(Estimator *estimator, const vector<double>& values, const vector<double>& probs)
+{
+    double estimate = estimator->getEstimate();
+    double total = 0.0, mean = 0.0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        total += probs[i];
+        mean += probs[i] * adjusted_estimate(estimate, values[i]);
+    }
+    if (total <= 0.0) {
+        return 0.0;
+    }
+    mean /= total;
+
+    double variance = 0.0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        double deviation = adjusted_estimate(estimate, values[i]) - mean;
+        variance += probs[i] * deviation * deviation;
+    }
+    double spread = sqrt(variance / total);
+    return (mean != 0.0) ? spread / fabs(mean) : spread;
+}
+
+void
+OptimizedGenericJointDistribution::applyEvaluationBudget(size_t budget)
+{
+    // each estimator's samples, from the first strategy that uses it.
+    struct Allocation {
+        Estimator *estimator;
+        size_t strategy_index, estimator_index;
+        size_t count, original_count;
+        double spread;
+    };
+    vector<Allocation> allocations;
+    vector<vector<size_t> > strategy_allocations(strategies.size());
+    for (size_t i = 0; i < strategy_estimators.size(); ++i) {
+        for (size_t j = 0; j < strategy_estimators[i].size(); ++j) {
+            Estimator *estimator = strategy_estimators[i][j];
+            if (!strategies[i]->usesEstimator(estimator)) {
+                continue;
+            }
+            size_t a = 0;
+            while (a < allocations.size() && allocations[a].estimator != estimator) {
+                ++a;
+            }
+            if (a == allocations.size()) {
+                const vector<double>& probs = probabilities[i][j];
+                size_t count = std::count_if(probs.begin(), probs.end(),
+                                             [](double p) { return p > 0.0; });
+                Allocation allocation = {
+                    estimator, i, j, count, count,
+                    relative_spread(estimator, samples_values[i][j], probs)
+                };
+                allocations.push_back(allocation);
+            }
+            strategy_allocations[i].push_back(a);
+        }
+    }
+
+    // the error of merging an estimator's samples into n groups
+    //  goes roughly as spread / n.  So, while a strategy is over
+    //  the budget, shrink its estimator with the least spread per
+    //  sample; that ends up with counts in proportion to the spreads.
+    for (size_t i = 0; i < strategies.size(); ++i) {
+        while (true) {
+            double tuples = 1.0;
+            for (size_t a : strategy_allocations[i]) {
+                tuples *= allocations[a].count;
+            }
+            if (tuples <= budget) {
+                break;
+            }
+
+            Allocation *smallest = NULL;
+            for (size_t a : strategy_allocations[i]) {
+                Allocation& allocation = allocations[a];
+                if (allocation.count > 1 &&
+                    (!smallest || (allocation.spread * smallest->count <
+                                   smallest->spread * allocation.count))) {
+                    smallest = &allocation;
+                }
+            }
+            if (!smallest) {
+                break;
+            }
+            smallest->count -= std::max((size_t) 1, smallest->count / 8);
+        }
+    }
+
+    for (Allocation& allocation : allocations) {
+        if (allocation.count >= allocation.original_count) {
+            continue;
+        }
+        vector<double> values = samples_values[allocation.strategy_index][allocation.estimator_index];
+        vector<double> probs = probabilities[allocation.strategy_index][allocation.estimator_index];
+        merge_samples(values, probs, allocation.count);
+        inst::dbgprintf(INFO, "Evaluation budget %zu: estimator %s gets %zu of %zu samples (spread %f)\n",
+                        budget, allocation.estimator->getName().c_str(), values.size(),
+                        allocation.original_count, allocation.spread);
+
+        for (size_t i = 0; i < strategy_estimators.size(); ++i) {
+            for (size_t j = 0; j < strategy_estimators[i].size(); ++j) {
+                if (strategy_estimators[i][j] == allocation.estimator &&
+                    strategies[i]->usesEstimator(allocation.estimator)) {
+                    samples_values[i][j] = values;
+                    probabilities[i][j] = probs;
+                }
+            }
+        }
+    }
 }
 
 void 
 OptimizedGenericJointDistribution::clearEstimatorSamplesDistributions()
 {
+    // the next extraction's budget, and a new measurement to update it.
+    tuple_budget = tupleBudget();
+    time_next_value = (max_microseconds > 0.0);
+    if (!samples_ready) {
+        return;
+    }
+
     for (size_t i = 0; i < strategy_estimators.size(); ++i) {
-        if (probabilities[i][0].empty()) {
-            return;
-        }
-        
         size_t num_estimators = strategies[i]->getEstimators().size();
         for (size_t j = 0; j < num_estimators; ++j) {
             probabilities[i][j].clear();
@@ -218,48 +454,52 @@ OptimizedGenericJointDistribution::clearEstimatorSamplesDistributions()
     estimatorSamplesValues.clear();
     estimatorIndices.clear();
     estimatorErrorAdjustedValues.clear();
+    samples_ready = false;
 }
 
 void 
-OptimizedGenericJointDistribution::setEvalArgs(void *strategy_arg_, void *chooser_arg_)
+OptimizedGenericJointDistribution::prepareEvaluation(void *chooser_arg_)
 {
-    if (chooser_arg != chooser_arg_) {
-        clearEstimatorSamplesDistributions();
-    }
-
-    strategy_arg = strategy_arg_;
-    chooser_arg = chooser_arg_;
+    // the samples don't depend on the chooser_arg, so they stay valid
+    //  until the next observation or estimator change.
+    getEstimatorSamplesDistributions();
 }
 
 class ExpectedValueLoop : public StrategyEvaluationContext {
     ostringstream indices_values;
     ostringstream estimator_values;
     
-    OptimizedGenericJointDistribution *distribution;
     vector<vector<double> >& cur_strategy_probabilities;
     vector<Estimator *>& cur_strategy_estimators;
-    double& weightedSum;
+    vector<const vector<double> *> adjusted_values_per_estimator;
+    double *weightedSums;
     typesafe_eval_fn_t fn;
+    void *strategy_arg;
+    void **chooser_args;
+    size_t num_args;
 
-    vector<vector<double> > adjusted_values_per_estimator;
-    size_t estimator_index = 0;
-    size_t current_dist_index = 0;
+    const vector<size_t> *cur_indices = nullptr;
     
   public:
-    ExpectedValueLoop(OptimizedGenericJointDistribution *distribution_,
+    // everything this touches in the distribution is read-only,
+    //  so several of these can run at once on different threads.
+    ExpectedValueLoop(OptimizedGenericJointDistribution *distribution,
                       vector<vector<double> >& cur_strategy_probabilities_,
                       vector<Estimator *>& cur_strategy_estimators_,
-                      double& weightedSum_,
-                      typesafe_eval_fn_t fn_)
-        : distribution(distribution_),
-          cur_strategy_probabilities(cur_strategy_probabilities_),
+                      double *weightedSums_, typesafe_eval_fn_t fn_, 
+                      void *strategy_arg_, void **chooser_args_, size_t num_args_)
+        : cur_strategy_probabilities(cur_strategy_probabilities_),
           cur_strategy_estimators(cur_strategy_estimators_),
-          weightedSum(weightedSum_),
-          fn(fn_)
+          weightedSums(weightedSums_), fn(fn_), strategy_arg(strategy_arg_), 
+          chooser_args(chooser_args_), num_args(num_args_)
     {
+        for (Estimator *estimator : cur_strategy_estimators) {
+            adjusted_values_per_estimator.push_back(&distribution->getAdjustedEstimatorValues(estimator));
+        }
     }
     
     void operator()(vector<size_t>& indices) {
+        cur_indices = &indices;
         if (inst::is_debugging_on(DEBUG)) {
             indices_values.str("");
             estimator_values.str("");
@@ -267,47 +507,135 @@ class ExpectedValueLoop : public StrategyEvaluationContext {
         
         double probability = 1.0;
         for (size_t i = 0; i < indices.size(); ++i) {
-            Estimator *estimator = cur_strategy_estimators[i];
-            distribution->estimatorIndices[estimator] = indices[i];
             probability *= cur_strategy_probabilities[i][indices[i]];
             if (inst::is_debugging_on(DEBUG)) {
                 indices_values << indices[i] << " ";
-                estimator_values << distribution->getAdjustedEstimatorValue(estimator) << " ";
+                estimator_values << (*adjusted_values_per_estimator[i])[indices[i]] << " ";
             }
         }
-        current_dist_index = indices[estimator_index];
-        double value = fn(this, distribution->strategy_arg, distribution->chooser_arg);
-        weightedSum += value * probability;
-        inst::dbgprintf(DEBUG, "  [ %s] [ %s]  value = %f  prob = %f  weightedSum = %f\n",
-                        indices_values.str().c_str(),
-                        estimator_values.str().c_str(),
-                        value, probability, weightedSum);
+        // the probability and estimator values are the same for every chooser_arg.
+        for (size_t i = 0; i < num_args; ++i) {
+            double value = fn(this, strategy_arg, chooser_args[i]);
+            weightedSums[i] += value * probability;
+            inst::dbgprintf(DEBUG, "  [ %s] [ %s]  value = %f  prob = %f  weightedSum = %f\n",
+                            indices_values.str().c_str(),
+                            estimator_values.str().c_str(),
+                            value, probability, weightedSums[i]);
+        }
     }
 
     double getAdjustedEstimatorValue(Estimator *estimator) {
-        if (adjusted_values_per_estimator.size() < cur_strategy_estimators.size()) {
-            adjusted_values_per_estimator.push_back(distribution->getAdjustedEstimatorValues(estimator));
+        // linear search, but a strategy only has a handful of estimators.
+        for (size_t i = 0; i < cur_strategy_estimators.size(); ++i) {
+            if (cur_strategy_estimators[i] == estimator) {
+                return (*adjusted_values_per_estimator[i])[(*cur_indices)[i]];
+            }
         }
-        double value = adjusted_values_per_estimator[estimator_index][current_dist_index];
-        estimator_index = (estimator_index + 1) % cur_strategy_estimators.size();
-        return value;
+        // not discovered as one of this strategy's estimators,
+        //  so there's no error distribution to draw from.
+        return estimator->getEstimate();
     }
 };
 
-double 
-OptimizedGenericJointDistribution::expectedValue(Strategy *strategy, typesafe_eval_fn_t fn)
+// like ExpectedValueLoop, but keeps the least value instead of the weighted sum.
+class MinimumValueLoop : public StrategyEvaluationContext {
+    vector<Estimator *>& cur_strategy_estimators;
+    vector<const vector<double> *>& adjusted_values_per_estimator;
+    double *minimums;
+    typesafe_eval_fn_t fn;
+    void *strategy_arg;
+    void **chooser_args;
+    size_t num_args;
+
+    const vector<size_t> *cur_indices = nullptr;
+
+  public:
+    MinimumValueLoop(vector<Estimator *>& cur_strategy_estimators_,
+                     vector<const vector<double> *>& adjusted_values_per_estimator_,
+                     double *minimums_, typesafe_eval_fn_t fn_,
+                     void *strategy_arg_, void **chooser_args_, size_t num_args_)
+        : cur_strategy_estimators(cur_strategy_estimators_),
+          adjusted_values_per_estimator(adjusted_values_per_estimator_),
+          minimums(minimums_), fn(fn_), strategy_arg(strategy_arg_),
+          chooser_args(chooser_args_), num_args(num_args_) {}
+
+    void operator()(vector<size_t>& indices) {
+        cur_indices = &indices;
+        for (size_t i = 0; i < num_args; ++i) {
+            double value = fn(this, strategy_arg, chooser_args[i]);
+            if (value < minimums[i]) {
+                minimums[i] = value;
+            }
+        }
+    }
+
+    double getAdjustedEstimatorValue(Estimator *estimator) {
+        for (size_t i = 0; i < cur_strategy_estimators.size(); ++i) {
+            if (cur_strategy_estimators[i] == estimator) {
+                return (*adjusted_values_per_estimator[i])[(*cur_indices)[i]];
+            }
+        }
+        return estimator->getEstimate();
+    }
+};
+
+bool
+OptimizedGenericJointDistribution::minimumValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                                 void *strategy_arg, void **chooser_args, size_t num_args,
+                                                 double *values)
 {
     getEstimatorSamplesDistributions();
-    
-    size_t strategy_index = strategies.size();
-    for (size_t i = 0; i < strategies.size(); ++i) {
-        if (strategy == strategies[i]) {
-            strategy_index = i;
-            break;
-        }
+
+    size_t strategy_index = getStrategyIndex(strategy);
+    vector<Estimator *>& cur_strategy_estimators = strategy_estimators[strategy_index];
+    vector<const vector<double> *> adjusted_values_per_estimator;
+    for (Estimator *estimator : cur_strategy_estimators) {
+        adjusted_values_per_estimator.push_back(&getAdjustedEstimatorValues(estimator));
+    }
+    vector<size_t> loop_dims;
+    for (vector<double>& probs : probabilities[strategy_index]) {
+        loop_dims.push_back(probs.size());
+    }
+    for (size_t i = 0; i < num_args; ++i) {
+        values[i] = DBL_MAX;
+    }
+
+    MinimumValueLoop loop_body(cur_strategy_estimators, adjusted_values_per_estimator,
+                               values, fn, strategy_arg, chooser_args, num_args);
+    NestedLoop loop;
+    loop.run_loop(loop_body, loop_dims);
+    return true;
+}
+
+double 
+OptimizedGenericJointDistribution::expectedValue(Strategy *strategy, typesafe_eval_fn_t fn,
+                                                 void *strategy_arg, void *chooser_arg_)
+{
+    if (!evaluationIsPrepared(chooser_arg_)) {
+        prepareEvaluation(chooser_arg_);
     }
-    assert(strategy_index < strategies.size());
     
+    double value = 0.0;
+    expectedValues(strategy, fn, strategy_arg, &chooser_arg_, 1, &value);
+    return value;
+}
+
+void
+OptimizedGenericJointDistribution::expectedValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                                  void *strategy_arg, void **chooser_args, size_t num_args,
+                                                  double *values)
+{
+    getEstimatorSamplesDistributions();
+
+    size_t strategy_index = getStrategyIndex(strategy);
+    for (size_t i = 0; i < num_args; ++i) {
+        values[i] = 0.0;
+    }
+    if (combinedExpectedValues(strategy_index, fn, chooser_args, num_args, values) ||
+        vectorExpectedValues(strategy_index, fn, chooser_args, num_args, values)) {
+        return;
+    }
+
     vector<vector<double> >& cur_strategy_probabilities = probabilities[strategy_index];
     vector<Estimator *>& cur_strategy_estimators = strategy_estimators[strategy_index];
     
@@ -315,8 +643,16 @@ OptimizedGenericJointDistribution::expectedValue(Strategy *strategy, typesafe_ev
     for (vector<double>& probs : cur_strategy_probabilities) {
         loop_dims.push_back(probs.size());
     }
-    
-    double weightedSum = 0.0;
+
+    // ahead of the running sums, which would neither split the loop
+    //  across the threads nor add up the slices in the promised order.
+    if ((loop_pool || deterministic_loops) && loop_dims.size() > 1) {
+        slicedExpectedValues(strategy_index, fn, strategy_arg, chooser_args, num_args, values);
+        return;
+    }
+    if (incrementalExpectedValues(strategy_index, fn, strategy_arg, chooser_args, num_args, values)) {
+        return;
+    }
     
     if (inst::is_debugging_on(DEBUG)) {
         inst::dbgprintf(DEBUG, "strategy \"%s\" (fn %s) uses %zu estimators\n", 
@@ -326,15 +662,15 @@ OptimizedGenericJointDistribution::expectedValue(Strategy *strategy, typesafe_ev
             Estimator *estimator = cur_strategy_estimators[i];
             ostringstream s;
             s << "  " << estimator->getName() << ": ";
-            for (size_t j = 0; j < loop_dims[i]; ++j) {
-                estimatorIndices[estimator] = j;
-                s << getAdjustedEstimatorValue(estimator) << " ";
+            for (double value : getAdjustedEstimatorValues(estimator)) {
+                s << value << " ";
             }
             inst::dbgprintf(DEBUG, "%s\n", s.str().c_str());
         }
     }
 
-    ExpectedValueLoop loop_body(this, cur_strategy_probabilities, cur_strategy_estimators, weightedSum, fn);
+    ExpectedValueLoop loop_body(this, cur_strategy_probabilities, cur_strategy_estimators, 
+                                values, fn, strategy_arg, chooser_args, num_args);
 
     ostringstream indices_max;
     if (inst::is_debugging_on(DEBUG)) {
@@ -345,10 +681,665 @@ OptimizedGenericJointDistribution::expectedValue(Strategy *strategy, typesafe_ev
     
     inst::dbgprintf(DEBUG, "About to run %zu-way nested loop, dims [ %s]\n", 
                     loop_dims.size(), indices_max.str().c_str());
-    auto& loop = loops[strategy_index];
+    // only this loop evaluates every tuple once, on one thread, so only
+    //  it measures the cost per tuple that converts the time budget.
+    bool timed = time_next_value.exchange(false);
+    steady_clock::time_point begin;
+    if (timed) {
+        begin = steady_clock::now();
+    }
+
+    // the loop keeps its indices as it goes, so concurrent calls need their own.
+    NestedLoop loop;
     loop.run_loop(loop_body, loop_dims);
-    
-    return weightedSum;
+
+    if (timed) {
+        double ns = std::chrono::duration<double, std::nano>(steady_clock::now() - begin).count();
+        double tuples = num_args;
+        for (size_t dim : loop_dims) {
+            tuples *= dim;
+        }
+        double cost = ns / tuples;
+        double average = ns_per_tuple.load();
+        ns_per_tuple.store(average + NS_PER_TUPLE_GAIN * (cost - average));
+    }
+}
+
+// runs an ExpectedValueLoop over the tuples whose first index is fixed.
+class LoopSlice {
+  public:
+    LoopSlice(ExpectedValueLoop& loop_body_, size_t first_index, size_t num_dims)
+        : loop_body(loop_body_), indices(num_dims, 0) {
+        indices[0] = first_index;
+    }
+
+    void operator()(vector<size_t>& rest) {
+        std::copy(rest.begin(), rest.end(), indices.begin() + 1);
+        loop_body(indices);
+    }
+
+  private:
+    ExpectedValueLoop& loop_body;
+    vector<size_t> indices;
+};
+
+void
+OptimizedGenericJointDistribution::slicedExpectedValues(size_t strategy_index, typesafe_eval_fn_t fn,
+                                                        void *strategy_arg, void **chooser_args,
+                                                        size_t num_args, double *values)
+{
+    vector<vector<double> >& cur_strategy_probabilities = probabilities[strategy_index];
+    vector<Estimator *>& cur_strategy_estimators = strategy_estimators[strategy_index];
+    size_t num_dims = cur_strategy_probabilities.size();
+    size_t num_slices = cur_strategy_probabilities[0].size();
+    vector<size_t> slice_dims;
+    for (size_t d = 1; d < num_dims; ++d) {
+        slice_dims.push_back(cur_strategy_probabilities[d].size());
+    }
+
+    // each slice only writes its own sums, and has its own loop state.
+    vector<double> slice_sums(num_slices * num_args, 0.0);
+    auto run_slice = [&](size_t i) {
+        ExpectedValueLoop loop_body(this, cur_strategy_probabilities, cur_strategy_estimators,
+                                    &slice_sums[i * num_args], fn, strategy_arg,
+                                    chooser_args, num_args);
+        LoopSlice slice(loop_body, i, num_dims);
+        NestedLoop loop;
+        loop.run_loop(slice, slice_dims);
+    };
+
+    inst::dbgprintf(DEBUG, "strategy \"%s\" (fn %s): %zu slices of a %zu-way loop on %zu threads\n",
+                    strategies[strategy_index]->getName(), get_value_name(strategies[strategy_index], fn).c_str(),
+                    num_slices, num_dims, loop_pool ? loop_pool->numThreads() + 1 : 1);
+    if (loop_pool) {
+        loop_pool->parallelFor(num_slices, run_slice);
+    } else {
+        for (size_t i = 0; i < num_slices; ++i) {
+            run_slice(i);
+        }
+    }
+
+    // always in slice order, however the slices were scheduled.
+    for (size_t i = 0; i < num_slices; ++i) {
+        for (size_t j = 0; j < num_args; ++j) {
+            values[j] += slice_sums[i * num_args + j];
+        }
+    }
+}
+
+// runs an ExpectedValueLoop over a box of tuples, offset from lows.
+class LoopRegion {
+  public:
+    LoopRegion(ExpectedValueLoop& loop_body_, const vector<size_t>& lows_)
+        : loop_body(loop_body_), lows(lows_), indices(lows_.size(), 0) {}
+
+    void operator()(vector<size_t>& offsets) {
+        for (size_t d = 0; d < indices.size(); ++d) {
+            indices[d] = lows[d] + offsets[d];
+        }
+        loop_body(indices);
+    }
+
+  private:
+    ExpectedValueLoop& loop_body;
+    const vector<size_t>& lows;
+    vector<size_t> indices;
+};
+
+// past this many, the running sums start over, so a stream of
+//  one-off chooser_args can't grow them without bound.
+static const size_t MAX_RUNNING_SUMS = 1024;
+
+bool
+OptimizedGenericJointDistribution::RunningSumKeyLess::operator()(const RunningSumKey& left,
+                                                                 const RunningSumKey& right) const
+{
+    auto left_rest = std::make_tuple(std::get<0>(left), std::get<1>(left), std::get<2>(left));
+    auto right_rest = std::make_tuple(std::get<0>(right), std::get<1>(right), std::get<2>(right));
+    if (left_rest != right_rest) {
+        return left_rest < right_rest;
+    }
+    return distribution->chooserArgLess(std::get<3>(left), std::get<3>(right));
+}
+
+static bool
+extends(const vector<double>& old_values, const vector<double>& new_values)
+{
+    return (old_values.size() <= new_values.size() &&
+            std::equal(old_values.begin(), old_values.end(), new_values.begin()));
+}
+
+bool
+OptimizedGenericJointDistribution::incrementalExpectedValues(size_t strategy_index, typesafe_eval_fn_t fn,
+                                                             void *strategy_arg, void **chooser_args,
+                                                             size_t num_args, double *values)
+{
+    Strategy *strategy = strategies[strategy_index];
+    vector<Estimator *>& cur_strategy_estimators = strategy_estimators[strategy_index];
+    if (max_incremental_updates == 0 || strategy->isRedundant() || cur_strategy_estimators.empty()) {
+        return false;
+    }
+
+    // if every sample of an estimator is equally likely, every tuple
+    //  has the same probability, so the expected value is the plain sum
+    //  of the values, scaled.  That's not true of weighted samples,
+    //  or of samples pruned by conditions.
+    vector<vector<double> >& cur_strategy_probabilities = probabilities[strategy_index];
+    size_t num_dims = cur_strategy_estimators.size();
+    double probability = 1.0;
+    vector<const vector<double> *> adjusted_values;
+    vector<size_t> new_counts;
+    for (size_t d = 0; d < num_dims; ++d) {
+        const vector<double>& probs = cur_strategy_probabilities[d];
+        if (probs.empty() || cur_strategy_estimators[d]->hasConditions() ||
+            std::count(probs.begin(), probs.end(), probs[0]) != (long) probs.size()) {
+            return false;
+        }
+        probability *= probs[0];
+        adjusted_values.push_back(&getAdjustedEstimatorValues(cur_strategy_estimators[d]));
+        new_counts.push_back(adjusted_values.back()->size());
+    }
+
+    // the loop body weights each value by the product of these.
+    vector<vector<double> > unit_probabilities;
+    for (size_t count : new_counts) {
+        unit_probabilities.emplace_back(count, 1.0);
+    }
+
+    for (size_t i = 0; i < num_args; ++i) {
+        RunningSumKey key(strategy_index, fn, strategy_arg, chooser_args[i]);
+        RunningSum running;
+        bool found = false;
+        {
+            std::lock_guard<std::mutex> lock(running_sums_mutex);
+            auto it = running_sums.find(key);
+            if (it != running_sums.end()) {
+                running = it->second;
+                found = true;
+            }
+        }
+
+        // the old tuples are still in the sum only if all their values
+        //  are unchanged; usually an observation moves the estimate,
+        //  and with it all the estimator's adjusted values.
+        vector<size_t> old_counts(num_dims, 0);
+        bool incremental = found && running.updates < max_incremental_updates;
+        for (size_t d = 0; incremental && d < num_dims; ++d) {
+            incremental = extends(running.adjusted_values[d], *adjusted_values[d]);
+        }
+        if (incremental) {
+            for (size_t d = 0; d < num_dims; ++d) {
+                old_counts[d] = running.adjusted_values[d].size();
+            }
+        } else {
+            running.sum = 0.0;
+            running.updates = 0;
+        }
+
+        // the new tuples, split into disjoint boxes: the ones whose
+        //  first new index is in dimension d have old indices before d.
+        double added = 0.0;
+        size_t num_tuples = 0;
+        ExpectedValueLoop loop_body(this, unit_probabilities, cur_strategy_estimators,
+                                    &added, fn, strategy_arg, &chooser_args[i], 1);
+        for (size_t d = 0; d < num_dims; ++d) {
+            vector<size_t> lows(num_dims, 0), dims(new_counts);
+            for (size_t e = 0; e < d; ++e) {
+                dims[e] = old_counts[e];
+            }
+            lows[d] = old_counts[d];
+            dims[d] = new_counts[d] - old_counts[d];
+
+            size_t box_tuples = 1;
+            for (size_t dim : dims) {
+                box_tuples *= dim;
+            }
+            if (box_tuples > 0) {
+                LoopRegion region(loop_body, lows);
+                NestedLoop loop;
+                loop.run_loop(region, dims);
+                num_tuples += box_tuples;
+            }
+        }
+        if (incremental && num_tuples > 0) {
+            ++running.updates;
+        }
+        running.sum += added;
+        values[i] = running.sum * probability;
+
+        inst::dbgprintf(DEBUG, "strategy \"%s\" (fn %s): %s, evaluated %zu tuples\n",
+                        strategy->getName(), get_value_name(strategy, fn).c_str(),
+                        incremental ? "updated running sum" : "recomputed running sum",
+                        num_tuples);
+
+        running.adjusted_values.clear();
+        for (size_t d = 0; d < num_dims; ++d) {
+            running.adjusted_values.push_back(*adjusted_values[d]);
+        }
+        std::lock_guard<std::mutex> lock(running_sums_mutex);
+        auto it = running_sums.find(key);
+        if (it != running_sums.end()) {
+            // the stored key points to this entry's copy, so keep it.
+            running.chooser_arg_copy = it->second.chooser_arg_copy;
+            it->second = running;
+        } else {
+            if (running_sums.size() >= MAX_RUNNING_SUMS) {
+                running_sums.clear();
+            }
+            running.chooser_arg_copy = copyChooserArg(chooser_args[i]);
+            RunningSumKey stored_key(strategy_index, fn, strategy_arg, running.chooser_arg_copy.get());
+            running_sums.emplace(stored_key, running);
+        }
+    }
+    return true;
+}
+
+// evaluation context for vectorized eval fns: a row of tuples in which
+//  only the last estimator's sample varies.  The last estimator's row
+//  is its adjusted values as they are; the others' rows repeat their
+//  current value, and are only refilled when that value changes.
+class EstimatorRows : public StrategyEvaluationContext {
+  public:
+    EstimatorRows(OptimizedGenericJointDistribution *distribution,
+                  const vector<Estimator *>& estimators_)
+        : estimators(estimators_), indices(estimators_.size(), 0), 
+          rows(estimators_.size()), has_rows(true)
+    {
+        assert(!estimators.empty());
+        for (Estimator *estimator : estimators) {
+            adjusted_values.push_back(&distribution->getAdjustedEstimatorValues(estimator));
+            if (adjusted_values.back()->empty()) {
+                has_rows = false;
+            }
+        }
+        length = adjusted_values.back()->size();
+        if (has_rows) {
+            for (size_t i = 0; i + 1 < estimators.size(); ++i) {
+                fillRow(i);
+            }
+        }
+    }
+
+    bool hasRows() const { return has_rows; }
+    size_t rowLength() const { return length; }
+    // the current row's sample indices; the last is always 0.
+    const vector<size_t>& rowIndices() const { return indices; }
+
+    // moves to the next row, in row-major order.  Returns false
+    //  after the last row.
+    bool nextRow() {
+        for (size_t i = estimators.size() - 1; i > 0; --i) {
+            size_t d = i - 1;
+            if (++indices[d] < adjusted_values[d]->size()) {
+                fillRow(d);
+                return true;
+            }
+            indices[d] = 0;
+            fillRow(d);
+        }
+        return false;
+    }
+
+    double getAdjustedEstimatorValue(Estimator *estimator) {
+        // the first tuple in the row; vectorized eval fns shouldn't need this.
+        for (size_t i = 0; i < estimators.size(); ++i) {
+            if (estimators[i] == estimator) {
+                return (*adjusted_values[i])[indices[i]];
+            }
+        }
+        return estimator->getEstimate();
+    }
+
+    const double *getAdjustedEstimatorRow(Estimator *estimator) {
+        size_t last = estimators.size() - 1;
+        for (size_t i = 0; i < last; ++i) {
+            if (estimators[i] == estimator) {
+                return rows[i].data();
+            }
+        }
+        if (estimators[last] == estimator) {
+            return adjusted_values[last]->data();
+        }
+        // not discovered as one of this strategy's estimators,
+        //  so there's no error distribution to draw from.
+        vector<double>& row = other_rows[estimator];
+        row.assign(length, estimator->getEstimate());
+        return row.data();
+    }
+
+  private:
+    vector<Estimator *> estimators;
+    vector<const vector<double> *> adjusted_values;
+    vector<size_t> indices;
+    vector<vector<double> > rows;
+    std::map<Estimator *, vector<double> > other_rows;
+    size_t length;
+    bool has_rows;
+
+    void fillRow(size_t i) {
+        rows[i].assign(length, (*adjusted_values[i])[indices[i]]);
+    }
+};
+
+bool
+OptimizedGenericJointDistribution::vectorExpectedValues(size_t strategy_index, typesafe_eval_fn_t fn,
+                                                        void **chooser_args, size_t num_args,
+                                                        double *values)
+{
+    Strategy *strategy = strategies[strategy_index];
+    vector<Estimator *>& cur_strategy_estimators = strategy_estimators[strategy_index];
+    if (strategy->isRedundant() || cur_strategy_estimators.empty()) {
+        return false;
+    }
+    eval_fn_type_t type = get_value_type(strategy, fn);
+    if (!strategy->isVectorized(type)) {
+        return false;
+    }
+
+    vector<vector<double> >& cur_strategy_probabilities = probabilities[strategy_index];
+    EstimatorRows rows(this, cur_strategy_estimators);
+    if (!rows.hasRows()) {
+        return true;
+    }
+
+    inst::dbgprintf(DEBUG, "strategy \"%s\" (fn %s): vectorized, rows of %zu\n",
+                    strategy->getName(), get_value_name(strategy, fn).c_str(),
+                    rows.rowLength());
+
+    size_t last = cur_strategy_estimators.size() - 1;
+    const vector<double>& row_probabilities = cur_strategy_probabilities[last];
+    vector<double> row_values(rows.rowLength());
+    do {
+        const vector<size_t>& indices = rows.rowIndices();
+        double probability = 1.0;
+        for (size_t d = 0; d < last; ++d) {
+            probability *= cur_strategy_probabilities[d][indices[d]];
+        }
+        if (probability == 0.0) {
+            continue;
+        }
+        for (size_t i = 0; i < num_args; ++i) {
+            strategy->calculateStrategyValues(type, &rows, chooser_args[i],
+                                              row_values.size(), row_values.data());
+            double row_sum = 0.0;
+            for (size_t k = 0; k < row_values.size(); ++k) {
+                row_sum += row_values[k] * row_probabilities[k];
+            }
+            values[i] += row_sum * probability;
+        }
+    } while (rows.nextRow());
+    return true;
+}
+
+// evaluation context for filling in a child strategy's table of values,
+//  one per tuple of the child's estimators' error samples.
+class ChildValuesTable : public StrategyEvaluationContext {
+  public:
+    ChildValuesTable(OptimizedGenericJointDistribution *distribution_,
+                     const vector<Estimator *>& estimators_)
+        : distribution(distribution_), estimators(estimators_), cur_indices(nullptr)
+    {
+        for (Estimator *estimator : estimators) {
+            adjusted_values.push_back(&distribution->getAdjustedEstimatorValues(estimator));
+        }
+    }
+
+    void fill(MultiDimensionArray<double>& table, Strategy *child, eval_fn_type_t type,
+              void *chooser_arg) {
+        if (child->isVectorized(type) && !estimators.empty()) {
+            // the table's last dimension is contiguous, so each row
+            //  goes straight into it.
+            EstimatorRows rows(distribution, estimators);
+            if (rows.hasRows()) {
+                size_t offset = 0;
+                do {
+                    child->calculateStrategyValues(type, &rows, chooser_arg, rows.rowLength(),
+                                                   &table.atOffset(offset));
+                    offset += rows.rowLength();
+                } while (rows.nextRow());
+            }
+            return;
+        }
+
+        MultiDimensionArray<double>::Iterator it(table);
+        cur_indices = &it.indices();
+        while (!it.isDone()) {
+            it.value() = child->calculateStrategyValue(type, this, chooser_arg);
+            it.advance();
+        }
+        cur_indices = nullptr;
+    }
+
+    double getAdjustedEstimatorValue(Estimator *estimator) {
+        for (size_t i = 0; i < estimators.size(); ++i) {
+            if (estimators[i] == estimator) {
+                return (*adjusted_values[i])[(*cur_indices)[i]];
+            }
+        }
+        return estimator->getEstimate();
+    }
+
+  private:
+    OptimizedGenericJointDistribution *distribution;
+    vector<Estimator *> estimators;
+    vector<const vector<double> *> adjusted_values;
+    const vector<size_t> *cur_indices;
+};
+
+bool
+OptimizedGenericJointDistribution::combinedExpectedValues(size_t strategy_index, typesafe_eval_fn_t fn,
+                                                          void **chooser_args, size_t num_args,
+                                                          double *values)
+{
+    combined_loop_fn_t loop = NULL;
+    if (fn == redundant_strategy_minimum_time) {
+        loop = min_loops[strategy_index];
+    } else if (fn == redundant_strategy_total_energy_cost ||
+               fn == redundant_strategy_total_data_cost) {
+        loop = sum_loops[strategy_index];
+    }
+    if (!loop) {
+        return false;
+    }
+
+    Strategy *strategy = strategies[strategy_index];
+    eval_fn_type_t type = get_value_type(strategy, fn);
+    vector<vector<double> >& cur_strategy_probabilities = probabilities[strategy_index];
+    vector<Estimator *>& cur_strategy_estimators = strategy_estimators[strategy_index];
+    size_t num_dims = cur_strategy_estimators.size();
+
+    CombinedLoopArgs args;
+    for (size_t d = 0; d < num_dims; ++d) {
+        args.probabilities[d] = cur_strategy_probabilities[d].data();
+        args.counts[d] = cur_strategy_probabilities[d].size();
+    }
+
+    // each child's values only vary with its own estimators, so a table
+    //  per child takes far fewer eval fn calls than the whole product;
+    //  the loop then broadcasts each table over the other dimensions.
+    //  Children without this eval fn don't add anything to the total.
+    vector<Strategy *> children;
+    vector<ChildValuesTable> contexts;
+    vector<MultiDimensionArray<double> > tables;
+    vector<CombinedLoopOperand> operands;
+    for (Strategy *child : strategy->getChildStrategies()) {
+        if (!child->getEvalFn(type)) {
+            continue;
+        }
+        vector<Estimator *> child_estimators;
+        vector<size_t> child_dims;
+        CombinedLoopOperand operand = {};
+        for (size_t d = 0; d < num_dims; ++d) {
+            if (child->usesEstimator(cur_strategy_estimators[d])) {
+                child_estimators.push_back(cur_strategy_estimators[d]);
+                child_dims.push_back(args.counts[d]);
+            }
+        }
+        if (child_dims.empty()) {
+            // a constant; one element, broadcast everywhere.
+            child_dims.push_back(1);
+        }
+        vector<size_t> child_strides(child_dims.size());
+        set_row_major_strides(child_dims.data(), child_dims.size(), child_strides.data());
+        for (size_t d = 0, k = 0; d < num_dims; ++d) {
+            if (k < child_estimators.size() && child_estimators[k] == cur_strategy_estimators[d]) {
+                operand.strides[d] = child_strides[k++];
+            }
+        }
+
+        children.push_back(child);
+        contexts.emplace_back(this, child_estimators);
+        tables.emplace_back(child_dims, 0.0);
+        operands.push_back(operand);
+    }
+    for (size_t c = 0; c < children.size(); ++c) {
+        operands[c].values = &tables[c].atOffset(0);
+    }
+    args.operands = operands.data();
+    args.num_operands = operands.size();
+
+    inst::dbgprintf(DEBUG, "strategy \"%s\" (fn %s): %zu-way combined loop over %zu children\n",
+                    strategy->getName(), get_value_name(strategy, fn).c_str(),
+                    num_dims, children.size());
+    for (size_t i = 0; i < num_args; ++i) {
+        for (size_t c = 0; c < children.size(); ++c) {
+            contexts[c].fill(tables[c], children[c], type, chooser_args[i]);
+        }
+        values[i] = loop(args);
+    }
+    return true;
+}
+
+// a tuple of ranks, one per estimator; rank r is the estimator's
+//  r-th most probable sample.
+struct RankedTuple {
+    double probability;
+    vector<size_t> ranks;
+    // the tuple's successors only increment ranks at or after this one,
+    //  so that each tuple is generated exactly once.
+    size_t last_incremented;
+
+    bool operator<(const RankedTuple& other) const {
+        return probability < other.probability;
+    }
+};
+
+double
+OptimizedGenericJointDistribution::expectedValueWithDeadline(Strategy *strategy, typesafe_eval_fn_t fn,
+                                                             void *strategy_arg, void *chooser_arg_,
+                                                             std::chrono::steady_clock::time_point deadline,
+                                                             double *coverage)
+{
+    if (!evaluationIsPrepared(chooser_arg_)) {
+        prepareEvaluation(chooser_arg_);
+    }
+
+    size_t strategy_index = getStrategyIndex(strategy);
+    vector<vector<double> >& cur_strategy_probabilities = probabilities[strategy_index];
+    vector<Estimator *>& cur_strategy_estimators = strategy_estimators[strategy_index];
+    size_t num_dims = cur_strategy_probabilities.size();
+
+    // each estimator's sample indices, most probable first.
+    vector<vector<size_t> > order(num_dims);
+    double total_mass = 1.0;
+    for (size_t d = 0; d < num_dims; ++d) {
+        const vector<double>& probs = cur_strategy_probabilities[d];
+        order[d].resize(probs.size());
+        std::iota(order[d].begin(), order[d].end(), 0);
+        std::stable_sort(order[d].begin(), order[d].end(), [&probs](size_t a, size_t b) {
+                return probs[a] > probs[b];
+            });
+        total_mass *= std::accumulate(probs.begin(), probs.end(), 0.0);
+    }
+    if (total_mass <= 0.0) {
+        *coverage = 1.0;
+        return 0.0;
+    }
+
+    double weightedSum = 0.0;
+    ExpectedValueLoop loop_body(this, cur_strategy_probabilities, cur_strategy_estimators,
+                                &weightedSum, fn, strategy_arg, &chooser_arg_, 1);
+
+    auto tuple_probability = [&](const vector<size_t>& ranks) {
+        double probability = 1.0;
+        for (size_t d = 0; d < num_dims; ++d) {
+            probability *= cur_strategy_probabilities[d][order[d][ranks[d]]];
+        }
+        return probability;
+    };
+
+    // best-first: each successor is no more probable than its parent,
+    //  so the queue always yields the most probable tuple not yet visited.
+    std::priority_queue<RankedTuple> frontier;
+    RankedTuple first = { 0.0, vector<size_t>(num_dims, 0), 0 };
+    first.probability = tuple_probability(first.ranks);
+    frontier.push(first);
+
+    const size_t DEADLINE_CHECK_INTERVAL = 16;
+    double visited_mass = 0.0;
+    size_t num_visited = 0;
+    vector<size_t> indices(num_dims);
+    while (!frontier.empty()) {
+        if (num_visited > 0 && num_visited % DEADLINE_CHECK_INTERVAL == 0 &&
+            std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+        RankedTuple tuple = frontier.top();
+        frontier.pop();
+        if (tuple.probability == 0.0) {
+            // everything left has zero probability.
+            visited_mass = total_mass;
+            break;
+        }
+
+        for (size_t d = 0; d < num_dims; ++d) {
+            indices[d] = order[d][tuple.ranks[d]];
+        }
+        loop_body(indices);
+        visited_mass += tuple.probability;
+        ++num_visited;
+
+        for (size_t d = tuple.last_incremented; d < num_dims; ++d) {
+            if (tuple.ranks[d] + 1 < order[d].size()) {
+                RankedTuple next = { 0.0, tuple.ranks, d };
+                ++next.ranks[d];
+                next.probability = tuple_probability(next.ranks);
+                frontier.push(next);
+            }
+        }
+    }
+
+    if (frontier.empty()) {
+        visited_mass = total_mass;
+    }
+    *coverage = std::min(1.0, visited_mass / total_mass);
+    inst::dbgprintf(DEBUG, "strategy \"%s\" (fn %s): visited %zu tuples, %f of probability mass\n",
+                    strategy->getName(), get_value_name(strategy, fn).c_str(),
+                    num_visited, *coverage);
+
+    // scale up the partial sum as though the unvisited tuples
+    //  had the same expected value as the visited ones.
+    return weightedSum * (total_mass / (visited_mass > 0.0 ? visited_mass : total_mass));
+}
+
+size_t
+OptimizedGenericJointDistribution::getStrategyIndex(Strategy *strategy)
+{
+    size_t strategy_index = strategies.size();
+    for (size_t i = 0; i < strategies.size(); ++i) {
+        if (strategy == strategies[i]) {
+            strategy_index = i;
+            break;
+        }
+    }
+    assert(strategy_index < strategies.size());
+    return strategy_index;
+}
+
+bool
+OptimizedGenericJointDistribution::evaluationIsPrepared(void *chooser_arg_)
+{
+    return samples_ready;
 }
 
 const vector<double>&
@@ -389,6 +1380,7 @@ OptimizedGenericJointDistribution::processObservation(Estimator *estimator, doub
     if (estimate_is_valid(old_estimate) && estimatorSamples.count(estimator) > 0) {
         // if there's a prior estimate, we can calculate an error sample
         double error = calculate_error(old_estimate, observation);
+        applyRetention(estimator, estimatorSamples[estimator]);
         estimatorSamples[estimator]->addValue(error);
         
         inst::dbgprintf(INFO, "IntNWJoint: Added error observation to estimator %s: %f\n", 
@@ -399,6 +1391,13 @@ OptimizedGenericJointDistribution::processObservation(Estimator *estimator, doub
     clearEstimatorSamplesDistributions();
 }
 
+void
+OptimizedGenericJointDistribution::setSketchSize(size_t max_centroids)
+{
+    resizeSketches(max_centroids, estimatorSamples, estimatorSamplesPlaceholders);
+    clearEstimatorSamplesDistributions();
+}
+
 void
 OptimizedGenericJointDistribution::processEstimatorConditionsChange(Estimator *estimator)
 {
@@ -4,6 +4,8 @@
 #include "abstract_joint_distribution.h"
 #include "small_map.h"
 #include "strategy.h"
+#include "combined_loop.h"
+#include "thread_pool.h"
 
 #include <nested_loop.h>
 
@@ -15,6 +17,9 @@ class StatsDistribution;
 #include <map>
 #include <string>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <tuple>
 
 class OptimizedGenericJointDistribution : public AbstractJointDistribution {
   public:
@@ -28,8 +33,59 @@ class OptimizedGenericJointDistribution : public AbstractJointDistribution {
                                       const std::vector<Strategy *>& strategies);
     ~OptimizedGenericJointDistribution();
 
-    virtual void setEvalArgs(void *strategy_arg_, void *chooser_arg_);
-    virtual double expectedValue(Strategy *strategy, typesafe_eval_fn_t fn);
+    virtual double expectedValue(Strategy *strategy, typesafe_eval_fn_t fn,
+                                 void *strategy_arg, void *chooser_arg_);
+
+    // the samples don't depend on the chooser_arg, so a batch shares
+    //  one extraction and one pass over the tuples.
+    virtual void expectedValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                void *strategy_arg, void **chooser_args, size_t num_args,
+                                double *values);
+
+    virtual bool minimumValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                               void *strategy_arg, void **chooser_args, size_t num_args,
+                               double *values);
+
+    // visits the tuples in order of decreasing joint probability,
+    //  so a cut-short evaluation covers as much probability mass as it can.
+    virtual double expectedValueWithDeadline(Strategy *strategy, typesafe_eval_fn_t fn,
+                                             void *strategy_arg, void *chooser_arg_,
+                                             std::chrono::steady_clock::time_point deadline,
+                                             double *coverage);
+
+    // all the per-call state lives in the loop body (ExpectedValueLoop),
+    //  and the samples are extracted once and then only read.
+    virtual bool evaluationIsReentrant() { return true; }
+    virtual void prepareEvaluation(void *chooser_arg_);
+
+    // redundant strategies are evaluated from scratch, not from
+    //  the singular strategies' results.
+    virtual bool strategyValuesAreReusable() { return true; }
+
+    // splits the exhaustive loop by the first estimator's samples.
+    //  Each slice gets its own sums, which are added up in slice order,
+    //  so the result doesn't depend on the thread count.
+    virtual void setLoopThreads(size_t num_threads, bool deterministic);
+
+    // keeps a running sum per singular strategy, fn, and chooser_arg,
+    //  and adds only the tuples with new samples to it, as long as
+    //  the old adjusted values are still there, unchanged, and every
+    //  sample is equally likely.  Vectorized strategies keep using
+    //  their rows.  Clears the running sums.
+    virtual void setIncrementalUpdates(size_t max_updates);
+
+    // merges each estimator's samples down (into equal-probability
+    //  groups, each at its mean) until every strategy's tuple count fits.
+    //  Estimators whose adjusted values are more spread out, relative
+    //  to their mean, keep more samples.  The time cap is converted to
+    //  tuples with the measured cost per tuple, so it follows the
+    //  cost of the eval fns.  Applied each time the samples are
+    //  extracted, i.e. after each observation.
+    virtual void setEvaluationBudget(size_t max_tuples_, double max_microseconds_);
+
+    // under a budget, an observation can shift the sample counts of
+    //  estimators that share a strategy with its estimator.
+    virtual bool valuesDependOnlyOnStrategyEstimators();
 
     virtual double getAdjustedEstimatorValue(Estimator *estimator);
 
@@ -37,6 +93,8 @@ class OptimizedGenericJointDistribution : public AbstractJointDistribution {
                                     double old_estimate, double new_estimate);
     virtual void processEstimatorConditionsChange(Estimator *estimator);
 
+    virtual void setSketchSize(size_t max_centroids);
+
     virtual void saveToFile(std::ofstream& out);
     virtual void restoreFromFile(std::ifstream& in);
 
@@ -44,8 +102,10 @@ class OptimizedGenericJointDistribution : public AbstractJointDistribution {
 
     const std::vector<double>& getAdjustedEstimatorValues(Estimator *estimator);
   protected:
-    void *strategy_arg;
-    void *chooser_arg;
+    // set once the samples below are extracted; they're shared by
+    //  every chooser_arg.  samples_mutex serializes the extraction.
+    std::atomic<bool> samples_ready;
+    std::mutex samples_mutex;
 
     EstimatorSamplesMap estimatorSamples;
     
@@ -56,15 +116,84 @@ class OptimizedGenericJointDistribution : public AbstractJointDistribution {
     std::vector<Strategy *> strategies;
     std::vector<std::vector<Estimator *> > strategy_estimators;
     
-    // for the brute-force nested loop
-    std::vector<NestedLoop> loops;
-    
     typedef std::vector<std::vector<std::vector< double> > > StrategyEstimatorSamples;
     StrategyEstimatorSamples probabilities;
     StrategyEstimatorSamples samples_values;
 
+    // per strategy: the loops that evaluate a redundant strategy from
+    //  its children's values, picked by estimator count at registration.
+    //  NULL for singular strategies, and where there's no instantiation.
+    std::vector<combined_loop_fn_t> min_loops;
+    std::vector<combined_loop_fn_t> sum_loops;
+
+    // NULL with one loop thread.  If deterministic_loops, the serial
+    //  loop is sliced too, so it matches the parallel one exactly.
+    std::unique_ptr<ThreadPool> loop_pool;
+    bool deterministic_loops;
+
+    // the unweighted sum of a strategy's values over every tuple of
+    //  the adjusted values it was computed from, and how many times
+    //  it's been updated since it was last computed from scratch.
+    struct RunningSum {
+        std::vector<std::vector<double> > adjusted_values;
+        double sum;
+        size_t updates;
+        // our copy of the chooser_arg in the key, so a caller may reuse its buffers.
+        std::shared_ptr<void> chooser_arg_copy;
+    };
+    // (strategy index, fn, strategy_arg, chooser_arg)
+    typedef std::tuple<size_t, typesafe_eval_fn_t, void *, void *> RunningSumKey;
+    // compares chooser_args with the evaluator's chooser_arg_less.
+    struct RunningSumKeyLess {
+        OptimizedGenericJointDistribution *distribution;
+        explicit RunningSumKeyLess(OptimizedGenericJointDistribution *distribution_)
+            : distribution(distribution_) {}
+        bool operator()(const RunningSumKey& left, const RunningSumKey& right) const;
+    };
+
+    size_t max_incremental_updates;
+    std::mutex running_sums_mutex;
+    std::map<RunningSumKey, RunningSum, RunningSumKeyLess> running_sums;
+
+    // see setEvaluationBudget.  ns_per_tuple is a moving average over
+    //  the first plain nested loop run after each extraction of the
+    //  samples; tuple_budget is converted from it when they're cleared.
+    size_t max_tuples;
+    double max_microseconds;
+    std::atomic<double> ns_per_tuple;
+    size_t tuple_budget;
+    std::atomic<bool> time_next_value;
+
+    // the most tuples per expected value, from both caps; 0 if none.
+    size_t tupleBudget();
+
+    // merges the extracted samples to fit the tuple budget.
+    void applyEvaluationBudget(size_t budget);
+
+    // returns false if the running sums can't be used for this strategy.
+    bool incrementalExpectedValues(size_t strategy_index, typesafe_eval_fn_t fn,
+                                   void *strategy_arg, void **chooser_args, size_t num_args,
+                                   double *values);
+
+    // the exhaustive loop, one slice per sample of the first estimator.
+    void slicedExpectedValues(size_t strategy_index, typesafe_eval_fn_t fn,
+                              void *strategy_arg, void **chooser_args, size_t num_args,
+                              double *values);
+
+    // returns false if the strategy can't use the combined loops.
+    bool combinedExpectedValues(size_t strategy_index, typesafe_eval_fn_t fn,
+                                void **chooser_args, size_t num_args, double *values);
+
+    // for singular strategies with a vectorized eval fn: one call per
+    //  row of tuples, rather than per tuple.  Returns false if the
+    //  strategy can't be evaluated that way.
+    bool vectorExpectedValues(size_t strategy_index, typesafe_eval_fn_t fn,
+                              void **chooser_args, size_t num_args, double *values);
+
     void getEstimatorSamplesDistributions();
     void clearEstimatorSamplesDistributions();
+    bool evaluationIsPrepared(void *chooser_arg_);
+    size_t getStrategyIndex(Strategy *strategy);
 
     EstimatorSamplesPlaceholderMap estimatorSamplesPlaceholders;
     Estimator *getExistingEstimator(const std::string& key);
@@ -45,20 +45,27 @@ static double *create_array(size_t length, double value)
     return array;
 }
 
+// the rows share one contiguous block, starting at array[0],
+//  so the combined loop can walk the whole array flat.
 static double **create_array(size_t dim1, size_t dim2, double value)
 {
-    double **array = new double*[dim1];
+    double **array = new double*[dim1 > 0 ? dim1 : 1];
+    double *block = create_array(dim1 * dim2, value);
+    array[0] = block;
     for (size_t i = 0; i < dim1; ++i) {
-        array[i] = create_array(dim2, value);
+        array[i] = block + i * dim2;
     }
     return array;
 }
 
+// likewise; the flat block starts at array[0][0].
 static double ***create_array(size_t dim1, size_t dim2, size_t dim3, double value)
 {
-    double ***array = new double**[dim1];
+    double ***array = new double**[dim1 > 0 ? dim1 : 1];
+    double **rows = create_array(dim1 * dim2, dim3, value);
+    array[0] = rows;
     for (size_t i = 0; i < dim1; ++i) {
-        array[i] = create_array(dim2, dim3, value);
+        array[i] = rows + i * dim2;
     }
     return array;
 }
@@ -68,22 +75,18 @@ static void destroy_array(double *array)
     delete [] array;
 }
 
-static void destroy_array(double **array, size_t dim1)
+static void destroy_array(double **array)
 {
     if (array) {
-        for (size_t i = 0; i < dim1; ++i) {
-            destroy_array(array[i]);
-        }
+        destroy_array(array[0]);
     }
     delete [] array;
 }
 
-static void destroy_array(double ***array, size_t dim1, size_t dim2)
+static void destroy_array(double ***array)
 {
     if (array) {
-        for (size_t i = 0; i < dim1; ++i) {
-            destroy_array(array[i], dim2);
-        }
+        destroy_array(array[0]);
     }
     delete [] array;
 }
@@ -173,6 +176,10 @@ RemoteExecJointDistribution::RemoteExecJointDistribution(StatsDistributionType d
         }
     }
     assert(singular_strategies.size() == REDUNDANT_STRATEGY_CHILDREN);
+
+    // the size estimator is shared, so there are only three loop dimensions.
+    min_loop = &combined_loop<MinCombiner, 3>;
+    sum_loop = &combined_loop<SumCombiner, 3>;
     
     singular_probabilities = new double**[singular_strategy_estimators.size()];
     singular_samples_values = new double**[singular_strategy_estimators.size()];
@@ -245,6 +252,8 @@ RemoteExecJointDistribution::getEstimatorSamplesDistributions()
 {
     for (size_t i = 0; i < singular_strategy_estimators.size(); ++i) {
         if (singular_probabilities[i][0] != NULL) {
+            // still valid; this chooser_arg might still need its memo arrays.
+            createMemoArrays();
             return;
         }
 
@@ -273,7 +282,16 @@ RemoteExecJointDistribution::getEstimatorSamplesDistributions()
             estimatorIndices[estimator] = 0;
         }
     }
+    createMemoArrays();
+}
+
+void
+RemoteExecJointDistribution::createMemoArrays()
+{
     for (size_t i = 0; i < NUM_SAVED_VALUE_TYPES; ++i) {
+        if (local_strategy_saved_values[i] != NULL) {
+            continue;
+        }
         local_strategy_saved_values[i] = create_array(singular_samples_count[LOCAL_STRATEGY_INDEX][0],
                                                       DBL_MAX);
         remote_strategy_saved_values[i] = create_array(singular_samples_count[REMOTE_STRATEGY_INDEX][0],
@@ -283,14 +301,88 @@ RemoteExecJointDistribution::getEstimatorSamplesDistributions()
     }
 }
 
+RemoteExecJointDistribution::MemoTable::MemoTable()
+{
+    for (size_t i = 0; i < NUM_SAVED_VALUE_TYPES; ++i) {
+        local_saved_values[i] = NULL;
+        remote_saved_values[i] = NULL;
+    }
+}
+
+void
+RemoteExecJointDistribution::swapMemoTable(MemoTable& table)
+{
+    for (size_t i = 0; i < NUM_SAVED_VALUE_TYPES; ++i) {
+        std::swap(local_strategy_saved_values[i], table.local_saved_values[i]);
+        std::swap(remote_strategy_saved_values[i], table.remote_saved_values[i]);
+    }
+    cache.swap(table.cache);
+}
+
+void
+RemoteExecJointDistribution::destroyMemoTable(MemoTable& table)
+{
+    for (size_t i = 0; i < NUM_SAVED_VALUE_TYPES; ++i) {
+        destroy_array(table.local_saved_values[i]);
+        destroy_array(table.remote_saved_values[i]);
+        table.local_saved_values[i] = NULL;
+        table.remote_saved_values[i] = NULL;
+    }
+    table.cache.clear();
+}
+
+void
+RemoteExecJointDistribution::switchMemoTable(void *new_chooser_arg)
+{
+    // park the current chooser_arg's table...
+    if (chooser_arg_copy) {
+        memo_tables.emplace_front(chooser_arg_copy, MemoTable());
+        swapMemoTable(memo_tables.front().second);
+    } else {
+        discardMemoTable();
+    }
+
+    // ...and bring back the new one's, if it's still around.
+    chooser_arg_copy.reset();
+    for (auto it = memo_tables.begin(); it != memo_tables.end(); ++it) {
+        if (chooserArgsEqual(it->first.get(), new_chooser_arg)) {
+            inst::dbgprintf(DEBUG, "RemoteExecJoint: reusing memoized values for chooser_arg %p\n",
+                            new_chooser_arg);
+            chooser_arg_copy = it->first;
+            swapMemoTable(it->second);
+            memo_tables.erase(it);
+            break;
+        }
+    }
+    if (!chooser_arg_copy) {
+        chooser_arg_copy = copyChooserArg(new_chooser_arg);
+    }
+    while (memo_tables.size() > MAX_MEMO_TABLES) {
+        destroyMemoTable(memo_tables.back().second);
+        memo_tables.pop_back();
+    }
+}
+
+void
+RemoteExecJointDistribution::discardMemoTable()
+{
+    MemoTable table;
+    swapMemoTable(table);
+    destroyMemoTable(table);
+}
+
 void 
 RemoteExecJointDistribution::clearEstimatorSamplesDistributions()
 {
+    // every chooser_arg's memoized values came from the old samples.
+    for (auto& entry : memo_tables) {
+        destroyMemoTable(entry.second);
+    }
+    memo_tables.clear();
+
     for (size_t i = 0; i < NUM_SAVED_VALUE_TYPES; ++i) {
         destroy_array(local_strategy_saved_values[i]);
-        destroy_array(remote_strategy_saved_values[i], 
-                      singular_samples_count[REMOTE_STRATEGY_INDEX][0],
-                      singular_samples_count[REMOTE_STRATEGY_INDEX][1]);
+        destroy_array(remote_strategy_saved_values[i]);
         local_strategy_saved_values[i] = NULL;
         remote_strategy_saved_values[i] = NULL;
     }
@@ -318,8 +410,13 @@ RemoteExecJointDistribution::clearEstimatorSamplesDistributions()
 void 
 RemoteExecJointDistribution::setEvalArgs(void *strategy_arg_, void *chooser_arg_)
 {
-    if (chooser_arg != chooser_arg_) {
-        clearEstimatorSamplesDistributions();
+    if (hasChooserArgComparator()) {
+        if (!chooser_arg_copy || !chooserArgsEqual(chooser_arg_copy.get(), chooser_arg_)) {
+            switchMemoTable(chooser_arg_);
+        }
+    } else if (chooser_arg != chooser_arg_) {
+        // nothing to key a parked table with.
+        discardMemoTable();
     }
 
     strategy_arg = strategy_arg_;
@@ -327,12 +424,16 @@ RemoteExecJointDistribution::setEvalArgs(void *strategy_arg_, void *chooser_arg_
 }
 
 double 
-RemoteExecJointDistribution::expectedValue(Strategy *strategy, typesafe_eval_fn_t fn)
+RemoteExecJointDistribution::expectedValue(Strategy *strategy, typesafe_eval_fn_t fn,
+                                           void *strategy_arg_, void *chooser_arg_)
 {
+    setEvalArgs(strategy_arg_, chooser_arg_);
+
     pair<Strategy *, typesafe_eval_fn_t> key = make_pair(strategy, fn);
     if (cache.count(key) == 0) {
         if (strategy->isRedundant()) {
-            assert(strategy->childrenAreDisjoint(fn));
+            // the children share the size estimator; the combined loop
+            //  gives it one dimension (see the constructor).
             cache[key] = redundantStrategyExpectedValue(strategy, fn);
         } else {
             cache[key] = singularStrategyExpectedValue(strategy, fn);
@@ -418,27 +519,6 @@ RemoteExecJointDistribution::singularStrategyExpectedValue(Strategy *strategy, t
     return weightedSum;
 }
 
-static inline double
-get_one_redundant_probability(double ***singular_probabilities,
-                              size_t strategy_index,
-                              size_t estimator_index,
-                              size_t distribution_index)
-{
-    return singular_probabilities[strategy_index][estimator_index][distribution_index];
-}
-
-#include <functional>
-
-static inline double min(double a, double b)
-{
-    return (a < b) ? a : b;
-}
-
-static inline double sum(double a, double b)
-{
-    return a + b;
-}
-
 static void ensure_valid(double& memoized_value)
 {
     if (memoized_value == DBL_MAX) {
@@ -503,22 +583,55 @@ RemoteExecJointDistribution::redundantStrategyExpectedValue(Strategy *strategy,
 }
 
 
-#include "tight_loop_remote_exec.h"
-
 double
 RemoteExecJointDistribution::redundantStrategyExpectedValueMin(size_t saved_value_type)
 {
-    double weightedSum = 0.0;
-    FN_BODY_WITH_COMBINER(weightedSum, min, saved_value_type);
-    return weightedSum;
+    return combinedExpectedValue(min_loop, saved_value_type);
 }
 
 double
 RemoteExecJointDistribution::redundantStrategyExpectedValueSum(size_t saved_value_type)
 {
-    double weightedSum = 0.0;
-    FN_BODY_WITH_COMBINER(weightedSum, sum, saved_value_type);
-    return weightedSum;
+    return combinedExpectedValue(sum_loop, saved_value_type);
+}
+
+double
+RemoteExecJointDistribution::combinedExpectedValue(combined_loop_fn_t loop, size_t saved_value_type)
+{
+    assert(local_strategy_saved_values[saved_value_type] != NULL);
+    assert(remote_strategy_saved_values[saved_value_type] != NULL);
+
+    // the remote strategy's estimators are (wifi-bw, wifi-rtt, size);
+    //  size is shared with the local strategy.
+    const size_t REMOTE_WIFI_BW_INDEX = 0;
+    const size_t REMOTE_WIFI_RTT_INDEX = 1;
+    const size_t REMOTE_SIZE_INDEX = 2;
+    size_t *remote_counts = singular_samples_count[REMOTE_STRATEGY_INDEX];
+    ASSERT(singular_samples_count[LOCAL_STRATEGY_INDEX][0] == remote_counts[REMOTE_SIZE_INDEX]);
+
+    // loop dimensions: wifi-bw, wifi-rtt, size.  Both strategies'
+    //  values are contiguous along size, so it goes innermost.
+    CombinedLoopArgs args;
+    args.probabilities[0] = singular_probabilities[REMOTE_STRATEGY_INDEX][REMOTE_WIFI_BW_INDEX];
+    args.counts[0] = remote_counts[REMOTE_WIFI_BW_INDEX];
+    args.probabilities[1] = singular_probabilities[REMOTE_STRATEGY_INDEX][REMOTE_WIFI_RTT_INDEX];
+    args.counts[1] = remote_counts[REMOTE_WIFI_RTT_INDEX];
+    args.probabilities[2] = singular_probabilities[LOCAL_STRATEGY_INDEX][0];
+    args.counts[2] = singular_samples_count[LOCAL_STRATEGY_INDEX][0];
+
+    CombinedLoopOperand operands[REDUNDANT_STRATEGY_CHILDREN] = {};
+    CombinedLoopOperand& local = operands[LOCAL_STRATEGY_INDEX];
+    CombinedLoopOperand& remote = operands[REMOTE_STRATEGY_INDEX];
+    local.values = local_strategy_saved_values[saved_value_type];
+    local.strides[2] = 1;
+
+    // the remote strategy's saved values are in the same order as the loop.
+    remote.values = remote_strategy_saved_values[saved_value_type][0][0];
+    set_row_major_strides(remote_counts, REMOTE_SIZE_INDEX + 1, remote.strides);
+
+    args.operands = operands;
+    args.num_operands = REDUNDANT_STRATEGY_CHILDREN;
+    return loop(args);
 }
 
 
@@ -544,6 +657,7 @@ RemoteExecJointDistribution::processObservation(Estimator *estimator, double obs
     if (estimate_is_valid(old_estimate) && estimatorSamples.count(estimator) > 0) {
         // if there's a prior estimate, we can calculate an error sample
         double error = calculate_error(old_estimate, observation);
+        applyRetention(estimator, estimatorSamples[estimator]);
         estimatorSamples[estimator]->addValue(error);
         
         inst::dbgprintf(INFO, "RemoteExecJoint: Added error observation to estimator %s: %f\n", 
@@ -554,6 +668,13 @@ RemoteExecJointDistribution::processObservation(Estimator *estimator, double obs
     clearEstimatorSamplesDistributions();
 }
 
+void
+RemoteExecJointDistribution::setSketchSize(size_t max_centroids)
+{
+    resizeSketches(max_centroids, estimatorSamples, estimatorSamplesPlaceholders);
+    clearEstimatorSamplesDistributions();
+}
+
 void
 RemoteExecJointDistribution::processEstimatorConditionsChange(Estimator *estimator)
 {
@@ -4,12 +4,15 @@
 #include "abstract_joint_distribution.h"
 #include "small_map.h"
 #include "strategy.h"
+#include "combined_loop.h"
 
 class Estimator;
 class StatsDistribution;
 
 #include <vector>
 #include <map>
+#include <list>
+#include <memory>
 #include <string>
 
 //#define DEBUG_REMOTE_EXEC_LOOP
@@ -25,18 +28,22 @@ class RemoteExecJointDistribution : public AbstractJointDistribution {
                                 const std::vector<Strategy *>& strategies);
     ~RemoteExecJointDistribution();
 
-    virtual void setEvalArgs(void *strategy_arg_, void *chooser_arg_);
-    virtual double expectedValue(Strategy *strategy, typesafe_eval_fn_t fn);
+    virtual double expectedValue(Strategy *strategy, typesafe_eval_fn_t fn,
+                                 void *strategy_arg_, void *chooser_arg_);
 
     virtual double getAdjustedEstimatorValue(Estimator *estimator);
     virtual void processObservation(Estimator *estimator, double observation,
                                     double old_estimate, double new_estimate);
     virtual void processEstimatorConditionsChange(Estimator *estimator);
+
+    virtual void setSketchSize(size_t max_centroids);
     virtual void processEstimatorReset(Estimator *estimator, const char *filename);
 
     virtual void saveToFile(std::ofstream& out);
     virtual void restoreFromFile(std::ifstream& in);
   protected:
+    void setEvalArgs(void *strategy_arg_, void *chooser_arg_);
+
     void *strategy_arg;
     void *chooser_arg;
 
@@ -55,13 +62,39 @@ class RemoteExecJointDistribution : public AbstractJointDistribution {
     double **local_strategy_saved_values;
     double ****remote_strategy_saved_values;
 
+    combined_loop_fn_t min_loop;
+    combined_loop_fn_t sum_loop;
+
     std::map<std::pair<Strategy *, typesafe_eval_fn_t>, double> cache;
 
+    // the memoized values and the cache above, for one chooser_arg.
+    //  See IntNWJointDistribution; the samples are shared by all of them.
+    struct MemoTable {
+        MemoTable();
+        double *local_saved_values[NUM_FNS];
+        double ***remote_saved_values[NUM_FNS];
+        std::map<std::pair<Strategy *, typesafe_eval_fn_t>, double> cache;
+    };
+    static const size_t MAX_MEMO_TABLES = 8;
+    // other chooser_args' tables, most recently used first, keyed by
+    //  copies of the chooser_args, so a caller may reuse its buffers.
+    //  Only kept if the evaluator has a chooser_arg comparator.
+    std::list<std::pair<std::shared_ptr<void>, MemoTable> > memo_tables;
+    // copy of chooser_arg, the key of the current table.
+    std::shared_ptr<void> chooser_arg_copy;
+
+    void switchMemoTable(void *new_chooser_arg);
+    void discardMemoTable();
+    void swapMemoTable(MemoTable& table);
+    void destroyMemoTable(MemoTable& table);
+    void createMemoArrays();
+
     double singularStrategyExpectedValue(Strategy *strategy, typesafe_eval_fn_t fn);
     double redundantStrategyExpectedValue(Strategy *strategy, typesafe_eval_fn_t fn);
 
     virtual double redundantStrategyExpectedValueMin(size_t saved_value_type);
     virtual double redundantStrategyExpectedValueSum(size_t saved_value_type);
+    double combinedExpectedValue(combined_loop_fn_t loop, size_t saved_value_type);
     
     void getEstimatorSamplesDistributions();
     void clearEstimatorSamplesDistributions();
@@ -75,9 +108,6 @@ class RemoteExecJointDistribution : public AbstractJointDistribution {
 
     virtual void addDefaultValue(Estimator *estimator);
 
-#ifdef DEBUG_REMOTE_EXEC_LOOP
-    void FN_BODY_WITH_COMBINER(double& weightedSum, double (*COMBINER)(double, double), size_t saved_value_type);
-#endif
   private:
     virtual void restoreFromFile(std::ifstream& in, const std::string& estimator_name);
 };
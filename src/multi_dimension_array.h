@@ -6,113 +6,208 @@
 #include <stdlib.h>
 #include <sys/types.h>
 
+/* N-dimensional array, stored flat in row-major order in one allocation.
+ *
+ * An element's offset is the dot product of its indices with the strides,
+ * which are precomputed; the last dimension is contiguous.  Walking the
+ * array with an Iterator keeps the offset up to date as the indices change,
+ * so the inner loop doesn't recompute it.
+ */
 template <typename T>
 class MultiDimensionArray {
   public:
     MultiDimensionArray<T>(const std::vector<size_t>& dimensions, const T& inital_value);
-    ~MultiDimensionArray();
-    
+
     const T& at(const std::vector<size_t>& indices) const;
     T& at(const std::vector<size_t>& indices);
-    
+
+    // the flat offset of the element at indices, for use with atOffset.
+    size_t offset(const std::vector<size_t>& indices) const;
+    const T& atOffset(size_t offset) const { return values[offset]; }
+    T& atOffset(size_t offset) { return values[offset]; }
+
+    const std::vector<size_t>& getDimensions() const { return dimensions; }
+    // offset distance between neighboring elements along a dimension.
+    size_t stride(size_t dimension) const { return strides[dimension]; }
+    size_t size() const { return num_elements; }
+
+    // sets every element to value.
+    void reset(const T& value);
+    // same, but changes the dimensions too.  Reuses the storage
+    //  if it's big enough, rather than reallocating.
+    void reset(const std::vector<size_t>& dimensions_, const T& value);
+
+    // changes the dimensions without touching the elements, which
+    //  keep their row-major order.  The number of elements can't change.
+    void reshape(const std::vector<size_t>& dimensions_);
+
+    class Iterator {
+      public:
+        // starts at the first element (all indices 0).
+        explicit Iterator(MultiDimensionArray<T>& array_);
+
+        // moves to the next element in row-major order.
+        void advance() {
+            assert(!done);
+            // row-major, so the next element is always the next offset;
+            //  usually only the innermost index changes.
+            ++cur_offset;
+            if (++position[innermost] == inner_size) {
+                carry();
+            }
+        }
+        bool isDone() const { return done; }
+
+        // moves along one dimension, leaving the other indices alone.
+        //  Once the iterator is done, the other indices are all 0.
+        void setIndex(size_t dimension, size_t index);
+
+        const std::vector<size_t>& indices() const { return position; }
+        size_t offset() const { return cur_offset; }
+        T& value() { return array.values[cur_offset]; }
+
+      private:
+        MultiDimensionArray<T>& array;
+        std::vector<size_t> position;
+        size_t cur_offset;
+        bool done;
+        size_t innermost;
+        size_t inner_size;
+
+        void carry();
+    };
+
   private:
-    void *the_array;
+    std::vector<T> values;
     std::vector<size_t> dimensions;
+    std::vector<size_t> strides;
     size_t num_dimensions;
-    
-    void *initializeArray(const T& initial_value, size_t next=0);
-    void destroyArray(void *array, size_t next=0);
-    T& at(void *array, const std::vector<size_t>& indices, size_t next);
+    size_t num_elements;
+
+    void setDimensions(const std::vector<size_t>& dimensions_);
 };
 
 template <typename T>
-MultiDimensionArray<T>::MultiDimensionArray(const std::vector<size_t>& dimensions_, 
+MultiDimensionArray<T>::MultiDimensionArray(const std::vector<size_t>& dimensions_,
                                             const T& initial_value)
-    : the_array(NULL)
+{
+    setDimensions(dimensions_);
+    values.assign(num_elements, initial_value);
+}
+
+template <typename T>
+void
+MultiDimensionArray<T>::setDimensions(const std::vector<size_t>& dimensions_)
 {
     dimensions = dimensions_;
     num_dimensions = dimensions.size();
-    if (num_dimensions > 0) {
-        the_array = initializeArray(initial_value);
+    strides.resize(num_dimensions);
+
+    // an array with no dimensions has no elements, not one.
+    num_elements = (num_dimensions > 0) ? 1 : 0;
+    for (size_t i = num_dimensions; i > 0; --i) {
+        strides[i - 1] = num_elements;
+        num_elements *= dimensions[i - 1];
     }
 }
 
 template <typename T>
-MultiDimensionArray<T>::~MultiDimensionArray()
+void
+MultiDimensionArray<T>::reset(const T& value)
 {
-    destroyArray(the_array);
+    values.assign(num_elements, value);
 }
 
 template <typename T>
-void *
-MultiDimensionArray<T>::initializeArray(const T& initial_value, size_t next)
+void
+MultiDimensionArray<T>::reset(const std::vector<size_t>& dimensions_, const T& value)
 {
-    if (next + 1 == num_dimensions) {
-        T *values = new T[dimensions[next]];
-        for (size_t i = 0; i < dimensions[next]; ++i) {
-            values[i] = initial_value;
-        }
-        return values;
-    }
-    void **bridges = new void *[dimensions[next]];
-    for (size_t i = 0; i < dimensions[next]; ++i) {
-        bridges[i] = initializeArray(initial_value, next + 1);
-    }
-    return bridges;
+    // assign doesn't give back capacity, so shrinking never reallocates.
+    setDimensions(dimensions_);
+    values.assign(num_elements, value);
 }
 
 template <typename T>
-void 
-MultiDimensionArray<T>::destroyArray(void *array, size_t next)
+void
+MultiDimensionArray<T>::reshape(const std::vector<size_t>& dimensions_)
 {
-    if (next + 1 == num_dimensions) {
-        T *valueArray = (T*) array;
-        delete [] valueArray;
-        return;
-    }
-    void **bridges = (void **)array;
-    for (size_t i = 0; i < dimensions[next]; ++i) {
-        destroyArray(bridges[i], next + 1);
+#ifndef NDEBUG
+    size_t old_num_elements = num_elements;
+#endif
+    setDimensions(dimensions_);
+    assert(num_elements == old_num_elements);
+}
+
+template <typename T>
+size_t
+MultiDimensionArray<T>::offset(const std::vector<size_t>& indices) const
+{
+    assert(indices.size() == num_dimensions);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < num_dimensions; ++i) {
+        assert(indices[i] < dimensions[i]);
+        offset += indices[i] * strides[i];
     }
-    delete [] bridges;
+    return offset;
 }
 
 template <typename T>
 const T& MultiDimensionArray<T>::at(const std::vector<size_t>& indices) const
 {
-    return at(the_array, indices, 0);
+    return values[offset(indices)];
 }
 
 template <typename T>
 T& MultiDimensionArray<T>::at(const std::vector<size_t>& indices)
 {
-    return at(the_array, indices, 0);
+    return values[offset(indices)];
 }
 
 template <typename T>
-T& MultiDimensionArray<T>::at(void *array, const std::vector<size_t>& indices, size_t next)
+MultiDimensionArray<T>::Iterator::Iterator(MultiDimensionArray<T>& array_)
+    : array(array_), position(array_.num_dimensions, 0), cur_offset(0),
+      done(array_.num_elements == 0), innermost(0), inner_size(0)
 {
-    assert(indices.size() == num_dimensions);
-    assert(indices[next] >= 0);
-    assert(indices[next] < dimensions[next]);
-    
-//#define RECURSIVE
-#ifdef RECURSIVE
-    if (next + 1 == num_dimensions) {
-        T *valuesArray = (T*) array;
-        return valuesArray[indices[next]];
+    if (!done) {
+        innermost = array.num_dimensions - 1;
+        inner_size = array.dimensions[innermost];
     }
-    void **bridges = (void **)array;
-    return at(bridges[indices[next]], indices, next + 1);
-#else
-    while (next + 1 < num_dimensions) {
-        void **bridges = (void **)array;
-        array = bridges[indices[next]];
-        ++next;
+}
+
+template <typename T>
+void
+MultiDimensionArray<T>::Iterator::carry()
+{
+    position[innermost] = 0;
+    for (size_t i = innermost; i > 0; --i) {
+        if (++position[i - 1] < array.dimensions[i - 1]) {
+            return;
+        }
+        position[i - 1] = 0;
     }
-    T *valuesArray = (T*) array;
-    return valuesArray[indices[next]];
-#endif
+    done = true;
+}
+
+template <typename T>
+void
+MultiDimensionArray<T>::Iterator::setIndex(size_t dimension, size_t index)
+{
+    assert(dimension < array.num_dimensions);
+    assert(index < array.dimensions[dimension]);
+
+    if (done) {
+        // past the end, cur_offset is size(), not the offset of position
+        //  (which carry() has wrapped back to all zeros), so start over.
+        position[dimension] = index;
+        cur_offset = array.offset(position);
+        done = false;
+        return;
+    }
+
+    // unsigned wraparound makes this right when moving backwards, too.
+    cur_offset += (index - position[dimension]) * array.strides[dimension];
+    position[dimension] = index;
 }
 
 #endif
@@ -1,17 +1,15 @@
-dofile("../common/r_premake.lua")
-
 project "InstrumentsLibrary"
   kind "SharedLib"
   language "C++"
   files { "**.cc" }
+  excludes { "r_singleton.cc" }
 
   includedirs { ".", "./evaluators", "./joint_distributions", "../../libcmm" }
 
   flags { "Symbols", "FatalWarnings" }
   links { "pthread", "mocktime", "flipflop" }
 
-  buildoptions { R_buildoptions(), "-Wall", "-std=c++11" }
-  linkoptions { R_linkoptions() }
+  buildoptions { "-Wall", "-std=c++11" }
   
   configuration "Debug"
     targetname "instruments_debug"
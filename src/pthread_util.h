@@ -81,7 +81,6 @@ class PthreadScopedLock {
     pthread_mutex_t *mutex;
 };
 
-#if 0
 class PthreadScopedRWLock {
   public:
     PthreadScopedRWLock() : mutex(NULL) {}
@@ -126,6 +125,7 @@ class PthreadScopedRWLock {
     bool writer;
 };
 
+#if 0
 template <typename T>
 class ThreadsafePrimitive {
   public:
@@ -0,0 +1,91 @@
+#ifndef RING_BUFFER_H_INCL_T6MX0QW2HN8C
+#define RING_BUFFER_H_INCL_T6MX0QW2HN8C
+
+#include <assert.h>
+#include <sys/types.h>
+
+#include <vector>
+
+/* A double-ended queue in one contiguous, power-of-two-sized array.
+ * Pushing at the back and popping at the front never move the other
+ * elements, and the storage only grows, so a bounded queue stops
+ * allocating once it reaches its bound.
+ */
+template <typename T>
+class RingBuffer {
+  public:
+    RingBuffer() : head(0), count(0) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T& operator[](size_t pos) {
+        assert(pos < count);
+        return storage[(head + pos) & mask()];
+    }
+    const T& operator[](size_t pos) const {
+        assert(pos < count);
+        return storage[(head + pos) & mask()];
+    }
+
+    T& front() { return (*this)[0]; }
+    T& back() { return (*this)[count - 1]; }
+
+    void push_back(const T& value) {
+        if (count == storage.size()) {
+            grow();
+        }
+        storage[(head + count) & mask()] = value;
+        ++count;
+    }
+
+    void pop_front() {
+        assert(count > 0);
+        head = (head + 1) & mask();
+        --count;
+    }
+
+    void pop_back() {
+        assert(count > 0);
+        --count;
+    }
+
+    // constant-time, but moves the back element into pos,
+    //  so only for contents whose order doesn't matter.
+    void erase_unordered(size_t pos) {
+        assert(pos < count);
+        (*this)[pos] = back();
+        pop_back();
+    }
+
+    void assign(size_t n, const T& value) {
+        clear();
+        for (size_t i = 0; i < n; ++i) {
+            push_back(value);
+        }
+    }
+
+    // keeps the storage.
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+
+  private:
+    std::vector<T> storage;
+    size_t head;
+    size_t count;
+
+    size_t mask() const { return storage.size() - 1; }
+
+    void grow() {
+        std::vector<T> bigger(storage.empty() ? 8 : storage.size() * 2);
+        for (size_t i = 0; i < count; ++i) {
+            bigger[i] = (*this)[i];
+        }
+        storage.swap(bigger);
+        head = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SAMPLE_RETENTION_H_INCL_K2W8RZ5QJ3VD
+#define SAMPLE_RETENTION_H_INCL_K2W8RZ5QJ3VD
+
+#include "instruments.h"
+
+// which error samples an estimator's distribution keeps.
+//  See set_estimator_sample_retention.
+struct SampleRetention {
+    instruments_sample_retention_t policy;
+    size_t max_samples;     // 0 means no limit.
+    double max_age_seconds; // MAX_AGE only; 0 means no limit.
+
+    SampleRetention()
+        : policy(INSTRUMENTS_RETAIN_ALL_SAMPLES), max_samples(0), max_age_seconds(0.0) {}
+
+    bool limitsAge() const {
+        return (policy == INSTRUMENTS_RETAIN_MAX_AGE && max_age_seconds > 0.0);
+    }
+
+    bool keepsAllSamples() const {
+        return (policy == INSTRUMENTS_RETAIN_ALL_SAMPLES ||
+                (max_samples == 0 && !limitsAge()));
+    }
+
+    bool operator==(const SampleRetention& other) const {
+        return (policy == other.policy &&
+                max_samples == other.max_samples &&
+                max_age_seconds == other.max_age_seconds);
+    }
+    bool operator!=(const SampleRetention& other) const {
+        return !(*this == other);
+    }
+};
+
+#endif
@@ -12,7 +12,7 @@ void
 StatsDistribution::finishIterator(Iterator *it)
 {
     iterators.erase(it);
-    delete it;
+    destroyIterator(it);
 }
 
 int
@@ -25,6 +25,9 @@ class StatsDistribution {
 
   protected:
     virtual Iterator *makeNewIterator() = 0;
+
+    // override to reuse iterators instead of deleting them.
+    virtual void destroyIterator(Iterator *it) { delete it; }
   private:
     small_set<Iterator *> iterators;
 };
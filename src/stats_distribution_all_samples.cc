@@ -1,4 +1,5 @@
 #include "stats_distribution_all_samples.h"
+#include "timeops.h"
 #include "debug.h"
 #include <assert.h>
 
@@ -10,21 +11,33 @@
 using std::string; using std::ifstream; using std::ofstream;
 using std::endl; using std::setprecision;
 using std::runtime_error; using std::count;
-using std::deque;
 
 #include "error_weight_params.h"
-using instruments::NEW_SAMPLE_WEIGHT;
 using instruments::MAX_SAMPLES;
-using instruments::calculate_sample_weight;
-using instruments::calculate_weighted_probability;
-using instruments::calculate_normalized_sample_weight;
+using instruments::get_weighted_sample_probabilities;
 
 
+// fixed, so that runs are reproducible.
+static const unsigned long RESERVOIR_SEED = 42;
+
+static double
+now_seconds()
+{
+    struct timeval now;
+    TIME(now);
+    return now.tv_sec + now.tv_usec / 1000000.0;
+}
+
 StatsDistributionAllSamples::StatsDistributionAllSamples(bool weighted_error_)
-    : weighted_error(weighted_error_)
+    : spare_iterator(NULL), num_seen(0), rng(RESERVOIR_SEED), weighted_error(weighted_error_)
 {
 }
 
+StatsDistributionAllSamples::~StatsDistributionAllSamples()
+{
+    delete spare_iterator;
+}
+
 double
 StatsDistributionAllSamples::getProbability(double value)
 {
@@ -40,32 +53,119 @@ StatsDistributionAllSamples::getProbability(double value)
 void 
 StatsDistributionAllSamples::addValue(double value)
 {
-    if (weighted_error && values.size() == MAX_SAMPLES) {
-        values.pop_front();
+    if (retention.policy == INSTRUMENTS_RETAIN_MAX_AGE) {
+        addValue(value, now_seconds());
+    } else {
+        addValue(value, 0.0);
     }
-    values.push_back(value);
 }
 
-double 
-StatsDistributionAllSamples::getWeight(size_t sample_index)
+void
+StatsDistributionAllSamples::addValue(double value, double timestamp)
 {
+    ++num_seen;
     if (weighted_error) {
-        return calculate_normalized_sample_weight(sample_index, values.size());
+        if (values.size() == MAX_SAMPLES) {
+            values.pop_front();
+        }
+        values.push_back(value);
+        return;
+    }
+
+    if (retention.policy == INSTRUMENTS_RETAIN_RESERVOIR &&
+        retention.max_samples > 0 && values.size() >= retention.max_samples) {
+        // Algorithm R: the new sample replaces a random one with
+        //  probability max_samples / num_seen.
+        std::uniform_int_distribution<size_t> pick(0, num_seen - 1);
+        size_t index = pick(rng);
+        if (index < values.size()) {
+            values[index] = value;
+        }
+        return;
+    }
+
+    values.push_back(value);
+    if (retention.policy == INSTRUMENTS_RETAIN_MAX_AGE) {
+        timestamps.push_back(timestamp);
+        enforceRetention(timestamp);
     } else {
-        return 1.0;
+        enforceRetention(0.0);
     }
 }
 
-double 
-StatsDistributionAllSamples::calculateProbability(size_t sample_index)
+void
+StatsDistributionAllSamples::enforceRetention(double now)
 {
-    return calculate_weighted_probability(values.size(), getWeight(sample_index));
+    if (retention.keepsAllSamples()) {
+        return;
+    }
+
+    // the newest sample always stays, so the distribution is never empty.
+    if (retention.limitsAge()) {
+        while (values.size() > 1 && now - timestamps.front() > retention.max_age_seconds) {
+            values.pop_front();
+            timestamps.pop_front();
+        }
+    }
+    if (retention.max_samples > 0) {
+        if (retention.policy == INSTRUMENTS_RETAIN_RESERVOIR) {
+            // only after shrinking the reservoir; keep a random subset.
+            //  Its order doesn't matter, so each removal is O(1).
+            while (values.size() > retention.max_samples) {
+                std::uniform_int_distribution<size_t> pick(0, values.size() - 1);
+                values.erase_unordered(pick(rng));
+            }
+        } else {
+            while (values.size() > retention.max_samples) {
+                values.pop_front();
+                if (!timestamps.empty()) {
+                    timestamps.pop_front();
+                }
+            }
+        }
+    }
+}
+
+void
+StatsDistributionAllSamples::setRetention(const SampleRetention& retention_)
+{
+    if (weighted_error || retention_ == retention) {
+        return;
+    }
+
+    double now = now_seconds();
+    if (retention_.policy == INSTRUMENTS_RETAIN_MAX_AGE) {
+        if (retention.policy != INSTRUMENTS_RETAIN_MAX_AGE) {
+            // their ages are unknown; count them from now.
+            timestamps.assign(values.size(), now);
+        }
+    } else {
+        timestamps.clear();
+    }
+    if (retention_.policy == INSTRUMENTS_RETAIN_RESERVOIR &&
+        retention.policy != INSTRUMENTS_RETAIN_RESERVOIR) {
+        // the reservoir starts from what's kept now.
+        num_seen = values.size();
+    }
+    retention = retention_;
+    enforceRetention(now);
+}
+
+SampleRetention
+StatsDistributionAllSamples::getRetention()
+{
+    return retention;
 }
 
 double
 StatsDistributionAllSamples::probabilityAtPosition(size_t pos)
 {
-    return calculateProbability(pos);
+    ASSERT(pos < values.size());
+    if (weighted_error) {
+        return get_weighted_sample_probabilities(values.size())[pos];
+    } else {
+        return 1.0 / values.size();
+    }
 }
 
 inline double 
@@ -77,7 +177,10 @@ StatsDistributionAllSamples::Iterator::probability()
 inline double 
 StatsDistributionAllSamples::Iterator::probability(size_t pos)
 {
-    return cached_probability[pos];
+    if (weighted_probabilities) {
+        return weighted_probabilities[pos];
+    }
+    return uniform_probability;
 }
 
 inline double
@@ -123,34 +226,86 @@ StatsDistributionAllSamples::Iterator::totalCount()
 }
 
 StatsDistributionAllSamples::Iterator::Iterator(StatsDistributionAllSamples *d)
-    : distribution(d), cur_position(0)
+    : distribution(d)
+{
+    attach();
+}
+
+// sees the samples as they are now.
+void
+StatsDistributionAllSamples::Iterator::attach()
 {
     ASSERT(distribution->values.size() > 0);
+    cur_position = 0;
     total_count = distribution->values.size();
-    cached_probability.resize(total_count);
-    
-    for (size_t i = 0; i < total_count; ++i) {
-        cached_probability[i] = distribution->probabilityAtPosition(i);
+    if (distribution->weighted_error) {
+        weighted_probabilities = get_weighted_sample_probabilities(total_count);
+    } else {
+        weighted_probabilities = NULL;
+        uniform_probability = 1.0 / total_count;
     }
 }
 
 StatsDistribution::Iterator *
 StatsDistributionAllSamples::makeNewIterator()
 {
+    if (spare_iterator) {
+        Iterator *it = spare_iterator;
+        spare_iterator = NULL;
+        it->attach();
+        return it;
+    }
     return new StatsDistributionAllSamples::Iterator(this);
 }
 
+void
+StatsDistributionAllSamples::destroyIterator(StatsDistribution::Iterator *it)
+{
+    if (spare_iterator) {
+        delete it;
+    } else {
+        spare_iterator = static_cast<Iterator *>(it);
+    }
+}
+
 #define VALUES_PER_LINE 5
 static const string TAG = "all-samples";
+static const string BOUNDED_TAG = "all-samples-bounded";
+
+static const char *POLICY_NAMES[] = {
+    "all", "sliding-window", "reservoir", "max-age"
+};
+static const size_t NUM_POLICIES = sizeof(POLICY_NAMES) / sizeof(POLICY_NAMES[0]);
 
 static int PRECISION = 20;
 
+/* With the default retention, the format is the same as before there
+ * were retention policies:
+ *   name all-samples num_values
+ *   value value ...
+ * Otherwise, the policy follows the count, and with MAX_AGE,
+ * each value is followed by its timestamp:
+ *   name all-samples-bounded num_values policy max_samples max_age num_seen
+ *   value [timestamp] value [timestamp] ...
+ */
 void 
 StatsDistributionAllSamples::appendToFile(const string& name, ofstream& out)
 {
-    out << name << " " << TAG << " " << values.size() << endl;;
+    bool bounded = (retention.policy != INSTRUMENTS_RETAIN_ALL_SAMPLES);
+    bool timestamped = (retention.policy == INSTRUMENTS_RETAIN_MAX_AGE);
+    if (bounded) {
+        out << name << " " << BOUNDED_TAG << " " << values.size() << " "
+            << POLICY_NAMES[retention.policy] << " " << retention.max_samples << " "
+            << setprecision(PRECISION) << retention.max_age_seconds << " "
+            << num_seen << endl;
+    } else {
+        out << name << " " << TAG << " " << values.size() << endl;
+    }
     for (size_t i = 0; i < values.size(); ++i) {
         out << setprecision(PRECISION) << values[i] << " ";
+        if (timestamped) {
+            out << setprecision(PRECISION) << timestamps[i] << " ";
+        }
         if ((i+1) % VALUES_PER_LINE == 0 || i+1 == values.size()) {
             out << endl;
         }
@@ -158,19 +313,59 @@ StatsDistributionAllSamples::appendToFile(const string& name, ofstream& out)
     check(out, "Failed to write values");
 }
 
+void
+read_bounded_samples_header(ifstream& in, SampleRetention& retention, size_t& num_seen)
+{
+    string policy_name;
+    check(in >> policy_name >> retention.max_samples
+          >> retention.max_age_seconds >> num_seen, "Failed to read retention fields");
+    for (size_t i = 0; i < NUM_POLICIES; ++i) {
+        if (policy_name == POLICY_NAMES[i]) {
+            retention.policy = instruments_sample_retention_t(i);
+            return;
+        }
+    }
+    throw runtime_error("Unknown retention policy: " + policy_name);
+}
+
 string
 StatsDistributionAllSamples::restoreFromFile(ifstream& in)
 {
     string name, type;
     int num_values = 0;
     check(in >> name >> type >> num_values, "Failed to read init fields");
-    check(type == TAG, "Distribution type mismatch");
+    check(type == TAG || type == BOUNDED_TAG, "Distribution type mismatch");
+
+    SampleRetention saved_retention;
+    size_t saved_num_seen = num_values;
+    if (type == BOUNDED_TAG) {
+        read_bounded_samples_header(in, saved_retention, saved_num_seen);
+    }
+    bool timestamped = (saved_retention.policy == INSTRUMENTS_RETAIN_MAX_AGE);
 
+    // the samples were kept under the saved policy;
+    //  restore them all, then apply it.
     values.clear();
+    timestamps.clear();
+    retention = SampleRetention();
     for (int i = 0; i < num_values; ++i) {
-        double value = 0.0;
+        double value = 0.0, timestamp = 0.0;
         check(in >> value, "Failed to read value");
-        addValue(value);
+        if (timestamped) {
+            check(in >> timestamp, "Failed to read timestamp");
+            timestamps.push_back(timestamp);
+        }
+        values.push_back(value);
+    }
+    if (weighted_error) {
+        timestamps.clear();
+        while (values.size() > MAX_SAMPLES) {
+            values.pop_front();
+        }
+    } else {
+        retention = saved_retention;
+        enforceRetention(now_seconds());
     }
+    num_seen = std::max(saved_num_seen, values.size());
     return name;
 }
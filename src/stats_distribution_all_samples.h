@@ -1,19 +1,31 @@
 #ifndef STATS_DISTRIBUTION_ALL_SAMPLES_H_INCL
 #define STATS_DISTRIBUTION_ALL_SAMPLES_H_INCL
 
-#include <deque>
+#include <random>
 #include "stats_distribution.h"
+#include "sample_retention.h"
+#include "ring_buffer.h"
 
 class StatsDistributionAllSamples : public StatsDistribution {
   public:
     StatsDistributionAllSamples(bool weighted_error_=false);
+    ~StatsDistributionAllSamples();
     virtual void addValue(double value);
+
+    // timestamp is in seconds, as from gettimeofday.
+    void addValue(double value, double timestamp);
+
+    // ignored if weighted_error is set.  Applies to the samples
+    //  already stored, too.
+    void setRetention(const SampleRetention& retention_);
+    SampleRetention getRetention();
     double getProbability(double value);
     virtual void appendToFile(const std::string& name, std::ofstream& out);
     virtual std::string restoreFromFile(std::ifstream& in);
 
     double probabilityAtPosition(size_t pos);
 
+    // a view of the samples; it holds no copy of them or their probabilities.
     class Iterator : StatsDistribution::Iterator {
       public:
         virtual double probability();
@@ -29,23 +41,46 @@ class StatsDistributionAllSamples : public StatsDistribution {
       private:
         friend class StatsDistributionAllSamples;
         Iterator(StatsDistributionAllSamples *d);
+        void attach();
+
         StatsDistributionAllSamples *distribution;
-        std::deque<double> cached_probability;
         size_t cur_position;
         size_t total_count;
+
+        // weighted: the probability of each sample.
+        //  unweighted: NULL, and each has uniform_probability.
+        const double *weighted_probabilities;
+        double uniform_probability;
     };
     
   protected:
     virtual StatsDistribution::Iterator *makeNewIterator();
+    virtual void destroyIterator(StatsDistribution::Iterator *it);
   private:
-    double getWeight(size_t sample_index);
-    double calculateProbability(size_t sample_index);
-    
-    std::deque<double> values;
+    RingBuffer<double> values;
+
+    // parallel to values; only kept for MAX_AGE retention.
+    RingBuffer<double> timestamps;
+
+    // the last finished iterator, kept for the next getIterator.
+    Iterator *spare_iterator;
+
+    SampleRetention retention;
+
+    // samples ever added, for reservoir sampling.
+    size_t num_seen;
+    std::mt19937_64 rng;
+
+    void enforceRetention(double now);
     
     // true iff distribution should use EWMA approach
     //  to de-emphasize older samples and emphasize newer samples
     bool weighted_error;
 };
 
+// reads the retention fields that follow the count in an
+//  "all-samples-bounded" header.  Throws runtime_error on failure.
+void read_bounded_samples_header(std::ifstream& in, SampleRetention& retention,
+                                 size_t& num_seen);
+
 #endif
@@ -8,48 +8,21 @@
 #include <iomanip>
 #include <vector>
 #include <stdexcept>
-using std::ostringstream; using std::string; using std::hex;
+using std::ostringstream; using std::string;
 using std::vector; using std::ifstream; using std::ofstream;
 using std::runtime_error;
 
-#include "small_set.h"
-#include "timeops.h"
-
-#ifndef ANDROID
-#include <RInside.h>
-using Rcpp::as;
-
-#include "r_singleton.h"
-
-void
-StatsDistributionBinned::initRInside()
-{
-    R = get_rinside_instance();
-    R->parseEvalQ("library(histogram)");
+#include <math.h>
+#include <float.h>
 
-    ostringstream oss;
-    oss << "samples_" << hex << this;
-    r_samples_name = oss.str();
-}
-#endif
+#include "small_set.h"
+#include "histogram_breaks.h"
 
 #include "debug.h"
 
-class NoRInsideOnAndroid : public runtime_error {
-  public:
-    NoRInsideOnAndroid() :
-        runtime_error("Can't auto-determine histogram bins on Android. (no R)") {}
-};
-
 StatsDistributionBinned::StatsDistributionBinned(bool weighted_error_)
-    : all_samples(weighted_error_), weighted_error(weighted_error_)
+    : all_samples(weighted_error_), preset_breaks(false), weighted_error(weighted_error_)
 {
-#ifdef ANDROID
-    throw NoRInsideOnAndroid();
-#else
-    initRInside();
-    preset_breaks = false;
-#endif
 }
 
 StatsDistributionBinned::StatsDistributionBinned(vector<double> new_breaks,
@@ -99,7 +72,7 @@ StatsDistributionBinned::create(Estimator *estimator, bool weighted_error_)
         EstimatorRangeHints hints = estimator->getRangeHints();
         return new StatsDistributionBinned(hints.min, hints.max, hints.num_bins, weighted_error_);
     } else {
-        ASSERT(false); // must have range hints to create histogram. (may change; probably not)
+        // picks its own bins once it has enough samples.
         return new StatsDistributionBinned(weighted_error_);
     }
 }
@@ -226,63 +199,32 @@ StatsDistributionBinned::makeNewIterator()
     }
 }
 
-void mark_timepoint(const char *msg)
-{
-    static std::string last_msg;
-    static struct timeval last_timestamp = {0, 0};
-
-    struct timeval now;
-    TIME(now);
-    
-    if (last_msg.length() > 0) {
-        struct timeval diff;
-        TIMEDIFF(last_timestamp, now, diff);
-        fprintf(stderr, "%s took %lu.%06lu seconds\n",
-                last_msg.c_str(), diff.tv_sec, diff.tv_usec);
-    }
-    if (msg) {
-        last_msg.assign(msg);
-    } else {
-        last_msg.assign("");
-    }
-    last_timestamp = now;
-}
-
 void StatsDistributionBinned::calculateBins()
 {
-#ifdef ANDROID
-    throw NoRInsideOnAndroid();
-#else
     assertValidHistogram();
 
     vector<double> samples(all_samples_sorted.begin(), all_samples_sorted.end());
-    std::set<double> unique_samples(samples.begin(), samples.end());
-    if (unique_samples.size() <= 1) {
-        // R's histogram function blows up if I pass a vector of one value
+    if (samples.front() == samples.back()) {
+        // one value doesn't make a histogram;
         // try again next sample
         return;
     }
 
-    R->assign(samples, r_samples_name);
-    //R->parseEval(string("print(") + r_samples_name + string(")"));
-
-    //mark_timepoint("calling histogram()");
-    ostringstream oss;
-    oss << "histogram::histogram(" << r_samples_name << ", verbose=FALSE, plot=FALSE)";
-    Rcpp::List hist_result = R->parseEval(oss.str());
-    //mark_timepoint(NULL);
-
-    breaks = as<vector<double> >(hist_result["breaks"]);
-    vector<double> tmp_mids = as<vector<double> >(hist_result["mids"]);
-    vector<int> tmp_counts = as<vector<int> >(hist_result["counts"]);
-    //fprintf(stderr, "histogram with %zu bins\n", tmp_counts.size());
+    breaks = choose_histogram_breaks(samples);
+    size_t num_bins = breaks.size() - 1;
 
     mids.assign(1, 0.0);
-    mids.insert(mids.end(), tmp_mids.begin(), tmp_mids.end());
+    for (size_t i = 0; i < num_bins; ++i) {
+        mids.push_back((breaks[i] + breaks[i+1]) / 2.0);
+    }
     mids.push_back(0.0);
 
-    counts.assign(tmp_counts.size() + 2, 0);
-    bin_weights.resize(tmp_counts.size() + 2, 0.0);
+    // the first bin includes its lower break, but getIndex would put
+    //  a value on that break in the left tail.
+    breaks[0] = nextafter(breaks[0], -DBL_MAX);
+
+    counts.assign(num_bins + 2, 0);
+    bin_weights.assign(num_bins + 2, 0.0);
     for (double sample : samples) {
         size_t index = getIndex(sample);
         updateBin(index, sample);
@@ -290,14 +232,9 @@ void StatsDistributionBinned::calculateBins()
     
     // tails are now empty, because all the data fits in the bins.
 
-    oss.str("");
-    oss << "remove(" << r_samples_name << ")";
-    R->parseEvalQ(oss.str());
-
     assertValidHistogram();
     
     //printHistogram();
-#endif
 }
 
 void
@@ -325,9 +262,6 @@ StatsDistributionBinned::printHistogram()
 bool
 StatsDistributionBinned::binsAreSet()
 {
-    // because I shouldn't be making histograms without range hints anymore.
-    ASSERT(!breaks.empty());
-    
     return (!breaks.empty());
 }
 
@@ -6,8 +6,6 @@
 #include "stats_distribution.h"
 #include "stats_distribution_all_samples.h"
 
-class RInside;
-
 class Estimator;
 
 class StatsDistributionBinned : public StatsDistribution {
@@ -90,11 +88,6 @@ class StatsDistributionBinned : public StatsDistribution {
 
     void updateBinWeights(int new_sample_bin);
 
-    std::string r_samples_name;
-    void initRInside();
-
-    RInside* R;
-
     void assertValidHistogram();
     void printHistogram();
 
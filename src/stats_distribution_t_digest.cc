@@ -0,0 +1,273 @@
+#include "stats_distribution_t_digest.h"
+#include "stats_distribution_all_samples.h"
+#include "debug.h"
+
+#include <math.h>
+
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+using std::string; using std::ifstream; using std::ofstream;
+using std::endl; using std::setprecision;
+using std::vector;
+
+// new samples wait in a buffer this many times max_centroids
+//  before they're merged in, so merging is amortized.
+static const size_t UNMERGED_FACTOR = 4;
+
+StatsDistributionTDigest::StatsDistributionTDigest(size_t max_centroids_)
+    : max_centroids(std::max<size_t>(max_centroids_, 2)), total_weight(0.0)
+{
+}
+
+void
+StatsDistributionTDigest::addValue(double value)
+{
+    unmerged.push_back(Centroid{value, 1.0});
+    total_weight += 1.0;
+    if (unmerged.size() >= UNMERGED_FACTOR * max_centroids) {
+        compress();
+    }
+}
+
+void
+StatsDistributionTDigest::merge(const StatsDistributionTDigest& other)
+{
+    unmerged.insert(unmerged.end(), other.centroids.begin(), other.centroids.end());
+    unmerged.insert(unmerged.end(), other.unmerged.begin(), other.unmerged.end());
+    total_weight += other.total_weight;
+    compress();
+}
+
+void
+StatsDistributionTDigest::setMaxCentroids(size_t max_centroids_)
+{
+    max_centroids = std::max<size_t>(max_centroids_, 2);
+    compress();
+}
+
+// the k1 scale function: a centroid may span at most 1 in k.
+//  Its slope is steepest near q = 0 and q = 1, so the tail
+//  centroids are the smallest.
+static double scale(double q, double compression)
+{
+    return compression / (2.0 * M_PI) * asin(2.0 * q - 1.0);
+}
+
+static double inverse_scale(double k, double compression)
+{
+    if (k >= compression / 4.0) {
+        return 1.0;
+    }
+    return (sin(k * 2.0 * M_PI / compression) + 1.0) / 2.0;
+}
+
+void
+StatsDistributionTDigest::compress()
+{
+    if (unmerged.empty() && centroids.size() <= max_centroids) {
+        return;
+    }
+    if (centroids.size() + unmerged.size() <= max_centroids) {
+        // they all fit; keep every sample as it is.
+        centroids.insert(centroids.end(), unmerged.begin(), unmerged.end());
+        unmerged.clear();
+        std::sort(centroids.begin(), centroids.end());
+        return;
+    }
+
+    // k1 gives at most about compression centroids, and usually fewer;
+    //  start high and tighten it until they fit.
+    double compression = 2.0 * max_centroids;
+    compress(compression);
+    while (centroids.size() > max_centroids) {
+        compression *= 0.8;
+        compress(compression);
+    }
+}
+
+void
+StatsDistributionTDigest::compress(double compression)
+{
+    vector<Centroid> all(centroids);
+    all.insert(all.end(), unmerged.begin(), unmerged.end());
+    unmerged.clear();
+    std::sort(all.begin(), all.end());
+
+    centroids.clear();
+    if (all.empty()) {
+        return;
+    }
+
+    double weight_so_far = 0.0;
+    double limit = total_weight * inverse_scale(scale(0.0, compression) + 1.0, compression);
+    Centroid cur = all[0];
+    for (size_t i = 1; i < all.size(); ++i) {
+        const Centroid& next = all[i];
+        if (weight_so_far + cur.weight + next.weight <= limit) {
+            cur.mean += (next.mean - cur.mean) * next.weight / (cur.weight + next.weight);
+            cur.weight += next.weight;
+        } else {
+            weight_so_far += cur.weight;
+            centroids.push_back(cur);
+            double q = weight_so_far / total_weight;
+            limit = total_weight * inverse_scale(scale(q, compression) + 1.0, compression);
+            cur = next;
+        }
+    }
+    centroids.push_back(cur);
+}
+
+double
+StatsDistributionTDigest::quantile(double q)
+{
+    compress();
+    ASSERT(!centroids.empty());
+
+    // interpolates between centroid means, treating each centroid's
+    //  mean as sitting at the middle of its weight.
+    double target = q * total_weight;
+    double weight_so_far = 0.0;
+    for (size_t i = 0; i < centroids.size(); ++i) {
+        double middle = weight_so_far + centroids[i].weight / 2.0;
+        if (target < middle) {
+            if (i == 0) {
+                return centroids[0].mean;
+            }
+            double prev_middle = weight_so_far - centroids[i - 1].weight / 2.0;
+            double fraction = (target - prev_middle) / (middle - prev_middle);
+            return centroids[i - 1].mean + fraction * (centroids[i].mean - centroids[i - 1].mean);
+        }
+        weight_so_far += centroids[i].weight;
+    }
+    return centroids.back().mean;
+}
+
+inline double
+StatsDistributionTDigest::Iterator::probability()
+{
+    return probability(cur_position);
+}
+
+inline double
+StatsDistributionTDigest::Iterator::probability(size_t pos)
+{
+    return distribution->centroids[pos].weight / distribution->total_weight;
+}
+
+inline double
+StatsDistributionTDigest::Iterator::value()
+{
+    return at(cur_position);
+}
+
+inline double
+StatsDistributionTDigest::Iterator::at(size_t pos)
+{
+    return distribution->centroids[pos].mean;
+}
+
+inline void
+StatsDistributionTDigest::Iterator::advance()
+{
+    ++cur_position;
+}
+
+inline bool
+StatsDistributionTDigest::Iterator::isDone()
+{
+    return (cur_position == distribution->centroids.size());
+}
+
+inline void
+StatsDistributionTDigest::Iterator::reset()
+{
+    cur_position = 0;
+}
+
+inline int
+StatsDistributionTDigest::Iterator::position()
+{
+    return cur_position;
+}
+
+inline int
+StatsDistributionTDigest::Iterator::totalCount()
+{
+    return distribution->centroids.size();
+}
+
+StatsDistributionTDigest::Iterator::Iterator(StatsDistributionTDigest *d)
+    : distribution(d), cur_position(0)
+{
+    // the iterator only sees merged centroids.
+    distribution->compress();
+}
+
+StatsDistribution::Iterator *
+StatsDistributionTDigest::makeNewIterator()
+{
+    return new StatsDistributionTDigest::Iterator(this);
+}
+
+static const string TAG = "t-digest";
+static const string ALL_SAMPLES_TAG = "all-samples";
+static const string BOUNDED_SAMPLES_TAG = "all-samples-bounded";
+
+static int PRECISION = 20;
+
+void
+StatsDistributionTDigest::appendToFile(const string& name, ofstream& out)
+{
+    compress();
+    out << name << " " << TAG << " " << centroids.size() << " " << max_centroids << endl;
+    for (const Centroid& centroid : centroids) {
+        out << setprecision(PRECISION) << centroid.mean << " " << centroid.weight << endl;
+    }
+    check(out, "Failed to write centroids");
+}
+
+string
+StatsDistributionTDigest::restoreFromFile(ifstream& in)
+{
+    string name, type;
+    int num_values = 0;
+    check(in >> name >> type >> num_values, "Failed to read init fields");
+    check(type == TAG || type == ALL_SAMPLES_TAG || type == BOUNDED_SAMPLES_TAG,
+          "Distribution type mismatch");
+
+    centroids.clear();
+    unmerged.clear();
+    total_weight = 0.0;
+    if (type == ALL_SAMPLES_TAG || type == BOUNDED_SAMPLES_TAG) {
+        // samples saved by an all-samples distribution; sketch them.
+        //  A sketch has no use for their retention policy.
+        SampleRetention retention;
+        size_t num_seen = 0;
+        if (type == BOUNDED_SAMPLES_TAG) {
+            read_bounded_samples_header(in, retention, num_seen);
+        }
+        for (int i = 0; i < num_values; ++i) {
+            double value = 0.0, timestamp = 0.0;
+            check(in >> value, "Failed to read value");
+            if (retention.policy == INSTRUMENTS_RETAIN_MAX_AGE) {
+                check(in >> timestamp, "Failed to read timestamp");
+            }
+            addValue(value);
+        }
+        return name;
+    }
+
+    size_t saved_max_centroids = 0;
+    check(in >> saved_max_centroids, "Failed to read max centroids");
+    for (int i = 0; i < num_values; ++i) {
+        Centroid centroid;
+        check(in >> centroid.mean >> centroid.weight, "Failed to read centroid");
+        unmerged.push_back(centroid);
+        total_weight += centroid.weight;
+    }
+    // keeps my own max_centroids, not the saved one.
+    compress();
+    return name;
+}
@@ -0,0 +1,81 @@
+#ifndef STATS_DISTRIBUTION_T_DIGEST_H_INCL_P4XG7NQ2VB8ELW3M
+#define STATS_DISTRIBUTION_T_DIGEST_H_INCL_P4XG7NQ2VB8ELW3M
+
+#include <vector>
+#include "stats_distribution.h"
+
+/* A quantile sketch (merging t-digest; Dunning and Ertl, "Computing
+ * extremely accurate quantiles using t-digests", 2019).  Samples are
+ * kept as weighted centroids, and neighbouring centroids are merged as
+ * long as each one covers a small enough slice of the quantile range.
+ * The slices are narrowest at the tails, so the extremes stay sharp.
+ *
+ * There are never more than max_centroids centroids, however many
+ * samples are added, so memory and the iteration width are bounded.
+ * Up to max_centroids samples, nothing is merged and the iterator
+ * gives the same values and probabilities as the unweighted
+ * all-samples distribution.
+ *
+ * Each centroid is one iteration position: its mean is the value,
+ * and its share of the total weight is the probability.
+ */
+class StatsDistributionTDigest : public StatsDistribution {
+  public:
+    static const size_t DEFAULT_MAX_CENTROIDS = 50;
+
+    StatsDistributionTDigest(size_t max_centroids_=DEFAULT_MAX_CENTROIDS);
+
+    virtual void addValue(double value);
+
+    // adds all of other's samples to this sketch.
+    void merge(const StatsDistributionTDigest& other);
+
+    // merges centroids if there are now too many.
+    void setMaxCentroids(size_t max_centroids_);
+    size_t getMaxCentroids() const { return max_centroids; }
+
+    // the value below which the given fraction of the samples lie.
+    double quantile(double q);
+
+    virtual void appendToFile(const std::string& name, std::ofstream& out);
+    virtual std::string restoreFromFile(std::ifstream& in);
+
+    class Iterator : StatsDistribution::Iterator {
+      public:
+        virtual double probability();
+        virtual double probability(size_t pos);
+        virtual double value();
+        virtual void advance();
+        virtual bool isDone();
+        virtual void reset();
+        virtual int position();
+        virtual int totalCount();
+        virtual double at(size_t pos);
+
+      private:
+        friend class StatsDistributionTDigest;
+        Iterator(StatsDistributionTDigest *d);
+        StatsDistributionTDigest *distribution;
+        size_t cur_position;
+    };
+
+  protected:
+    virtual StatsDistribution::Iterator *makeNewIterator();
+
+  private:
+    struct Centroid {
+        double mean;
+        double weight;
+        bool operator<(const Centroid& other) const { return mean < other.mean; }
+    };
+
+    size_t max_centroids;
+    std::vector<Centroid> centroids; // sorted by mean
+    std::vector<Centroid> unmerged;  // added since the last compress()
+    double total_weight;             // of centroids and unmerged
+
+    void compress();
+    void compress(double compression);
+};
+
+#endif
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <vector>
 #include <set>
+#include <deque>
 #include <string>
 #include <sstream>
 #include <iomanip>
@@ -37,6 +38,90 @@ Strategy::Strategy(eval_fn_t time_fn_,
     ASSERT(time_fn != data_cost_fn);
     ASSERT(energy_cost_fn != data_cost_fn);
     
+    for (size_t i = 0; i < NUM_FNS; ++i) {
+        vec_fns[i] = NULL;
+    }
+    vec_strategy_arg = NULL;
+
+    collectEstimators();
+    setEvalFnLookupArray();
+
+    ostringstream s;
+    s << hex << this;
+    name = s.str();
+}
+
+/* evaluation context for calling a vectorized eval fn on one tuple,
+ *  from wherever a scalar eval fn is expected. */
+class SingleTupleContext : public StrategyEvaluationContext {
+    StrategyEvaluationContext *ctx;
+    // a deque, so the rows already handed out don't move.
+    std::deque<double> values;
+  public:
+    SingleTupleContext(StrategyEvaluationContext *ctx_) : ctx(ctx_) {}
+
+    virtual double getAdjustedEstimatorValue(Estimator *estimator) {
+        if (ctx) {
+            return ctx->getAdjustedEstimatorValue(estimator);
+        }
+        // app just wants the raw value.
+        return estimator->getEstimate();
+    }
+    virtual const double *getAdjustedEstimatorRow(Estimator *estimator) {
+        values.push_back(getAdjustedEstimatorValue(estimator));
+        return &values.back();
+    }
+};
+
+static double
+vector_strategy_value(eval_fn_type_t type, StrategyEvaluationContext *ctx, 
+                      void *arg, void *chooser_arg)
+{
+    Strategy *strategy = (Strategy *) arg;
+    SingleTupleContext tuple(ctx);
+    double value = 0.0;
+    strategy->calculateStrategyValues(type, &tuple, chooser_arg, 1, &value);
+    return value;
+}
+
+static double
+vector_strategy_time(StrategyEvaluationContext *ctx, void *arg, void *chooser_arg)
+{
+    return vector_strategy_value(TIME_FN, ctx, arg, chooser_arg);
+}
+
+static double
+vector_strategy_energy_cost(StrategyEvaluationContext *ctx, void *arg, void *chooser_arg)
+{
+    return vector_strategy_value(ENERGY_FN, ctx, arg, chooser_arg);
+}
+
+static double
+vector_strategy_data_cost(StrategyEvaluationContext *ctx, void *arg, void *chooser_arg)
+{
+    return vector_strategy_value(DATA_FN, ctx, arg, chooser_arg);
+}
+
+Strategy::Strategy(eval_vec_fn_t time_fn_, 
+                   eval_vec_fn_t energy_cost_fn_, 
+                   eval_vec_fn_t data_cost_fn_, 
+                   void *strategy_arg_, 
+                   void *default_chooser_arg_)
+    : time_fn(time_fn_ ? vector_strategy_time : NULL),
+      energy_cost_fn(energy_cost_fn_ ? vector_strategy_energy_cost : NULL),
+      data_cost_fn(data_cost_fn_ ? vector_strategy_data_cost : NULL),
+      strategy_arg(this),
+      default_chooser_arg(default_chooser_arg_),
+      vec_strategy_arg(strategy_arg_)
+{
+    ASSERT(time_fn_ != energy_cost_fn_);
+    ASSERT(time_fn_ != data_cost_fn_);
+    ASSERT(energy_cost_fn_ != data_cost_fn_);
+
+    vec_fns[TIME_FN] = time_fn_;
+    vec_fns[ENERGY_FN] = energy_cost_fn_;
+    vec_fns[DATA_FN] = data_cost_fn_;
+
     collectEstimators();
     setEvalFnLookupArray();
 
@@ -176,7 +261,12 @@ Strategy::calculateCost(StrategyEvaluator *evaluator, void *chooser_arg,
 {
     double energy_cost = expectedValue(evaluator, energy_cost_fn, chooser_arg, comparison_type);
     double data_cost = expectedValue(evaluator, data_cost_fn, chooser_arg, comparison_type);
+    return weightedCost(evaluator, energy_cost, data_cost);
+}
 
+double
+Strategy::weightedCost(StrategyEvaluator *evaluator, double energy_cost, double data_cost)
+{
     double energy_weight = get_energy_cost_weight();
     double data_weight = get_data_cost_weight();
     if (!evaluator->isSilent()) {
@@ -188,6 +278,62 @@ Strategy::calculateCost(StrategyEvaluator *evaluator, void *chooser_arg,
     return ((energy_cost * energy_weight) + (data_cost * data_weight));
 }
 
+void
+Strategy::expectedValues(StrategyEvaluator *evaluator, typesafe_eval_fn_t fn,
+                         void **chooser_args, size_t num_args,
+                         ComparisonType comparison_type, double *values)
+{
+    if (fn == NULL || usesNoEstimators(fn)) {
+        for (size_t i = 0; i < num_args; ++i) {
+            values[i] = expectedValue(evaluator, fn, chooser_args[i], comparison_type);
+        }
+    } else {
+        evaluator->expectedValues(this, fn, strategy_arg, chooser_args, num_args,
+                                  values, comparison_type);
+    }
+}
+
+void
+Strategy::calculateTimes(StrategyEvaluator *evaluator, void **chooser_args, size_t num_args,
+                         ComparisonType comparison_type, double *times)
+{
+    expectedValues(evaluator, time_fn, chooser_args, num_args, comparison_type, times);
+}
+
+void
+Strategy::calculateCosts(StrategyEvaluator *evaluator, void **chooser_args, size_t num_args,
+                         ComparisonType comparison_type, double *costs)
+{
+    std::vector<double> energy_costs(num_args), data_costs(num_args);
+    expectedValues(evaluator, energy_cost_fn, chooser_args, num_args, comparison_type, energy_costs.data());
+    expectedValues(evaluator, data_cost_fn, chooser_args, num_args, comparison_type, data_costs.data());
+
+    for (size_t i = 0; i < num_args; ++i) {
+        costs[i] = weightedCost(evaluator, energy_costs[i], data_costs[i]);
+    }
+}
+
+bool
+Strategy::calculateMinimumTimes(StrategyEvaluator *evaluator, void **chooser_args, size_t num_args,
+                                double *times)
+{
+    if (time_fn == NULL || usesNoEstimators(time_fn)) {
+        for (size_t i = 0; i < num_args; ++i) {
+            times[i] = expectedValue(evaluator, time_fn, chooser_args[i], COMPARISON_TYPE_IRRELEVANT);
+        }
+        return true;
+    }
+    return evaluator->minimumValues(this, time_fn, strategy_arg, chooser_args, num_args, times);
+}
+
+void
+Strategy::calculateValues(StrategyEvaluator *evaluator, eval_fn_type_t type,
+                          void **chooser_args, size_t num_args,
+                          ComparisonType comparison_type, double *values)
+{
+    expectedValues(evaluator, fns[type], chooser_args, num_args, comparison_type, values);
+}
+
 bool
 Strategy::isRedundant()
 {
@@ -246,6 +392,11 @@ Strategy::Strategy(const instruments_strategy_t strategies[],
       data_cost_fn(redundant_strategy_total_data_cost),
       strategy_arg(this), default_chooser_arg(default_chooser_arg_)
 {
+    for (size_t i = 0; i < NUM_FNS; ++i) {
+        vec_fns[i] = NULL;
+    }
+    vec_strategy_arg = NULL;
+
     for (size_t i = 0; i < num_strategies; ++i) {
         this->child_strategies.push_back((Strategy *) strategies[i]);
     }
@@ -271,10 +422,16 @@ Strategy::includes(Strategy *child)
 bool
 Strategy::childrenAreDisjoint(typesafe_eval_fn_t fn)
 {
+    // fn is this strategy's; the children's estimators are under their own fns.
+    eval_fn_type_t type = get_value_type(this, fn);
     std::set<Estimator *> all_estimators;
     for (size_t i = 0; i < child_strategies.size(); ++i) {
         Strategy *child = child_strategies[i];
-        for (Estimator *estimator :  child->estimators[fn]) {
+        typesafe_eval_fn_t child_fn = child->fns[type];
+        if (!child_fn || child->usesNoEstimators(child_fn)) {
+            continue;
+        }
+        for (Estimator *estimator : child->estimators[child_fn]) {
             if (all_estimators.count(estimator) > 0) {
                 return false;
             }
@@ -301,6 +458,21 @@ Strategy::calculateStrategyValue(eval_fn_type_t type,
     return 0.0;
 }
 
+bool
+Strategy::isVectorized(eval_fn_type_t type)
+{
+    return vec_fns[type] != NULL;
+}
+
+void
+Strategy::calculateStrategyValues(eval_fn_type_t type, StrategyEvaluationContext *ctx,
+                                  void *chooser_arg, size_t count, double *values)
+{
+    ASSERT(vec_fns[type]);
+    vec_fns[type](static_cast<instruments_context_t>(ctx), vec_strategy_arg, chooser_arg,
+                  count, values);
+}
+
 std::set<Estimator *>
 Strategy::getEstimatorsSet()
 {
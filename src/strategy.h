@@ -38,6 +38,12 @@ class Strategy {
              eval_fn_t data_cost_fn_, 
              void *strategy_arg_,
              void *default_chooser_arg_);
+    // vectorized eval fns; the scalar eval fns call these with a row of one.
+    Strategy(eval_vec_fn_t time_fn_, 
+             eval_vec_fn_t energy_cost_fn_, 
+             eval_vec_fn_t data_cost_fn_, 
+             void *strategy_arg_,
+             void *default_chooser_arg_);
     Strategy(const instruments_strategy_t strategies[], 
              size_t num_strategies, void *default_chooser_arg_=nullptr);
 
@@ -47,11 +53,36 @@ class Strategy {
     void addEstimator(typesafe_eval_fn_t fn, Estimator *estimator);
     double calculateTime(StrategyEvaluator *evaluator, void *chooser_arg, ComparisonType comparison_type);
     double calculateCost(StrategyEvaluator *evaluator, void *chooser_arg, ComparisonType comparison_type);
+
+    // same as above, for a batch of chooser_args at once.
+    void calculateTimes(StrategyEvaluator *evaluator, void **chooser_args, size_t num_args,
+                        ComparisonType comparison_type, double *times);
+    void calculateCosts(StrategyEvaluator *evaluator, void **chooser_args, size_t num_args,
+                        ComparisonType comparison_type, double *costs);
+
+    // expected values of a single eval fn (unweighted, in the case of costs).
+    void calculateValues(StrategyEvaluator *evaluator, eval_fn_type_t type,
+                         void **chooser_args, size_t num_args,
+                         ComparisonType comparison_type, double *values);
+    // the least time the evaluator's samples allow, for each chooser_arg.
+    //  Returns false if the evaluator can't say.
+    bool calculateMinimumTimes(StrategyEvaluator *evaluator, void **chooser_args, size_t num_args,
+                               double *times);
+    // combines expected energy and data costs into the weighted cost,
+    //  using the current resource weights.
+    double weightedCost(StrategyEvaluator *evaluator, double energy_cost, double data_cost);
     bool isRedundant();
 
     double calculateStrategyValue(eval_fn_type_t type, 
                                   StrategyEvaluationContext *ctx, void *chooser_arg);
 
+    // true if the strategy has a vectorized eval fn of this type.
+    bool isVectorized(eval_fn_type_t type);
+    // evaluates a row of count tuples; ctx provides the rows
+    //  (see StrategyEvaluationContext::getAdjustedEstimatorRow).
+    void calculateStrategyValues(eval_fn_type_t type, StrategyEvaluationContext *ctx,
+                                 void *chooser_arg, size_t count, double *values);
+
     void getAllEstimators(StrategyEvaluator *evaluator);
     bool usesEstimator(Estimator *estimator);
     bool usesEstimator(typesafe_eval_fn_t fn, Estimator *estimator);
@@ -62,6 +93,8 @@ class Strategy {
 
     const std::vector<Strategy *>& getChildStrategies();
     bool includes(Strategy *child);
+    // true if no two children use the same estimator for
+    //  the value that this strategy's fn combines.
     bool childrenAreDisjoint(typesafe_eval_fn_t fn);
 
   private:
@@ -81,6 +114,11 @@ class Strategy {
     void *strategy_arg;
     void *default_chooser_arg;
 
+    // for vectorized strategies, strategy_arg is the strategy itself,
+    //  for the scalar adapters; the app's arg goes to these.
+    eval_vec_fn_t vec_fns[NUM_FNS];
+    void *vec_strategy_arg;
+
     std::string name;
 
     typesafe_eval_fn_t fns[NUM_FNS];
@@ -90,6 +128,9 @@ class Strategy {
 
     double expectedValue(StrategyEvaluator *evaluator, typesafe_eval_fn_t fn, void *chooser_arg,
                          ComparisonType comparison_type);
+    void expectedValues(StrategyEvaluator *evaluator, typesafe_eval_fn_t fn, 
+                        void **chooser_args, size_t num_args,
+                        ComparisonType comparison_type, double *values);
 
 
     std::map<typesafe_eval_fn_t, small_set<Estimator*> > estimators;
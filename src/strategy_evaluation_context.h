@@ -9,6 +9,11 @@ struct EstimatorContext;
 class StrategyEvaluationContext {
   public:
     virtual double getAdjustedEstimatorValue(Estimator *estimator) = 0;
+
+    // for vectorized eval fns: the estimator's values across the row
+    //  of tuples being evaluated.  Only the contexts that call
+    //  eval_vec_fn_t callbacks have rows.
+    virtual const double *getAdjustedEstimatorRow(Estimator *estimator) { return nullptr; }
 };
 
 #endif
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <math.h>
+#include <float.h>
 #include "strategy_evaluator.h"
 #include "trusted_oracle_strategy_evaluator.h"
 #include "empirical_error_strategy_evaluator.h"
@@ -18,25 +19,18 @@ using inst::INFO;
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/select.h>
 #include <signal.h>
 
 #include <vector>
 #include <map>
+#include <set>
+#include <functional>
+#include <algorithm>
+#include <chrono>
 using std::vector; using std::map;
-
-StrategyEvaluator::DelegatingChooserArgComparator::
-DelegatingChooserArgComparator(StrategyEvaluator *evaluator_)
-    : evaluator(evaluator_) 
-{
-}
-
-bool 
-StrategyEvaluator::DelegatingChooserArgComparator::
-operator()(void *left, void *right)
-{
-    return evaluator->chooser_arg_fns.chooser_arg_less(left, right);
-};
+using std::chrono::steady_clock;
 
 static int default_chooser_arg_less(void *left, void *right)
 {
@@ -53,19 +47,78 @@ static void default_delete_chooser_arg(void *arg)
     // no-op
 }
 
-struct instruments_chooser_arg_fns default_chooser_arg_fns = {
+static size_t default_chooser_arg_hash(void *arg)
+{
+    return std::hash<void *>()(arg);
+}
+
+struct instruments_chooser_arg_fns_v2 default_chooser_arg_fns = {
     default_chooser_arg_less,
     default_copy_chooser_arg,
-    default_delete_chooser_arg
+    default_delete_chooser_arg,
+    default_chooser_arg_hash
 };
 
+struct instruments_chooser_arg_fns_v2
+upgrade_chooser_arg_fns(struct instruments_chooser_arg_fns chooser_arg_fns)
+{
+    struct instruments_chooser_arg_fns_v2 fns = {
+        chooser_arg_fns.chooser_arg_less,
+        chooser_arg_fns.copy_chooser_arg,
+        chooser_arg_fns.delete_chooser_arg,
+        NULL
+    };
+    return fns;
+}
+
+thread_local StrategyEvaluator::EvaluationCall *StrategyEvaluator::current_call = nullptr;
+
+StrategyEvaluator::EvaluationCall::EvaluationCall(StrategyEvaluator *evaluator_, 
+                                                  double *coverage_out_)
+    : evaluator(evaluator_), deadline_active(false), 
+      values_remaining(0), coverage(1.0), coverage_out(coverage_out_)
+{
+}
+
+StrategyEvaluator::EvaluationCall::~EvaluationCall()
+{
+    if (coverage_out) {
+        *coverage_out = coverage.load();
+    }
+}
+
+// makes call the current one for this thread, for as long as it's in scope.
+class StrategyEvaluator::CallScope {
+  public:
+    explicit CallScope(EvaluationCall *call) : saved(current_call) {
+        current_call = call;
+    }
+    ~CallScope() {
+        current_call = saved;
+    }
+  private:
+    EvaluationCall *saved;
+};
+
+StrategyEvaluator::EvaluationCall *
+StrategyEvaluator::currentCall()
+{
+    // a strategy's eval fn might ask a different evaluator for a decision,
+    //  but that one's call is back out of scope by the time we get here.
+    if (current_call && current_call->evaluator == this) {
+        return current_call;
+    }
+    return NULL;
+}
+
 StrategyEvaluator::StrategyEvaluator(bool trivial)
-    : currentStrategy(NULL), silent(false), subscribe_all(!trivial), delegating_comparator(this),
+    : silent(false), subscribe_all(!trivial),
       chooser_arg_fns(default_chooser_arg_fns),
-      nonredundant_choice_cache(delegating_comparator),
-      redundant_choice_cache(delegating_comparator)
+      nonredundant_choice_cache(default_chooser_arg_fns),
+      redundant_choice_cache(default_chooser_arg_fns),
+      pruning_suspended(0), redundant_evaluated(0), redundant_pruned(0)
 {
-    MY_PTHREAD_MUTEX_INIT(&evaluator_mutex);
+    RWLOCK_INIT(&evaluator_lock, NULL);
     MY_PTHREAD_MUTEX_INIT(&cache_mutex);
     
     const int ASYNC_EVAL_THREADS = 3;
@@ -74,6 +127,7 @@ StrategyEvaluator::StrategyEvaluator(bool trivial)
     } else {
         pool = new ThreadPool(ASYNC_EVAL_THREADS);
     }
+    eval_pool = nullptr;
 }
 
 StrategyEvaluator::~StrategyEvaluator()
@@ -82,20 +136,156 @@ StrategyEvaluator::~StrategyEvaluator()
         estimator->unsubscribe(this);
     }
     delete pool;
+    delete eval_pool;
     clearCache();
 }
 
+void
+StrategyEvaluator::setEvaluationThreads(size_t num_threads)
+{
+    PthreadScopedRWLock lock(&evaluator_lock, true);
+    delete eval_pool;
+    eval_pool = nullptr;
+    if (num_threads > 1) {
+        // the thread calling chooseStrategy does its share of the work.
+        eval_pool = new ThreadPool(num_threads - 1);
+    }
+}
+
+void
+StrategyEvaluator::setLoopThreads(size_t num_threads, bool deterministic)
+{
+    PthreadScopedRWLock lock(&evaluator_lock, true);
+    setLoopThreadsImpl(num_threads, deterministic);
+    clearCache();
+}
+
+void
+StrategyEvaluator::setIncrementalUpdates(size_t max_updates)
+{
+    PthreadScopedRWLock lock(&evaluator_lock, true);
+    setIncrementalUpdatesImpl(max_updates);
+    clearCache();
+}
+
+void
+StrategyEvaluator::setEvaluationBudget(size_t max_tuples, double max_microseconds)
+{
+    PthreadScopedRWLock lock(&evaluator_lock, true);
+    setEvaluationBudgetImpl(max_tuples, max_microseconds);
+    clearCache();
+}
+
+void
+StrategyEvaluator::setSketchSize(size_t max_centroids)
+{
+    PthreadScopedRWLock lock(&evaluator_lock, true);
+    setSketchSizeImpl(max_centroids);
+    clearCache();
+}
+
+void
+StrategyEvaluator::setSampling(size_t num_samples, unsigned long seed)
+{
+    PthreadScopedRWLock lock(&evaluator_lock, true);
+    setSamplingImpl(num_samples, seed);
+    clearCache();
+}
+
+bool
+StrategyEvaluator::evaluationIsReentrant()
+{
+    // by default.  override in subclass if it's safe.
+    return false;
+}
+
 void
 StrategyEvaluator::setStrategies(const instruments_strategy_t *new_strategies,
                                  size_t num_strategies)
 {
     strategies.clear();
+    strategy_indices.clear();
     
     for (size_t i = 0; i < num_strategies; ++i) {
         Strategy *strategy = (Strategy *)new_strategies[i];
         strategy->getAllEstimators(this); // subscribes this to all estimators
+        strategy_indices[strategy] = strategies.size();
         strategies.push_back(strategy);
     }
+
+    strategy_parents.assign(strategies.size(), vector<size_t>());
+    for (size_t i = 0; i < strategies.size(); ++i) {
+        for (Strategy *child : strategies[i]->getChildStrategies()) {
+            if (strategy_indices.count(child) > 0) {
+                strategy_parents[strategy_indices[child]].push_back(i);
+            }
+        }
+    }
+    strategy_disabled.assign(strategies.size(), false);
+    disabled_count.assign(strategies.size(), 0);
+}
+
+bool
+StrategyEvaluator::strategyIsActive(size_t i)
+{
+    return disabled_count[i] == 0;
+}
+
+void
+StrategyEvaluator::setStrategyDisabled(size_t i, bool disabled)
+{
+    strategy_disabled[i] = disabled;
+    for (size_t index : strategy_parents[i]) {
+        disabled_count[index] += (disabled ? 1 : -1);
+    }
+    disabled_count[i] += (disabled ? 1 : -1);
+}
+
+bool
+StrategyEvaluator::disableStrategy(Strategy *strategy)
+{
+    PthreadScopedRWLock lock(&evaluator_lock, true);
+    auto it = strategy_indices.find(strategy);
+    if (it == strategy_indices.end()) {
+        return false;
+    }
+    if (strategy_disabled[it->second]) {
+        return true;
+    }
+    setStrategyDisabled(it->second, true);
+
+    // taking away a strategy that didn't win can only change a decision
+    //  if it was the best singular strategy that a redundant winner beat.
+    //  Cached values are still valid either way.  Invalidating before
+    //  the lock is released means no cached decision outlives the change.
+    bool singular = !strategy->isRedundant();
+    auto affected = [=](instruments_strategy_t winner) {
+        return (winner == strategy || 
+                (singular && static_cast<Strategy *>(winner)->isRedundant()));
+    };
+    nonredundant_choice_cache.invalidateWinners(affected);
+    redundant_choice_cache.invalidateWinners(affected);
+    return true;
+}
+
+bool
+StrategyEvaluator::enableStrategy(Strategy *strategy)
+{
+    PthreadScopedRWLock lock(&evaluator_lock, true);
+    auto it = strategy_indices.find(strategy);
+    if (it == strategy_indices.end()) {
+        return false;
+    }
+    if (!strategy_disabled[it->second]) {
+        return true;
+    }
+    setStrategyDisabled(it->second, false);
+
+    // a new candidate might beat any cached winner.
+    auto affected = [](instruments_strategy_t winner) { return true; };
+    nonredundant_choice_cache.invalidateWinners(affected);
+    redundant_choice_cache.invalidateWinners(affected);
+    return true;
 }
 
 void
@@ -136,7 +326,7 @@ StrategyEvaluator *
 StrategyEvaluator::create(const char *name_, 
                           const instruments_strategy_t *strategies,
                           size_t num_strategies,
-                          struct instruments_chooser_arg_fns chooser_arg_fns)
+                          struct instruments_chooser_arg_fns_v2 chooser_arg_fns)
 {
     return create(name_, strategies, num_strategies, DEFAULT_EVAL_METHOD, chooser_arg_fns);
 }
@@ -155,7 +345,7 @@ StrategyEvaluator *
 StrategyEvaluator::create(const char *name_, 
                           const instruments_strategy_t *strategies,
                           size_t num_strategies, EvalMethod type,
-                          struct instruments_chooser_arg_fns chooser_arg_fns_)
+                          struct instruments_chooser_arg_fns_v2 chooser_arg_fns_)
 {
     //wait_for_debugger();
 
@@ -178,8 +368,11 @@ StrategyEvaluator::create(const char *name_,
         __builtin_unreachable();
     }
     evaluator->setName(name_);
-    evaluator->setStrategies(strategies, num_strategies);
+    // before setStrategies, which may hand them to a joint distribution.
     evaluator->chooser_arg_fns = chooser_arg_fns_;
+    evaluator->nonredundant_choice_cache.setChooserArgFns(chooser_arg_fns_);
+    evaluator->redundant_choice_cache.setChooserArgFns(chooser_arg_fns_);
+    evaluator->setStrategies(strategies, num_strategies);
     return evaluator;
 }
 
@@ -207,36 +400,151 @@ StrategyEvaluator::isSilent()
     return silent;
 }
 
-instruments_strategy_t
-StrategyEvaluator::getCachedChoice(void *chooser_arg, bool redundancy)
+void
+StrategyEvaluator::setCacheSize(size_t max_entries)
 {
-    PthreadScopedLock lock(&cache_mutex);
-    
-    auto& cache = (redundancy ? redundant_choice_cache : nonredundant_choice_cache);
+    nonredundant_choice_cache.setMaxEntries(max_entries);
+    redundant_choice_cache.setMaxEntries(max_entries);
+}
 
-    auto it = cache.find(chooser_arg);
-    if (it != cache.end()) {
-        return it->second;
+void
+StrategyEvaluator::getStats(struct instruments_evaluator_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (ChoiceCache *cache : {&nonredundant_choice_cache, &redundant_choice_cache}) {
+        ChoiceCache::Stats cache_stats = cache->getStats();
+        stats->cache_hits += cache_stats.hits;
+        stats->cache_misses += cache_stats.misses;
+        stats->cache_evictions += cache_stats.evictions;
+        stats->cache_entries += cache_stats.entries;
     }
-    return NULL;
+    stats->redundant_strategies_evaluated = redundant_evaluated.load();
+    stats->redundant_strategies_pruned = redundant_pruned.load();
+}
+
+void
+StrategyEvaluator::suspendPruning()
+{
+    ++pruning_suspended;
+}
+
+void
+StrategyEvaluator::resumePruning()
+{
+    ASSERT(pruning_suspended.load() > 0);
+    --pruning_suspended;
+}
+
+vector<vector<bool> >
+StrategyEvaluator::pruneRedundantStrategies(void **chooser_args, size_t num_args, bool consider_cost,
+                                            const vector<vector<double> >& times, 
+                                            const vector<vector<double> >& costs,
+                                            const vector<double>& best_singular_time,
+                                            const vector<double>& best_singular_cost)
+{
+    vector<vector<bool> > pruned(strategies.size(), vector<bool>(num_args, false));
+    if (!consider_cost || singularComparisonIsDifferent() || pruning_suspended.load() > 0) {
+        // the singular costs weren't computed, or they aren't
+        //  comparable to the redundant ones.
+        return pruned;
+    }
+
+    vector<vector<double> > minimum_times(strategies.size()); // computed as needed
+    for (size_t i = 0; i < strategies.size(); ++i) {
+        if (!strategies[i]->isRedundant() || !strategyIsActive(i)) {
+            continue;
+        }
+        const vector<Strategy *>& children = strategies[i]->getChildStrategies();
+        vector<size_t> child_indices;
+        for (Strategy *child : children) {
+            auto it = strategy_indices.find(child);
+            if (it == strategy_indices.end() || child->isRedundant()) {
+                break;
+            }
+            child_indices.push_back(it->second);
+        }
+        if (child_indices.size() != children.size()) {
+            // some child wasn't evaluated, so there's no bound.
+            continue;
+        }
+
+        // its energy and data costs are the sums of its children's, 
+        //  so its (linearly) weighted expected cost is the sum of theirs too.
+        //  Its time is the minimum of theirs, tuple by tuple, so it's never
+        //  less than the least time any child takes on any tuple -- which
+        //  is at most the least expected time, so there's no use finding it
+        //  unless that would be enough for pruning.
+        vector<double> cost_bound(num_args, 0.0);
+        bool prunable = false;
+        for (size_t j = 0; j < num_args; ++j) {
+            double least_time = DBL_MAX;
+            for (size_t child_index : child_indices) {
+                cost_bound[j] += costs[child_index][j];
+                least_time = std::min(least_time, times[child_index][j]);
+            }
+            prunable = prunable || (least_time + cost_bound[j] >= 
+                                    best_singular_time[j] + best_singular_cost[j]);
+        }
+        if (!prunable) {
+            continue;
+        }
+
+        vector<double> time_bound(num_args, DBL_MAX);
+        for (size_t child_index : child_indices) {
+            vector<double>& child_minimums = minimum_times[child_index];
+            if (child_minimums.empty()) {
+                child_minimums.resize(num_args);
+                if (!strategies[child_index]->calculateMinimumTimes(this, chooser_args, num_args,
+                                                                    child_minimums.data())) {
+                    // this evaluator can't bound times, so none of them can be pruned.
+                    return pruned;
+                }
+            }
+            for (size_t j = 0; j < num_args; ++j) {
+                time_bound[j] = std::min(time_bound[j], child_minimums[j]);
+            }
+        }
+
+        for (size_t j = 0; j < num_args; ++j) {
+            // if the bounds alone are no better than the best singular
+            //  time + cost, its net benefit can't be positive.
+            if (time_bound[j] + cost_bound[j] >= best_singular_time[j] + best_singular_cost[j]) {
+                inst::dbgprintf(INFO, "Pruned redundant strategy \"%s\" "
+                                "(time + cost at least %f; best singular time + cost %f)\n",
+                                strategies[i]->getName(), time_bound[j] + cost_bound[j], 
+                                best_singular_time[j] + best_singular_cost[j]);
+                pruned[i][j] = true;
+            }
+        }
+    }
+    return pruned;
+}
+
+ChoiceCache&
+StrategyEvaluator::getChoiceCache(bool redundancy)
+{
+    return (redundancy ? redundant_choice_cache : nonredundant_choice_cache);
+}
+
+instruments_strategy_t
+StrategyEvaluator::getCachedChoice(void *chooser_arg, bool redundancy)
+{
+    // lock-free; cache hits never wait on an evaluation or an invalidation.
+    return getChoiceCache(redundancy).lookup(chooser_arg);
 }
 
 void
 StrategyEvaluator::saveCachedChoice(instruments_strategy_t winner, void *chooser_arg, bool redundancy,
+                                    unsigned long cache_generation,
+                                    const vector<Estimator *>& dependencies,
+                                    const vector<double>& value_memo,
                                     map<instruments_strategy_t, double>& strategy_times,
                                     map<instruments_strategy_t, double>& strategy_costs)
 {
-    PthreadScopedLock lock(&cache_mutex);
-    auto& cache = (redundancy ? redundant_choice_cache : nonredundant_choice_cache);
-
-    auto it = cache.find(chooser_arg);
-    if (it != cache.end()) {
-        it->second = winner;
-    } else {
-        void *my_copy = chooser_arg_fns.copy_chooser_arg(chooser_arg);
-        cache[my_copy] = winner;
-    }
+    getChoiceCache(redundancy).insert(chooser_arg, winner, cache_generation, 
+                                      dependencies, value_memo);
     
+    PthreadScopedLock lock(&cache_mutex);
     ASSERT(strategy_times.size() == strategy_costs.size());
     for (auto& p : strategy_times) {
         instruments_strategy_t strategy = p.first;
@@ -252,14 +560,6 @@ StrategyEvaluator::saveCachedChoice(instruments_strategy_t winner, void *chooser
 void
 StrategyEvaluator::clearCache()
 {
-    PthreadScopedLock lock(&cache_mutex);
-    for (auto &cache : {nonredundant_choice_cache, redundant_choice_cache}) {
-        for (auto& it : cache) {
-            void *my_copy = it.first;
-            chooser_arg_fns.delete_chooser_arg(my_copy);
-        }
-    }
-
     nonredundant_choice_cache.clear();
     redundant_choice_cache.clear();
 
@@ -269,23 +569,101 @@ StrategyEvaluator::clearCache()
     // a new strategy decision.
 }
 
+vector<Estimator *>
+StrategyEvaluator::getDecisionDependencies(bool redundancy)
+{
+    std::set<Estimator *> dependencies;
+    for (Strategy *strategy : strategies) {
+        if (redundancy || !strategy->isRedundant()) {
+            std::set<Estimator *> strategy_estimators = strategy->getEstimatorsSet();
+            dependencies.insert(strategy_estimators.begin(), strategy_estimators.end());
+        }
+    }
+    return vector<Estimator *>(dependencies.begin(), dependencies.end());
+}
+
+void
+StrategyEvaluator::invalidateCachedChoices(Estimator *estimator)
+{
+    invalidateCachedChoices(vector<Estimator *>(1, estimator));
+}
+
+void
+StrategyEvaluator::invalidateCachedChoices(const vector<Estimator *>& estimators)
+{
+    if (!valuesDependOnlyOnStrategyEstimators()) {
+        clearCache();
+        return;
+    }
+
+    auto uses_any = [&](Strategy *strategy, typesafe_eval_fn_t fn) {
+        for (Estimator *estimator : estimators) {
+            if (strategy->usesEstimator(fn, estimator)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    vector<size_t> stale_values;
+    if (strategyValuesAreReusable()) {
+        for (size_t i = 0; i < strategies.size(); ++i) {
+            for (int type = TIME_FN; type < NUM_FNS; ++type) {
+                typesafe_eval_fn_t fn = strategies[i]->getEvalFn((eval_fn_type_t) type);
+                if (fn && uses_any(strategies[i], fn)) {
+                    for (auto comparison_type : {COMPARISON_TYPE_IRRELEVANT, 
+                                                 SINGULAR_TO_SINGULAR, SINGULAR_TO_REDUNDANT}) {
+                        stale_values.push_back(valueMemoIndex(i, (eval_fn_type_t) type, 
+                                                              comparison_type));
+                    }
+                }
+            }
+        }
+    }
+    nonredundant_choice_cache.invalidate(estimators, stale_values);
+    redundant_choice_cache.invalidate(estimators, stale_values);
+}
+
 void
 StrategyEvaluator::observationAdded(Estimator *estimator, double observation, 
                                     double old_estimate, double new_estimate)
 {
-    clearCache();
+    {
+        PthreadScopedRWLock lock(&evaluator_lock, true);
+        processObservation(estimator, observation, old_estimate, new_estimate);
+    }
 
-    PthreadScopedLock lock(&evaluator_mutex);
-    processObservation(estimator, observation, old_estimate, new_estimate);
+    // after processing, so that no decision made before the evaluator
+    //  has seen the observation survives it.
+    invalidateCachedChoices(estimator);
 }
 
 void
-StrategyEvaluator::estimatorConditionsChanged(Estimator *estimator)
+StrategyEvaluator::observationsAdded(const vector<EstimatorObservation>& observations)
 {
-    clearCache();
+    vector<Estimator *> estimators;
+    {
+        PthreadScopedRWLock lock(&evaluator_lock, true);
+        for (const EstimatorObservation& record : observations) {
+            processObservation(record.estimator, record.observation, 
+                               record.old_estimate, record.new_estimate);
+            estimators.push_back(record.estimator);
+        }
+    }
 
-    PthreadScopedLock lock(&evaluator_mutex);
-    processEstimatorConditionsChange(estimator);
+    std::sort(estimators.begin(), estimators.end());
+    estimators.erase(std::unique(estimators.begin(), estimators.end()), estimators.end());
+    invalidateCachedChoices(estimators);
+}
+
+void
+StrategyEvaluator::estimatorConditionsChanged(Estimator *estimator)
+{
+    {
+        PthreadScopedRWLock lock(&evaluator_lock, true);
+        processEstimatorConditionsChange(estimator);
+    }
+    invalidateCachedChoices(estimator);
 }
 
 void 
@@ -293,7 +671,7 @@ StrategyEvaluator::resetError(Estimator *estimator)
 {
     clearCache();
 
-    PthreadScopedLock lock(&evaluator_mutex);
+    PthreadScopedRWLock lock(&evaluator_lock, true);
     const char *filename = nullptr;
     if (!last_history_filename.empty()) {
         filename = last_history_filename.c_str();
@@ -304,20 +682,274 @@ StrategyEvaluator::resetError(Estimator *estimator)
     processEstimatorReset(estimator, filename);
 }
 
+void
+StrategyEvaluator::expectedValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                  void *strategy_arg, void **chooser_args, size_t num_args,
+                                  double *values, ComparisonType comparison_type)
+{
+    for (size_t i = 0; i < num_args; ++i) {
+        values[i] = expectedValue(strategy, fn, strategy_arg, chooser_args[i], comparison_type);
+    }
+}
+
+size_t
+StrategyEvaluator::valueMemoSize()
+{
+    return strategies.size() * NUM_FNS * 3;
+}
+
+size_t
+StrategyEvaluator::valueMemoIndex(size_t strategy_index, eval_fn_type_t type, 
+                                  ComparisonType comparison_type)
+{
+    // three comparison types.
+    return (strategy_index * NUM_FNS + type) * 3 + comparison_type;
+}
+
+void
+StrategyEvaluator::evaluateStrategies(void **chooser_args, size_t num_args,
+                                      bool redundant, bool consider_cost,
+                                      ComparisonType comparison_type,
+                                      vector<vector<double> >& times, 
+                                      vector<vector<double> >& costs,
+                                      vector<vector<double> >& value_memos,
+                                      const vector<vector<bool> > *pruned)
+{
+    auto is_pruned = [&](size_t i, size_t j) {
+        return pruned && (*pruned)[i][j];
+    };
+
+    // computes only the values that aren't saved in value_memos.
+    auto calculate_values = [&](size_t i, eval_fn_type_t type, double *values) {
+        size_t memo_index = valueMemoIndex(i, type, comparison_type);
+        vector<void *> missing_args;
+        vector<size_t> missing_indices;
+        for (size_t j = 0; j < num_args; ++j) {
+            if (is_pruned(i, j)) {
+                continue;
+            }
+            if (!value_memos[j].empty() && !isnan(value_memos[j][memo_index])) {
+                values[j] = value_memos[j][memo_index];
+            } else {
+                missing_args.push_back(chooser_args[j]);
+                missing_indices.push_back(j);
+            }
+        }
+        if (missing_args.empty()) {
+            return;
+        }
+
+        vector<double> missing_values(missing_args.size());
+        strategies[i]->calculateValues(this, type, missing_args.data(), missing_args.size(),
+                                       comparison_type, missing_values.data());
+        for (size_t k = 0; k < missing_indices.size(); ++k) {
+            size_t j = missing_indices[k];
+            values[j] = missing_values[k];
+            if (!value_memos[j].empty()) {
+                value_memos[j][memo_index] = missing_values[k];
+            }
+        }
+    };
+
+    auto evaluate = [&](size_t i) {
+        Strategy *strategy = strategies[i];
+        inst::dbgprintf(INFO, "Evaluating %s strategy \"%s\"\n",
+                        redundant ? "redundant" : "singular", strategy->getName());
+        calculate_values(i, TIME_FN, times[i].data());
+        if (consider_cost) {
+            vector<double> energy_costs(num_args), data_costs(num_args);
+            calculate_values(i, ENERGY_FN, energy_costs.data());
+            calculate_values(i, DATA_FN, data_costs.data());
+            for (size_t j = 0; j < num_args; ++j) {
+                if (!is_pruned(i, j)) {
+                    costs[i][j] = strategy->weightedCost(this, energy_costs[j], data_costs[j]);
+                }
+            }
+        }
+        for (size_t j = 0; j < num_args; ++j) {
+            ASSERT(!isnan(times[i][j]));
+            ASSERT(!isnan(costs[i][j]));
+        }
+    };
+
+    vector<size_t> indices;
+    for (size_t i = 0; i < strategies.size(); ++i) {
+        if (strategies[i]->isRedundant() == redundant && strategyIsActive(i)) {
+            indices.push_back(i);
+        }
+    }
+
+    if (eval_pool && indices.size() > 1 && evaluationIsReentrant()) {
+        // each worker writes only its own strategies' slots;
+        //  the caller picks the winner afterwards, in the same order
+        //  as the serial loop, so the choice doesn't depend on timing.
+        prepareEvaluation(chooser_args[0]);
+        EvaluationCall *call = currentCall();
+        eval_pool->parallelFor(indices.size(), [&](size_t j) {
+                CallScope call_scope(call);
+                evaluate(indices[j]);
+            });
+    } else {
+        for (size_t i : indices) {
+            evaluate(i);
+        }
+    }
+}
+
 instruments_strategy_t
 StrategyEvaluator::chooseStrategy(void *chooser_arg, bool redundancy, bool consider_cost)
 {
-    instruments_strategy_t cached_choice = getCachedChoice(chooser_arg, redundancy);
-    if (cached_choice) {
-        return cached_choice;
+    instruments_strategy_t winner = NULL;
+    chooseStrategies(&chooser_arg, 1, &winner, redundancy, consider_cost);
+    return winner;
+}
+
+instruments_strategy_t
+StrategyEvaluator::chooseStrategyWithDeadline(void *chooser_arg, double max_micros,
+                                              double *coverage)
+{
+    instruments_strategy_t winner = NULL;
+    chooseStrategies(&chooser_arg, 1, &winner, true, true, max_micros, coverage);
+    return winner;
+}
+
+void
+StrategyEvaluator::chooseStrategies(void **chooser_args, size_t num_args,
+                                    instruments_strategy_t *chosen_strategies,
+                                    bool redundancy, bool consider_cost)
+{
+    chooseStrategies(chooser_args, num_args, chosen_strategies, 
+                     redundancy, consider_cost, 0.0, NULL);
+}
+
+void
+StrategyEvaluator::startEvaluationDeadline(EvaluationCall& call, double max_micros, 
+                                           bool redundancy, bool consider_cost)
+{
+    // count the expected values the decision needs.
+    long num_values = 0;
+    for (size_t i = 0; i < strategies.size(); ++i) {
+        Strategy *strategy = strategies[i];
+        bool redundant = strategy->isRedundant();
+        if ((redundant && !redundancy) || !strategyIsActive(i)) {
+            continue;
+        }
+        for (int type = TIME_FN; type < NUM_FNS; ++type) {
+            if (type != TIME_FN && !consider_cost && !redundant) {
+                continue;
+            }
+            if (strategy->getEvalFn((eval_fn_type_t) type)) {
+                ++num_values;
+            }
+        }
     }
 
-    PthreadScopedLock lock(&evaluator_mutex);
-    
-    ASSERT(currentStrategy == NULL);
+    call.deadline_active = true;
+    auto budget = std::chrono::duration<double, std::micro>(max_micros > 0.0 ? max_micros : 0.0);
+    call.deadline = steady_clock::now() + 
+        std::chrono::duration_cast<steady_clock::duration>(budget);
+    call.values_remaining = num_values;
+    call.coverage = 1.0;
+}
+
+bool
+StrategyEvaluator::hasEvaluationDeadline()
+{
+    EvaluationCall *call = currentCall();
+    return call && call->deadline_active;
+}
+
+steady_clock::time_point
+StrategyEvaluator::nextValueDeadline()
+{
+    EvaluationCall *call = currentCall();
+    ASSERT(call && call->deadline_active);
+    long remaining = call->values_remaining.fetch_sub(1);
+    steady_clock::time_point now = steady_clock::now();
+    if (remaining <= 1 || now >= call->deadline) {
+        return call->deadline;
+    }
+    return now + (call->deadline - now) / remaining;
+}
+
+void
+StrategyEvaluator::reportCoverage(double coverage)
+{
+    EvaluationCall *call = currentCall();
+    ASSERT(call);
+    double cur = call->coverage.load();
+    while (coverage < cur && !call->coverage.compare_exchange_weak(cur, coverage)) {}
+}
+
+void
+StrategyEvaluator::chooseStrategies(void **chooser_args, size_t num_args,
+                                    instruments_strategy_t *chosen_strategies,
+                                    bool redundancy, bool consider_cost,
+                                    double max_micros, double *coverage)
+{
+    if (coverage) {
+        *coverage = 1.0;
+    }
+
+    // read this before looking at the estimators, so we don't cache
+    //  decisions computed from estimates that change in the meantime.
+    unsigned long cache_generation = getChoiceCache(redundancy).generation();
+
+    vector<void *> uncached_args;
+    vector<size_t> uncached_indices;
+    for (size_t j = 0; j < num_args; ++j) {
+        chosen_strategies[j] = getCachedChoice(chooser_args[j], redundancy);
+        if (!chosen_strategies[j]) {
+            uncached_args.push_back(chooser_args[j]);
+            uncached_indices.push_back(j);
+        }
+    }
+    if (uncached_args.empty()) {
+        return;
+    }
+
+    // reentrant evaluations don't touch anything that concurrent
+    //  decisions share, besides the estimates, which only change 
+    //  under the exclusive lock.
+    PthreadScopedRWLock lock(&evaluator_lock, !evaluationIsReentrant());
+
+    EvaluationCall call(this, coverage);
+    if (coverage) {
+        startEvaluationDeadline(call, max_micros, redundancy, consider_cost);
+    }
+    CallScope call_scope(&call);
+
+    size_t num_uncached = uncached_args.size();
+    vector<map<instruments_strategy_t, double> > strategy_times(num_uncached);
+    vector<map<instruments_strategy_t, double> > strategy_costs(num_uncached);
+
+    // times[strategy_index][arg_index]
+    vector<vector<double> > times(strategies.size(), vector<double>(num_uncached, 0.0));
+    vector<vector<double> > costs(strategies.size(), vector<double>(num_uncached, 0.0));
+
+    // expected values saved from earlier decisions, minus any 
+    //  that depended on estimators that have changed since.
+    vector<vector<double> > value_memos(num_uncached);
+    if (strategyValuesAreReusable()) {
+        ChoiceCache& cache = getChoiceCache(redundancy);
+        for (size_t j = 0; j < num_uncached; ++j) {
+            if (!cache.lookupValues(uncached_args[j], value_memos[j])) {
+                value_memos[j].assign(valueMemoSize(), NAN);
+            }
+        }
+    }
+    vector<Estimator *> dependencies;
+    if (valuesDependOnlyOnStrategyEstimators()) {
+        dependencies = getDecisionDependencies(redundancy);
+    }
 
-    map<instruments_strategy_t, double> strategy_times;
-    map<instruments_strategy_t, double> strategy_costs;
+    // a decision made from part of the distribution isn't worth caching.
+    auto save_choice = [&](instruments_strategy_t winner, size_t j) {
+        if (!call.deadline_active || call.coverage.load() == 1.0) {
+            saveCachedChoice(winner, uncached_args[j], redundancy, cache_generation,
+                             dependencies, value_memos[j], strategy_times[j], strategy_costs[j]);
+        }
+    };
 
     // the consider_cost argument turns cost consideration on and off.
     // if false, we use time as ranking for singular strategies.
@@ -326,89 +958,110 @@ StrategyEvaluator::chooseStrategy(void *chooser_arg, bool redundancy, bool consi
 
     // first, pick the singular strategy that takes the least time (expected)
     //  or minimizes the weighted cost function, depending on consider_cost.
-    Strategy *best_singular = NULL;
-    double best_singular_time = 0.0;
+    vector<Strategy *> best_singular(num_uncached, NULL);
+    vector<double> best_singular_time(num_uncached, 0.0);
 
     // not the "best cost," but the cost of the best singular strategy.
-    double best_singular_cost = 0.0;
-    for (vector<Strategy *>::const_iterator it = strategies.begin();
-         it != strategies.end(); ++it) {
-        currentStrategy = *it;
-        if (!currentStrategy->isRedundant()) {
-            inst::dbgprintf(INFO, "Evaluating singular strategy \"%s\"\n",
-                            currentStrategy->getName());
-            inst::dbgprintf(INFO, "Calculating time\n");
-            double time = calculateTime(currentStrategy, chooser_arg, SINGULAR_TO_SINGULAR);
-            ASSERT(!isnan(time));
-            strategy_times[currentStrategy] = time;
+    vector<double> best_singular_cost(num_uncached, 0.0);
+
+    // calculate the singular-strategy costs here so I don't have to do it
+    //  later when calculating redundant-strategy costs.
+    // XXX: HACK.  This is a caching decision that belongs inside
+    // XXX:  the class that does the caching.
+    evaluateStrategies(uncached_args.data(), num_uncached, false, consider_cost, 
+                       SINGULAR_TO_SINGULAR, times, costs, value_memos);
+    for (size_t j = 0; j < num_uncached; ++j) {
+        for (size_t i = 0; i < strategies.size(); ++i) {
+            Strategy *strategy = strategies[i];
+            if (strategy->isRedundant() || !strategyIsActive(i)) {
+                continue;
+            }
 
+            double time = times[i][j];
+            strategy_times[j][strategy] = time;
+            
             double cost = 0.0;
-            bool new_winner = (best_singular == NULL);
-
+            bool new_winner = (best_singular[j] == NULL);
+            
             if (consider_cost) {
-                inst::dbgprintf(INFO, "Calculating cost\n");
-                // calculate the singular-strategy cost so I don't have to do it
-                //  later when calculating redundant-strategy costs.
-                // XXX: HACK.  This is a caching decision that belongs inside
-                // XXX:  the class that does the caching.
-                cost = calculateCost(currentStrategy, chooser_arg, SINGULAR_TO_SINGULAR);
-                ASSERT(!isnan(cost));
-                strategy_costs[currentStrategy] = cost;
+                cost = costs[i][j];
+                strategy_costs[j][strategy] = cost;
                 inst::dbgprintf(INFO, "Singular strategy \"%s\"  time: %f  cost: %f  sum: %f\n",
-                                currentStrategy->getName(), time, cost, time + cost);
-
-                new_winner = new_winner || ((time + cost) < (best_singular_time + best_singular_cost));
+                                strategy->getName(), time, cost, time + cost);
+                
+                new_winner = new_winner || ((time + cost) < (best_singular_time[j] + best_singular_cost[j]));
             } else {
                 inst::dbgprintf(INFO, "Singular strategy \"%s\"  time: %f\n",
-                                currentStrategy->getName(), time);
-                new_winner = new_winner || (time < best_singular_time);
+                                strategy->getName(), time);
+                new_winner = new_winner || (time < best_singular_time[j]);
             }
-
+            
             if (new_winner) {
-                best_singular = currentStrategy;
-                best_singular_time = time;
-                best_singular_cost = cost;
+                best_singular[j] = strategy;
+                best_singular_time[j] = time;
+                best_singular_cost[j] = cost;
             }
         }
     }
-    currentStrategy = NULL;
     
+    if (best_singular[0] == NULL) {
+        // every singular strategy is disabled, so every redundant one is too.
+        inst::dbgprintf(INFO, "All strategies are disabled; nothing to choose\n");
+        for (size_t j = 0; j < num_uncached; ++j) {
+            chosen_strategies[uncached_indices[j]] = NULL;
+        }
+        return;
+    }
+
     if (!redundancy) {
-        inst::dbgprintf(INFO, "Not considering redundancy; returning best "
-                        "singular strategy (time %f)\n",
-                        best_singular_time);
-        saveCachedChoice(best_singular, chooser_arg, redundancy, strategy_times, strategy_costs);
-        return best_singular;
+        for (size_t j = 0; j < num_uncached; ++j) {
+            inst::dbgprintf(INFO, "Not considering redundancy; returning best "
+                            "singular strategy (time %f)\n",
+                            best_singular_time[j]);
+            save_choice(best_singular[j], j);
+            chosen_strategies[uncached_indices[j]] = best_singular[j];
+        }
+        return;
     }
 
     if (singularComparisonIsDifferent()) {
         // recalculate time and cost
-        best_singular_time = calculateTime(best_singular, chooser_arg, SINGULAR_TO_REDUNDANT);
-        best_singular_cost = calculateCost(best_singular, chooser_arg, SINGULAR_TO_REDUNDANT);
+        for (size_t j = 0; j < num_uncached; ++j) {
+            best_singular_time[j] = calculateTime(best_singular[j], uncached_args[j], SINGULAR_TO_REDUNDANT);
+            best_singular_cost[j] = calculateCost(best_singular[j], uncached_args[j], SINGULAR_TO_REDUNDANT);
+        }
     }
 
     // then, pick the cheapest redundant strategy that offers net benefit
-    //  over the best singular strategy (if any)
-    Strategy *best_redundant = NULL;
-    double best_redundant_net_benefit = 0.0;
-    for (vector<Strategy *>::const_iterator it = strategies.begin();
-         it != strategies.end(); ++it) {
-        currentStrategy = *it;
-        if (currentStrategy->isRedundant()) {
-            inst::dbgprintf(INFO, "Evaluating redundant strategy \"%s\"\n",
-                            currentStrategy->getName());
-            double redundant_time = calculateTime(currentStrategy, chooser_arg,
-                                                  SINGULAR_TO_REDUNDANT);
-            ASSERT(!isnan(redundant_time));
-            strategy_times[currentStrategy] = redundant_time;
-            double benefit = best_singular_time - redundant_time;
-
-            double redundant_cost = calculateCost(currentStrategy, chooser_arg,
-                                                  SINGULAR_TO_REDUNDANT);
-            ASSERT(!isnan(redundant_cost));
-            strategy_costs[currentStrategy] = redundant_cost;
+    //  over the best singular strategy (if any),
+    //  skipping the ones that can't offer any.
+    vector<vector<bool> > pruned = 
+        pruneRedundantStrategies(uncached_args.data(), num_uncached, consider_cost, times, costs,
+                                 best_singular_time, best_singular_cost);
+    evaluateStrategies(uncached_args.data(), num_uncached, true, true, 
+                       SINGULAR_TO_REDUNDANT, times, costs, value_memos, &pruned);
+    for (size_t j = 0; j < num_uncached; ++j) {
+        Strategy *best_redundant = NULL;
+        double best_redundant_net_benefit = 0.0;
+        for (size_t i = 0; i < strategies.size(); ++i) {
+            Strategy *strategy = strategies[i];
+            if (!strategy->isRedundant() || !strategyIsActive(i)) {
+                continue;
+            }
+            if (pruned[i][j]) {
+                ++redundant_pruned;
+                continue;
+            }
+            ++redundant_evaluated;
+
+            double redundant_time = times[i][j];
+            strategy_times[j][strategy] = redundant_time;
+            double benefit = best_singular_time[j] - redundant_time;
+
+            double redundant_cost = costs[i][j];
+            strategy_costs[j][strategy] = redundant_cost;
             
-            double extra_redundant_cost = redundant_cost - best_singular_cost;
+            double extra_redundant_cost = redundant_cost - best_singular_cost[j];
             double net_benefit = benefit - extra_redundant_cost;
 
             /*
@@ -425,15 +1078,16 @@ StrategyEvaluator::chooseStrategy(void *chooser_arg, bool redundancy, bool consi
              */
 
             if (!silent) {
-                inst::dbgprintf(INFO, "Best singular strategy time: %f\n", best_singular_time);
+                inst::dbgprintf(INFO, "Redundant strategy \"%s\"\n", strategy->getName());
+                inst::dbgprintf(INFO, "Best singular strategy time: %f\n", best_singular_time[j]);
                 inst::dbgprintf(INFO, "Redundant strategy time: %f\n", redundant_time);
                 inst::dbgprintf(INFO, "Redundant strategy benefit: %f\n", benefit);
-                inst::dbgprintf(INFO, "Best-time singular strategy cost: %f\n", best_singular_cost);
+                inst::dbgprintf(INFO, "Best-time singular strategy cost: %f\n", best_singular_cost[j]);
                 inst::dbgprintf(INFO, "Redundant strategy cost: %f\n", redundant_cost);
                 inst::dbgprintf(INFO, "Redundant strategy additional cost: %f\n", 
                                 extra_redundant_cost);
             }
-            if (currentStrategy->includes(best_singular)) {
+            if (strategy->includes(best_singular[j])) {
                 // because the redundant strategy includes the best singular strategy,
                 //  the singular strategy can never have a lower time, and
                 //  the redundant strategy can never have a lower cost.
@@ -448,24 +1102,23 @@ StrategyEvaluator::chooseStrategy(void *chooser_arg, bool redundancy, bool consi
 
             if (net_benefit > 0.0 && 
                 (best_redundant == NULL || net_benefit > best_redundant_net_benefit)) {
-                best_redundant = currentStrategy;
+                best_redundant = strategy;
                 best_redundant_net_benefit = net_benefit;
             }
         }
-    }
-    currentStrategy = NULL;
 
-    // if any redundant strategy was better than the best singular strategy, use it.
-    //  otherwise, just use the best singular strategy.
-    instruments_strategy_t winner = NULL;
-    if (best_redundant) {
-        winner = best_redundant;
-    } else {
-        winner = best_singular;
+        // if any redundant strategy was better than the best singular strategy, use it.
+        //  otherwise, just use the best singular strategy.
+        instruments_strategy_t winner = NULL;
+        if (best_redundant) {
+            winner = best_redundant;
+        } else {
+            winner = best_singular[j];
+        }
+        
+        save_choice(winner, j);
+        chosen_strategies[uncached_indices[j]] = winner;
     }
-    
-    saveCachedChoice(winner, chooser_arg, redundancy, strategy_times, strategy_costs);
-    return winner;
 }
 
 double
@@ -519,9 +1172,11 @@ StrategyEvaluator::strategyGapIsWidening(Strategy *current_winner, bool redundan
 
     double min_badness_gap = 0.0;
     Strategy *min_gap_strategy = nullptr;
-    for (Strategy *strategy : strategies) {
+    for (size_t i = 0; i < strategies.size(); ++i) {
+        Strategy *strategy = strategies[i];
         if (strategy == current_winner || 
-            (!redundant && strategy->isRedundant())) {
+            (!redundant && strategy->isRedundant()) ||
+            !strategyIsActive(i)) {
             continue;
         }
 
@@ -6,16 +6,25 @@
 #include "strategy_evaluation_context.h"
 #include "eval_method.h"
 #include "thread_pool.h"
+#include "choice_cache.h"
+#include "estimator.h"
 
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
 
 #include <pthread.h>
 
 class Estimator;
 class Strategy;
 
-extern struct instruments_chooser_arg_fns default_chooser_arg_fns;
+extern struct instruments_chooser_arg_fns_v2 default_chooser_arg_fns;
+
+// no hash function, so these are compared with chooser_arg_less.
+struct instruments_chooser_arg_fns_v2 
+upgrade_chooser_arg_fns(struct instruments_chooser_arg_fns chooser_arg_fns);
 
 /*
  * These help implement the different uncertainty evaluation methods
@@ -30,11 +39,11 @@ class StrategyEvaluator : public StrategyEvaluationContext {
   public:
     static StrategyEvaluator *create(const char *name_, 
                                      const instruments_strategy_t *strategies,
-                                     size_t num_strategies, struct instruments_chooser_arg_fns chooser_arg_fns=default_chooser_arg_fns);
+                                     size_t num_strategies, struct instruments_chooser_arg_fns_v2 chooser_arg_fns=default_chooser_arg_fns);
     static StrategyEvaluator *create(const char *name_, 
                                      const instruments_strategy_t *strategies,
                                      size_t num_strategies, EvalMethod type,
-                                     struct instruments_chooser_arg_fns chooser_arg_fns=default_chooser_arg_fns);
+                                     struct instruments_chooser_arg_fns_v2 chooser_arg_fns=default_chooser_arg_fns);
 
     void setSilent(bool silent_);
     bool isSilent();
@@ -44,10 +53,23 @@ class StrategyEvaluator : public StrategyEvaluationContext {
 
     instruments_strategy_t chooseStrategy(void *chooser_arg, bool redundancy=true, 
                                           bool consider_cost=true);
+    // chooses a strategy for each chooser_arg, sharing the evaluation work
+    //  (e.g. sample extraction and tuple iteration) across the whole batch.
+    void chooseStrategies(void **chooser_args, size_t num_args,
+                          instruments_strategy_t *chosen_strategies,
+                          bool redundancy=true, bool consider_cost=true);
+    // like chooseStrategy, but stops evaluating after about max_micros.
+    //  *coverage is set to the smallest fraction of probability mass
+    //  covered by the expected values compared (1.0 if complete).
+    instruments_strategy_t chooseStrategyWithDeadline(void *chooser_arg, double max_micros,
+                                                      double *coverage);
     void chooseStrategyAsync(void *chooser_arg, 
                              instruments_strategy_chosen_callback_t callback,
                              void *callback_arg, bool redundancy=true);
     double getLastStrategyTime(instruments_strategy_t strategy);
+    // standard error of the last expected value of the given type computed
+    //  for strategy; 0 unless the evaluator estimates it by sampling.
+    virtual double getLastStandardError(Strategy *strategy, eval_fn_type_t type) { return 0.0; }
     
     instruments_scheduled_reevaluation_t
     scheduleReevaluation(void *chooser_arg, 
@@ -67,15 +89,98 @@ class StrategyEvaluator : public StrategyEvaluationContext {
                                  void *strategy_arg, void *chooser_arg,
                                  ComparisonType comparison_type=COMPARISON_TYPE_IRRELEVANT) = 0;
 
+    // values[i] = expectedValue(..., chooser_args[i], ...).
+    // override if the evaluator can share work across the batch.
+    virtual void expectedValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                                void *strategy_arg, void **chooser_args, size_t num_args,
+                                double *values,
+                                ComparisonType comparison_type=COMPARISON_TYPE_IRRELEVANT);
+
+    // values[i] = the least value fn takes on any tuple that
+    //  expectedValue(..., chooser_args[i], ...) would weigh.
+    // Returns false if the evaluator can't bound its values that way
+    //  (the default), in which case values is left alone.
+    virtual bool minimumValues(Strategy *strategy, typesafe_eval_fn_t fn,
+                               void *strategy_arg, void **chooser_args, size_t num_args,
+                               double *values) { return false; }
+
     // override if the comparison_type argument to expectedValue actually matters.
     virtual bool singularComparisonIsDifferent();
 
+    // override and return true if expectedValue can be called for several
+    //  strategies at once (after prepareEvaluation) without stepping on
+    //  any shared state.  Only reentrant evaluators use the worker threads
+    //  set by setEvaluationThreads; the rest always evaluate serially.
+    // That includes calls from concurrent decisions for different
+    //  chooser_args, so prepareEvaluation must be thread-safe too.
+    //  Reentrant evaluators make decisions under a shared lock,
+    //  so they only wait for observations and other updates;
+    //  the rest make one decision at a time.
+    virtual bool evaluationIsReentrant();
+    virtual void prepareEvaluation(void *chooser_arg) { /* nothing by default */ }
+
+    // override and return true if a strategy's expected values depend
+    //  only on the estimators that strategy uses.  Then a change to
+    //  an estimator only invalidates the cached decisions that 
+    //  considered a strategy using it, instead of all of them.
+    virtual bool valuesDependOnlyOnStrategyEstimators() { return false; }
+
+    // override and return true if, in addition, a strategy's expected
+    //  values can be saved and reused in later decisions until one of its
+    //  estimators changes -- i.e. evaluating a strategy doesn't leave
+    //  behind any state that evaluating another one depends on.
+    virtual bool strategyValuesAreReusable() { return false; }
+
+    // a disabled strategy, and any redundant strategy that includes it,
+    //  isn't considered by chooseStrategy until it's enabled again.
+    //  Returns false if the strategy isn't one of this evaluator's.
+    bool disableStrategy(Strategy *strategy);
+    bool enableStrategy(Strategy *strategy);
+
+    // number of threads (including the caller's) that chooseStrategy
+    //  uses to evaluate strategies.  1 (the default) means serial evaluation.
+    void setEvaluationThreads(size_t num_threads);
+
+    // number of threads (including the caller's) that one expected-value
+    //  calculation is split across, for evaluators that enumerate
+    //  the error samples.  Clears the cache.
+    void setLoopThreads(size_t num_threads, bool deterministic);
+
+    // how many times in a row an expected value may be updated for
+    //  new error samples instead of recomputed; 0 means never.
+    //  Clears the cache.
+    void setIncrementalUpdates(size_t max_updates);
+
+    // most tuples of error samples and/or microseconds per expected
+    //  value, for evaluators that enumerate the error samples;
+    //  0 means no limit.  Clears the cache.
+    void setEvaluationBudget(size_t max_tuples, double max_microseconds);
+
+    // most centroids per estimator for evaluators that sketch
+    //  the error samples.  Clears the cache.
+    void setSketchSize(size_t max_centroids);
+
+    // number of random draws (and the seed for them) for evaluators
+    //  that estimate expected values by sampling.  Clears the cache.
+    void setSampling(size_t num_samples, unsigned long seed);
+
+    // max entries in each of the decision caches; 0 means unbounded.
+    void setCacheSize(size_t max_entries);
+    void getStats(struct instruments_evaluator_stats *stats);
+
+    // while suspended, every redundant strategy is evaluated,
+    //  so that the last-value caches are complete.  Calls nest.
+    void suspendPruning();
+    void resumePruning();
+
     // only used during tipping point upper bound calculation.
     bool strategyGapIsWidening(Strategy *current_winner, bool redundant,
                                std::map<Strategy*, double>& last_strategy_badness);
 
     void observationAdded(Estimator *estimator, double observation, 
                           double old_estimate, double new_estimate);
+    // processes them all, in order, then invalidates the cache once.
+    void observationsAdded(const std::vector<EstimatorObservation>& observations);
     void estimatorConditionsChanged(Estimator *estimator);
 
     void resetError(Estimator *estimator);
@@ -94,10 +199,20 @@ class StrategyEvaluator : public StrategyEvaluationContext {
     std::vector<Strategy*> strategies;
     const small_set<Estimator*>& getAllEstimators();
 
+    const struct instruments_chooser_arg_fns_v2& getChooserArgFns() { return chooser_arg_fns; }
+
+    // false if strategies[i] or one of its children is disabled.
+    bool strategyIsActive(size_t i);
+
     virtual void processObservation(Estimator *estimator, double observation, 
                                     double old_estimate, double new_estimate) { /* ignore by default */ }
     virtual void processEstimatorConditionsChange(Estimator *estimator) { /* ignore by default */ }
     virtual void restoreFromFileImpl(const char *filename) = 0;
+    virtual void setSamplingImpl(size_t num_samples, unsigned long seed) { /* ignore by default */ }
+    virtual void setLoopThreadsImpl(size_t num_threads, bool deterministic) { /* ignore by default */ }
+    virtual void setIncrementalUpdatesImpl(size_t max_updates) { /* ignore by default */ }
+    virtual void setSketchSizeImpl(size_t max_centroids) { /* ignore by default */ }
+    virtual void setEvaluationBudgetImpl(size_t max_tuples, double max_microseconds) { /* ignore by default */ }
     virtual void processEstimatorReset(Estimator *estimator, const char *filename) {/* ignore by default */}
 
     // TODO: change to a better default.
@@ -106,44 +221,127 @@ class StrategyEvaluator : public StrategyEvaluationContext {
     // used for resetting estimator error to historical values, per-evaluator.
     std::string last_history_filename;
 
+    // during chooseStrategyWithDeadline, expectedValue should call 
+    //  nextValueDeadline to get its share of the remaining time, and
+    //  report how much of the probability mass it covered by then.
+    //  These apply to the decision the calling thread is working on.
+    bool hasEvaluationDeadline();
+    std::chrono::steady_clock::time_point nextValueDeadline();
+    void reportCoverage(double coverage);
+
   private:
+    // the state of one chooseStrategies call.  Several can be in progress
+    //  at once, so the threads working on one find it in current_call.
+    struct EvaluationCall {
+        StrategyEvaluator *evaluator;
+        bool deadline_active;
+        std::chrono::steady_clock::time_point deadline;
+        // the values not yet evaluated share the remaining time equally.
+        std::atomic<long> values_remaining;
+        std::atomic<double> coverage;
+        // if non-NULL, gets the final coverage when the call is done.
+        double *coverage_out;
+
+        EvaluationCall(StrategyEvaluator *evaluator_, double *coverage_out_);
+        ~EvaluationCall();
+    };
+    static thread_local EvaluationCall *current_call;
+    class CallScope;
+    EvaluationCall *currentCall();
+
     double calculateTime(Strategy *strategy, void *chooser_arg, ComparisonType comparison_type);
     double calculateCost(Strategy *strategy, void *chooser_arg, ComparisonType comparison_type);
-    Strategy *currentStrategy;
+
+    // if coverage is non-NULL, evaluation stops after about max_micros.
+    void chooseStrategies(void **chooser_args, size_t num_args,
+                          instruments_strategy_t *chosen_strategies,
+                          bool redundancy, bool consider_cost,
+                          double max_micros, double *coverage);
+    void startEvaluationDeadline(EvaluationCall& call, double max_micros, 
+                                 bool redundancy, bool consider_cost);
+
+    // fills in times[i][j] (and costs[i][j], if consider_cost) for each strategy i
+    //  that is redundant iff redundant is true, and each chooser_args[j].
+    // value_memos[j] holds the saved expected values for chooser_args[j]
+    //  (see valueMemoIndex), or is empty if they aren't being saved.
+    //  Known values are reused; the rest are computed and filled in.
+    // If pruned is given, strategy i isn't evaluated for chooser_args[j]
+    //  if pruned[i][j] is true.
+    void evaluateStrategies(void **chooser_args, size_t num_args, 
+                            bool redundant, bool consider_cost,
+                            ComparisonType comparison_type,
+                            std::vector<std::vector<double> >& times, 
+                            std::vector<std::vector<double> >& costs,
+                            std::vector<std::vector<double> >& value_memos,
+                            const std::vector<std::vector<bool> > *pruned=nullptr);
+
+    // finds the redundant strategies that can't beat the best singular
+    //  strategy, using only the singular strategies' times and costs.
+    std::vector<std::vector<bool> > 
+    pruneRedundantStrategies(void **chooser_args, size_t num_args, bool consider_cost,
+                             const std::vector<std::vector<double> >& times, 
+                             const std::vector<std::vector<double> >& costs,
+                             const std::vector<double>& best_singular_time,
+                             const std::vector<double>& best_singular_cost);
+    size_t valueMemoSize();
+    static size_t valueMemoIndex(size_t strategy_index, eval_fn_type_t type, 
+                                 ComparisonType comparison_type);
+
+    // all the estimators used by the strategies a decision considers (sorted).
+    std::vector<Estimator *> getDecisionDependencies(bool redundancy);
+    void invalidateCachedChoices(Estimator *estimator);
+    void invalidateCachedChoices(const std::vector<Estimator *>& estimators); // sorted
     bool silent;
     bool subscribe_all;
 
     std::string name;
 
-    class DelegatingChooserArgComparator {
-      public:
-        DelegatingChooserArgComparator(StrategyEvaluator *evaluator_);
-        bool operator()(void *left, void *right);
-      private:
-        StrategyEvaluator *evaluator;
-    };
-    DelegatingChooserArgComparator delegating_comparator;
-    struct instruments_chooser_arg_fns chooser_arg_fns;
+    struct instruments_chooser_arg_fns_v2 chooser_arg_fns;
 
     small_set<Estimator *> subscribed_estimators;
 
+    ChoiceCache nonredundant_choice_cache;
+    ChoiceCache redundant_choice_cache;
+
+    // protects only the last-value caches; the choice caches are lock-free to read.
     pthread_mutex_t cache_mutex;
-    std::map<void *, instruments_strategy_t, DelegatingChooserArgComparator> nonredundant_choice_cache;
-    std::map<void *, instruments_strategy_t, DelegatingChooserArgComparator> redundant_choice_cache;
     std::map<instruments_strategy_t, double> strategy_times_cache;
     std::map<instruments_strategy_t, double> strategy_costs_cache; // weighted cost sum
 
+    ChoiceCache& getChoiceCache(bool redundancy);
     instruments_strategy_t getCachedChoice(void *chooser_arg, bool redundancy);
     void saveCachedChoice(instruments_strategy_t winner, void *chooser_arg, bool redundancy,
+                          unsigned long cache_generation,
+                          const std::vector<Estimator *>& dependencies,
+                          const std::vector<double>& value_memo,
                           std::map<instruments_strategy_t, double>& strategy_times,
                           std::map<instruments_strategy_t, double>& strategy_costs);
     void clearCache();
 
     
-    pthread_mutex_t evaluator_mutex;
+    // decisions hold this shared (or exclusively, if the evaluation isn't
+    //  reentrant); anything that changes the estimates or the strategies
+    //  holds it exclusively, so it applies between decisions.
+    pthread_rwlock_t evaluator_lock;
+
+    // indices of each strategy and of the redundant strategies that include it.
+    std::unordered_map<Strategy *, size_t> strategy_indices;
+    std::vector<std::vector<size_t> > strategy_parents;
+    // set only while holding evaluator_lock exclusively.
+    std::vector<bool> strategy_disabled;
+    // number of disabled strategies among strategies[i] and its children.
+    std::vector<size_t> disabled_count;
+    void setStrategyDisabled(size_t i, bool disabled);
+
+    std::atomic<int> pruning_suspended;
+    std::atomic<unsigned long long> redundant_evaluated;
+    std::atomic<unsigned long long> redundant_pruned;
 
     // for asynchronous strategy decisions.
     ThreadPool *pool;
+
+    // for evaluating strategies in parallel; nullptr if serial.
+    ThreadPool *eval_pool;
 };
 
 struct ScheduledReevaluationHandle {
@@ -4,6 +4,9 @@ namespace inst = instruments;
 using inst::dbgprintf;
 
 #include <thread>
+#include <atomic>
+#include <algorithm>
+#include <exception>
 #include <chrono>
 #include <queue>
 #include <vector>
@@ -130,6 +133,74 @@ ThreadPool::startTask(std::function<void()> fn)
     return true;
 }
 
+size_t
+ThreadPool::numThreads()
+{
+    unique_lock<mutex> guard(lock);
+    return workers.size();
+}
+
+struct ParallelForState {
+    std::function<void(size_t)> fn;
+    size_t count;
+    std::atomic<size_t> next_index;
+
+    mutex lock;
+    condition_variable done_cv;
+    size_t num_done;
+    std::exception_ptr first_error;
+
+    ParallelForState(size_t count_, std::function<void(size_t)> fn_)
+        : fn(fn_), count(count_), next_index(0), num_done(0) {}
+
+    // claim and run items until there are none left.
+    // helpers that start after everything is claimed just return.
+    void work() {
+        size_t index;
+        while ((index = next_index++) < count) {
+            std::exception_ptr error;
+            try {
+                fn(index);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            
+            unique_lock<mutex> guard(lock);
+            if (error && !first_error) {
+                first_error = error;
+            }
+            if (++num_done == count) {
+                done_cv.notify_all();
+            }
+        }
+    }
+};
+
+void
+ThreadPool::parallelFor(size_t count, std::function<void(size_t)> fn)
+{
+    if (count == 0) {
+        return;
+    }
+
+    shared_ptr<ParallelForState> state(new ParallelForState(count, fn));
+    size_t num_helpers = std::min(numThreads(), count - 1);
+    for (size_t i = 0; i < num_helpers; ++i) {
+        // the helper holds its own reference, since it may not
+        //  get scheduled until after we've returned.
+        startTask([state]() { state->work(); });
+    }
+    state->work();
+
+    unique_lock<mutex> guard(state->lock);
+    while (state->num_done < count) {
+        state->done_cv.wait(guard);
+    }
+    if (state->first_error) {
+        std::rethrow_exception(state->first_error);
+    }
+}
+
 ThreadPool::TimerTaskPtr
 ThreadPool::scheduleTask(double seconds_in_future, std::function<void()> fn)
 {
@@ -39,6 +39,14 @@ class ThreadPool {
     bool startTask(std::function<void()> fn);
     TimerTaskPtr scheduleTask(double seconds_in_future, std::function<void()> fn);
     void idle(Worker *worker);
+
+    // Calls fn(0) ... fn(count - 1), spread across the pool's workers,
+    //  and returns when all calls have finished.  The calling thread
+    //  takes work items too, so this never waits on a busy pool
+    //  (and so it's safe to call from inside one of the pool's own tasks).
+    // If any call throws, the first exception is rethrown here.
+    void parallelFor(size_t count, std::function<void(size_t)> fn);
+    size_t numThreads();
     
   private:
     std::mutex lock;
@@ -0,0 +1,310 @@
+#include <instruments.h>
+#include <instruments_private.h>
+#include <resource_weights.h>
+
+#include <stdio.h>
+#include <math.h>
+
+#include "ctest.h"
+
+CTEST_DATA(evaluation_budget) {
+    instruments_external_estimator_t bandwidth;
+    instruments_external_estimator_t rtt;
+    instruments_external_estimator_t slow_bandwidth;
+    instruments_external_estimator_t other_rtt;
+};
+
+CTEST_SETUP(evaluation_budget)
+{
+    instruments_set_debug_level(INSTRUMENTS_DEBUG_LEVEL_NONE);
+    set_fixed_resource_weights(0.0, 0.0);
+
+    data->bandwidth = create_external_estimator("budget-bandwidth");
+    data->rtt = create_external_estimator("budget-rtt");
+    data->slow_bandwidth = create_external_estimator("budget-slow-bandwidth");
+    data->other_rtt = create_external_estimator("budget-other-rtt");
+}
+
+CTEST_TEARDOWN(evaluation_budget)
+{
+    free_external_estimator(data->bandwidth);
+    free_external_estimator(data->rtt);
+    free_external_estimator(data->slow_bandwidth);
+    free_external_estimator(data->other_rtt);
+}
+
+struct network {
+    instruments_external_estimator_t bandwidth;
+    instruments_external_estimator_t rtt;
+    double bytes;
+};
+
+/* calls to transfer_time, and the distinct estimator values it saw. */
+#define MAX_DISTINCT 4096
+static int num_calls;
+static double bandwidths[MAX_DISTINCT], rtts[MAX_DISTINCT];
+static int num_bandwidths, num_rtts;
+
+static void
+note_value(double *seen, int *num_seen, double value)
+{
+    int i;
+    for (i = 0; i < *num_seen; ++i) {
+        if (seen[i] == value) {
+            return;
+        }
+    }
+    if (*num_seen < MAX_DISTINCT) {
+        seen[(*num_seen)++] = value;
+    }
+}
+
+static void
+reset_counts()
+{
+    num_calls = num_bandwidths = num_rtts = 0;
+}
+
+static double
+transfer_time(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    struct network *net = (struct network *) strategy_arg;
+    double bandwidth = get_estimator_value(ctx, net->bandwidth);
+    double rtt = get_estimator_value(ctx, net->rtt);
+    ++num_calls;
+    note_value(bandwidths, &num_bandwidths, bandwidth);
+    note_value(rtts, &num_rtts, rtt);
+    return net->bytes / bandwidth + rtt;
+}
+
+static double
+data_cost(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    struct network *net = (struct network *) strategy_arg;
+    return net->bytes;
+}
+
+/* vectorized, and not counted: far cheaper per tuple than transfer_time. */
+static void
+transfer_time_vec(instruments_context_t ctx, void *strategy_arg, void *chooser_arg,
+                  size_t count, double *values)
+{
+    struct network *net = (struct network *) strategy_arg;
+    const double *bandwidth = get_estimator_values_vec(ctx, net->bandwidth);
+    const double *rtt = get_estimator_values_vec(ctx, net->rtt);
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        values[i] = net->bytes / bandwidth[i] + rtt[i];
+    }
+}
+
+static void
+data_cost_vec(instruments_context_t ctx, void *strategy_arg, void *chooser_arg,
+              size_t count, double *values)
+{
+    struct network *net = (struct network *) strategy_arg;
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        values[i] = net->bytes;
+    }
+}
+
+/* the bandwidth errors are spread much wider than the rtt errors. */
+static void
+add_observations(struct evaluation_budget_data *data, int num_observations)
+{
+    int i;
+    for (i = 0; i < num_observations; ++i) {
+        add_observation(data->bandwidth, 100.0 + (i % 11) * 17.3, 100.0 + (i % 7) * 19.1);
+        add_observation(data->slow_bandwidth, 20.0 + (i % 3) * 1.3, 20.0 + (i % 4) * 0.7);
+        add_observation(data->rtt, 0.5 + (i % 13) * 0.001, 0.5 + (i % 5) * 0.0013);
+    }
+}
+
+struct evaluation {
+    instruments_strategy_t strategies[3];
+    instruments_strategy_evaluator_t evaluator;
+    struct network nets[2];
+};
+
+static void
+setup_evaluation(struct evaluation_budget_data *data, struct evaluation *e)
+{
+    int i;
+    struct network nets[2] = {
+        { data->bandwidth, data->rtt, 1000.0 },
+        { data->slow_bandwidth, data->rtt, 200.0 }
+    };
+    for (i = 0; i < 2; ++i) {
+        e->nets[i] = nets[i];
+        e->strategies[i] = make_strategy(transfer_time, NULL, data_cost, &e->nets[i], NULL);
+    }
+    e->strategies[2] = make_redundant_strategy(e->strategies, 2, NULL);
+    e->evaluator = register_strategy_set_with_method("", e->strategies, 3,
+                                                     EMPIRICAL_ERROR_ALL_SAMPLES);
+}
+
+static void
+teardown_evaluation(struct evaluation *e)
+{
+    int i;
+    free_strategy_evaluator(e->evaluator);
+    for (i = 2; i >= 0; --i) {
+        free_strategy(e->strategies[i]);
+    }
+}
+
+CTEST2(evaluation_budget, tuple_budget_caps_evaluations)
+{
+    struct evaluation e;
+    double exact, budgeted;
+    int exact_calls, budgeted_calls;
+    setup_evaluation(data, &e);
+    add_observations(data, 60);
+
+    reset_counts();
+    choose_nonredundant_strategy(e.evaluator, NULL);
+    exact_calls = num_calls;
+    exact = get_last_strategy_time(e.evaluator, e.strategies[0]);
+
+    set_strategy_evaluator_evaluation_budget(e.evaluator, 200, 0.0);
+    reset_counts();
+    choose_nonredundant_strategy(e.evaluator, NULL);
+    budgeted_calls = num_calls;
+    budgeted = get_last_strategy_time(e.evaluator, e.strategies[0]);
+
+    /* two singular strategies of two estimators each, 60 samples apiece.
+     *  The redundant strategy's three estimators must fit too. */
+    ASSERT_EQUAL(2 * 60 * 60, exact_calls);
+    ASSERT_TRUE(budgeted_calls > 0);
+    ASSERT_TRUE(budgeted_calls <= 2 * 200);
+    ASSERT_TRUE(fabs(exact - budgeted) < 0.02 * exact);
+
+    /* the wide bandwidth errors keep more samples than the narrow rtt errors. */
+    reset_counts();
+    set_strategy_evaluator_evaluation_budget(e.evaluator, 200, 0.0);
+    choose_nonredundant_strategy(e.evaluator, NULL);
+    ASSERT_TRUE(num_bandwidths > num_rtts);
+
+    /* and no budget means every sample again. */
+    set_strategy_evaluator_evaluation_budget(e.evaluator, 0, 0.0);
+    reset_counts();
+    choose_nonredundant_strategy(e.evaluator, NULL);
+    ASSERT_EQUAL(exact_calls, num_calls);
+
+    teardown_evaluation(&e);
+}
+
+CTEST2(evaluation_budget, time_budget_caps_evaluations)
+{
+    struct evaluation e;
+    int exact_calls, i;
+    setup_evaluation(data, &e);
+    add_observations(data, 60);
+
+    reset_counts();
+    choose_nonredundant_strategy(e.evaluator, NULL);
+    exact_calls = num_calls;
+
+    /* far less than the full loop takes.  The first decision measures
+     *  the cost per tuple; the next observation applies it. */
+    set_strategy_evaluator_evaluation_budget(e.evaluator, 0, 5.0);
+    for (i = 0; i < 3; ++i) {
+        choose_nonredundant_strategy(e.evaluator, NULL);
+        add_observations(data, 1);
+    }
+    reset_counts();
+    choose_nonredundant_strategy(e.evaluator, NULL);
+    ASSERT_TRUE(num_calls > 0);
+    ASSERT_TRUE(num_calls < exact_calls / 10);
+
+    teardown_evaluation(&e);
+}
+
+CTEST2(evaluation_budget, time_budget_ignores_vectorized_strategies)
+{
+    struct network nets[2] = {
+        { data->bandwidth, data->rtt, 1000.0 },
+        { data->slow_bandwidth, data->rtt, 200.0 }
+    };
+    instruments_strategy_t strategies[2];
+    instruments_strategy_evaluator_t evaluator;
+    int exact_calls, i;
+
+    /* the vectorized strategy is evaluated first, so it would be
+     *  the one measured if every loop counted. */
+    strategies[0] = make_vector_strategy(transfer_time_vec, NULL, data_cost_vec, &nets[0], NULL);
+    strategies[1] = make_strategy(transfer_time, NULL, data_cost, &nets[1], NULL);
+    evaluator = register_strategy_set_with_method("", strategies, 2, EMPIRICAL_ERROR_ALL_SAMPLES);
+    add_observations(data, 60);
+
+    reset_counts();
+    choose_nonredundant_strategy(evaluator, NULL);
+    exact_calls = num_calls;
+    ASSERT_EQUAL(60 * 60, exact_calls);
+
+    /* enough decisions for the moving average to settle. */
+    set_strategy_evaluator_evaluation_budget(evaluator, 0, 5.0);
+    for (i = 0; i < 20; ++i) {
+        choose_nonredundant_strategy(evaluator, NULL);
+        add_observations(data, 1);
+    }
+    reset_counts();
+    choose_nonredundant_strategy(evaluator, NULL);
+    ASSERT_TRUE(num_calls > 0);
+    ASSERT_TRUE(num_calls < exact_calls / 10);
+
+    free_strategy_evaluator(evaluator);
+    free_strategy(strategies[1]);
+    free_strategy(strategies[0]);
+}
+
+/* two servers behind one link: the strategies share the bandwidth
+ *  estimator, and each has its own rtt. */
+CTEST2(evaluation_budget, observation_updates_strategies_sharing_an_estimator)
+{
+    struct network nets[2] = {
+        { data->bandwidth, data->rtt, 1000.0 },
+        { data->bandwidth, data->other_rtt, 1000.0 }
+    };
+    instruments_strategy_t strategies[3];
+    instruments_strategy_evaluator_t evaluator, fresh_evaluator;
+    double old_time, fresh_time;
+    int i;
+
+    for (i = 0; i < 2; ++i) {
+        strategies[i] = make_strategy(transfer_time, NULL, data_cost, &nets[i], NULL);
+    }
+    strategies[2] = make_redundant_strategy(strategies, 2, NULL);
+    evaluator = register_strategy_set_with_method("", strategies, 3, EMPIRICAL_ERROR_ALL_SAMPLES);
+    /* makes no decision until the end, so it has nothing cached. */
+    fresh_evaluator = register_strategy_set_with_method("", strategies, 3,
+                                                        EMPIRICAL_ERROR_ALL_SAMPLES);
+    set_strategy_evaluator_evaluation_budget(evaluator, 150, 0.0);
+    set_strategy_evaluator_evaluation_budget(fresh_evaluator, 150, 0.0);
+
+    /* the bandwidth errors are the narrowest, so the redundant
+     *  strategy's tuples fit by merging the bandwidth samples. */
+    for (i = 0; i < 6; ++i) {
+        add_observation(data->bandwidth, 100.0 + (i % 3) * 10.0, 100.0);
+        add_observation(data->rtt, 0.5 + (i % 4) * 2.0, 2.0);
+        add_observation(data->other_rtt, 0.5 + (i % 5) * 2.0, 2.0);
+    }
+    choose_strategy(evaluator, NULL);
+    old_time = get_last_strategy_time(evaluator, strategies[1]);
+
+    /* a new rtt sample leaves room for fewer bandwidth samples,
+     *  which changes the other server's expected time too. */
+    add_observation(data->rtt, 20.0, 2.0);
+    choose_strategy(evaluator, NULL);
+    choose_strategy(fresh_evaluator, NULL);
+    fresh_time = get_last_strategy_time(fresh_evaluator, strategies[1]);
+    ASSERT_TRUE(fabs(fresh_time - old_time) > 1e-6 * fresh_time);
+    ASSERT_TRUE(fabs(fresh_time - get_last_strategy_time(evaluator, strategies[1])) < 1e-9 * fresh_time);
+
+    free_strategy_evaluator(fresh_evaluator);
+    free_strategy_evaluator(evaluator);
+    for (i = 2; i >= 0; --i) {
+        free_strategy(strategies[i]);
+    }
+}
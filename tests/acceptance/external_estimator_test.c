@@ -3,6 +3,7 @@
 #include <resource_weights.h>
 
 #include <stdio.h>
+#include <math.h>
 #include <assert.h>
 
 #include "ctest.h"
@@ -40,6 +41,35 @@ static double data_cost(instruments_context_t ctx, void *strategy_arg, void *cho
     return 2.0;
 }
 
+static instruments_strategy_evaluator_t
+make_high_low_evaluator_with_costs(instruments_external_estimator_t high, 
+                                   instruments_external_estimator_t low,
+                                   instruments_strategy_t *strategies,
+                                   enum EvalMethod method, eval_fn_t data_cost_fn)
+{
+    strategies[0] = make_strategy(estimator_value, NULL, data_cost_fn, (void*) high, NULL);
+    strategies[1] = make_strategy(estimator_value, NULL, data_cost_fn, (void*) low, NULL);
+    strategies[2] = make_redundant_strategy(strategies, 2, NULL);
+    return register_strategy_set_with_method("", strategies, 3, method);
+}
+
+static instruments_strategy_evaluator_t
+make_high_low_evaluator_with_method(instruments_external_estimator_t high, 
+                                    instruments_external_estimator_t low,
+                                    instruments_strategy_t *strategies,
+                                    enum EvalMethod method)
+{
+    return make_high_low_evaluator_with_costs(high, low, strategies, method, data_cost);
+}
+
+static instruments_strategy_evaluator_t
+make_high_low_evaluator(instruments_external_estimator_t high, instruments_external_estimator_t low,
+                        instruments_strategy_t *strategies)
+{
+    return make_high_low_evaluator_with_method(high, low, strategies, 
+                                               EMPIRICAL_ERROR_ALL_SAMPLES);
+}
+
 
 CTEST2(external_estimator, value_observed)
 {
@@ -130,3 +160,341 @@ CTEST2(external_estimator, cost_has_effect)
     set_fixed_resource_weights(0.0, 99999999.0);
     run_test_with_oscillating_estimator(data, 20.0, 10.0, 1);
 }
+
+static void
+check_decision_follows_observations(struct external_estimator_data *data, enum EvalMethod method)
+{
+    add_observation(data->high_estimator, 10.0, 10.0);
+    add_observation(data->low_estimator, 5.0, 5.0);
+
+    instruments_strategy_t strategies[3];
+    instruments_strategy_evaluator_t evaluator = 
+        make_high_low_evaluator_with_method(data->high_estimator, data->low_estimator,
+                                            strategies, method);
+    ASSERT_EQUAL((int)strategies[1], (int)choose_nonredundant_strategy(evaluator, NULL));
+
+    /* only the high strategy's values need reevaluating after each of these. */
+    add_observation(data->high_estimator, 1.0, 1.0);
+    ASSERT_EQUAL((int)strategies[0], (int)choose_nonredundant_strategy(evaluator, NULL));
+    add_observation(data->high_estimator, 10.0, 10.0);
+    ASSERT_EQUAL((int)strategies[1], (int)choose_nonredundant_strategy(evaluator, NULL));
+
+    /* ...and only the low strategy's, after this one. */
+    add_observation(data->low_estimator, 100.0, 100.0);
+    ASSERT_EQUAL((int)strategies[0], (int)choose_nonredundant_strategy(evaluator, NULL));
+
+    free_strategy_evaluator(evaluator);
+    free_strategy(strategies[2]);
+    free_strategy(strategies[1]);
+    free_strategy(strategies[0]);
+}
+
+CTEST2(external_estimator, trusted_oracle_decision_follows_observations)
+{
+    check_decision_follows_observations(data, TRUSTED_ORACLE);
+}
+
+CTEST2(external_estimator, empirical_error_decision_follows_observations)
+{
+    check_decision_follows_observations(data, EMPIRICAL_ERROR_ALL_SAMPLES);
+}
+
+static double expensive_data_cost(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    return 10.0;
+}
+
+static void
+check_redundancy_pruning(struct external_estimator_data *data, enum EvalMethod method,
+                         eval_fn_t data_cost_fn, int spread_errors, int expect_pruned)
+{
+    add_observation(data->high_estimator, 10.0, 10.0);
+    add_observation(data->low_estimator, 5.0, 5.0);
+
+    instruments_strategy_t strategies[3];
+    instruments_strategy_evaluator_t evaluator = 
+        make_high_low_evaluator_with_costs(data->high_estimator, data->low_estimator,
+                                           strategies, method, data_cost_fn);
+    if (spread_errors) {
+        /* high's time is 1 in one of its three samples. */
+        add_observation(data->high_estimator, 10.0, 10.0);
+        add_observation(data->high_estimator, 1.0, 10.0);
+        add_observation(data->high_estimator, 10.0, 10.0);
+    }
+    ASSERT_EQUAL((int)strategies[1], (int)choose_strategy(evaluator, NULL));
+
+    struct instruments_evaluator_stats stats;
+    get_strategy_evaluator_stats(evaluator, &stats);
+    ASSERT_EQUAL(expect_pruned, (int) stats.redundant_strategies_pruned);
+    ASSERT_EQUAL(!expect_pruned, (int) stats.redundant_strategies_evaluated);
+
+    free_strategy_evaluator(evaluator);
+    free_strategy(strategies[2]);
+    free_strategy(strategies[1]);
+    free_strategy(strategies[0]);
+}
+
+CTEST2(external_estimator, redundancy_pruned_when_too_costly)
+{
+    /* best singular: time 5 + cost 10; redundant cost alone is 20. */
+    check_redundancy_pruning(data, TRUSTED_ORACLE, expensive_data_cost, 0, 1);
+    check_redundancy_pruning(data, EMPIRICAL_ERROR_ALL_SAMPLES, expensive_data_cost, 0, 1);
+
+    /* best singular: time 5 + cost 2; redundant time is exactly 5, cost 4. */
+    check_redundancy_pruning(data, TRUSTED_ORACLE, data_cost, 0, 1);
+}
+
+CTEST2(external_estimator, redundancy_evaluated_when_affordable)
+{
+    /* best singular: time 5 + cost 2; redundant time is at least 1, cost 4. */
+    check_redundancy_pruning(data, EMPIRICAL_ERROR_ALL_SAMPLES, data_cost, 1, 0);
+}
+
+static double pricey_data_cost(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    return 4.0;
+}
+
+CTEST2(external_estimator, redundancy_evaluated_despite_nonnegative_expected_times)
+{
+    add_observation(data->high_estimator, 10.0, 10.0);
+    add_observation(data->low_estimator, 5.0, 5.0);
+
+    instruments_strategy_t strategies[3];
+    instruments_strategy_evaluator_t evaluator = 
+        make_high_low_evaluator_with_costs(data->high_estimator, data->low_estimator, strategies,
+                                           EMPIRICAL_ERROR_ALL_SAMPLES, pricey_data_cost);
+    /* high's time samples: 10, 20, -25; low's: 5, -10, 20. */
+    add_observation(data->high_estimator, 10.0, 10.0);
+    add_observation(data->high_estimator, 20.0, 10.0);
+    add_observation(data->high_estimator, -25.0, 10.0);
+    add_observation(data->low_estimator, 5.0, 5.0);
+    add_observation(data->low_estimator, -10.0, 5.0);
+    add_observation(data->low_estimator, 20.0, 5.0);
+
+    /* best singular: time 1.67 + cost 4.  The redundant cost (8) is more
+     *  than that, and both expected times are positive, but the redundant
+     *  strategy's expected time is -6.11, so it wins anyway. */
+    ASSERT_EQUAL((int)strategies[2], (int)choose_strategy(evaluator, NULL));
+
+    struct instruments_evaluator_stats stats;
+    get_strategy_evaluator_stats(evaluator, &stats);
+    ASSERT_EQUAL(0, (int) stats.redundant_strategies_pruned);
+
+    free_strategy_evaluator(evaluator);
+    free_strategy(strategies[2]);
+    free_strategy(strategies[1]);
+    free_strategy(strategies[0]);
+}
+
+static void
+check_disable_strategy(struct external_estimator_data *data, enum EvalMethod method)
+{
+    add_observation(data->high_estimator, 10.0, 10.0);
+    add_observation(data->low_estimator, 5.0, 5.0);
+
+    instruments_strategy_t strategies[3];
+    instruments_strategy_evaluator_t evaluator = 
+        make_high_low_evaluator_with_method(data->high_estimator, data->low_estimator,
+                                            strategies, method);
+    ASSERT_EQUAL((int)strategies[1], (int)choose_nonredundant_strategy(evaluator, NULL));
+
+    disable_strategy(evaluator, strategies[1]);
+    ASSERT_EQUAL((int)strategies[0], (int)choose_nonredundant_strategy(evaluator, NULL));
+    /* the redundant strategy includes the disabled one. */
+    ASSERT_EQUAL((int)strategies[0], (int)choose_strategy(evaluator, NULL));
+
+    disable_strategy(evaluator, strategies[0]);
+    ASSERT_NULL(choose_strategy(evaluator, NULL));
+
+    enable_strategy(evaluator, strategies[0]);
+    enable_strategy(evaluator, strategies[1]);
+    ASSERT_EQUAL((int)strategies[1], (int)choose_nonredundant_strategy(evaluator, NULL));
+
+    free_strategy_evaluator(evaluator);
+    free_strategy(strategies[2]);
+    free_strategy(strategies[1]);
+    free_strategy(strategies[0]);
+}
+
+CTEST2(external_estimator, trusted_oracle_disable_strategy)
+{
+    check_disable_strategy(data, TRUSTED_ORACLE);
+}
+
+CTEST2(external_estimator, empirical_error_disable_strategy)
+{
+    check_disable_strategy(data, EMPIRICAL_ERROR_ALL_SAMPLES);
+}
+
+CTEST2(external_estimator, observations_batch_matches_sequential)
+{
+    instruments_external_estimator_t estimators[2] = {
+        create_external_estimator("high2"), create_external_estimator("low2")
+    };
+    instruments_strategy_t strategies[3], batch_strategies[3];
+    instruments_strategy_evaluator_t evaluator = 
+        make_high_low_evaluator(data->high_estimator, data->low_estimator, strategies);
+    instruments_strategy_evaluator_t batch_evaluator = 
+        make_high_low_evaluator(estimators[0], estimators[1], batch_strategies);
+
+    double observations[] = { 10.0, 5.0, 1.0, 2.0, 100.0 };
+    double new_estimates[] = { 10.0, 5.0, 1.0, 1.5, 100.0 };
+    int which[] = { 0, 1, 0, 0, 1 };
+    instruments_external_estimator_t batch_estimators[5];
+    int i;
+    for (i = 0; i < 5; ++i) {
+        add_observation(which[i] == 0 ? data->high_estimator : data->low_estimator,
+                        observations[i], new_estimates[i]);
+        batch_estimators[i] = estimators[which[i]];
+    }
+    add_observations_batch(batch_estimators, observations, new_estimates, 5);
+
+    ASSERT_EQUAL((int)strategies[0], (int)choose_nonredundant_strategy(evaluator, NULL));
+    ASSERT_EQUAL((int)batch_strategies[0], (int)choose_nonredundant_strategy(batch_evaluator, NULL));
+    for (i = 0; i < 2; ++i) {
+        double time = get_last_strategy_time(evaluator, strategies[i]);
+        double batch_time = get_last_strategy_time(batch_evaluator, batch_strategies[i]);
+        ASSERT_TRUE(fabs(time - batch_time) < 0.0001);
+    }
+
+    free_strategy_evaluator(batch_evaluator);
+    free_strategy_evaluator(evaluator);
+    for (i = 2; i >= 0; --i) {
+        free_strategy(batch_strategies[i]);
+        free_strategy(strategies[i]);
+    }
+    free_external_estimator(estimators[0]);
+    free_external_estimator(estimators[1]);
+}
+
+CTEST2(external_estimator, choose_strategy_with_deadline)
+{
+    int i;
+    instruments_strategy_t strategies[3];
+    instruments_strategy_evaluator_t evaluator = 
+        make_high_low_evaluator(data->high_estimator, data->low_estimator, strategies);
+
+    /* more error samples than one deadline check interval covers. */
+    for (i = 0; i < 200; ++i) {
+        add_observation(data->high_estimator, 10.0 + (i % 7), 10.0);
+        add_observation(data->low_estimator, 5.0 + (i % 5), 5.0);
+    }
+
+    /* the deadline has already passed, so the evaluation stops early. */
+    double confidence = -1.0;
+    instruments_strategy_t hurried = choose_strategy_with_deadline(evaluator, NULL, 0.0, &confidence);
+    ASSERT_NOT_NULL(hurried);
+    ASSERT_TRUE(confidence > 0.0 && confidence < 1.0);
+
+    /* partial decisions aren't cached. */
+    struct instruments_evaluator_stats stats;
+    get_strategy_evaluator_stats(evaluator, &stats);
+    ASSERT_EQUAL(0, (int) stats.cache_entries);
+
+    confidence = -1.0;
+    instruments_strategy_t patient = choose_strategy_with_deadline(evaluator, NULL, 1e9, &confidence);
+    ASSERT_TRUE(confidence == 1.0);
+    ASSERT_EQUAL((int)choose_strategy(evaluator, NULL), (int)patient);
+
+    free_strategy_evaluator(evaluator);
+    free_strategy(strategies[2]);
+    free_strategy(strategies[1]);
+    free_strategy(strategies[0]);
+}
+
+CTEST2(external_estimator, monte_carlo_matches_exhaustive)
+{
+    instruments_strategy_t strategies[3], mc_strategies[3];
+    instruments_strategy_evaluator_t evaluator = 
+        make_high_low_evaluator(data->high_estimator, data->low_estimator, strategies);
+    instruments_strategy_evaluator_t mc_evaluator = 
+        make_high_low_evaluator_with_method(data->high_estimator, data->low_estimator, 
+                                            mc_strategies, EMPIRICAL_ERROR_ALL_SAMPLES_MONTE_CARLO);
+    int i;
+    for (i = 0; i < 50; ++i) {
+        /* errors spread over a range, so the draws have some variance. */
+        add_observation(data->high_estimator, 10.0 + (i % 7), 10.0 + (i % 5));
+        add_observation(data->low_estimator, 5.0 + (i % 3), 5.0 + (i % 4));
+    }
+
+    ASSERT_EQUAL((int)strategies[1], (int)choose_nonredundant_strategy(evaluator, NULL));
+    ASSERT_EQUAL((int)mc_strategies[1], (int)choose_nonredundant_strategy(mc_evaluator, NULL));
+
+    double mc_times[2], errors[2];
+    for (i = 0; i < 2; ++i) {
+        double time = get_last_strategy_time(evaluator, strategies[i]);
+        mc_times[i] = get_last_strategy_time(mc_evaluator, mc_strategies[i]);
+        errors[i] = get_last_strategy_time_error(mc_evaluator, mc_strategies[i]);
+        ASSERT_TRUE(get_last_strategy_time_error(evaluator, strategies[i]) == 0.0);
+        ASSERT_TRUE(errors[i] > 0.0);
+        ASSERT_TRUE(fabs(time - mc_times[i]) < 5.0 * errors[i]);
+    }
+
+    /* same seed, same draws. */
+    set_strategy_evaluator_sampling(mc_evaluator, 1000, 42);
+    choose_nonredundant_strategy(mc_evaluator, NULL);
+    for (i = 0; i < 2; ++i) {
+        ASSERT_TRUE(mc_times[i] == get_last_strategy_time(mc_evaluator, mc_strategies[i]));
+    }
+
+    /* more draws, smaller error. */
+    set_strategy_evaluator_sampling(mc_evaluator, 16000, 42);
+    choose_nonredundant_strategy(mc_evaluator, NULL);
+    for (i = 0; i < 2; ++i) {
+        double error = get_last_strategy_time_error(mc_evaluator, mc_strategies[i]);
+        ASSERT_TRUE(error < errors[i] / 2.0);
+    }
+
+    free_strategy_evaluator(mc_evaluator);
+    free_strategy_evaluator(evaluator);
+    for (i = 2; i >= 0; --i) {
+        free_strategy(mc_strategies[i]);
+        free_strategy(strategies[i]);
+    }
+}
+
+static void
+check_sampling_method(struct external_estimator_data *data, enum EvalMethod method)
+{
+    instruments_strategy_t strategies[3], sampled_strategies[3];
+    instruments_strategy_evaluator_t evaluator = 
+        make_high_low_evaluator(data->high_estimator, data->low_estimator, strategies);
+    instruments_strategy_evaluator_t sampled_evaluator = 
+        make_high_low_evaluator_with_method(data->high_estimator, data->low_estimator, 
+                                            sampled_strategies, method);
+    /* fewer draws than plain Monte Carlo uses by default. */
+    set_strategy_evaluator_sampling(sampled_evaluator, 625, 7);
+    int i;
+    for (i = 0; i < 50; ++i) {
+        add_observation(data->high_estimator, 10.0 + (i % 7), 10.0 + (i % 5));
+        add_observation(data->low_estimator, 5.0 + (i % 3), 5.0 + (i % 4));
+    }
+
+    ASSERT_EQUAL((int)strategies[1], (int)choose_nonredundant_strategy(evaluator, NULL));
+    ASSERT_EQUAL((int)sampled_strategies[1], 
+                 (int)choose_nonredundant_strategy(sampled_evaluator, NULL));
+    for (i = 0; i < 2; ++i) {
+        double time = get_last_strategy_time(evaluator, strategies[i]);
+        double sampled_time = get_last_strategy_time(sampled_evaluator, sampled_strategies[i]);
+        double error = get_last_strategy_time_error(sampled_evaluator, sampled_strategies[i]);
+        ASSERT_TRUE(fabs(time - sampled_time) < 5.0 * error);
+    }
+
+    free_strategy_evaluator(sampled_evaluator);
+    free_strategy_evaluator(evaluator);
+    for (i = 2; i >= 0; --i) {
+        free_strategy(sampled_strategies[i]);
+        free_strategy(strategies[i]);
+    }
+}
+
+CTEST2(external_estimator, quasi_monte_carlo_matches_exhaustive)
+{
+    check_sampling_method(data, EMPIRICAL_ERROR_ALL_SAMPLES_QUASI_MONTE_CARLO);
+}
+
+CTEST2(external_estimator, stratified_matches_exhaustive)
+{
+    check_sampling_method(data, EMPIRICAL_ERROR_ALL_SAMPLES_STRATIFIED);
+}
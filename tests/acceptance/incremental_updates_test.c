@@ -0,0 +1,177 @@
+#include <instruments.h>
+#include <instruments_private.h>
+#include <resource_weights.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "ctest.h"
+
+CTEST_DATA(incremental_updates) {
+    instruments_external_estimator_t bandwidth;
+    instruments_external_estimator_t rtt;
+    instruments_external_estimator_t slow_bandwidth;
+};
+
+CTEST_SETUP(incremental_updates)
+{
+    instruments_set_debug_level(INSTRUMENTS_DEBUG_LEVEL_NONE);
+    set_fixed_resource_weights(0.0, 0.0);
+
+    data->bandwidth = create_external_estimator("incremental-bandwidth");
+    data->rtt = create_external_estimator("incremental-rtt");
+    data->slow_bandwidth = create_external_estimator("incremental-slow-bandwidth");
+}
+
+CTEST_TEARDOWN(incremental_updates)
+{
+    free_external_estimator(data->bandwidth);
+    free_external_estimator(data->rtt);
+    free_external_estimator(data->slow_bandwidth);
+}
+
+struct network {
+    instruments_external_estimator_t bandwidth;
+    instruments_external_estimator_t rtt;
+    double bytes;
+};
+
+/* chooser_arg scales the transfer size. */
+static double
+size_scale(void *chooser_arg)
+{
+    return chooser_arg ? *(double *) chooser_arg : 1.0;
+}
+
+static double
+transfer_time(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    struct network *net = (struct network *) strategy_arg;
+    double bytes = net->bytes * size_scale(chooser_arg);
+    return bytes / get_estimator_value(ctx, net->bandwidth) + get_estimator_value(ctx, net->rtt);
+}
+
+static double
+data_cost(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    struct network *net = (struct network *) strategy_arg;
+    return net->bytes * size_scale(chooser_arg);
+}
+
+static int
+size_less(void *left, void *right)
+{
+    return *(double *) left < *(double *) right;
+}
+
+static void *
+copy_size(void *arg)
+{
+    double *copy = malloc(sizeof(double));
+    *copy = *(double *) arg;
+    return copy;
+}
+
+static void
+delete_size(void *arg)
+{
+    free(arg);
+}
+
+/* adds observations one round at a time, and after each round checks
+ * that an evaluator with incremental updates agrees with one without.
+ * If moving_estimates, every observation also moves the estimate,
+ * so the running sums can never be updated, only recomputed.
+ * If reuse_buffer, every size is passed in the same buffer, and
+ * the evaluators compare sizes by value. */
+static void
+check_incremental_updates(struct incremental_updates_data *data, int moving_estimates,
+                          int reuse_buffer)
+{
+    struct network nets[2] = {
+        { data->bandwidth, data->rtt, 1000.0 },
+        { data->slow_bandwidth, data->rtt, 200.0 }
+    };
+    double sizes[2] = { 1.0, 3.0 };
+    double buffer;
+    instruments_strategy_t strategies[3];
+    instruments_strategy_evaluator_t full, incremental;
+    int i, j, k;
+
+    for (i = 0; i < 2; ++i) {
+        strategies[i] = make_strategy(transfer_time, NULL, data_cost, &nets[i], NULL);
+    }
+    strategies[2] = make_redundant_strategy(strategies, 2, NULL);
+    if (reuse_buffer) {
+        struct instruments_chooser_arg_fns_v2 fns = {
+            size_less, copy_size, delete_size, NULL
+        };
+        full = register_strategy_set_with_method_and_fns_v2("", strategies, 3,
+                                                            EMPIRICAL_ERROR_ALL_SAMPLES, fns);
+        incremental = register_strategy_set_with_method_and_fns_v2("", strategies, 3,
+                                                                   EMPIRICAL_ERROR_ALL_SAMPLES, fns);
+    } else {
+        full = register_strategy_set_with_method("", strategies, 3, EMPIRICAL_ERROR_ALL_SAMPLES);
+        incremental = register_strategy_set_with_method("", strategies, 3, EMPIRICAL_ERROR_ALL_SAMPLES);
+    }
+    set_strategy_evaluator_incremental_updates(incremental, 5);
+
+    /* first estimates */
+    add_observation(data->bandwidth, 100.0, 100.0);
+    add_observation(data->slow_bandwidth, 20.0, 20.0);
+    add_observation(data->rtt, 0.5, 0.5);
+    /* ...with some error already, so that the redundant strategy
+     *  isn't pruned for lack of any chance to beat the singular ones. */
+    add_observation(data->bandwidth, 80.0, 100.0);
+    add_observation(data->slow_bandwidth, 25.0, 20.0);
+
+    for (i = 0; i < 25; ++i) {
+        double bandwidth_estimate = moving_estimates ? 100.0 + (i % 5) * 9.1 : 100.0;
+        double rtt_estimate = moving_estimates ? 0.5 + (i % 3) * 0.13 : 0.5;
+        add_observation(data->bandwidth, 100.0 + (i % 7) * 13.7, bandwidth_estimate);
+        if (i % 2 == 0) {
+            add_observation(data->slow_bandwidth, 20.0 + (i % 3) * 1.3, 20.0);
+        }
+        if (i % 3 == 0) {
+            add_observation(data->rtt, 0.5 + (i % 4) * 0.11, rtt_estimate);
+        }
+
+        for (k = 0; k < 2; ++k) {
+            double *size = &sizes[k];
+            if (reuse_buffer) {
+                buffer = sizes[k];
+                size = &buffer;
+            }
+            choose_strategy(full, size);
+            choose_strategy(incremental, size);
+            for (j = 0; j < 3; ++j) {
+                double expected = get_last_strategy_time(full, strategies[j]);
+                double actual = get_last_strategy_time(incremental, strategies[j]);
+                ASSERT_TRUE(expected > 0.0);
+                ASSERT_TRUE(fabs(expected - actual) < 1e-9 * expected);
+            }
+        }
+    }
+
+    free_strategy_evaluator(full);
+    free_strategy_evaluator(incremental);
+    for (i = 2; i >= 0; --i) {
+        free_strategy(strategies[i]);
+    }
+}
+
+CTEST2(incremental_updates, fixed_estimates_match_full_recomputation)
+{
+    check_incremental_updates(data, 0, 0);
+}
+
+CTEST2(incremental_updates, moving_estimates_match_full_recomputation)
+{
+    check_incremental_updates(data, 1, 0);
+}
+
+CTEST2(incremental_updates, reused_chooser_arg_buffer_matches_full_recomputation)
+{
+    check_incremental_updates(data, 0, 1);
+}
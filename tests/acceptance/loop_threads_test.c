@@ -0,0 +1,167 @@
+#include <instruments.h>
+#include <instruments_private.h>
+#include <resource_weights.h>
+
+#include <stdio.h>
+#include <math.h>
+
+#include "ctest.h"
+
+CTEST_DATA(loop_threads) {
+    instruments_external_estimator_t bandwidth;
+    instruments_external_estimator_t rtt;
+    instruments_external_estimator_t slow_bandwidth;
+};
+
+CTEST_SETUP(loop_threads)
+{
+    instruments_set_debug_level(INSTRUMENTS_DEBUG_LEVEL_NONE);
+    set_fixed_resource_weights(0.0, 0.0);
+
+    data->bandwidth = create_external_estimator("loop-bandwidth");
+    data->rtt = create_external_estimator("loop-rtt");
+    data->slow_bandwidth = create_external_estimator("loop-slow-bandwidth");
+}
+
+CTEST_TEARDOWN(loop_threads)
+{
+    free_external_estimator(data->bandwidth);
+    free_external_estimator(data->rtt);
+    free_external_estimator(data->slow_bandwidth);
+}
+
+struct network {
+    instruments_external_estimator_t bandwidth;
+    instruments_external_estimator_t rtt;
+    double bytes;
+};
+
+static double
+transfer_time(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    struct network *net = (struct network *) strategy_arg;
+    return net->bytes / get_estimator_value(ctx, net->bandwidth) + get_estimator_value(ctx, net->rtt);
+}
+
+static double
+data_cost(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    struct network *net = (struct network *) strategy_arg;
+    return net->bytes;
+}
+
+#define NUM_EVALUATORS 4
+
+/* evaluates the same strategies serially and on 4 threads, with and
+ * without deterministic sums, and returns each one's transfer times.
+ * The last evaluator keeps the default (serial, one running sum). */
+static void
+evaluate_with_loop_threads(struct loop_threads_data *data, double times[NUM_EVALUATORS][3])
+{
+    struct network nets[2] = {
+        { data->bandwidth, data->rtt, 1000.0 },
+        { data->slow_bandwidth, data->rtt, 200.0 }
+    };
+    instruments_strategy_t strategies[3];
+    instruments_strategy_evaluator_t evaluators[NUM_EVALUATORS];
+    int i, j;
+
+    for (i = 0; i < 2; ++i) {
+        strategies[i] = make_strategy(transfer_time, NULL, data_cost, &nets[i], NULL);
+    }
+    strategies[2] = make_redundant_strategy(strategies, 2, NULL);
+    for (j = 0; j < NUM_EVALUATORS; ++j) {
+        evaluators[j] = register_strategy_set_with_method("", strategies, 3, EMPIRICAL_ERROR_ALL_SAMPLES);
+    }
+    set_strategy_evaluator_loop_threads(evaluators[0], 1, 1);
+    set_strategy_evaluator_loop_threads(evaluators[1], 4, 1);
+    set_strategy_evaluator_loop_threads(evaluators[2], 4, 0);
+
+    for (i = 0; i < 40; ++i) {
+        add_observation(data->bandwidth, 100.0 + (i % 7) * 13.7, 100.0 + (i % 5) * 9.1);
+        add_observation(data->slow_bandwidth, 20.0 + (i % 3) * 1.3, 20.0 + (i % 4) * 0.7);
+        add_observation(data->rtt, 0.5 + (i % 4) * 0.11, 0.5 + (i % 3) * 0.13);
+    }
+
+    for (j = 0; j < NUM_EVALUATORS; ++j) {
+        choose_strategy(evaluators[j], NULL);
+        for (i = 0; i < 3; ++i) {
+            times[j][i] = get_last_strategy_time(evaluators[j], strategies[i]);
+        }
+    }
+
+    for (j = 0; j < NUM_EVALUATORS; ++j) {
+        free_strategy_evaluator(evaluators[j]);
+    }
+    for (i = 2; i >= 0; --i) {
+        free_strategy(strategies[i]);
+    }
+}
+
+CTEST2(loop_threads, deterministic_sums_match_exactly)
+{
+    double times[NUM_EVALUATORS][3];
+    int i;
+    evaluate_with_loop_threads(data, times);
+    for (i = 0; i < 3; ++i) {
+        ASSERT_TRUE(times[0][i] > 0.0);
+        /* serial and parallel agree to the last bit... */
+        ASSERT_TRUE(times[0][i] == times[1][i]);
+        /* ...and the parallel sums don't depend on the mode. */
+        ASSERT_TRUE(times[1][i] == times[2][i]);
+    }
+}
+
+CTEST2(loop_threads, parallel_matches_default_serial)
+{
+    double times[NUM_EVALUATORS][3];
+    int i;
+    evaluate_with_loop_threads(data, times);
+    for (i = 0; i < 3; ++i) {
+        /* one running sum can differ from the sliced sums,
+         * but only by rounding. */
+        ASSERT_TRUE(fabs(times[3][i] - times[2][i]) < 1e-9 * times[3][i]);
+    }
+}
+
+CTEST2(loop_threads, deterministic_sums_ignore_incremental_updates)
+{
+    struct network nets[2] = {
+        { data->bandwidth, data->rtt, 1000.0 },
+        { data->slow_bandwidth, data->rtt, 200.0 }
+    };
+    instruments_strategy_t strategies[3];
+    instruments_strategy_evaluator_t incremental, parallel;
+    int i;
+
+    for (i = 0; i < 2; ++i) {
+        strategies[i] = make_strategy(transfer_time, NULL, data_cost, &nets[i], NULL);
+    }
+    strategies[2] = make_redundant_strategy(strategies, 2, NULL);
+    incremental = register_strategy_set_with_method("", strategies, 3, EMPIRICAL_ERROR_ALL_SAMPLES);
+    parallel = register_strategy_set_with_method("", strategies, 3, EMPIRICAL_ERROR_ALL_SAMPLES);
+    set_strategy_evaluator_loop_threads(incremental, 1, 1);
+    set_strategy_evaluator_incremental_updates(incremental, 100);
+    set_strategy_evaluator_loop_threads(parallel, 4, 1);
+
+    /* fixed estimates, so the running sums would apply after each observation. */
+    for (i = 0; i < 40; ++i) {
+        add_observation(data->bandwidth, 100.0 + (i % 7) * 13.7, 100.0);
+        add_observation(data->slow_bandwidth, 20.0 + (i % 3) * 1.3, 20.0);
+        add_observation(data->rtt, 0.5 + (i % 4) * 0.11, 0.5);
+        choose_strategy(incremental, NULL);
+        choose_strategy(parallel, NULL);
+    }
+
+    for (i = 0; i < 3; ++i) {
+        double time = get_last_strategy_time(incremental, strategies[i]);
+        ASSERT_TRUE(time > 0.0);
+        ASSERT_TRUE(time == get_last_strategy_time(parallel, strategies[i]));
+    }
+
+    free_strategy_evaluator(parallel);
+    free_strategy_evaluator(incremental);
+    for (i = 2; i >= 0; --i) {
+        free_strategy(strategies[i]);
+    }
+}
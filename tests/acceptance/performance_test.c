@@ -42,6 +42,25 @@ time_choose_strategy(instruments_strategy_evaluator_t evaluator, int bytelen, in
     return diff;
 }
 
+static struct timeval
+time_choose_strategies_batch(instruments_strategy_evaluator_t evaluator, 
+                             int first_bytelen, int batch_size)
+{
+    void *chooser_args[batch_size];
+    instruments_strategy_t chosen[batch_size];
+    int i;
+    for (i = 0; i < batch_size; ++i) {
+        chooser_args[i] = (void *) (first_bytelen + i * 1024);
+    }
+    
+    struct timeval begin, end, diff;
+    gettimeofday(&begin, NULL);
+    choose_strategies_batch(evaluator, chooser_args, batch_size, chosen);
+    gettimeofday(&end, NULL);
+    TIMEDIFF(begin, end, diff);
+    return diff;
+}
+
 struct strategy_args {
     int num_estimators;
     instruments_external_estimator_t *estimators;
@@ -71,6 +90,12 @@ static double no_cost(instruments_context_t ctx, void *strategy_arg, void *choos
     return estimator_value(ctx, strategy_arg, chooser_arg) * 2.0;
 }
 
+/* the eval fns must be distinct functions. */
+static double no_data_cost(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    return no_cost(ctx, strategy_arg, chooser_arg);
+}
+
 static double get_unit_uniform_sample()
 {
     return ((double) random()) / RAND_MAX;
@@ -117,6 +142,26 @@ static const int NUM_ESTIMATORS = NUM_WIFI_ESTIMATORS + NUM_CELLULAR_ESTIMATORS;
 
 static const size_t NUM_STRATEGIES = 3;
 
+/* for the sampling methods: draws per expected value (0 for the default).
+ *  run_test saves the first strategy's expected time in last_strategy_time. */
+static size_t sampling_draws = 0;
+static double last_strategy_time = 0.0;
+
+/* threads per expected value, with deterministic sums (0 for the default). */
+static size_t loop_threads = 0;
+
+/* max incremental updates per expected value (0 for the default).
+ *  If fixed_estimates, the observations between decisions keep
+ *  each estimator's estimate, so the updates can be incremental. */
+static size_t incremental_updates = 0;
+static int fixed_estimates = 0;
+
+/* if > 0, the most tuples per expected value. */
+static size_t max_tuples = 0;
+
+/* if > 0, each estimator keeps a sliding window of this many error samples. */
+static size_t sample_window = 0;
+
 static void init_estimators(instruments_external_estimator_t *estimators,
                             int num_samples)
 {
@@ -129,12 +174,18 @@ static void init_estimators(instruments_external_estimator_t *estimators,
         // set bin hints for bayesian method -- scale with num_samples
         double range = normal_stddev * 2.0;
         set_estimator_range_hints(estimators[i], normal_mean - range, normal_mean + range, num_samples);
+        if (sample_window > 0) {
+            set_estimator_sample_retention(estimators[i], INSTRUMENTS_RETAIN_SLIDING_WINDOW,
+                                           sample_window, 0.0);
+        }
     }
 }
 
+/* batch_size > 0: each 'choose' is one choose_strategies_batch call 
+ *                 for batch_size different chooser_args. */
 static struct timeval run_test(int num_samples, enum EvalMethod method,
                                const char *restore_file, int choose_strategy_count,
-                               int redundant)
+                               int redundant, int batch_size)
 {
     instruments_external_estimator_t estimators[NUM_ESTIMATORS];
     instruments_strategy_t strategies[NUM_STRATEGIES];
@@ -153,8 +204,8 @@ static struct timeval run_test(int num_samples, enum EvalMethod method,
         },
     };
 
-    strategies[0] = make_strategy(estimator_value, no_cost, no_cost, (void*) &args[0], NULL);
-    strategies[1] = make_strategy(estimator_value, no_cost, no_cost, (void*) &args[1], NULL);
+    strategies[0] = make_strategy(estimator_value, no_cost, no_data_cost, (void*) &args[0], NULL);
+    strategies[1] = make_strategy(estimator_value, no_cost, no_data_cost, (void*) &args[1], NULL);
     strategies[2] = make_redundant_strategy(strategies, 2, NULL);
     
     instruments_strategy_evaluator_t evaluator = 
@@ -163,22 +214,48 @@ static struct timeval run_test(int num_samples, enum EvalMethod method,
     if (restore_file) {
         restore_evaluator(evaluator, restore_file);
     }
+    if (sampling_draws > 0) {
+        set_strategy_evaluator_sampling(evaluator, sampling_draws, 42);
+    }
+    if (loop_threads > 0) {
+        set_strategy_evaluator_loop_threads(evaluator, loop_threads, 1);
+    }
+    if (incremental_updates > 0) {
+        set_strategy_evaluator_incremental_updates(evaluator, incremental_updates);
+    }
+    if (max_tuples > 0) {
+        set_strategy_evaluator_evaluation_budget(evaluator, max_tuples, 0.0);
+    }
 
     int bytelen = 4096;
 
     reset_prng();
     int i, j;
+    double observation, estimates[NUM_ESTIMATORS];
     for (i = 0; i < num_samples; ++i) {
         for (j = 0; j < NUM_ESTIMATORS; ++j) {
-            add_observation(estimators[j], get_sample(), get_sample());
+            observation = get_sample();
+            estimates[j] = get_sample();
+            add_observation(estimators[j], observation, estimates[j]);
         }
     }
     struct timeval total_duration = {0, 0};
     for (i = 0; i < choose_strategy_count; ++i) {
-        struct timeval duration = time_choose_strategy(evaluator, bytelen, redundant);
+        struct timeval duration;
+        if (batch_size > 0) {
+            duration = time_choose_strategies_batch(evaluator, bytelen, batch_size);
+        } else {
+            duration = time_choose_strategy(evaluator, bytelen, redundant);
+        }
         timeradd(&total_duration, &duration, &total_duration);
+        last_strategy_time = get_last_strategy_time(evaluator, strategies[0]);
         
-        add_observation(estimators[i % NUM_ESTIMATORS], get_sample(), get_sample());
+        j = i % NUM_ESTIMATORS;
+        observation = get_sample();
+        if (!fixed_estimates) {
+            estimates[j] = get_sample();
+        }
+        add_observation(estimators[j], observation, estimates[j]);
     }
     
     for (i = 0; i < NUM_ESTIMATORS; ++i) {
@@ -193,10 +270,59 @@ static struct timeval run_test(int num_samples, enum EvalMethod method,
     return total_duration;
 }
 
+/* adds total_observations, spread over the estimators, timing
+ * a redundant decision after each power of 10 of them. */
+static void run_soak_test(enum EvalMethod method, int total_observations)
+{
+    instruments_external_estimator_t estimators[NUM_ESTIMATORS];
+    instruments_strategy_t strategies[NUM_STRATEGIES];
+    init_estimators(estimators, 50);
+
+    struct strategy_args args[2] = {
+        {
+        num_estimators: NUM_WIFI_ESTIMATORS,
+        estimators: &estimators[0],
+        other_estimators: &estimators[CELLULAR_ESTIMATORS_INDEX]
+        },
+        {
+        num_estimators: NUM_CELLULAR_ESTIMATORS,
+        estimators: &estimators[CELLULAR_ESTIMATORS_INDEX],
+        other_estimators: NULL
+        },
+    };
+
+    strategies[0] = make_strategy(estimator_value, no_cost, no_data_cost, (void*) &args[0], NULL);
+    strategies[1] = make_strategy(estimator_value, no_cost, no_data_cost, (void*) &args[1], NULL);
+    strategies[2] = make_redundant_strategy(strategies, 2, NULL);
+    
+    instruments_strategy_evaluator_t evaluator = 
+        register_strategy_set_with_method("", strategies, 3, method);
+
+    reset_prng();
+    int i, checkpoint = 1000;
+    for (i = 1; i <= total_observations; ++i) {
+        int j = i % NUM_ESTIMATORS;
+        add_observation(estimators[j], get_sample(), get_sample());
+        if (i == checkpoint) {
+            struct timeval duration = time_choose_strategy(evaluator, 4096, 1);
+            fprintf(stderr, "%8d observations  %lu.%06lu\n", i,
+                    duration.tv_sec, duration.tv_usec);
+            checkpoint *= 10;
+        }
+    }
+    
+    for (i = 0; i < NUM_ESTIMATORS; ++i) {
+        free_external_estimator(estimators[i]);
+    }
+    for (i = 0; i < NUM_STRATEGIES; ++i) {
+        free_strategy(strategies[i]);
+    }
+    free_strategy_evaluator(evaluator);
+}
 
 int main(int argc, char *argv[])
 {
-    int i;
+    int i, j;
     instruments_debug_level_t debug_level = NONE;
     if (argc > 1 && !strcasecmp(argv[1], "debug")) {
         debug_level = DEBUG;
@@ -238,7 +364,7 @@ int main(int argc, char *argv[])
             fprintf(stderr, "%3d samples", num_samples);
             for (i = 0; i < NUM_METHODS; ++i) {
                 enum EvalMethod method = methods[i];
-                struct timeval duration = run_test(num_samples, method, NULL, 1, redundant);
+                struct timeval duration = run_test(num_samples, method, NULL, 1, redundant, 0);
                 fprintf(stderr, " %lu.%06lu%7s", duration.tv_sec, duration.tv_usec, "");
             }
             fprintf(stderr, "\n");
@@ -253,14 +379,141 @@ int main(int argc, char *argv[])
     fprintf(stderr, "%11s bayesian-with-history\n", "");
     for (num_samples = min_samples; num_samples <= max_samples;
          num_samples += new_samples) {
-        struct timeval duration = run_test(num_samples, BAYESIAN, bayesian_history, 1, 1);
+        struct timeval duration = run_test(num_samples, BAYESIAN, bayesian_history, 1, 1, 0);
         fprintf(stderr, "%3d samples %lu.%06lu\n", num_samples, duration.tv_sec, duration.tv_usec);
     }
 
+    // per-decision cost of batched decisions; each batch follows
+    //  a new observation, so nothing is served from the cache.
+    int batch_sizes[] = { 1, 2, 4, 8, 16, 32, 64 };
+    const size_t NUM_BATCH_SIZES = sizeof(batch_sizes) / sizeof(int);
+    const int num_batches = 10;
+    num_samples = 20;
+    fprintf(stderr, "batched decisions, %d samples, %s (usec per decision)\n",
+            num_samples, get_method_name(EMPIRICAL_ERROR_ALL_SAMPLES));
+    for (i = 0; i < NUM_BATCH_SIZES; ++i) {
+        int batch_size = batch_sizes[i];
+        struct timeval duration = run_test(num_samples, EMPIRICAL_ERROR_ALL_SAMPLES, NULL, 
+                                           num_batches, 1, batch_size);
+        double usecs = duration.tv_sec * 1000000.0 + duration.tv_usec;
+        fprintf(stderr, "batch of %2d  %10.1f\n", batch_size, 
+                usecs / (num_batches * batch_size));
+    }
+
+    // error of the sampling methods vs. the number of draws, against
+    //  the exhaustive evaluation (num_samples^2 eval fn calls per value).
+    enum EvalMethod sampling_methods[] = {
+        EMPIRICAL_ERROR_ALL_SAMPLES_MONTE_CARLO,
+        EMPIRICAL_ERROR_ALL_SAMPLES_QUASI_MONTE_CARLO,
+        EMPIRICAL_ERROR_ALL_SAMPLES_STRATIFIED,
+    };
+    const size_t NUM_SAMPLING_METHODS = sizeof(sampling_methods) / sizeof(enum EvalMethod);
+    size_t draw_counts[] = { 16, 64, 256, 1024, 4096 };
+    const size_t NUM_DRAW_COUNTS = sizeof(draw_counts) / sizeof(size_t);
+    num_samples = 50;
+
+    struct timeval exact_duration = run_test(num_samples, EMPIRICAL_ERROR_ALL_SAMPLES, NULL, 1, 0, 0);
+    double exact_time = last_strategy_time;
+    fprintf(stderr, "sampling error, %d samples; exhaustive: %d evals, %lu.%06lu sec\n",
+            num_samples, num_samples * num_samples, 
+            exact_duration.tv_sec, exact_duration.tv_usec);
+    fprintf(stderr, "%5s", "draws");
+    for (i = 0; i < NUM_SAMPLING_METHODS; ++i) {
+        fprintf(stderr, " %-25s", get_method_name(sampling_methods[i]));
+    }
+    fprintf(stderr, "\n");
+    for (j = 0; j < NUM_DRAW_COUNTS; ++j) {
+        sampling_draws = draw_counts[j];
+        fprintf(stderr, "%5zu", sampling_draws);
+        for (i = 0; i < NUM_SAMPLING_METHODS; ++i) {
+            struct timeval duration = run_test(num_samples, sampling_methods[i], NULL, 1, 0, 0);
+            fprintf(stderr, " %9.6f %lu.%06lu     ", fabs(last_strategy_time - exact_time),
+                    duration.tv_sec, duration.tv_usec);
+        }
+        fprintf(stderr, "\n");
+    }
+    sampling_draws = 0;
+
+    // one exhaustive expectation split across threads.
+    size_t thread_counts[] = { 1, 2, 4, 8 };
+    const size_t NUM_THREAD_COUNTS = sizeof(thread_counts) / sizeof(size_t);
+    num_samples = 200;
+    double serial_seconds = 0.0;
+    fprintf(stderr, "loop threads, %d samples, %s\n",
+            num_samples, get_method_name(EMPIRICAL_ERROR_ALL_SAMPLES));
+    for (i = 0; i < NUM_THREAD_COUNTS; ++i) {
+        loop_threads = thread_counts[i];
+        struct timeval duration = run_test(num_samples, EMPIRICAL_ERROR_ALL_SAMPLES, NULL, 1, 0, 0);
+        double seconds = duration.tv_sec + duration.tv_usec / 1000000.0;
+        if (i == 0) {
+            serial_seconds = seconds;
+        }
+        fprintf(stderr, "%zu threads  %lu.%06lu  speedup %.2f\n", loop_threads,
+                duration.tv_sec, duration.tv_usec, serial_seconds / seconds);
+    }
+    loop_threads = 0;
+
+    // decisions after observations that don't move the estimates,
+    //  the only case incremental updates help.
+    num_samples = 50;
+    int num_decisions = 20;
+    fixed_estimates = 1;
+    fprintf(stderr, "incremental updates (fixed estimates), %d samples, %d decisions, %s\n",
+            num_samples, num_decisions, get_method_name(EMPIRICAL_ERROR_ALL_SAMPLES));
+    for (i = 0; i < 2; ++i) {
+        incremental_updates = (i == 0) ? 0 : 100;
+        struct timeval duration = run_test(num_samples, EMPIRICAL_ERROR_ALL_SAMPLES, NULL,
+                                           num_decisions, 0, 0);
+        fprintf(stderr, "%-12s %lu.%06lu\n", incremental_updates > 0 ? "incremental" : "full",
+                duration.tv_sec, duration.tv_usec);
+    }
+    incremental_updates = 0;
+    fixed_estimates = 0;
+
+    // a fixed number of centroids per estimator, however many samples.
+    int sketch_samples[] = { 50, 200, 800 };
+    fprintf(stderr, "quantile sketch vs. all samples (time, first strategy's expected time)\n");
+    for (i = 0; i < sizeof(sketch_samples) / sizeof(int); ++i) {
+        struct timeval exact_duration = run_test(sketch_samples[i], EMPIRICAL_ERROR_ALL_SAMPLES,
+                                                 NULL, 1, 0, 0);
+        double exact_time = last_strategy_time;
+        struct timeval sketch_duration = run_test(sketch_samples[i], EMPIRICAL_ERROR_QUANTILE_SKETCH,
+                                                  NULL, 1, 0, 0);
+        fprintf(stderr, "%3d samples  %lu.%06lu %f   %lu.%06lu %f\n", sketch_samples[i],
+                exact_duration.tv_sec, exact_duration.tv_usec, exact_time,
+                sketch_duration.tv_sec, sketch_duration.tv_usec, last_strategy_time);
+    }
+
+    // the same, with a tuple budget instead.
+    max_tuples = 10000;
+    fprintf(stderr, "budget of %zu tuples vs. all samples (time, first strategy's expected time)\n",
+            max_tuples);
+    for (i = 0; i < sizeof(sketch_samples) / sizeof(int); ++i) {
+        max_tuples = 0;
+        struct timeval exact_duration = run_test(sketch_samples[i], EMPIRICAL_ERROR_ALL_SAMPLES,
+                                                 NULL, 1, 0, 0);
+        double exact_time = last_strategy_time;
+        max_tuples = 10000;
+        struct timeval budget_duration = run_test(sketch_samples[i], EMPIRICAL_ERROR_ALL_SAMPLES,
+                                                  NULL, 1, 0, 0);
+        fprintf(stderr, "%3d samples  %lu.%06lu %f   %lu.%06lu %f\n", sketch_samples[i],
+                exact_duration.tv_sec, exact_duration.tv_usec, exact_time,
+                budget_duration.tv_sec, budget_duration.tv_usec, last_strategy_time);
+    }
+    max_tuples = 0;
+
+    // decision latency over a long run, with each estimator's
+    //  error samples in a sliding window.
+    sample_window = 50;
+    fprintf(stderr, "long soak, sliding window of %zu samples, %s\n",
+            sample_window, get_method_name(EMPIRICAL_ERROR_ALL_SAMPLES));
+    run_soak_test(EMPIRICAL_ERROR_ALL_SAMPLES, 1000000);
+    sample_window = 0;
+
 #if 0
     int num_iterations = 1000;
     num_samples = 50;
-    struct timeval total_duration = run_test(num_samples, CONFIDENCE_BOUNDS, NULL, num_iterations, 1);
+    struct timeval total_duration = run_test(num_samples, CONFIDENCE_BOUNDS, NULL, num_iterations, 1, 0);
     fprintf(stderr, "Confidence bounds, %d samples, %d times:  %lu.%06lu sec\n", 
             num_samples, num_iterations, total_duration.tv_sec, total_duration.tv_usec);
 #endif    
@@ -271,7 +524,7 @@ int main(int argc, char *argv[])
     for (i = 0; i < NUM_METHODS; ++i) {
         enum EvalMethod method = methods[i];
         fprintf(stderr, "*** %s ***\n", get_method_name(method));
-        (void) run_test(5, method, NULL, 1, 1);
+        (void) run_test(5, method, NULL, 1, 1, 0);
     }
 #endif
 
@@ -0,0 +1,116 @@
+#include <instruments.h>
+#include <instruments_private.h>
+#include <resource_weights.h>
+
+#include <stdio.h>
+#include <math.h>
+
+#include "ctest.h"
+
+CTEST_DATA(quantile_sketch) {
+    instruments_external_estimator_t bandwidth;
+    instruments_external_estimator_t rtt;
+    instruments_external_estimator_t slow_bandwidth;
+};
+
+CTEST_SETUP(quantile_sketch)
+{
+    instruments_set_debug_level(INSTRUMENTS_DEBUG_LEVEL_NONE);
+    set_fixed_resource_weights(0.0, 0.0);
+
+    data->bandwidth = create_external_estimator("sketch-bandwidth");
+    data->rtt = create_external_estimator("sketch-rtt");
+    data->slow_bandwidth = create_external_estimator("sketch-slow-bandwidth");
+}
+
+CTEST_TEARDOWN(quantile_sketch)
+{
+    free_external_estimator(data->bandwidth);
+    free_external_estimator(data->rtt);
+    free_external_estimator(data->slow_bandwidth);
+}
+
+struct network {
+    instruments_external_estimator_t bandwidth;
+    instruments_external_estimator_t rtt;
+    double bytes;
+};
+
+static double
+transfer_time(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    struct network *net = (struct network *) strategy_arg;
+    return net->bytes / get_estimator_value(ctx, net->bandwidth) + get_estimator_value(ctx, net->rtt);
+}
+
+static double
+data_cost(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    struct network *net = (struct network *) strategy_arg;
+    return net->bytes;
+}
+
+/* adds num_observations to each estimator, then returns the strategies'
+ * expected times from an all-samples evaluator and a sketch evaluator. */
+static void
+compare_with_all_samples(struct quantile_sketch_data *data, int num_observations,
+                         size_t sketch_size, double exact[3], double sketched[3])
+{
+    struct network nets[2] = {
+        { data->bandwidth, data->rtt, 1000.0 },
+        { data->slow_bandwidth, data->rtt, 200.0 }
+    };
+    instruments_strategy_t strategies[3];
+    instruments_strategy_evaluator_t all_samples, sketch;
+    int i;
+
+    for (i = 0; i < 2; ++i) {
+        strategies[i] = make_strategy(transfer_time, NULL, data_cost, &nets[i], NULL);
+    }
+    strategies[2] = make_redundant_strategy(strategies, 2, NULL);
+    all_samples = register_strategy_set_with_method("", strategies, 3, EMPIRICAL_ERROR_ALL_SAMPLES);
+    sketch = register_strategy_set_with_method("", strategies, 3, EMPIRICAL_ERROR_QUANTILE_SKETCH);
+    set_strategy_evaluator_sketch_size(sketch, sketch_size);
+
+    for (i = 0; i < num_observations; ++i) {
+        add_observation(data->bandwidth, 100.0 + (i % 7) * 13.7, 100.0 + (i % 5) * 9.1);
+        add_observation(data->slow_bandwidth, 20.0 + (i % 3) * 1.3, 20.0 + (i % 4) * 0.7);
+        add_observation(data->rtt, 0.5 + (i % 4) * 0.11, 0.5 + (i % 3) * 0.13);
+    }
+
+    choose_strategy(all_samples, NULL);
+    choose_strategy(sketch, NULL);
+    for (i = 0; i < 3; ++i) {
+        exact[i] = get_last_strategy_time(all_samples, strategies[i]);
+        sketched[i] = get_last_strategy_time(sketch, strategies[i]);
+    }
+
+    free_strategy_evaluator(all_samples);
+    free_strategy_evaluator(sketch);
+    for (i = 2; i >= 0; --i) {
+        free_strategy(strategies[i]);
+    }
+}
+
+CTEST2(quantile_sketch, few_samples_match_all_samples)
+{
+    double exact[3], sketched[3];
+    int i;
+    /* fewer error samples than centroids: nothing is merged. */
+    compare_with_all_samples(data, 20, 50, exact, sketched);
+    for (i = 0; i < 3; ++i) {
+        ASSERT_TRUE(exact[i] > 0.0);
+        ASSERT_TRUE(fabs(exact[i] - sketched[i]) < 1e-9 * exact[i]);
+    }
+}
+
+CTEST2(quantile_sketch, many_samples_stay_close)
+{
+    double exact[3], sketched[3];
+    int i;
+    compare_with_all_samples(data, 400, 20, exact, sketched);
+    for (i = 0; i < 3; ++i) {
+        ASSERT_TRUE(exact[i] > 0.0);
+        ASSERT_TRUE(fabs(exact[i] - sketched[i]) < 0.01 * exact[i]);
+    }
+}
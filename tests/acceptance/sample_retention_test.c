@@ -0,0 +1,149 @@
+#include <instruments.h>
+#include <instruments_private.h>
+#include <resource_weights.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "ctest.h"
+
+CTEST_DATA(sample_retention) {
+    instruments_external_estimator_t bandwidth;
+    instruments_external_estimator_t slow_bandwidth;
+};
+
+CTEST_SETUP(sample_retention)
+{
+    instruments_set_debug_level(INSTRUMENTS_DEBUG_LEVEL_NONE);
+    set_fixed_resource_weights(0.0, 0.0);
+
+    data->bandwidth = create_external_estimator("retention-bandwidth");
+    data->slow_bandwidth = create_external_estimator("retention-slow-bandwidth");
+}
+
+CTEST_TEARDOWN(sample_retention)
+{
+    free_external_estimator(data->bandwidth);
+    free_external_estimator(data->slow_bandwidth);
+}
+
+static const double BYTES = 1000.0;
+
+static double
+transfer_time(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    instruments_external_estimator_t bandwidth = (instruments_external_estimator_t) strategy_arg;
+    return BYTES / get_estimator_value(ctx, bandwidth);
+}
+
+static double
+data_cost(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    return BYTES;
+}
+
+/* many observations far from the estimate, then a few right on it. */
+static void
+add_observations(struct sample_retention_data *data, int num_bad, int num_good)
+{
+    int i;
+    for (i = 0; i < num_bad; ++i) {
+        add_observation(data->bandwidth, 50.0, 100.0);
+        add_observation(data->slow_bandwidth, 5.0, 10.0);
+    }
+    for (i = 0; i < num_good; ++i) {
+        add_observation(data->bandwidth, 100.0, 100.0);
+        add_observation(data->slow_bandwidth, 10.0, 10.0);
+    }
+}
+
+/* the expected time of the strategy using data->bandwidth. */
+static double
+expected_time(struct sample_retention_data *data, const char *restore_filename,
+              const char *save_filename, int num_bad, int num_good)
+{
+    instruments_strategy_t strategies[2];
+    instruments_strategy_evaluator_t evaluator;
+    double time;
+
+    strategies[0] = make_strategy(transfer_time, NULL, data_cost, data->bandwidth, NULL);
+    strategies[1] = make_strategy(transfer_time, NULL, data_cost, data->slow_bandwidth, NULL);
+    evaluator = register_strategy_set_with_method("", strategies, 2, EMPIRICAL_ERROR_ALL_SAMPLES);
+    if (restore_filename) {
+        restore_evaluator(evaluator, restore_filename);
+    }
+
+    add_observations(data, num_bad, num_good);
+    choose_strategy(evaluator, NULL);
+    time = get_last_strategy_time(evaluator, strategies[0]);
+
+    if (save_filename) {
+        save_evaluator(evaluator, save_filename);
+    }
+    free_strategy_evaluator(evaluator);
+    free_strategy(strategies[0]);
+    free_strategy(strategies[1]);
+    return time;
+}
+
+CTEST2(sample_retention, sliding_window_forgets_old_error)
+{
+    double exact = BYTES / 100.0;
+    double unbounded = expected_time(data, NULL, NULL, 100, 20);
+    ASSERT_TRUE(fabs(unbounded - exact) > 0.1 * exact);
+
+    set_estimator_sample_retention(data->bandwidth, INSTRUMENTS_RETAIN_SLIDING_WINDOW, 10, 0.0);
+    set_estimator_sample_retention(data->slow_bandwidth, INSTRUMENTS_RETAIN_SLIDING_WINDOW, 10, 0.0);
+    ASSERT_TRUE(fabs(expected_time(data, NULL, NULL, 100, 20) - exact) < 1e-9 * exact);
+}
+
+CTEST2(sample_retention, max_age_forgets_old_error)
+{
+    double exact = BYTES / 100.0;
+    set_estimator_sample_retention(data->bandwidth, INSTRUMENTS_RETAIN_MAX_AGE, 0, 0.2);
+    set_estimator_sample_retention(data->slow_bandwidth, INSTRUMENTS_RETAIN_MAX_AGE, 0, 0.2);
+
+    instruments_strategy_t strategies[2];
+    instruments_strategy_evaluator_t evaluator;
+    strategies[0] = make_strategy(transfer_time, NULL, data_cost, data->bandwidth, NULL);
+    strategies[1] = make_strategy(transfer_time, NULL, data_cost, data->slow_bandwidth, NULL);
+    evaluator = register_strategy_set_with_method("", strategies, 2, EMPIRICAL_ERROR_ALL_SAMPLES);
+
+    add_observations(data, 100, 0);
+    choose_strategy(evaluator, NULL);
+    ASSERT_TRUE(fabs(get_last_strategy_time(evaluator, strategies[0]) - exact) > 0.1 * exact);
+
+    usleep(300 * 1000);
+    add_observations(data, 0, 1);
+    choose_strategy(evaluator, NULL);
+    ASSERT_TRUE(fabs(get_last_strategy_time(evaluator, strategies[0]) - exact) < 1e-9 * exact);
+
+    free_strategy_evaluator(evaluator);
+    free_strategy(strategies[0]);
+    free_strategy(strategies[1]);
+}
+
+CTEST2(sample_retention, policy_survives_save_and_restore)
+{
+    double exact = BYTES / 100.0;
+    char filename[] = "/tmp/sample_retention_test_XXXXXX";
+    int fd = mkstemp(filename);
+    ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    set_estimator_sample_retention(data->bandwidth, INSTRUMENTS_RETAIN_SLIDING_WINDOW, 10, 0.0);
+    set_estimator_sample_retention(data->slow_bandwidth, INSTRUMENTS_RETAIN_SLIDING_WINDOW, 10, 0.0);
+    expected_time(data, NULL, filename, 100, 20);
+
+    /* fresh estimators have no policy of their own,
+     *  so the restored distributions keep theirs. */
+    free_external_estimator(data->bandwidth);
+    free_external_estimator(data->slow_bandwidth);
+    data->bandwidth = create_external_estimator("retention-bandwidth");
+    data->slow_bandwidth = create_external_estimator("retention-slow-bandwidth");
+    ASSERT_TRUE(fabs(expected_time(data, filename, NULL, 100, 20) - exact) < 1e-9 * exact);
+
+    unlink(filename);
+}
@@ -1,6 +1,9 @@
 #include <instruments.h>
+#include <instruments_private.h>
 #include "ctest.h"
 
+#include <pthread.h>
+
 static double
 one_of_two_values(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
 {
@@ -39,3 +42,157 @@ CTEST(chooser_arg, arg_is_passed)
     ASSERT_NOT_NULL(chosen);
     ASSERT_EQUAL((int)strategies[1], (int) chosen);
 }
+
+static void check_batch_matches_individual(instruments_strategy_evaluator_t evaluator)
+{
+    void *chooser_args[5] = { (void*) 0, (void*) 1, (void*) 2, (void*) 3, (void*) 4 };
+    instruments_strategy_t batch_chosen[5];
+    int i;
+
+    choose_strategies_batch(evaluator, chooser_args, 5, batch_chosen);
+    for (i = 0; i < 5; ++i) {
+        instruments_strategy_t chosen = choose_strategy(evaluator, chooser_args[i]);
+        ASSERT_NOT_NULL(batch_chosen[i]);
+        ASSERT_EQUAL((int) chosen, (int) batch_chosen[i]);
+    }
+}
+
+CTEST(chooser_arg, batch_matches_individual)
+{
+    instruments_strategy_t strategies[2];
+
+    strategies[0] = make_strategy(one_of_two_values, NULL, no_cost, (void*) 0, NULL);
+    strategies[1] = make_strategy(one_of_two_values, NULL, no_cost, (void*) 1, NULL);
+
+    instruments_strategy_evaluator_t evaluator = register_strategy_set("", strategies, 2);
+    check_batch_matches_individual(evaluator);
+    free_strategy_evaluator(evaluator);
+
+    evaluator = register_strategy_set_with_method("", strategies, 2, EMPIRICAL_ERROR_ALL_SAMPLES);
+    check_batch_matches_individual(evaluator);
+    free_strategy_evaluator(evaluator);
+    
+    free_strategy(strategies[0]);
+    free_strategy(strategies[1]);
+}
+
+static int int_arg_less(void *left, void *right)
+{
+    return (long) left < (long) right;
+}
+
+static void *copy_int_arg(void *arg)
+{
+    return arg;
+}
+
+static void delete_int_arg(void *arg)
+{
+}
+
+static size_t hash_int_arg(void *arg)
+{
+    return (size_t) arg;
+}
+
+CTEST(chooser_arg, cache_is_bounded)
+{
+    instruments_strategy_t strategies[2];
+    struct instruments_chooser_arg_fns_v2 fns = {
+        int_arg_less, copy_int_arg, delete_int_arg, hash_int_arg
+    };
+    struct instruments_evaluator_stats stats;
+    long i;
+
+    strategies[0] = make_strategy(one_of_two_values, NULL, no_cost, (void*) 0, NULL);
+    strategies[1] = make_strategy(one_of_two_values, NULL, no_cost, (void*) 1, NULL);
+
+    instruments_strategy_evaluator_t evaluator = 
+        register_strategy_set_with_fns_v2("", strategies, 2, fns);
+    set_strategy_evaluator_cache_size(evaluator, 10);
+
+    for (i = 0; i < 100; ++i) {
+        instruments_strategy_t chosen = choose_strategy(evaluator, (void*) i);
+        ASSERT_EQUAL((int) strategies[i % 2], (int) chosen);
+    }
+    for (i = 90; i < 100; ++i) {
+        instruments_strategy_t chosen = choose_strategy(evaluator, (void*) i);
+        ASSERT_EQUAL((int) strategies[i % 2], (int) chosen);
+    }
+
+    get_strategy_evaluator_stats(evaluator, &stats);
+    ASSERT_EQUAL(10, (int) stats.cache_entries);
+    ASSERT_EQUAL(90, (int) stats.cache_evictions);
+    ASSERT_EQUAL(100, (int) stats.cache_misses);
+    ASSERT_EQUAL(10, (int) stats.cache_hits);
+
+    free_strategy_evaluator(evaluator);
+    free_strategy(strategies[0]);
+    free_strategy(strategies[1]);
+}
+
+#define NUM_DECIDING_THREADS 4
+#define DECISIONS_PER_THREAD 200
+
+struct decider_args {
+    instruments_strategy_evaluator_t evaluator;
+    instruments_strategy_t *strategies;
+    long first_arg;
+    int wrong_choices;
+};
+
+static void *
+decide_many(void *arg)
+{
+    struct decider_args *args = (struct decider_args *) arg;
+    long i;
+    for (i = args->first_arg; i < args->first_arg + DECISIONS_PER_THREAD; ++i) {
+        instruments_strategy_t chosen = choose_strategy(args->evaluator, (void*) i);
+        if (chosen != args->strategies[i % 2]) {
+            ++args->wrong_choices;
+        }
+    }
+    return NULL;
+}
+
+static void check_concurrent_decisions(instruments_strategy_t *strategies, 
+                                       enum EvalMethod method)
+{
+    struct decider_args args[NUM_DECIDING_THREADS];
+    pthread_t threads[NUM_DECIDING_THREADS];
+    struct instruments_evaluator_stats stats;
+    int i;
+
+    instruments_strategy_evaluator_t evaluator = 
+        register_strategy_set_with_method("", strategies, 2, method);
+    for (i = 0; i < NUM_DECIDING_THREADS; ++i) {
+        args[i].evaluator = evaluator;
+        args[i].strategies = strategies;
+        args[i].first_arg = i * DECISIONS_PER_THREAD;
+        args[i].wrong_choices = 0;
+        ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, decide_many, &args[i]));
+    }
+    for (i = 0; i < NUM_DECIDING_THREADS; ++i) {
+        ASSERT_EQUAL(0, pthread_join(threads[i], NULL));
+        ASSERT_EQUAL(0, args[i].wrong_choices);
+    }
+
+    get_strategy_evaluator_stats(evaluator, &stats);
+    ASSERT_EQUAL(NUM_DECIDING_THREADS * DECISIONS_PER_THREAD, (int) stats.cache_misses);
+    free_strategy_evaluator(evaluator);
+}
+
+CTEST(chooser_arg, concurrent_decisions)
+{
+    instruments_strategy_t strategies[2];
+
+    strategies[0] = make_strategy(one_of_two_values, NULL, no_cost, (void*) 0, NULL);
+    strategies[1] = make_strategy(one_of_two_values, NULL, no_cost, (void*) 1, NULL);
+
+    check_concurrent_decisions(strategies, TRUSTED_ORACLE);
+    check_concurrent_decisions(strategies, EMPIRICAL_ERROR_ALL_SAMPLES);
+    check_concurrent_decisions(strategies, CONFIDENCE_BOUNDS);
+
+    free_strategy(strategies[0]);
+    free_strategy(strategies[1]);
+}
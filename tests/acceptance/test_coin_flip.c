@@ -173,3 +173,16 @@ CTEST2(coinflip, tails_heavy_coin_should_choose_tails)
     assert_correct_strategy(data, data->strategies[1]);
 }
 
+CTEST2(coinflip, parallel_faircoin_should_choose_redundant)
+{
+    set_strategy_evaluator_threads(data->evaluator, 4);
+    init_coin(5, 100);
+    assert_correct_strategy(data, data->strategies[2]);
+}
+
+CTEST2(coinflip, parallel_heads_heavy_coin_should_choose_heads)
+{
+    set_strategy_evaluator_threads(data->evaluator, 4);
+    init_coin(9, 100);
+    assert_correct_strategy(data, data->strategies[0]);
+}
@@ -0,0 +1,146 @@
+#include <instruments.h>
+#include <instruments_private.h>
+#include <resource_weights.h>
+
+#include <stdio.h>
+#include <math.h>
+
+#include "ctest.h"
+
+CTEST_DATA(vector_eval_fn) {
+    instruments_external_estimator_t bandwidth;
+    instruments_external_estimator_t rtt;
+};
+
+CTEST_SETUP(vector_eval_fn)
+{
+    instruments_set_debug_level(INSTRUMENTS_DEBUG_LEVEL_NONE);
+    set_fixed_resource_weights(0.0, 1.0);
+
+    data->bandwidth = create_external_estimator("vec-bandwidth");
+    data->rtt = create_external_estimator("vec-rtt");
+}
+
+CTEST_TEARDOWN(vector_eval_fn)
+{
+    free_external_estimator(data->bandwidth);
+    free_external_estimator(data->rtt);
+}
+
+struct network {
+    instruments_external_estimator_t bandwidth;
+    instruments_external_estimator_t rtt;
+    double bytes;
+};
+
+static double
+transfer_time(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    struct network *net = (struct network *) strategy_arg;
+    return net->bytes / get_estimator_value(ctx, net->bandwidth) + get_estimator_value(ctx, net->rtt);
+}
+
+static void
+transfer_time_vec(instruments_context_t ctx, void *strategy_arg, void *chooser_arg,
+                  size_t count, double *values)
+{
+    struct network *net = (struct network *) strategy_arg;
+    const double *bandwidth = get_estimator_values_vec(ctx, net->bandwidth);
+    const double *rtt = get_estimator_values_vec(ctx, net->rtt);
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        values[i] = net->bytes / bandwidth[i] + rtt[i];
+    }
+}
+
+static double
+data_cost(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    struct network *net = (struct network *) strategy_arg;
+    return net->bytes;
+}
+
+static void
+data_cost_vec(instruments_context_t ctx, void *strategy_arg, void *chooser_arg,
+              size_t count, double *values)
+{
+    struct network *net = (struct network *) strategy_arg;
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        values[i] = net->bytes;
+    }
+}
+
+static void
+check_vector_matches_scalar(struct vector_eval_fn_data *data, enum EvalMethod method)
+{
+    /* the slow network only shares the rtt estimator. */
+    instruments_external_estimator_t slow_bandwidth = create_external_estimator("vec-slow-bandwidth");
+    struct network nets[2] = {
+        { data->bandwidth, data->rtt, 1000.0 },
+        { slow_bandwidth, data->rtt, 200.0 }
+    };
+
+    instruments_strategy_t strategies[3], vec_strategies[3];
+    int i;
+
+    /* costs don't matter, so the redundant strategy gets evaluated too. */
+    set_fixed_resource_weights(0.0, 0.0);
+    for (i = 0; i < 2; ++i) {
+        strategies[i] = make_strategy(transfer_time, NULL, data_cost, &nets[i], NULL);
+        vec_strategies[i] = make_vector_strategy(transfer_time_vec, NULL, data_cost_vec, &nets[i], NULL);
+    }
+    strategies[2] = make_redundant_strategy(strategies, 2, NULL);
+    vec_strategies[2] = make_redundant_strategy(vec_strategies, 2, NULL);
+
+    instruments_strategy_evaluator_t evaluator = 
+        register_strategy_set_with_method("", strategies, 3, method);
+    instruments_strategy_evaluator_t vec_evaluator = 
+        register_strategy_set_with_method("", vec_strategies, 3, method);
+
+    for (i = 0; i < 20; ++i) {
+        add_observation(data->bandwidth, 100.0 + (i % 7) * 10.0, 100.0 + (i % 5) * 10.0);
+        add_observation(slow_bandwidth, 20.0 + (i % 3), 20.0 + (i % 4));
+        add_observation(data->rtt, 0.5 + (i % 4) * 0.1, 0.5 + (i % 3) * 0.1);
+    }
+
+    instruments_strategy_t chosen = choose_strategy(evaluator, NULL);
+    instruments_strategy_t vec_chosen = choose_strategy(vec_evaluator, NULL);
+    for (i = 0; i < 3; ++i) {
+        if (chosen == strategies[i]) {
+            ASSERT_EQUAL((int)vec_strategies[i], (int)vec_chosen);
+        }
+    }
+    for (i = 0; i < 3; ++i) {
+        double time = get_last_strategy_time(evaluator, strategies[i]);
+        double vec_time = get_last_strategy_time(vec_evaluator, vec_strategies[i]);
+        ASSERT_TRUE(fabs(time - vec_time) < 0.0001);
+    }
+
+    /* outside an evaluation, the callbacks see the current estimates. */
+    ASSERT_TRUE(fabs(calculate_strategy_time(NULL, strategies[0], NULL) -
+                     calculate_strategy_time(NULL, vec_strategies[0], NULL)) < 0.0001);
+
+    free_strategy_evaluator(vec_evaluator);
+    free_strategy_evaluator(evaluator);
+    for (i = 2; i >= 0; --i) {
+        free_strategy(vec_strategies[i]);
+        free_strategy(strategies[i]);
+    }
+    free_external_estimator(slow_bandwidth);
+}
+
+CTEST2(vector_eval_fn, empirical_error_matches_scalar)
+{
+    check_vector_matches_scalar(data, EMPIRICAL_ERROR_ALL_SAMPLES);
+}
+
+CTEST2(vector_eval_fn, trusted_oracle_matches_scalar)
+{
+    check_vector_matches_scalar(data, TRUSTED_ORACLE);
+}
+
+CTEST2(vector_eval_fn, monte_carlo_matches_scalar)
+{
+    check_vector_matches_scalar(data, EMPIRICAL_ERROR_ALL_SAMPLES_MONTE_CARLO);
+}
@@ -0,0 +1,257 @@
+#include <cppunit/Test.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "choice_cache_test.h"
+#include "choice_cache.h"
+
+#include <math.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+using std::atomic; using std::thread; using std::vector;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ChoiceCacheTest);
+
+static int int_less(void *left, void *right)
+{
+    return *(int *) left < *(int *) right;
+}
+
+static atomic<int> num_copies(0);
+
+static void *copy_int(void *arg)
+{
+    ++num_copies;
+    return new int(*(int *) arg);
+}
+
+static void delete_int(void *arg)
+{
+    --num_copies;
+    delete (int *) arg;
+}
+
+static size_t hash_int(void *arg)
+{
+    return *(int *) arg;
+}
+
+static struct instruments_chooser_arg_fns_v2 int_fns = {
+    int_less, copy_int, delete_int, NULL
+};
+
+static struct instruments_chooser_arg_fns_v2 hashed_int_fns = {
+    int_less, copy_int, delete_int, hash_int
+};
+
+// the cache never dereferences the strategies; any distinct pointers will do.
+static int strategy_a, strategy_b;
+static instruments_strategy_t A = &strategy_a;
+static instruments_strategy_t B = &strategy_b;
+
+static void testInsertAndLookup(struct instruments_chooser_arg_fns_v2 fns)
+{
+    ChoiceCache cache(fns);
+    int one = 1, two = 2;
+    CPPUNIT_ASSERT(cache.lookup(&one) == NULL);
+
+    cache.insert(&one, A, cache.generation());
+    CPPUNIT_ASSERT(cache.lookup(&one) == A);
+    CPPUNIT_ASSERT(cache.lookup(&two) == NULL);
+
+    cache.insert(&one, B, cache.generation());
+    CPPUNIT_ASSERT(cache.lookup(&one) == B);
+
+    cache.clear();
+    CPPUNIT_ASSERT(cache.lookup(&one) == NULL);
+}
+
+void
+ChoiceCacheTest::testInsertAndLookup()
+{
+    ::testInsertAndLookup(int_fns);
+}
+
+void
+ChoiceCacheTest::testHashedInsertAndLookup()
+{
+    ::testInsertAndLookup(hashed_int_fns);
+}
+
+void
+ChoiceCacheTest::testKeyCopies()
+{
+    num_copies = 0;
+    {
+        ChoiceCache cache(int_fns);
+        int *key = new int(5);
+        cache.insert(key, A, cache.generation());
+        delete key;
+
+        int same = 5;
+        CPPUNIT_ASSERT(cache.lookup(&same) == A);
+        CPPUNIT_ASSERT_EQUAL(1, num_copies.load());
+
+        cache.insert(&same, B, cache.generation());
+        CPPUNIT_ASSERT_EQUAL(1, num_copies.load());
+    }
+    CPPUNIT_ASSERT_EQUAL(0, num_copies.load());
+}
+
+void
+ChoiceCacheTest::testStaleInsertIgnored()
+{
+    ChoiceCache cache(int_fns);
+    int one = 1;
+    unsigned long generation = cache.generation();
+    cache.clear();
+    cache.insert(&one, A, generation);
+    CPPUNIT_ASSERT(cache.lookup(&one) == NULL);
+}
+
+void
+ChoiceCacheTest::testEviction()
+{
+    num_copies = 0;
+    {
+        ChoiceCache cache(hashed_int_fns, 4);
+        int keys[] = {0, 1, 2, 3, 4, 5};
+        for (int i = 0; i < 4; ++i) {
+            cache.insert(&keys[i], A, cache.generation());
+        }
+        // only key 0 has been used since it was cached,
+        //  so the clock evicts key 1 and then key 2.
+        CPPUNIT_ASSERT(cache.lookup(&keys[0]) == A);
+        cache.insert(&keys[4], B, cache.generation());
+        cache.insert(&keys[5], B, cache.generation());
+
+        CPPUNIT_ASSERT(cache.lookup(&keys[0]) == A);
+        CPPUNIT_ASSERT(cache.lookup(&keys[1]) == NULL);
+        CPPUNIT_ASSERT(cache.lookup(&keys[2]) == NULL);
+        CPPUNIT_ASSERT(cache.lookup(&keys[3]) == A);
+        CPPUNIT_ASSERT(cache.lookup(&keys[4]) == B);
+        CPPUNIT_ASSERT(cache.lookup(&keys[5]) == B);
+
+        ChoiceCache::Stats stats = cache.getStats();
+        CPPUNIT_ASSERT_EQUAL(2ULL, stats.evictions);
+        CPPUNIT_ASSERT_EQUAL((size_t) 4, stats.entries);
+        CPPUNIT_ASSERT_EQUAL(5ULL, stats.hits);
+        CPPUNIT_ASSERT_EQUAL(2ULL, stats.misses);
+        CPPUNIT_ASSERT_EQUAL(4, num_copies.load());
+
+        cache.setMaxEntries(2);
+        stats = cache.getStats();
+        CPPUNIT_ASSERT_EQUAL(4ULL, stats.evictions);
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, stats.entries);
+        CPPUNIT_ASSERT_EQUAL(2, num_copies.load());
+    }
+    CPPUNIT_ASSERT_EQUAL(0, num_copies.load());
+}
+
+void
+ChoiceCacheTest::testSelectiveInvalidation()
+{
+    num_copies = 0;
+    {
+        ChoiceCache cache(int_fns);
+        // the cache never dereferences the estimators either.
+        Estimator *x = (Estimator *) &strategy_a;
+        Estimator *y = (Estimator *) &strategy_b;
+        vector<Estimator *> x_only = {x};
+        vector<Estimator *> x_and_y = {std::min(x, y), std::max(x, y)};
+    
+        int one = 1, two = 2, three = 3;
+        vector<double> values = {1.0, 2.0, 3.0};
+        cache.insert(&one, A, cache.generation(), x_only, values);
+        cache.insert(&two, B, cache.generation(), x_and_y, values);
+        cache.insert(&three, B, cache.generation(), x_and_y);
+        
+        vector<size_t> stale = {1};
+        cache.invalidate(y, stale);
+        CPPUNIT_ASSERT(cache.lookup(&one) == A);
+        CPPUNIT_ASSERT(cache.lookup(&two) == NULL);
+        CPPUNIT_ASSERT(cache.lookup(&three) == NULL);
+        
+        // two keeps its other values; three had none, so it's gone.
+        vector<double> saved;
+        CPPUNIT_ASSERT(cache.lookupValues(&two, saved));
+        CPPUNIT_ASSERT_EQUAL((size_t) 3, saved.size());
+        CPPUNIT_ASSERT_EQUAL(1.0, saved[0]);
+        CPPUNIT_ASSERT(isnan(saved[1]));
+        CPPUNIT_ASSERT_EQUAL(3.0, saved[2]);
+        CPPUNIT_ASSERT(!cache.lookupValues(&three, saved));
+        CPPUNIT_ASSERT_EQUAL((size_t) 2, cache.getStats().entries);
+        CPPUNIT_ASSERT_EQUAL(2, num_copies.load());
+
+        // decisions in flight during the invalidation don't get cached.
+        unsigned long generation = cache.generation();
+        cache.invalidate(x, stale);
+        cache.insert(&three, A, generation, x_only);
+        CPPUNIT_ASSERT(cache.lookup(&one) == NULL);
+        CPPUNIT_ASSERT(cache.lookup(&three) == NULL);
+    }
+    CPPUNIT_ASSERT_EQUAL(0, num_copies.load());
+}
+
+void
+ChoiceCacheTest::testInvalidateWinners()
+{
+    ChoiceCache cache(int_fns);
+    int one = 1, two = 2;
+    vector<double> values = {1.0, 2.0};
+    cache.insert(&one, A, cache.generation(), {}, values);
+    cache.insert(&two, B, cache.generation());
+
+    cache.invalidateWinners([](instruments_strategy_t winner) { return winner == A; });
+    CPPUNIT_ASSERT(cache.lookup(&one) == NULL);
+    CPPUNIT_ASSERT(cache.lookup(&two) == B);
+
+    // values don't depend on which strategies are candidates.
+    vector<double> saved;
+    CPPUNIT_ASSERT(cache.lookupValues(&one, saved));
+    CPPUNIT_ASSERT_EQUAL(2.0, saved[1]);
+
+    cache.invalidateWinners([](instruments_strategy_t winner) { return true; });
+    CPPUNIT_ASSERT(cache.lookup(&two) == NULL);
+    CPPUNIT_ASSERT_EQUAL((size_t) 1, cache.getStats().entries);
+}
+
+void
+ChoiceCacheTest::testConcurrentReaders()
+{
+    ChoiceCache cache(int_fns, 16);
+    const int NUM_KEYS = 32;
+    atomic<bool> done(false);
+    atomic<int> bad_lookups(0);
+
+    // readers only ever see A, B, or nothing.
+    vector<thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.push_back(thread([&]() {
+                    while (!done) {
+                        for (int k = 0; k < NUM_KEYS; ++k) {
+                            instruments_strategy_t winner = cache.lookup(&k);
+                            if (winner != NULL && winner != A && winner != B) {
+                                ++bad_lookups;
+                            }
+                        }
+                    }
+                }));
+    }
+    for (int round = 0; round < 200; ++round) {
+        for (int k = 0; k < NUM_KEYS; ++k) {
+            cache.insert(&k, (round % 2) ? A : B, cache.generation());
+        }
+        if (round % 10 == 0) {
+            cache.clear();
+        }
+    }
+    done = true;
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    CPPUNIT_ASSERT_EQUAL(0, bad_lookups.load());
+}
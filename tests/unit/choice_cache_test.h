@@ -0,0 +1,31 @@
+#ifndef CHOICE_CACHE_TEST_H_INCL
+#define CHOICE_CACHE_TEST_H_INCL
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class ChoiceCacheTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE(ChoiceCacheTest);
+    CPPUNIT_TEST(testInsertAndLookup);
+    CPPUNIT_TEST(testHashedInsertAndLookup);
+    CPPUNIT_TEST(testKeyCopies);
+    CPPUNIT_TEST(testStaleInsertIgnored);
+    CPPUNIT_TEST(testEviction);
+    CPPUNIT_TEST(testSelectiveInvalidation);
+    CPPUNIT_TEST(testInvalidateWinners);
+    CPPUNIT_TEST(testConcurrentReaders);
+    CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testInsertAndLookup();
+    void testHashedInsertAndLookup();
+    void testKeyCopies();
+    void testStaleInsertIgnored();
+    void testEviction();
+    void testSelectiveInvalidation();
+    void testInvalidateWinners();
+    void testConcurrentReaders();
+};
+
+#endif
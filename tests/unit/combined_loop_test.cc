@@ -0,0 +1,316 @@
+#include <cppunit/Test.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "combined_loop_test.h"
+#include "combined_loop.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+using std::vector;
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CombinedLoopTest);
+
+static const double probs_a[] = { 0.25, 0.75 };
+static const double probs_b[] = { 0.5, 0.0, 0.5 };
+static const double probs_c[] = { 0.1, 0.2, 0.3, 0.4 };
+
+static void
+set_dimension(CombinedLoopArgs& args, size_t d, const double *probs, size_t count)
+{
+    args.probabilities[d] = probs;
+    args.counts[d] = count;
+}
+
+// the expected sum, tuple by tuple; the reference for linear_sum_expectation.
+static double
+product_sum(const CombinedLoopArgs& args, size_t arity)
+{
+    size_t indices[COMBINED_LOOP_MAX_ARITY] = { 0 };
+    for (size_t d = 0; d < arity; ++d) {
+        if (args.counts[d] == 0) {
+            return 0.0;
+        }
+    }
+    double total = 0.0;
+    while (true) {
+        double probability = 1.0;
+        double value = 0.0;
+        for (size_t d = 0; d < arity; ++d) {
+            probability *= args.probabilities[d][indices[d]];
+        }
+        for (size_t c = 0; c < args.num_operands; ++c) {
+            size_t offset = 0;
+            for (size_t d = 0; d < arity; ++d) {
+                offset += indices[d] * args.operands[c].strides[d];
+            }
+            value += args.operands[c].values[offset];
+        }
+        total += value * probability;
+
+        size_t d = arity;
+        for (; d > 0; --d) {
+            if (++indices[d - 1] < args.counts[d - 1]) {
+                break;
+            }
+            indices[d - 1] = 0;
+        }
+        if (d == 0) {
+            return total;
+        }
+    }
+}
+
+void
+CombinedLoopTest::testDisjointOperands()
+{
+    // first operand uses (a, b); second uses c.
+    CombinedLoopArgs args;
+    set_dimension(args, 0, probs_a, 2);
+    set_dimension(args, 1, probs_b, 3);
+    set_dimension(args, 2, probs_c, 4);
+
+    double first[2][3];
+    double second[4];
+    for (size_t i = 0; i < 2; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            first[i][j] = 10.0 * i + j;
+        }
+    }
+    for (size_t k = 0; k < 4; ++k) {
+        second[k] = 3.5 * k;
+    }
+
+    CombinedLoopOperand operands[2] = {};
+    operands[0].values = &first[0][0];
+    operands[0].strides[0] = 3;
+    operands[0].strides[1] = 1;
+    operands[1].values = second;
+    operands[1].strides[2] = 1;
+    args.operands = operands;
+    args.num_operands = 2;
+
+    double expected_min = 0.0, expected_sum = 0.0;
+    for (size_t i = 0; i < 2; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            for (size_t k = 0; k < 4; ++k) {
+                double prob = probs_a[i] * probs_b[j] * probs_c[k];
+                expected_min += prob * std::min(first[i][j], second[k]);
+                expected_sum += prob * (first[i][j] + second[k]);
+            }
+        }
+    }
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_min, (combined_loop<MinCombiner, 3>(args)), 0.0001);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_sum, (combined_loop<SumCombiner, 3>(args)), 0.0001);
+}
+
+void
+CombinedLoopTest::testSharedEstimator()
+{
+    // both operands use a; the second also uses c, stored as [c][a].
+    CombinedLoopArgs args;
+    set_dimension(args, 0, probs_a, 2);
+    set_dimension(args, 1, probs_c, 4);
+
+    double first[2] = { 1.0, 5.0 };
+    double second[4][2];
+    for (size_t k = 0; k < 4; ++k) {
+        for (size_t i = 0; i < 2; ++i) {
+            second[k][i] = 2.0 * k + i;
+        }
+    }
+
+    CombinedLoopOperand operands[2] = {};
+    operands[0].values = first;
+    operands[0].strides[0] = 1;
+    operands[1].values = &second[0][0];
+    operands[1].strides[0] = 1;
+    operands[1].strides[1] = 2;
+    args.operands = operands;
+    args.num_operands = 2;
+
+    double expected_min = 0.0;
+    for (size_t i = 0; i < 2; ++i) {
+        for (size_t k = 0; k < 4; ++k) {
+            expected_min += probs_a[i] * probs_c[k] * std::min(first[i], second[k][i]);
+        }
+    }
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_min, (combined_loop<MinCombiner, 2>(args)), 0.0001);
+}
+
+void
+CombinedLoopTest::testConstantOperand()
+{
+    CombinedLoopArgs args;
+    set_dimension(args, 0, probs_c, 4);
+
+    double varying[4] = { 1.0, 2.0, 3.0, 4.0 };
+    double constant = 2.5;
+
+    CombinedLoopOperand operands[2] = {};
+    operands[0].values = varying;
+    operands[0].strides[0] = 1;
+    operands[1].values = &constant;
+    args.operands = operands;
+    args.num_operands = 2;
+
+    // 0.1*1 + 0.2*2 + 0.3*2.5 + 0.4*2.5
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(2.25, (combined_loop<MinCombiner, 1>(args)), 0.0001);
+    // 2.5 + (0.1*1 + 0.2*2 + 0.3*3 + 0.4*4)
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(5.5, (combined_loop<SumCombiner, 1>(args)), 0.0001);
+}
+
+void
+CombinedLoopTest::testDispatch()
+{
+    CPPUNIT_ASSERT(get_combined_loop<MinCombiner>(0) == NULL);
+    CPPUNIT_ASSERT(get_combined_loop<MinCombiner>(COMBINED_LOOP_MAX_ARITY + 1) == NULL);
+    for (size_t arity = 1; arity <= COMBINED_LOOP_MAX_ARITY; ++arity) {
+        CPPUNIT_ASSERT(get_combined_loop<MinCombiner>(arity) != NULL);
+        CPPUNIT_ASSERT(get_combined_loop<SumCombiner>(arity) != NULL);
+    }
+
+    // one 8-way loop over two-sample estimators, each operand using
+    //  every other dimension.
+    const double probs[] = { 0.5, 0.5 };
+    CombinedLoopArgs args;
+    for (size_t d = 0; d < 8; ++d) {
+        set_dimension(args, d, probs, 2);
+    }
+    vector<double> even(16, 1.0), odd(16, 2.0);
+    CombinedLoopOperand operands[2] = {};
+    operands[0].values = even.data();
+    operands[1].values = odd.data();
+    for (size_t d = 0, stride = 8; d < 8; d += 2, stride /= 2) {
+        operands[0].strides[d] = stride;
+        operands[1].strides[d + 1] = stride;
+    }
+    args.operands = operands;
+    args.num_operands = 2;
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(3.0, get_combined_loop<SumCombiner>(8)(args), 0.0001);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, get_combined_loop<MinCombiner>(8)(args), 0.0001);
+}
+
+void
+CombinedLoopTest::testKernelLevelsAgree()
+{
+    // odd lengths, so the kernels' scalar tails get exercised too.
+    const size_t MAX_COUNT = 19;
+    double probs[MAX_COUNT], a[MAX_COUNT], b[MAX_COUNT];
+    for (size_t i = 0; i < MAX_COUNT; ++i) {
+        probs[i] = 1.0 / (i + 2);
+        a[i] = 3.0 * ((i * 7) % 11);
+        b[i] = 2.0 * ((i * 5) % 13) + 1.0;
+    }
+
+    CombinerKernelLevel best = get_best_combiner_kernel_level();
+    for (int level = SCALAR_COMBINER_KERNELS; level <= best; ++level) {
+        set_combiner_kernel_level((CombinerKernelLevel) level);
+        CPPUNIT_ASSERT_EQUAL(level, (int) get_combiner_kernel_level());
+        for (size_t count = 0; count <= MAX_COUNT; ++count) {
+            for (size_t a_stride = 0; a_stride <= 1; ++a_stride) {
+                for (size_t b_stride = 0; b_stride <= 1; ++b_stride) {
+                    double expected_min = 0.0;
+                    for (size_t i = 0; i < count; ++i) {
+                        double x = a[i * a_stride], y = b[i * b_stride];
+                        expected_min += probs[i] * std::min(x, y);
+                    }
+                    CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_min,
+                                                 weighted_min(probs, a, a_stride, b, b_stride, count),
+                                                 0.000001);
+                }
+            }
+        }
+    }
+    set_combiner_kernel_level(best);
+}
+
+// k operands over disjoint groups of a 6-way loop (the last dimension
+//  unused), with tied values and zero probabilities in the mix.
+template <size_t NumOperands>
+static void
+check_shortcuts(unsigned int seed)
+{
+    const size_t ARITY = 6;
+    const size_t counts[ARITY] = { 3, 5, 1, 4, 7, 2 };
+    const size_t owners[ARITY - 1] = { 0, 1 % NumOperands, 2 % NumOperands,
+                                       0, 1 % NumOperands };
+    srand(seed);
+
+    vector<vector<double> > probs(ARITY);
+    CombinedLoopArgs args;
+    for (size_t d = 0; d < ARITY; ++d) {
+        for (size_t i = 0; i < counts[d]; ++i) {
+            probs[d].push_back((rand() % 5) / 10.0);
+        }
+        set_dimension(args, d, probs[d].data(), counts[d]);
+    }
+
+    vector<vector<double> > tables(NumOperands);
+    CombinedLoopOperand operands[NumOperands] = {};
+    for (size_t c = 0; c < NumOperands; ++c) {
+        size_t size = 1;
+        for (size_t d = ARITY - 1; d > 0; --d) {
+            if (owners[d - 1] == c) {
+                operands[c].strides[d - 1] = size;
+                size *= counts[d - 1];
+            }
+        }
+        for (size_t i = 0; i < size; ++i) {
+            tables[c].push_back(rand() % 8);
+        }
+        operands[c].values = tables[c].data();
+    }
+    args.operands = operands;
+    args.num_operands = NumOperands;
+
+    double product_min = combined_product_loop<MinCombiner, ARITY>(args);
+    double expected_sum = product_sum(args, ARITY);
+    double sorted_min = 0.0;
+    CPPUNIT_ASSERT(sorted_min_expectation(args, ARITY, &sorted_min));
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(product_min, sorted_min, 1e-9 * (1.0 + product_min));
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_sum, (combined_loop<SumCombiner, ARITY>(args)),
+                                 1e-9 * (1.0 + expected_sum));
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(product_min, (combined_loop<MinCombiner, ARITY>(args)),
+                                 1e-9 * (1.0 + product_min));
+}
+
+void
+CombinedLoopTest::testShortcutsMatchProduct()
+{
+    for (unsigned int seed = 1; seed <= 20; ++seed) {
+        check_shortcuts<1>(seed);
+        check_shortcuts<2>(seed);
+        check_shortcuts<3>(seed);
+    }
+}
+
+void
+CombinedLoopTest::testSharedMinWalksProduct()
+{
+    // as in testSharedEstimator: both operands use a.
+    CombinedLoopArgs args;
+    set_dimension(args, 0, probs_a, 2);
+    set_dimension(args, 1, probs_c, 4);
+
+    double first[2] = { 1.0, 5.0 };
+    double second[8] = { 0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0 };
+    CombinedLoopOperand operands[2] = {};
+    operands[0].values = first;
+    operands[0].strides[0] = 1;
+    operands[1].values = second;
+    operands[1].strides[0] = 1;
+    operands[1].strides[1] = 2;
+    args.operands = operands;
+    args.num_operands = 2;
+
+    double unused = -1.0;
+    CPPUNIT_ASSERT(!sorted_min_expectation(args, 2, &unused));
+    CPPUNIT_ASSERT_EQUAL(-1.0, unused);
+
+    // the sum doesn't care that the estimator is shared.
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(product_sum(args, 2), (combined_loop<SumCombiner, 2>(args)),
+                                 0.000001);
+}
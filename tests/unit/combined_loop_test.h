@@ -0,0 +1,29 @@
+#ifndef COMBINED_LOOP_TEST_H_INCL_8DN3YQXW0A
+#define COMBINED_LOOP_TEST_H_INCL_8DN3YQXW0A
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class CombinedLoopTest : public CppUnit::TestFixture {
+
+    CPPUNIT_TEST_SUITE(CombinedLoopTest);
+    CPPUNIT_TEST(testDisjointOperands);
+    CPPUNIT_TEST(testSharedEstimator);
+    CPPUNIT_TEST(testConstantOperand);
+    CPPUNIT_TEST(testDispatch);
+    CPPUNIT_TEST(testKernelLevelsAgree);
+    CPPUNIT_TEST(testShortcutsMatchProduct);
+    CPPUNIT_TEST(testSharedMinWalksProduct);
+    CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testDisjointOperands();
+    void testSharedEstimator();
+    void testConstantOperand();
+    void testDispatch();
+    void testKernelLevelsAgree();
+    void testShortcutsMatchProduct();
+    void testSharedMinWalksProduct();
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "combiner_kernels.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <vector>
+using std::vector;
+
+static const char *level_names[] = { "scalar", "sse2", "avx" };
+
+static double elapsed_seconds(const struct timeval& begin, const struct timeval& end)
+{
+    return (end.tv_sec - begin.tv_sec) + (end.tv_usec - begin.tv_usec) / 1000000.0;
+}
+
+// one redundant pass over two children's memoized tables, as the
+//  combined loop does it: an outer row per sample of the first child,
+//  each reduced against the whole of the second child's row.
+static double redundant_pass(const vector<double>& probs, const vector<double>& a,
+                             const vector<double>& b)
+{
+    size_t n = probs.size();
+    double total = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        total += probs[i] * weighted_min(&probs[0], &a[i], 0, &b[0], 1, n);
+    }
+    return total;
+}
+
+int main()
+{
+    // error-sample counts like the ones the acceptance and performance tests see.
+    const size_t sample_counts[] = { 5, 10, 20, 50, 100, 200, 500 };
+    const size_t num_counts = sizeof(sample_counts) / sizeof(sample_counts[0]);
+    const size_t target_tuples = 20000000;
+
+    CombinerKernelLevel best = get_best_combiner_kernel_level();
+    printf("best kernels: %s\n", level_names[best]);
+    printf("samples  ");
+    for (int level = SCALAR_COMBINER_KERNELS; level <= best; ++level) {
+        printf(" %12s", level_names[level]);
+    }
+    printf("   (nanoseconds per tuple)\n");
+
+    srand(42);
+    for (size_t c = 0; c < num_counts; ++c) {
+        size_t n = sample_counts[c];
+        vector<double> probs(n), a(n), b(n);
+        for (size_t i = 0; i < n; ++i) {
+            probs[i] = 1.0 / n;
+            a[i] = 1.0 + rand() / (double) RAND_MAX;
+            b[i] = 1.0 + rand() / (double) RAND_MAX;
+        }
+        size_t iterations = target_tuples / (n * n) + 1;
+
+        printf("%7zu  ", n);
+        double check = 0.0;
+        for (int level = SCALAR_COMBINER_KERNELS; level <= best; ++level) {
+            set_combiner_kernel_level((CombinerKernelLevel) level);
+            struct timeval begin, end;
+            gettimeofday(&begin, NULL);
+            for (size_t it = 0; it < iterations; ++it) {
+                check += redundant_pass(probs, a, b);
+            }
+            gettimeofday(&end, NULL);
+            double ns = elapsed_seconds(begin, end) * 1e9 / (iterations * n * n);
+            printf(" %12.3f", ns);
+        }
+        // keep the results live, so the loops aren't optimized away.
+        printf("   [%g]\n", check);
+    }
+    return 0;
+}
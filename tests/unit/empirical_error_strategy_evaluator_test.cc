@@ -411,3 +411,182 @@ EmpiricalErrorStrategyEvaluatorTest::assertValueBetweenErrors(const char *name,
              name, value, low_value, high_value);
     CPPUNIT_ASSERT_MESSAGE(msg, value >= low_value && value <= high_value);
 }
+
+void
+EmpiricalErrorStrategyEvaluatorTest::testAlternatingChooserArgs()
+{
+    const size_t NUM_STRATEGIES = 3;
+    Estimator *estimators[NUM_INTNW_ESTIMATORS];
+    Strategy *strategies[NUM_STRATEGIES];
+    create_estimators_and_strategies(estimators, NUM_INTNW_ESTIMATORS,
+                                     strategies, NUM_STRATEGIES);
+
+    // the value of each strategy (the redundant one last) with chooser_arg.
+    auto evaluate_strategies = [&](StrategyEvaluator *evaluator, void *chooser_arg, double *values) {
+        for (size_t i = 0; i < NUM_STRATEGIES; ++i) {
+            Strategy *strategy = strategies[i];
+            values[i] = evaluator->expectedValue(strategy, strategy->time_fn,
+                                                 strategy->strategy_arg, chooser_arg);
+        }
+    };
+
+    // one evaluator alternates between chooser_args; the other
+    //  only ever sees one, so it never reuses anything.
+    StrategyEvaluator *evaluator = 
+        StrategyEvaluator::create("", (instruments_strategy_t *) strategies, NUM_STRATEGIES,
+                                  EMPIRICAL_ERROR_ALL_SAMPLES_INTNW);
+    StrategyEvaluator *single_arg_evaluator = 
+        StrategyEvaluator::create("", (instruments_strategy_t *) strategies, NUM_STRATEGIES,
+                                  EMPIRICAL_ERROR_ALL_SAMPLES_INTNW);
+
+    srandom(42);
+    for (int i = 0; i < NUM_INTNW_ESTIMATORS; ++i) {
+        for (int j = 0; j < 10; ++j) {
+            estimators[i]->addObservation(random() % 100);
+        }
+    }
+
+    // the chooser_arg is the number of estimators each strategy adds up.
+    void *chooser_args[] = { (void *) 1, (void *) 2 };
+    double first_values[2][NUM_STRATEGIES];
+    for (int k = 0; k < 2; ++k) {
+        evaluate_strategies(evaluator, chooser_args[k], first_values[k]);
+    }
+    CPPUNIT_ASSERT(first_values[0][1] != first_values[1][1]);
+
+    for (int round = 0; round < 3; ++round) {
+        for (int k = 0; k < 2; ++k) {
+            double values[NUM_STRATEGIES];
+            evaluate_strategies(evaluator, chooser_args[k], values);
+            for (size_t i = 0; i < NUM_STRATEGIES; ++i) {
+                CPPUNIT_ASSERT_EQUAL(first_values[k][i], values[i]);
+            }
+        }
+    }
+
+    // a new observation invalidates every chooser_arg's memoized values.
+    estimators[0]->addObservation(1000.0);
+    double values[NUM_STRATEGIES], expected_values[NUM_STRATEGIES];
+    evaluate_strategies(evaluator, chooser_args[1], values);
+    evaluate_strategies(evaluator, chooser_args[0], values);
+    evaluate_strategies(single_arg_evaluator, chooser_args[0], expected_values);
+    CPPUNIT_ASSERT(values[0] != first_values[0][0]);
+    for (size_t i = 0; i < NUM_STRATEGIES; ++i) {
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_values[i], values[i], 0.000001);
+    }
+
+    delete single_arg_evaluator;
+    delete evaluator;
+    for (int i = NUM_STRATEGIES - 1; i >= 0; --i) {
+        delete strategies[i];
+    }
+    for (int i = 0; i < NUM_INTNW_ESTIMATORS; ++i) {
+        delete estimators[i];
+    }
+}
+
+// like get_time_all_estimators, but the chooser_arg points to the count.
+static double get_time_buffered_estimators(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    Estimator **estimators = (Estimator**) strategy_arg;
+    int num_estimators = *(int *) chooser_arg;
+    double sum = 0.0;
+    for (int i = 0; i < num_estimators; ++i) {
+        sum += get_adjusted_estimator_value(ctx, estimators[i]);
+    }
+    return sum;
+}
+
+static int int_less(void *left, void *right)
+{
+    return *(int *) left < *(int *) right;
+}
+
+static void *copy_int(void *arg)
+{
+    return new int(*(int *) arg);
+}
+
+static void delete_int(void *arg)
+{
+    delete (int *) arg;
+}
+
+void
+EmpiricalErrorStrategyEvaluatorTest::testReusedChooserArgBuffer()
+{
+    const size_t NUM_STRATEGIES = 3;
+    Estimator *estimators[NUM_INTNW_ESTIMATORS];
+    Strategy *strategies[NUM_STRATEGIES];
+    for (int i = 0; i < NUM_INTNW_ESTIMATORS; ++i) {
+        ostringstream name;
+        name << "estimator-" << i;
+        estimators[i] = Estimator::create(RUNNING_MEAN, name.str());
+    }
+    // the defaults, for estimator discovery.
+    int num_wifi_estimators = CELLULAR_ESTIMATORS_INDEX;
+    int num_cellular_estimators = 2;
+    strategies[0] = new Strategy(get_time_buffered_estimators,
+                                 get_energy_cost, get_data_cost, estimators, &num_wifi_estimators);
+    strategies[1] = new Strategy(get_time_buffered_estimators,
+                                 get_energy_cost, get_data_cost,
+                                 estimators + CELLULAR_ESTIMATORS_INDEX, &num_cellular_estimators);
+    strategies[2] = new Strategy((instruments_strategy_t *) strategies, 2, &num_wifi_estimators);
+
+    // the value of each strategy (the redundant one last) with chooser_arg.
+    auto evaluate_strategies = [&](StrategyEvaluator *evaluator, void *chooser_arg, double *values) {
+        for (size_t i = 0; i < NUM_STRATEGIES; ++i) {
+            Strategy *strategy = strategies[i];
+            values[i] = evaluator->expectedValue(strategy, strategy->time_fn,
+                                                 strategy->strategy_arg, chooser_arg);
+        }
+    };
+
+    struct instruments_chooser_arg_fns_v2 fns = {
+        int_less, copy_int, delete_int, default_chooser_arg_fns.chooser_arg_hash
+    };
+    StrategyEvaluator *evaluator = 
+        StrategyEvaluator::create("", (instruments_strategy_t *) strategies, NUM_STRATEGIES,
+                                  EMPIRICAL_ERROR_ALL_SAMPLES_INTNW, fns);
+    // these only ever see one chooser_arg each, so they never reuse anything.
+    StrategyEvaluator *single_arg_evaluators[2];
+    for (int k = 0; k < 2; ++k) {
+        single_arg_evaluators[k] = 
+            StrategyEvaluator::create("", (instruments_strategy_t *) strategies, NUM_STRATEGIES,
+                                      EMPIRICAL_ERROR_ALL_SAMPLES_INTNW, fns);
+    }
+
+    srandom(42);
+    for (int i = 0; i < NUM_INTNW_ESTIMATORS; ++i) {
+        for (int j = 0; j < 10; ++j) {
+            estimators[i]->addObservation(random() % 100);
+        }
+    }
+
+    // the caller fills in the same buffer for every decision, so only
+    //  its contents tell the chooser_args apart.
+    int buffer;
+    for (int round = 0; round < 2; ++round) {
+        for (int k = 0; k < 2; ++k) {
+            buffer = k + 1;
+            double values[NUM_STRATEGIES], expected_values[NUM_STRATEGIES];
+            evaluate_strategies(evaluator, &buffer, values);
+
+            int single_arg = k + 1;
+            evaluate_strategies(single_arg_evaluators[k], &single_arg, expected_values);
+            for (size_t i = 0; i < NUM_STRATEGIES; ++i) {
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_values[i], values[i], 0.000001);
+            }
+        }
+    }
+
+    delete single_arg_evaluators[1];
+    delete single_arg_evaluators[0];
+    delete evaluator;
+    for (int i = NUM_STRATEGIES - 1; i >= 0; --i) {
+        delete strategies[i];
+    }
+    for (int i = 0; i < NUM_INTNW_ESTIMATORS; ++i) {
+        delete estimators[i];
+    }
+}
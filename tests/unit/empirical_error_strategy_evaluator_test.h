@@ -16,6 +16,8 @@ class EmpiricalErrorStrategyEvaluatorTest : public CppUnit::TestFixture {
     CPPUNIT_TEST(testOnlyIterateOverRelevantEstimators);
     CPPUNIT_TEST(testSaveRestore);
     CPPUNIT_TEST(testEstimatorConditions);
+    CPPUNIT_TEST(testAlternatingChooserArgs);
+    CPPUNIT_TEST(testReusedChooserArgBuffer);
     CPPUNIT_TEST_SUITE_END();
 
   public:
@@ -25,6 +27,8 @@ class EmpiricalErrorStrategyEvaluatorTest : public CppUnit::TestFixture {
     void testOnlyIterateOverRelevantEstimators();
     void testSaveRestore();
     void testEstimatorConditions();
+    void testAlternatingChooserArgs();
+    void testReusedChooserArgBuffer();
 
   private:
     void assertRestoredEvaluationMatches(Strategy **strategies, double *expected_values,
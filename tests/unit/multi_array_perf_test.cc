@@ -111,6 +111,50 @@ int main()
 
     fprintf(stderr, "MultiDimensionArray took %f seconds; sum=%f\n", seconds, sum);
 
+    // ===== MultiDimensionArray, strided offsets ===== //
+
+    gettimeofday(&begin, NULL);
+    sum = 0.0;
+    const size_t row_stride = array.stride(0);
+    for (size_t z = 0; z < iterations; ++z) {
+        for (size_t i = 0; i < rowlen; ++i) {
+            size_t row_offset = i * row_stride;
+            for (size_t j = 0; j < rowlen; ++j) {
+                sum += array.atOffset(row_offset + j);
+            }
+        }
+    }
+    gettimeofday(&end, NULL);
+    diff.tv_sec = end.tv_sec - begin.tv_sec;
+    if (end.tv_usec < begin.tv_usec) {
+        --diff.tv_sec;
+        end.tv_usec += 1000000;
+    }
+    diff.tv_usec = end.tv_usec - begin.tv_usec;
+    seconds = diff.tv_sec + (diff.tv_usec / 1000000.0);
+
+    fprintf(stderr, "MultiDimensionArray (offsets) took %f seconds; sum=%f\n", seconds, sum);
+
+    // ===== MultiDimensionArray::Iterator ===== //
+
+    gettimeofday(&begin, NULL);
+    sum = 0.0;
+    for (size_t z = 0; z < iterations; ++z) {
+        for (MultiDimensionArray<double>::Iterator it(array); !it.isDone(); it.advance()) {
+            sum += it.value();
+        }
+    }
+    gettimeofday(&end, NULL);
+    diff.tv_sec = end.tv_sec - begin.tv_sec;
+    if (end.tv_usec < begin.tv_usec) {
+        --diff.tv_sec;
+        end.tv_usec += 1000000;
+    }
+    diff.tv_usec = end.tv_usec - begin.tv_usec;
+    seconds = diff.tv_sec + (diff.tv_usec / 1000000.0);
+
+    fprintf(stderr, "MultiDimensionArray (iterator) took %f seconds; sum=%f\n", seconds, sum);
+
     
     // ===== boost::multi_array ===== //
 
@@ -55,3 +55,86 @@ void MultiDimensionArrayTest::testValueSetting()
     array->at(indices) = 42.0;
     CPPUNIT_ASSERT_DOUBLES_EQUAL(42.0, array->at(indices), 0.001);
 }
+
+void MultiDimensionArrayTest::testRowMajorOffsets()
+{
+    CPPUNIT_ASSERT_EQUAL((size_t) 27, array->size());
+    CPPUNIT_ASSERT_EQUAL((size_t) 9, array->stride(0));
+    CPPUNIT_ASSERT_EQUAL((size_t) 3, array->stride(1));
+    CPPUNIT_ASSERT_EQUAL((size_t) 1, array->stride(2));
+
+    vector<size_t> indices;
+    indices.push_back(1);
+    indices.push_back(0);
+    indices.push_back(2);
+    CPPUNIT_ASSERT_EQUAL((size_t) 11, array->offset(indices));
+
+    array->at(indices) = 42.0;
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(42.0, array->atOffset(11), 0.001);
+}
+
+void MultiDimensionArrayTest::testIterator()
+{
+    size_t count = 0;
+    for (MultiDimensionArray<double>::Iterator it(*array); !it.isDone(); it.advance()) {
+        CPPUNIT_ASSERT_EQUAL(count, it.offset());
+        CPPUNIT_ASSERT_EQUAL(array->offset(it.indices()), it.offset());
+        it.value() = count;
+        ++count;
+    }
+    CPPUNIT_ASSERT_EQUAL(array->size(), count);
+
+    MultiDimensionArray<double>::Iterator it(*array);
+    it.setIndex(1, 2);
+    it.setIndex(0, 1);
+    CPPUNIT_ASSERT_EQUAL((size_t) 15, it.offset());
+    it.setIndex(1, 0);
+    CPPUNIT_ASSERT_EQUAL((size_t) 9, it.offset());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(9.0, it.value(), 0.001);
+
+    // setting an index after the end starts over from the first element.
+    while (!it.isDone()) {
+        it.advance();
+    }
+    it.setIndex(1, 2);
+    CPPUNIT_ASSERT(!it.isDone());
+    CPPUNIT_ASSERT_EQUAL((size_t) 6, it.offset());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(6.0, it.value(), 0.001);
+}
+
+void MultiDimensionArrayTest::testReshape()
+{
+    vector<size_t> indices;
+    indices.push_back(1);
+    indices.push_back(0);
+    indices.push_back(2);
+    array->at(indices) = 42.0;
+
+    vector<size_t> new_dimensions;
+    new_dimensions.push_back(9);
+    new_dimensions.push_back(3);
+    array->reshape(new_dimensions);
+
+    // same element, same row-major position.
+    indices.clear();
+    indices.push_back(3);
+    indices.push_back(2);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(42.0, array->at(indices), 0.001);
+    CPPUNIT_ASSERT_EQUAL((size_t) 27, array->size());
+}
+
+void MultiDimensionArrayTest::testReset()
+{
+    vector<size_t> indices(3, 1);
+    array->at(indices) = 42.0;
+    array->reset(-2.0);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(-2.0, array->at(indices), 0.001);
+
+    vector<size_t> smaller(2, 2);
+    array->reset(smaller, 5.0);
+    CPPUNIT_ASSERT_EQUAL((size_t) 4, array->size());
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, array->stride(0));
+    for (MultiDimensionArray<double>::Iterator it(*array); !it.isDone(); it.advance()) {
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(5.0, it.value(), 0.001);
+    }
+}
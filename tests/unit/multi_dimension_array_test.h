@@ -13,6 +13,10 @@ class MultiDimensionArrayTest : public CppUnit::TestFixture {
     CPPUNIT_TEST_SUITE(MultiDimensionArrayTest);
     CPPUNIT_TEST(testInitialize);
     CPPUNIT_TEST(testValueSetting);
+    CPPUNIT_TEST(testRowMajorOffsets);
+    CPPUNIT_TEST(testIterator);
+    CPPUNIT_TEST(testReshape);
+    CPPUNIT_TEST(testReset);
     CPPUNIT_TEST_SUITE_END();
 
   public:
@@ -21,6 +25,10 @@ class MultiDimensionArrayTest : public CppUnit::TestFixture {
 
     void testInitialize();
     void testValueSetting();
+    void testRowMajorOffsets();
+    void testIterator();
+    void testReshape();
+    void testReset();
   private:
     MultiDimensionArray<double> *array;
     std::vector<size_t> dimensions;
@@ -9,8 +9,9 @@ project "InstrumentsTests"
   files { 
      "run_all_tests.cc",
      
+     "choice_cache_test.cc",
+     "combined_loop_test.cc",
      "empirical_error_strategy_evaluator_test.cc",
-     "r_test.cc",
      "stats_distribution_test.cc",
      "goal_adaptive_resource_weight_test.cc",
      "multi_dimension_array_test.cc",
@@ -21,6 +22,7 @@ project "InstrumentsTests"
   }
   local support_files = {
      "abstract_joint_distribution.cc",
+     "choice_cache.cc",
      "continuous_distribution.cc",
      "evaluators/bayesian_strategy_evaluator.cc",
      "debug.cc",
@@ -36,11 +38,14 @@ project "InstrumentsTests"
      "external_estimator.cc",
      "generic_joint_distribution.cc",
      "goal_adaptive_resource_weight.cc",
+     "histogram_breaks.cc",
      "instruments.cc",
+     "joint_distributions/combined_loop.cc",
+     "joint_distributions/combiner_kernels.cc",
      "joint_distributions/intnw_joint_distribution.cc",
+     "joint_distributions/monte_carlo_joint_distribution.cc",
      "joint_distributions/remote_exec_joint_distribution.cc",
      "joint_distributions/optimized_generic_joint_distribution.cc",
-     "r_singleton.cc",
      "resource_weights.cc",
      "running_mean_estimator.cc",
      "strategy.cc",
@@ -48,6 +53,7 @@ project "InstrumentsTests"
      "stats_distribution.cc",
      "stats_distribution_all_samples.cc",
      "stats_distribution_binned.cc",
+     "stats_distribution_t_digest.cc",
      "stopwatch.cc",
      "thread_pool.cc",
      "timeops.cc",
@@ -64,8 +70,13 @@ project "InstrumentsTests"
   flags { "Symbols", "FatalWarnings" }
   links { "pthread", "mocktime", "cppunit", "flipflop" }
 
-  buildoptions { R_buildoptions(), "-Wall", "-std=gnu++0x" }
-  linkoptions { R_linkoptions() }
+  buildoptions { "-Wall", "-std=gnu++0x" }
+
+  if _OPTIONS["with-r"] then
+    files { "r_test.cc", "../../src/r_singleton.cc" }
+    buildoptions { R_buildoptions() }
+    linkoptions { R_linkoptions() }
+  end
   
   targetname "run_unit_tests"
   
@@ -107,3 +118,40 @@ project "MultiArrayPerfTestDeeper"
     flags { "Optimize" }
     defines { "NDEBUG" }
 
+
+project "CombinerKernelPerfTest"
+  kind "ConsoleApp"
+  language "C++"
+  files { "combiner_kernel_perf_test.cc", "../../src/joint_distributions/combiner_kernels.cc" }
+  includedirs { "../../src/joint_distributions" }
+  buildoptions { "-std=gnu++0x" }
+
+  targetname "combiner_kernel_perf_test"
+
+  configuration "Debug"
+    targetsuffix "_debug"
+
+  configuration "Release"
+    flags { "Optimize" }
+    defines { "NDEBUG" }
+
+
+project "StatsDistributionIteratorPerfTest"
+  kind "ConsoleApp"
+  language "C++"
+  files { "stats_distribution_iterator_perf_test.cc" }
+  files(_.map({"debug.cc", "error_weight_params.cc", "stats_distribution.cc",
+               "stats_distribution_all_samples.cc", "timeops.cc"},
+              function(f) return "../../src/"..f; end))
+  includedirs { "../../src" }
+  buildoptions { "-std=gnu++0x" }
+  links { "pthread" }
+
+  targetname "stats_distribution_iterator_perf_test"
+
+  configuration "Debug"
+    targetsuffix "_debug"
+
+  configuration "Release"
+    flags { "Optimize" }
+    defines { "NDEBUG" }
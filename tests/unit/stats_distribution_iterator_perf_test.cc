@@ -0,0 +1,53 @@
+#include "stats_distribution_all_samples.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+static double elapsed_seconds(const struct timeval& begin, const struct timeval& end)
+{
+    return (end.tv_sec - begin.tv_sec) + (end.tv_usec - begin.tv_usec) / 1000000.0;
+}
+
+// creates and finishes an iterator, reading one probability,
+//  as the joint distributions do on every cache rebuild.
+static double time_iterators(StatsDistributionAllSamples& dist, size_t iterations, double& check)
+{
+    struct timeval begin, end;
+    gettimeofday(&begin, NULL);
+    for (size_t i = 0; i < iterations; ++i) {
+        StatsDistribution::Iterator *it = dist.getIterator();
+        check += it->probability(it->totalCount() - 1);
+        dist.finishIterator(it);
+    }
+    gettimeofday(&end, NULL);
+    return elapsed_seconds(begin, end) * 1e9 / iterations;
+}
+
+int main()
+{
+    const size_t sample_counts[] = { 10, 20, 100, 1000, 10000, 100000 };
+    const size_t num_counts = sizeof(sample_counts) / sizeof(sample_counts[0]);
+    const size_t target_samples = 100000000;
+
+    printf("samples   unweighted     weighted   (nanoseconds per iterator)\n");
+    srand(42);
+    double check = 0.0;
+    for (size_t c = 0; c < num_counts; ++c) {
+        size_t n = sample_counts[c];
+        // the weighted distribution keeps at most MAX_SAMPLES of them.
+        StatsDistributionAllSamples unweighted(false), weighted(true);
+        for (size_t i = 0; i < n; ++i) {
+            double value = rand() / (double) RAND_MAX;
+            unweighted.addValue(value);
+            weighted.addValue(value);
+        }
+        size_t iterations = target_samples / n + 1000;
+        double unweighted_ns = time_iterators(unweighted, iterations, check);
+        double weighted_ns = time_iterators(weighted, iterations, check);
+        printf("%7zu %12.1f %12.1f\n", n, unweighted_ns, weighted_ns);
+    }
+    // keep the results live, so the loops aren't optimized away.
+    printf("[%g]\n", check);
+    return 0;
+}
@@ -6,9 +6,21 @@
 #include "stats_distribution.h"
 #include "stats_distribution_all_samples.h"
 #include "stats_distribution_binned.h"
+#include "stats_distribution_t_digest.h"
+#include "histogram_breaks.h"
+#include "error_weight_params.h"
 
+#include <math.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
 #include <vector>
-using std::vector;
+using std::vector; using std::string;
+using std::ifstream; using std::ofstream;
 
 CPPUNIT_TEST_SUITE_REGISTRATION(StatsDistributionTest);
 
@@ -147,3 +159,405 @@ StatsDistributionTest::testBinnedWeightedSamples()
     CPPUNIT_ASSERT(all_samples_it->isDone());
     CPPUNIT_ASSERT(binned_it->isDone());
 }
+
+// two well-separated clumps, with a sample at each end of the range.
+static vector<double> clumped_samples(size_t count)
+{
+    vector<double> samples;
+    for (size_t i = 0; i < count; ++i) {
+        double offset = (i % 10) * 0.01;
+        samples.push_back((i % 2 == 0) ? 1.0 + offset : 9.0 + offset);
+    }
+    samples.push_back(0.0);
+    samples.push_back(10.0);
+    return samples;
+}
+
+void
+StatsDistributionTest::testHistogramBreaks()
+{
+    vector<double> samples = clumped_samples(200);
+    std::sort(samples.begin(), samples.end());
+
+    HistogramType types[] = { REGULAR_HISTOGRAM, IRREGULAR_HISTOGRAM, COMBINED_HISTOGRAM };
+    for (HistogramType type : types) {
+        vector<double> breaks = choose_histogram_breaks(samples, type);
+        CPPUNIT_ASSERT(breaks.size() > 2);
+        CPPUNIT_ASSERT_EQUAL(samples.front(), breaks.front());
+        CPPUNIT_ASSERT_EQUAL(samples.back(), breaks.back());
+        for (size_t i = 1; i < breaks.size(); ++i) {
+            CPPUNIT_ASSERT(breaks[i] > breaks[i-1]);
+        }
+    }
+
+    // the clumps want narrow bins, and the space between them one wide one.
+    vector<double> irregular = choose_histogram_breaks(samples, IRREGULAR_HISTOGRAM);
+    vector<double> regular = choose_histogram_breaks(samples, REGULAR_HISTOGRAM);
+    CPPUNIT_ASSERT(irregular.size() < regular.size());
+
+    // evenly-spread samples don't need many bins.
+    vector<double> even;
+    for (int i = 0; i <= 100; ++i) {
+        even.push_back(i / 100.0);
+    }
+    CPPUNIT_ASSERT(choose_histogram_breaks(even).size() <= 3);
+}
+
+void
+StatsDistributionTest::testAutomaticBins()
+{
+    vector<double> samples = clumped_samples(98);
+    StatsDistribution *dist = new StatsDistributionBinned;
+    for (double sample : samples) {
+        dist->addValue(sample);
+        sanityCheckPDF(dist);
+    }
+
+    // 100 samples; the bins were picked at 50 and again at 100.
+    StatsDistribution::Iterator *it = dist->getIterator();
+    int num_bins = it->totalCount() - 2;
+    CPPUNIT_ASSERT(num_bins > 1 && num_bins < 50);
+
+    // every sample fits in the bins, including the ones on the ends.
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, it->probability(0), 0.0001);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, it->probability(num_bins + 1), 0.0001);
+
+    double mean = 0.0, expected_mean = 0.0;
+    for (it->reset(); !it->isDone(); it->advance()) {
+        mean += it->value() * it->probability();
+    }
+    for (double sample : samples) {
+        expected_mean += sample / samples.size();
+    }
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(expected_mean, mean, 0.5);
+    dist->finishIterator(it);
+    delete dist;
+}
+
+// a deterministic shuffle of 0 .. count-1, scaled to [0, 1).
+static vector<double> shuffled_unit_samples(size_t count)
+{
+    vector<double> samples;
+    for (size_t i = 0; i < count; ++i) {
+        samples.push_back(((i * 7919) % count) / double(count));
+    }
+    return samples;
+}
+
+void
+StatsDistributionTest::testSketchSmallSamplesAreExact()
+{
+    StatsDistributionTDigest sketch(10);
+    vector<double> values = {3.0, 1.0, 4.0, 1.0, 5.0, 9.0, 2.0, 6.0};
+    for (double value : values) {
+        sketch.addValue(value);
+        sanityCheckPDF(&sketch);
+    }
+
+    std::sort(values.begin(), values.end());
+    StatsDistribution::Iterator *it = sketch.getIterator();
+    CPPUNIT_ASSERT_EQUAL((int) values.size(), it->totalCount());
+    for (size_t i = 0; !it->isDone(); it->advance(), ++i) {
+        CPPUNIT_ASSERT_EQUAL(values[i], it->value());
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0 / values.size(), it->probability(), 1e-12);
+    }
+    sketch.finishIterator(it);
+}
+
+void
+StatsDistributionTest::testSketchIsBounded()
+{
+    StatsDistributionTDigest sketch(40);
+    vector<double> samples = shuffled_unit_samples(10000);
+    for (double sample : samples) {
+        sketch.addValue(sample);
+    }
+    CPPUNIT_ASSERT(sketch.totalCount() <= 40);
+    CPPUNIT_ASSERT(sketch.totalCount() > 20);
+    sanityCheckPDF(&sketch);
+
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5, sketch.quantile(0.5), 0.02);
+    // the tails are kept sharper than the middle.
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.01, sketch.quantile(0.01), 0.005);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.99, sketch.quantile(0.99), 0.005);
+
+    double mean = 0.0;
+    StatsDistribution::Iterator *it;
+    for (it = sketch.getIterator(); !it->isDone(); it->advance()) {
+        mean += it->value() * it->probability();
+    }
+    sketch.finishIterator(it);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.49995, mean, 1e-9);
+}
+
+void
+StatsDistributionTest::testSketchMergeAndResize()
+{
+    StatsDistributionTDigest low(30), high(30);
+    vector<double> samples = shuffled_unit_samples(2000);
+    for (double sample : samples) {
+        if (sample < 0.5) {
+            low.addValue(sample);
+        } else {
+            high.addValue(sample);
+        }
+    }
+    low.merge(high);
+    CPPUNIT_ASSERT(low.totalCount() <= 30);
+    sanityCheckPDF(&low);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5, low.quantile(0.5), 0.03);
+
+    low.setMaxCentroids(10);
+    CPPUNIT_ASSERT(low.totalCount() <= 10);
+    sanityCheckPDF(&low);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5, low.quantile(0.5), 0.06);
+}
+
+void
+StatsDistributionTest::testSketchSaveRestore()
+{
+    StatsDistributionTDigest sketch(20);
+    for (double sample : shuffled_unit_samples(500)) {
+        sketch.addValue(sample);
+    }
+
+    char filename[] = "/tmp/sketch_test_XXXXXX";
+    int fd = mkstemp(filename);
+    CPPUNIT_ASSERT(fd >= 0);
+    close(fd);
+    {
+        ofstream out(filename);
+        sketch.appendToFile("estimator", out);
+    }
+
+    StatsDistributionTDigest restored(20);
+    string name;
+    {
+        ifstream in(filename);
+        name = restored.restoreFromFile(in);
+    }
+    unlink(filename);
+    CPPUNIT_ASSERT_EQUAL(string("estimator"), name);
+
+    CPPUNIT_ASSERT_EQUAL(sketch.totalCount(), restored.totalCount());
+    StatsDistribution::Iterator *it = sketch.getIterator();
+    StatsDistribution::Iterator *restored_it = restored.getIterator();
+    for (; !it->isDone(); it->advance(), restored_it->advance()) {
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(it->value(), restored_it->value(), 1e-12);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(it->probability(), restored_it->probability(), 1e-12);
+    }
+    sketch.finishIterator(it);
+    restored.finishIterator(restored_it);
+}
+
+static vector<double>
+distribution_values(StatsDistribution *dist)
+{
+    vector<double> values;
+    StatsDistribution::Iterator *it = dist->getIterator();
+    for (; !it->isDone(); it->advance()) {
+        values.push_back(it->value());
+    }
+    dist->finishIterator(it);
+    return values;
+}
+
+static SampleRetention
+make_retention(instruments_sample_retention_t policy, size_t max_samples, double max_age_seconds)
+{
+    SampleRetention retention;
+    retention.policy = policy;
+    retention.max_samples = max_samples;
+    retention.max_age_seconds = max_age_seconds;
+    return retention;
+}
+
+void
+StatsDistributionTest::testSlidingWindowRetention()
+{
+    StatsDistributionAllSamples dist;
+    for (int i = 0; i < 10; ++i) {
+        dist.addValue(i);
+    }
+    CPPUNIT_ASSERT_EQUAL(10, dist.totalCount());
+
+    // shrinking the window drops the oldest samples right away.
+    dist.setRetention(make_retention(INSTRUMENTS_RETAIN_SLIDING_WINDOW, 4, 0.0));
+    vector<double> expected = { 6.0, 7.0, 8.0, 9.0 };
+    CPPUNIT_ASSERT(expected == distribution_values(&dist));
+
+    for (int i = 10; i < 1000; ++i) {
+        dist.addValue(i);
+    }
+    expected = { 996.0, 997.0, 998.0, 999.0 };
+    CPPUNIT_ASSERT(expected == distribution_values(&dist));
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.25, dist.probabilityAtPosition(0), 1e-12);
+}
+
+void
+StatsDistributionTest::testReservoirRetention()
+{
+    const size_t max_samples = 100;
+    const int num_samples = 100000;
+    StatsDistributionAllSamples dist;
+    dist.setRetention(make_retention(INSTRUMENTS_RETAIN_RESERVOIR, max_samples, 0.0));
+    for (int i = 0; i < num_samples; ++i) {
+        dist.addValue(i);
+    }
+
+    // a uniform sample of all of them, not just the newest.
+    vector<double> values = distribution_values(&dist);
+    CPPUNIT_ASSERT_EQUAL(max_samples, values.size());
+    double sum = 0.0;
+    for (double value : values) {
+        sum += value;
+    }
+    double mean = sum / values.size();
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(num_samples / 2.0, mean, num_samples * 0.1);
+    CPPUNIT_ASSERT(*std::min_element(values.begin(), values.end()) < num_samples / 4);
+}
+
+void
+StatsDistributionTest::testMaxAgeRetention()
+{
+    StatsDistributionAllSamples dist;
+    dist.setRetention(make_retention(INSTRUMENTS_RETAIN_MAX_AGE, 0, 10.0));
+    for (int i = 0; i < 30; ++i) {
+        dist.addValue(i, 1000.0 + i);
+    }
+    // samples more than 10 seconds older than the newest are gone.
+    vector<double> values = distribution_values(&dist);
+    CPPUNIT_ASSERT_EQUAL((size_t) 11, values.size());
+    CPPUNIT_ASSERT_EQUAL(19.0, values.front());
+    CPPUNIT_ASSERT_EQUAL(29.0, values.back());
+
+    // the newest sample stays, however old.
+    dist.addValue(-1.0, 2000.0);
+    CPPUNIT_ASSERT_EQUAL(1, dist.totalCount());
+
+    // with a count limit, too.
+    dist.setRetention(make_retention(INSTRUMENTS_RETAIN_MAX_AGE, 3, 10.0));
+    for (int i = 0; i < 5; ++i) {
+        dist.addValue(i, 2001.0);
+    }
+    vector<double> expected = { 2.0, 3.0, 4.0 };
+    CPPUNIT_ASSERT(expected == distribution_values(&dist));
+}
+
+static StatsDistributionAllSamples *
+save_and_restore(StatsDistributionAllSamples *dist, string& name)
+{
+    char filename[] = "/tmp/retention_test_XXXXXX";
+    int fd = mkstemp(filename);
+    CPPUNIT_ASSERT(fd >= 0);
+    close(fd);
+    {
+        ofstream out(filename);
+        dist->appendToFile("estimator", out);
+    }
+
+    StatsDistributionAllSamples *restored = new StatsDistributionAllSamples;
+    {
+        ifstream in(filename);
+        name = restored->restoreFromFile(in);
+    }
+    unlink(filename);
+    return restored;
+}
+
+void
+StatsDistributionTest::testRetentionSaveRestore()
+{
+    // a far-future age limit, so restoring doesn't expire anything.
+    SampleRetention policies[] = {
+        make_retention(INSTRUMENTS_RETAIN_ALL_SAMPLES, 0, 0.0),
+        make_retention(INSTRUMENTS_RETAIN_SLIDING_WINDOW, 8, 0.0),
+        make_retention(INSTRUMENTS_RETAIN_RESERVOIR, 8, 0.0),
+        make_retention(INSTRUMENTS_RETAIN_MAX_AGE, 8, 1e12),
+    };
+    for (const SampleRetention& retention : policies) {
+        StatsDistributionAllSamples dist;
+        dist.setRetention(retention);
+        for (int i = 0; i < 20; ++i) {
+            dist.addValue(i * 0.5);
+        }
+
+        string name;
+        StatsDistributionAllSamples *restored = save_and_restore(&dist, name);
+        CPPUNIT_ASSERT_EQUAL(string("estimator"), name);
+        CPPUNIT_ASSERT(retention == restored->getRetention());
+        CPPUNIT_ASSERT(distribution_values(&dist) == distribution_values(restored));
+
+        // the restored policy keeps applying.
+        for (int i = 0; i < 20; ++i) {
+            restored->addValue(100.0 + i);
+        }
+        size_t expected_count = (retention.keepsAllSamples() ? 40 : 8);
+        CPPUNIT_ASSERT_EQUAL((int) expected_count, restored->totalCount());
+        delete restored;
+    }
+
+    // a sketch can read the samples, whatever their policy.
+    StatsDistributionAllSamples dist;
+    dist.setRetention(make_retention(INSTRUMENTS_RETAIN_MAX_AGE, 0, 1e12));
+    dist.addValue(1.0);
+    dist.addValue(2.0);
+    char filename[] = "/tmp/retention_test_XXXXXX";
+    int fd = mkstemp(filename);
+    CPPUNIT_ASSERT(fd >= 0);
+    close(fd);
+    {
+        ofstream out(filename);
+        dist.appendToFile("estimator", out);
+    }
+    StatsDistributionTDigest sketch;
+    string name;
+    {
+        ifstream in(filename);
+        name = sketch.restoreFromFile(in);
+    }
+    unlink(filename);
+    CPPUNIT_ASSERT_EQUAL(string("estimator"), name);
+    vector<double> expected = { 1.0, 2.0 };
+    CPPUNIT_ASSERT(expected == distribution_values(&sketch));
+}
+
+void
+StatsDistributionTest::testIteratorProbabilities()
+{
+    using instruments::MAX_SAMPLES;
+    StatsDistributionAllSamples weighted(true);
+    for (size_t i = 0; i < 3 * MAX_SAMPLES; ++i) {
+        weighted.addValue(i);
+
+        size_t count = std::min(i + 1, MAX_SAMPLES);
+        StatsDistribution::Iterator *it = weighted.getIterator();
+        CPPUNIT_ASSERT_EQUAL((int) count, it->totalCount());
+        double sum = 0.0;
+        for (size_t pos = 0; pos < count; ++pos) {
+            double weight = instruments::calculate_normalized_sample_weight(pos, count);
+            double expected = instruments::calculate_weighted_probability(count, weight);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, it->probability(pos), 1e-15);
+            CPPUNIT_ASSERT_EQUAL(double(i + 1 - count + pos), it->at(pos));
+            sum += it->probability(pos);
+        }
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, sum, 1e-9);
+        weighted.finishIterator(it);
+    }
+
+    // a reused iterator sees the samples added since.
+    StatsDistributionAllSamples unweighted;
+    unweighted.addValue(1.0);
+    StatsDistribution::Iterator *first = unweighted.getIterator();
+    StatsDistribution::Iterator *second = unweighted.getIterator();
+    CPPUNIT_ASSERT_EQUAL(1.0, first->probability(0));
+    unweighted.finishIterator(first);
+    unweighted.finishIterator(second);
+
+    unweighted.addValue(2.0);
+    StatsDistribution::Iterator *it = unweighted.getIterator();
+    CPPUNIT_ASSERT_EQUAL(2, it->totalCount());
+    CPPUNIT_ASSERT_EQUAL(0.5, it->probability(1));
+    CPPUNIT_ASSERT_EQUAL(2.0, it->at(1));
+    unweighted.finishIterator(it);
+}
@@ -14,6 +14,17 @@ class StatsDistributionTest : public CppUnit::TestFixture {
     CPPUNIT_TEST(testHistogramWithKnownBinsExplicit);
     CPPUNIT_TEST(testHistogramWithKnownBinsRange);
     CPPUNIT_TEST(testBinnedWeightedSamples);
+    CPPUNIT_TEST(testHistogramBreaks);
+    CPPUNIT_TEST(testAutomaticBins);
+    CPPUNIT_TEST(testSketchSmallSamplesAreExact);
+    CPPUNIT_TEST(testSketchIsBounded);
+    CPPUNIT_TEST(testSketchMergeAndResize);
+    CPPUNIT_TEST(testSketchSaveRestore);
+    CPPUNIT_TEST(testSlidingWindowRetention);
+    CPPUNIT_TEST(testReservoirRetention);
+    CPPUNIT_TEST(testMaxAgeRetention);
+    CPPUNIT_TEST(testRetentionSaveRestore);
+    CPPUNIT_TEST(testIteratorProbabilities);
     CPPUNIT_TEST_SUITE_END();
 
   public:
@@ -22,6 +33,17 @@ class StatsDistributionTest : public CppUnit::TestFixture {
     void testHistogramWithKnownBinsExplicit();
     void testHistogramWithKnownBinsRange();
     void testBinnedWeightedSamples();
+    void testHistogramBreaks();
+    void testAutomaticBins();
+    void testSketchSmallSamplesAreExact();
+    void testSketchIsBounded();
+    void testSketchMergeAndResize();
+    void testSketchSaveRestore();
+    void testSlidingWindowRetention();
+    void testReservoirRetention();
+    void testMaxAgeRetention();
+    void testRetentionSaveRestore();
+    void testIteratorProbabilities();
     
   private:
     void sanityCheckPDF(StatsDistribution *dist);
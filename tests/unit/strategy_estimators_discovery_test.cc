@@ -48,6 +48,16 @@ double eval_fn_with_all_estimators_two_steps(instruments_context_t ctx, void *st
     return eval_fn_estimators_range(ctx, strategy_arg, first, last);
 }
 
+double eval_fn_with_first_estimator(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    return eval_fn_estimators_range(ctx, strategy_arg, 0, 0);
+}
+
+double eval_fn_with_other_estimators(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
+{
+    return eval_fn_estimators_range(ctx, strategy_arg, 1, NUM_ESTIMATORS - 1);
+}
+
 double eval_fn_no_estimators(instruments_context_t ctx, void *strategy_arg, void *chooser_arg)
 {
     return 0.0;
@@ -115,3 +125,37 @@ void StrategyEstimatorsDiscoveryTest::testEstimatorsDiscoveredUponLaterUse()
     }
 }
 
+
+void StrategyEstimatorsDiscoveryTest::testRedundantChildrenDisjoint()
+{
+    Estimator *estimators[NUM_ESTIMATORS];
+    for (size_t i = 0; i < NUM_ESTIMATORS; ++i) {
+        char name[64];
+        snprintf(name, 64, "estimator-%d", i);
+        estimators[i] = Estimator::create(LAST_OBSERVATION, name);
+        estimators[i]->addObservation(1.0);
+    }
+    Strategy *first = new Strategy(eval_fn_with_first_estimator, NULL, eval_fn_no_estimators,
+                                   estimators, NULL);
+    Strategy *others = new Strategy(eval_fn_with_other_estimators, NULL, eval_fn_no_estimators,
+                                    estimators, NULL);
+    Strategy *all = new Strategy(eval_fn_with_all_estimators, NULL, eval_fn_no_estimators,
+                                 estimators, NULL);
+
+    instruments_strategy_t disjoint_children[] = { first, others };
+    Strategy disjoint(disjoint_children, 2, NULL);
+    CPPUNIT_ASSERT(disjoint.childrenAreDisjoint(disjoint.getEvalFn(TIME_FN)));
+    CPPUNIT_ASSERT(disjoint.childrenAreDisjoint(disjoint.getEvalFn(DATA_FN)));
+
+    instruments_strategy_t overlapping_children[] = { first, all };
+    Strategy overlapping(overlapping_children, 2, NULL);
+    CPPUNIT_ASSERT(!overlapping.childrenAreDisjoint(overlapping.getEvalFn(TIME_FN)));
+    CPPUNIT_ASSERT(overlapping.childrenAreDisjoint(overlapping.getEvalFn(DATA_FN)));
+
+    delete all;
+    delete others;
+    delete first;
+    for (size_t i = 0; i < NUM_ESTIMATORS; ++i) {
+        delete estimators[i];
+    }
+}
@@ -8,6 +8,7 @@ class StrategyEstimatorsDiscoveryTest : public CppUnit::TestFixture {
 
     CPPUNIT_TEST_SUITE(StrategyEstimatorsDiscoveryTest);
     CPPUNIT_TEST(testEstimatorsDiscoveredAtRegistration);
+    CPPUNIT_TEST(testRedundantChildrenDisjoint);
 
     // Not running this test for now, since the use case that
     //  it tests isn't present in my applications, and catching
@@ -18,6 +19,7 @@ class StrategyEstimatorsDiscoveryTest : public CppUnit::TestFixture {
   public:
     void testEstimatorsDiscoveredAtRegistration();
     void testEstimatorsDiscoveredUponLaterUse();
+    void testRedundantChildrenDisjoint();
 };
 
 #endif
@@ -117,3 +117,49 @@ ThreadPoolTest::testTaskScheduling()
     }
     delete pool;
 }
+
+void
+ThreadPoolTest::testParallelFor()
+{
+    const size_t num_items = 100;
+    vector<int> results(num_items, 0);
+    mutex lock;
+    set<pthread_t> threads;
+
+    ThreadPool *pool = new ThreadPool(3);
+    pool->parallelFor(num_items, [&](size_t i) {
+            lock.lock();
+            threads.insert(pthread_self());
+            lock.unlock();
+
+            usleep(1000);
+            results[i] += (int) i;
+        });
+
+    // everything has finished by the time parallelFor returns
+    for (size_t i = 0; i < num_items; ++i) {
+        CPPUNIT_ASSERT_EQUAL((int) i, results[i]);
+    }
+    CPPUNIT_ASSERT_MESSAGE("Work was spread across threads", threads.size() > 1);
+    CPPUNIT_ASSERT_MESSAGE("No more than pool + caller threads", threads.size() <= 4);
+    delete pool;
+}
+
+void
+ThreadPoolTest::testNestedParallelFor()
+{
+    // a parallelFor inside a pool task must not wait on its own (busy) pool.
+    const size_t num_items = 8;
+    vector<int> results(num_items * num_items, 0);
+
+    ThreadPool *pool = new ThreadPool(2);
+    pool->parallelFor(num_items, [&](size_t i) {
+            pool->parallelFor(num_items, [&](size_t j) {
+                    results[i * num_items + j] = 1;
+                });
+        });
+    for (int result : results) {
+        CPPUNIT_ASSERT_EQUAL(1, result);
+    }
+    delete pool;
+}
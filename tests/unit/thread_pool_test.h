@@ -10,12 +10,16 @@ class ThreadPoolTest : public CppUnit::TestFixture {
     CPPUNIT_TEST(testAsynchrony);
     CPPUNIT_TEST(testThreadCount);
     CPPUNIT_TEST(testTaskScheduling);
+    CPPUNIT_TEST(testParallelFor);
+    CPPUNIT_TEST(testNestedParallelFor);
     CPPUNIT_TEST_SUITE_END();
 
   public:
     void testAsynchrony();
     void testThreadCount();
     void testTaskScheduling();
+    void testParallelFor();
+    void testNestedParallelFor();
 };
 
 #endif